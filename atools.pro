@@ -854,6 +854,7 @@ HEADERS += \
   src/fs/xp/xpdatacompiler.h \
   src/fs/xp/xpfixreader.h \
   src/fs/xp/xpholdingreader.h \
+  src/fs/xp/xplinereader.h \
   src/fs/xp/xpmorareader.h \
   src/fs/xp/xpnavreader.h \
   src/fs/xp/xpreader.h \
@@ -1002,6 +1003,7 @@ SOURCES += \
   src/fs/xp/xpdatacompiler.cpp \
   src/fs/xp/xpfixreader.cpp \
   src/fs/xp/xpholdingreader.cpp \
+  src/fs/xp/xplinereader.cpp \
   src/fs/xp/xpmorareader.cpp \
   src/fs/xp/xpnavreader.cpp \
   src/fs/xp/xpreader.cpp \
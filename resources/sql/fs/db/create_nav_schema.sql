@@ -146,6 +146,7 @@ drop table if exists ils;
 create table ils
 (
   ils_id integer primary key,
+  file_id integer,                 -- BGL or dat file of the feature - null for Navigraph
   ident varchar(5),                -- ICAO ident
   name varchar(50),
   region varchar(2),               -- ICAO two letter region identifier (always null)
@@ -199,6 +200,7 @@ create table ils
 foreign key(loc_runway_end_id) references runway_end(runway_end_id)
 );
 
+create index if not exists idx_ils_file_id on ils(file_id);
 create index if not exists idx_ils_loc_runway_end_id on ils(loc_runway_end_id);
 create index if not exists idx_ils_loc_airport_ident on ils(loc_airport_ident);
 create index if not exists idx_ils_loc_runway_name on ils(loc_runway_name);
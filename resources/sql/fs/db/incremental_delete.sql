@@ -0,0 +1,95 @@
+-- *****************************************************************************
+-- Copyright 2015-2025 Alexander Barthel alex@littlenavmap.org
+--
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+-- ****************************************************************************/
+
+-- *************************************************************
+-- Remove all content of changed and removed BGL files from a copied database
+-- for incremental updates. File ids are given in table tmp_incremental_file.
+-- *************************************************************
+
+-- Airports of changed files including all facilities and procedures --------------------
+drop table if exists tmp_incremental_airport;
+
+create table tmp_incremental_airport as
+select airport_id, ident from airport where file_id in (select file_id from tmp_incremental_file);
+
+create index if not exists idx_tmp_incremental_airport_id on tmp_incremental_airport(airport_id);
+
+-- Idents of airports needing an update of references - new airports are added after loading
+drop table if exists tmp_incremental_ident;
+
+create table tmp_incremental_ident as
+select ident from tmp_incremental_airport
+union
+select loc_airport_ident as ident from ils
+where file_id in (select file_id from tmp_incremental_file) and loc_airport_ident is not null;
+
+create index if not exists idx_tmp_incremental_ident on tmp_incremental_ident(ident);
+
+delete from com where airport_id in (select airport_id from tmp_incremental_airport);
+delete from helipad where airport_id in (select airport_id from tmp_incremental_airport);
+delete from start where airport_id in (select airport_id from tmp_incremental_airport);
+delete from apron where airport_id in (select airport_id from tmp_incremental_airport);
+delete from taxi_path where airport_id in (select airport_id from tmp_incremental_airport);
+delete from parking where airport_id in (select airport_id from tmp_incremental_airport);
+
+delete from transition_leg where transition_id in (
+  select t.transition_id from transition t
+  join approach a on t.approach_id = a.approach_id
+  where a.airport_id in (select airport_id from tmp_incremental_airport));
+
+delete from transition where approach_id in (
+  select approach_id from approach where airport_id in (select airport_id from tmp_incremental_airport));
+
+delete from approach_leg where approach_id in (
+  select approach_id from approach where airport_id in (select airport_id from tmp_incremental_airport));
+
+delete from approach where airport_id in (select airport_id from tmp_incremental_airport);
+
+delete from runway_end where runway_end_id in (
+  select primary_end_id from runway where airport_id in (select airport_id from tmp_incremental_airport)
+  union
+  select secondary_end_id from runway where airport_id in (select airport_id from tmp_incremental_airport));
+
+delete from runway where airport_id in (select airport_id from tmp_incremental_airport);
+
+delete from airport where airport_id in (select airport_id from tmp_incremental_airport);
+
+delete from airport_file where file_id in (select file_id from tmp_incremental_file);
+
+-- Navaids and boundaries ------------------------------------------------------------
+delete from waypoint where file_id in (select file_id from tmp_incremental_file);
+delete from vor where file_id in (select file_id from tmp_incremental_file);
+delete from ndb where file_id in (select file_id from tmp_incremental_file);
+delete from marker where file_id in (select file_id from tmp_incremental_file);
+delete from ils where file_id in (select file_id from tmp_incremental_file);
+delete from boundary where file_id in (select file_id from tmp_incremental_file);
+delete from nav_search where file_id in (select file_id from tmp_incremental_file);
+
+delete from bgl_file where bgl_file_id in (select file_id from tmp_incremental_file);
+
+-- Largest ids of the remaining rows. All rows with larger ids are loaded from changed files.
+drop table if exists tmp_incremental_max_id;
+
+create table tmp_incremental_max_id as
+select
+  ifnull((select max(scenery_area_id) from scenery_area), 0) as scenery_area_id,
+  ifnull((select max(airport_id) from airport), 0) as airport_id,
+  ifnull((select max(approach_id) from approach), 0) as approach_id,
+  ifnull((select max(waypoint_id) from waypoint), 0) as waypoint_id,
+  ifnull((select max(vor_id) from vor), 0) as vor_id,
+  ifnull((select max(ndb_id) from ndb), 0) as ndb_id,
+  ifnull((select max(ils_id) from ils), 0) as ils_id;
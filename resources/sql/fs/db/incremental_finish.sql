@@ -0,0 +1,114 @@
+-- *****************************************************************************
+-- Copyright 2015-2025 Alexander Barthel alex@littlenavmap.org
+--
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+-- ****************************************************************************/
+
+-- *************************************************************
+-- Finish incremental updates. Only rows loaded from changed files and rows
+-- referencing airports from changed files are updated.
+-- Replaces update_num_ils.sql and populate_nav_search.sql.
+-- *************************************************************
+
+-- Update number of ILS runway ends in changed airports ------------------
+update airport set num_runway_end_ils = (
+  select count(distinct i.loc_runway_end_id)
+  from runway r
+  join ils i on i.loc_runway_end_id = r.primary_end_id or i.loc_runway_end_id = r.secondary_end_id
+  where r.airport_id = airport.airport_id and i.gs_range is not null and i.type not in ('G', 'T') -- Only real ILS
+) where airport.ident in (select ident from tmp_incremental_ident);
+
+-- Replace changed waypoints in nav_search table ------------------
+delete from nav_search where waypoint_id in (select waypoint_id from tmp_incremental_waypoint);
+
+insert into nav_search (waypoint_id, waypoint_nav_id, file_id, ident, name, region, airport_id, airport_ident,
+  type, arinc_type, nav_type, waypoint_num_victor_airway, waypoint_num_jet_airway, scenery_local_path, bgl_filename, mag_var, lonx, laty)
+select w.waypoint_id, w.nav_id, w.file_id, w.ident, w.name, w.region, w.airport_id, a.ident as airport_ident,
+  w.type, w.arinc_type, 'W', w.num_victor_airway, w.num_jet_airway, s.local_path, f.filename, w.mag_var, w.lonx, w.laty
+from waypoint w
+join bgl_file f on f.bgl_file_id = w.file_id
+join scenery_area s on f.scenery_area_id = s.scenery_area_id
+left outer join airport a on w.airport_id = a.airport_id
+where w.artificial is null and w.waypoint_id in (select waypoint_id from tmp_incremental_waypoint);
+
+-- Replace changed NDBs in nav_search table ------------------
+delete from nav_search where ndb_id in (select ndb_id from ndb where ndb_id > (select ndb_id from tmp_incremental_max_id) or
+  airport_ident in (select ident from tmp_incremental_ident));
+
+insert into nav_search (ndb_id, file_id, airport_id, airport_ident, ident, name, region, range, type, nav_type, frequency,
+  scenery_local_path, bgl_filename, mag_var, altitude, lonx, laty)
+select n.ndb_id, n.file_id, n.airport_id, a.ident as airport_ident, n.ident, n.name, n.region, n.range, 'N' || n.type, 'N', n.frequency,
+  s.local_path, f.filename, n.mag_var, n.altitude, n.lonx, n.laty
+from ndb n
+join bgl_file f on f.bgl_file_id = n.file_id
+join scenery_area s on f.scenery_area_id = s.scenery_area_id
+left outer join airport a on n.airport_id = a.airport_id
+where n.ndb_id in (select ndb_id from ndb where ndb_id > (select ndb_id from tmp_incremental_max_id) or
+  airport_ident in (select ident from tmp_incremental_ident));
+
+-- Replace changed VORs in nav_search table ------------------
+delete from nav_search where vor_id in (select vor_id from vor where vor_id > (select vor_id from tmp_incremental_max_id) or
+  airport_ident in (select ident from tmp_incremental_ident));
+
+insert into nav_search (vor_id, file_id, airport_id, airport_ident, ident, name, region, range, type, nav_type, frequency, channel,
+  scenery_local_path, bgl_filename, mag_var, altitude, lonx, laty)
+select v.vor_id, v.file_id, v.airport_id, a.ident as airport_ident, v.ident, v.name, v.region, v.range,
+  case
+    when v.type = 'VTH' or v.type = 'H' then 'VH'              -- VORTAC
+    when v.type = 'VTL' or v.type = 'L' then 'VL'              -- VORTAC
+    when v.type = 'VTT' or v.type = 'T' then 'VT'              -- VORTAC
+  else
+    v.type
+  end as type,
+  case
+    when v.type = 'TC' and dme_only = 0 then 'TC'              -- TACAN
+    when v.type = 'TC' and dme_only = 1 then 'TCD'             -- TACAN DME only
+    when v.type like 'VT%' and dme_only = 0 then 'VT'          -- VORTAC
+    when v.type like 'VT%' and dme_only = 1 then 'VTD'         -- VORTAC DME only
+    when dme_only = 1 then 'D'                                 -- DME
+    when dme_only = 0 and dme_altitude is not null then 'VD'   -- VORDME
+    when dme_only = 0 and dme_altitude is null then 'V'        -- VOR
+  else
+    'U'
+  end as nav_type,
+  v.frequency * 10 as frequency,
+  v.channel,
+  s.local_path, f.filename, v.mag_var, v.altitude, v.lonx, v.laty
+from vor v
+join bgl_file f on f.bgl_file_id = v.file_id
+join scenery_area s on f.scenery_area_id = s.scenery_area_id
+left outer join airport a on v.airport_id = a.airport_id
+where v.vor_id in (select vor_id from vor where vor_id > (select vor_id from tmp_incremental_max_id) or
+  airport_ident in (select ident from tmp_incremental_ident));
+
+-- Scenery areas ------------------
+-- Areas of changed files were written again - move files back to the existing area
+update bgl_file set scenery_area_id = (
+  select min(s2.scenery_area_id) from scenery_area s1
+  join scenery_area s2 on s1.layer = s2.layer and s1.local_path is s2.local_path
+  where s1.scenery_area_id = bgl_file.scenery_area_id
+) where bgl_file.scenery_area_id > (select scenery_area_id from tmp_incremental_max_id);
+
+delete from scenery_area
+where scenery_area_id > (select scenery_area_id from tmp_incremental_max_id) and
+  exists (select 1 from scenery_area s2
+          where s2.layer = scenery_area.layer and s2.local_path is scenery_area.local_path and
+          s2.scenery_area_id < scenery_area.scenery_area_id);
+
+drop table if exists tmp_incremental_file;
+drop table if exists tmp_incremental_airport;
+drop table if exists tmp_incremental_ident;
+drop table if exists tmp_incremental_waypoint;
+drop table if exists tmp_incremental_ils;
+drop table if exists tmp_incremental_max_id;
@@ -0,0 +1,117 @@
+-- *****************************************************************************
+-- Copyright 2015-2025 Alexander Barthel alex@littlenavmap.org
+--
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+-- ****************************************************************************/
+
+-- *************************************************************
+-- Update references for incremental updates. Only rows loaded from changed files and rows
+-- referencing airports from changed files are updated.
+-- Replaces update_wp_ids.sql, update_nav_ids.sql, update_approaches.sql and update_airport.sql.
+-- *************************************************************
+
+-- Add idents of airports loaded from changed files
+insert into tmp_incremental_ident (ident)
+select ident from airport
+where airport_id > (select airport_id from tmp_incremental_max_id) and
+  ident not in (select ident from tmp_incremental_ident);
+
+-- Waypoints which are new or lost their navaid or airport references ---------------------
+drop table if exists tmp_incremental_waypoint;
+
+create table tmp_incremental_waypoint as
+select waypoint_id from waypoint
+where waypoint_id > (select waypoint_id from tmp_incremental_max_id) or
+  airport_ident in (select ident from tmp_incremental_ident) or
+  (type = 'V' and (nav_id is null or nav_id not in (select vor_id from vor))) or
+  (type = 'N' and (nav_id is null or nav_id not in (select ndb_id from ndb)));
+
+create index if not exists idx_tmp_incremental_waypoint_id on tmp_incremental_waypoint(waypoint_id);
+
+-- Update navigation references for waypoint -------------------
+update waypoint set nav_id =
+(
+  select v.vor_id
+  from vor v
+  where waypoint.type = 'V' and waypoint.ident = v.ident and waypoint.region = v.region and
+  (abs(v.lonx - waypoint.lonx) + abs(v.laty - waypoint.laty)) < 0.01
+)
+where waypoint.type = 'V' and waypoint.waypoint_id in (select waypoint_id from tmp_incremental_waypoint);
+
+update waypoint set nav_id =
+(
+  select n.ndb_id
+  from ndb n
+  where waypoint.type = 'N' and waypoint.ident = n.ident and waypoint.region = n.region and
+  (abs(n.lonx - waypoint.lonx) + abs(n.laty - waypoint.laty)) < 0.01
+)
+where waypoint.type = 'N' and waypoint.waypoint_id in (select waypoint_id from tmp_incremental_waypoint);
+
+-- Airways are not changed in incremental updates - update counts for new waypoints only
+update waypoint set num_victor_airway = (
+select count(1) from airway ap
+where (ap.from_waypoint_id = waypoint.waypoint_id or ap.to_waypoint_id = waypoint.waypoint_id) and
+       ap.airway_type in ('V', 'B'))
+where waypoint.waypoint_id > (select waypoint_id from tmp_incremental_max_id);
+
+update waypoint set num_jet_airway = (
+select count(1) from airway ap
+where (ap.from_waypoint_id = waypoint.waypoint_id or ap.to_waypoint_id = waypoint.waypoint_id) and
+       ap.airway_type in ('J', 'B'))
+where waypoint.waypoint_id > (select waypoint_id from tmp_incremental_max_id);
+
+-- Update airport references for navaids -------------------
+update waypoint set airport_id = (
+  select a.airport_id from airport a where waypoint.airport_ident = a.ident
+) where waypoint.waypoint_id in (select waypoint_id from tmp_incremental_waypoint);
+
+update ndb set airport_id = (
+  select a.airport_id from airport a where ndb.airport_ident = a.ident
+) where ndb.ndb_id > (select ndb_id from tmp_incremental_max_id) or
+  ndb.airport_ident in (select ident from tmp_incremental_ident);
+
+update vor set airport_id = (
+  select a.airport_id from airport a where vor.airport_ident = a.ident
+) where vor.vor_id > (select vor_id from tmp_incremental_max_id) or
+  vor.airport_ident in (select ident from tmp_incremental_ident);
+
+-- Update runway references for new approaches where missing -------------------
+update approach set runway_end_id = (
+  select runway_end_id
+  from airport a
+  join runway r on r.airport_id = a.airport_id
+  join runway_end e on r.primary_end_id = e.runway_end_id
+  where e.name = approach.runway_name and a.ident = approach.airport_ident
+) where approach.runway_end_id is null and approach.approach_id > (select approach_id from tmp_incremental_max_id);
+
+update approach set runway_end_id = (
+  select runway_end_id
+  from airport a
+  join runway r on r.airport_id = a.airport_id
+  join runway_end e on r.secondary_end_id = e.runway_end_id
+  where e.name = approach.runway_name and a.ident = approach.airport_ident
+) where approach.runway_end_id is null and approach.approach_id > (select approach_id from tmp_incremental_max_id);
+
+-- Update region of new airports -------------------
+update airport set region = (
+  select w.region from waypoint w where airport.airport_id = w.airport_id)
+where airport.region is null and airport.airport_id > (select airport_id from tmp_incremental_max_id);
+
+update airport set region = (
+  select v.region from vor v where airport.airport_id = v.airport_id)
+where airport.region is null and airport.airport_id > (select airport_id from tmp_incremental_max_id);
+
+update airport set region = (
+  select n.region from ndb n where airport.airport_id = n.airport_id)
+where airport.region is null and airport.airport_id > (select airport_id from tmp_incremental_max_id);
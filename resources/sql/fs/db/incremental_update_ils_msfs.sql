@@ -0,0 +1,56 @@
+-- *****************************************************************************
+-- Copyright 2015-2025 Alexander Barthel alex@littlenavmap.org
+--
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+-- ****************************************************************************/
+
+-- *************************************************************
+-- Update ILS runway ids for incremental updates - only MSFS
+-- Same as update_airport_ils_msfs.sql but limited to changed ILS and airports
+-- *************************************************************
+
+-- ILS which are new, not assigned or belong to airports from changed files
+drop table if exists tmp_incremental_ils;
+
+create table tmp_incremental_ils as
+select ils_id from ils
+where ils_id > (select ils_id from tmp_incremental_max_id) or loc_runway_end_id is null or
+  loc_airport_ident in (select ident from tmp_incremental_ident);
+
+create index if not exists idx_tmp_incremental_ils_id on tmp_incremental_ils(ils_id);
+
+-- loc_runway_name and loc_airport_ident are set in IlsWriter. Runway ends of changed airports got new ids.
+update ils set loc_runway_end_id = null where ils.ils_id in (select ils_id from tmp_incremental_ils);
+
+update ils set loc_runway_end_id = (
+  select runway_end_id
+  from runway_end e
+  join runway r on e.runway_end_id = r.primary_end_id
+  join airport a on r.airport_id = a.airport_id
+  where e.name = ils.loc_runway_name and a.ident = ils.loc_airport_ident
+) where loc_runway_end_id is null and ils.ils_id in (select ils_id from tmp_incremental_ils);
+
+update ils set loc_runway_end_id = (
+  select runway_end_id
+  from runway_end e
+  join runway r on e.runway_end_id = r.secondary_end_id
+  join airport a on r.airport_id = a.airport_id
+  where e.name = ils.loc_runway_name and a.ident = ils.loc_airport_ident
+) where loc_runway_end_id is null and ils.ils_id in (select ils_id from tmp_incremental_ils);
+
+-- Airports of updated ILS need a new ILS count
+insert into tmp_incremental_ident (ident)
+select distinct loc_airport_ident from ils
+where ils_id in (select ils_id from tmp_incremental_ils) and loc_airport_ident is not null and
+  loc_airport_ident not in (select ident from tmp_incremental_ident);
@@ -79,7 +79,8 @@ CREATE TABLE undo_data
   description varchar(2048) collate nocase,
   flightplan blob,
   aircraft_perf blob,
-  aircraft_trail blob
+  aircraft_trail blob,
+  aircraft_trail_bin blob
 );
 
 create index if not exists  idx_undo_data_id on undo_data(undo_data_id);
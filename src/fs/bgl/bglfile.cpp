@@ -72,32 +72,49 @@ void BglFile::readFile(const QString& filenameParam, const atools::fs::scenery::
 
   if(file.open(QIODevice::ReadOnly))
   {
-    BinaryStream stream(&file);
+    // Read fields directly from memory instead of going through QDataStream
+    uchar *data = options->isBglStreamReader() ? nullptr : file.map(0, file.size());
 
-    size = stream.getFileSize();
+    if(data != nullptr)
+    {
+      BinaryStream stream(reinterpret_cast<const char *>(data), file.size(), filename);
+      readStream(&stream, area);
+      file.unmap(data);
+    }
+    else
+    {
+      // Fall back to stream if mapping is not supported
+      BinaryStream stream(&file);
+      readStream(&stream, area);
+    }
+
+    file.close();
+  }
+}
 
-    readHeader(&stream);
-    if(!header.isValid())
-      // Skip any obscure BGL files that do not contain a section structure or are too small
-      return;
+void BglFile::readStream(BinaryStream *bs, const scenery::SceneryArea& area)
+{
+  size = bs->getFileSize();
 
-    readSections(&stream);
+  readHeader(bs);
+  if(!header.isValid())
+    // Skip any obscure BGL files that do not contain a section structure or are too small
+    return;
 
-    if(options->isIncludedNavDbObject(type::BOUNDARY) && !area.isMsfsNavigraphNavdata())
-      readBoundaryRecords(&stream);
+  readSections(bs);
 
-    readRecords(&stream, area);
+  if(options->isIncludedNavDbObject(type::BOUNDARY) && !area.isMsfsNavigraphNavdata())
+    readBoundaryRecords(bs);
 
-    file.close();
-  }
+  readRecords(bs, area);
 }
 
-bool BglFile::isValid()
+bool BglFile::isValid() const
 {
   return header.isValid();
 }
 
-bool BglFile::hasContent()
+bool BglFile::hasContent() const
 {
   return !(airports.isEmpty() &&
            namelists.isEmpty() &&
@@ -90,7 +90,7 @@ public:
 
   /*
    * Reads the full content of the BGL file into the internal lists including header, sections,
-   * airports and so on.
+   * airports and so on. The file is memory mapped unless disabled in options.
    * @param file BGL filename
    */
   void readFile(const QString& filenameParam, const scenery::SceneryArea& area);
@@ -161,15 +161,18 @@ public:
   /*
    * @return true if any relevant content is available. Header and sections do not count.
    */
-  bool hasContent();
+  bool hasContent() const;
 
   /*
    * @return true if header and section structure is valid
    */
-  bool isValid();
+  bool isValid() const;
 
 private:
   void deleteAllObjects();
+
+  /* Read header, sections and records from file or memory stream */
+  void readStream(atools::io::BinaryStream *bs, const atools::fs::scenery::SceneryArea& area);
   void readHeader(atools::io::BinaryStream *bs);
   void readSections(atools::io::BinaryStream *bs);
 
@@ -120,6 +120,7 @@ GlobeReader::GlobeReader(const QString& dataDirParam)
 {
   // Fill lists with empty values
   dataFiles.fill(nullptr, NUM_DATAFILES);
+  dataMapped.fill(nullptr, NUM_DATAFILES);
   dataFilenames.fill(QStringLiteral(), NUM_DATAFILES);
 }
 
@@ -171,9 +172,32 @@ bool GlobeReader::openFiles()
     else
       qWarning() << "Found invalid file" << fileEntry.filePath();
   }
+
+  if(memoryMapped)
+  {
+    // Map all available files now - pages are read on demand
+    for(int i = 0; i < NUM_DATAFILES; i++)
+      mapFile(i);
+  }
   return true;
 }
 
+void GlobeReader::mapFile(int i)
+{
+  if(dataFilenames.at(i).isEmpty() || dataMapped.at(i) != nullptr)
+    return;
+
+  openFile(i);
+  QFile *dataFile = dataFiles.at(i);
+  if(dataFile != nullptr)
+  {
+    dataMapped[i] = dataFile->map(0, dataFile->size());
+    if(dataMapped.at(i) == nullptr)
+      // Fall back to reading file into cache
+      qWarning() << Q_FUNC_INFO << "Cannot map" << dataFile->fileName() << dataFile->errorString();
+  }
+}
+
 void GlobeReader::openFile(int i)
 {
   if(atools::inRange(dataFilenames, i))
@@ -201,6 +225,12 @@ void GlobeReader::closeFile(int i)
 {
   if(dataFiles[i] != nullptr)
   {
+    if(dataMapped.at(i) != nullptr)
+    {
+      dataFiles[i]->unmap(const_cast<uchar *>(dataMapped.at(i)));
+      dataMapped[i] = nullptr;
+    }
+
     dataFiles[i]->close();
     delete dataFiles[i];
     dataFiles[i] = nullptr;
@@ -350,6 +380,39 @@ void GlobeReader::getElevations(atools::geo::LineString& elevations, const atool
   }
 }
 
+void GlobeReader::getElevations(QList<float>& elevations, const atools::geo::LineString& positions,
+                                float sampleRadiusMeter)
+{
+  elevations.clear();
+  if(!valid)
+  {
+    elevations.fill(ELEVATION_INVALID, positions.size());
+    return;
+  }
+
+  elevations.reserve(positions.size());
+  if(sampleRadiusMeter < 0.001f)
+  {
+    // Fast path reading single samples without probe rectangles ===============
+    int fileIndex, fileOffset;
+    for(const Pos& pos : positions)
+    {
+      if(pos.isValid())
+      {
+        fileOffset = calcFileOffset(pos.getLonX(), pos.getLatY(), fileIndex);
+        elevations.append(elevationFromIndexAndOffset(fileIndex, fileOffset));
+      }
+      else
+        elevations.append(ELEVATION_INVALID);
+    }
+  }
+  else
+  {
+    for(const Pos& pos : positions)
+      elevations.append(getElevation(pos, sampleRadiusMeter));
+  }
+}
+
 void GlobeReader::setCacheMaxBytes(qsizetype maxBytes)
 {
   fileCache.setMaxCost(std::min(maxBytes, FILE_SIZE_LARGE * 2L));
@@ -360,23 +423,30 @@ void GlobeReader::clearCache()
   fileCache.clear();
 }
 
+inline float bytesToElevation(const uchar *data, int fileOffset)
+{
+  // LittleEndian
+  unsigned short e0 = (static_cast<unsigned short>(data[fileOffset])) & 0xff;
+  unsigned short e1 = (static_cast<unsigned short>(data[fileOffset + 1]) << 8) & 0xff00;
+
+  return static_cast<float>(static_cast<qint16>(e0 | e1));
+}
+
 inline float fileBytesToElevation(QByteArray *fileBytes, int fileOffset)
 {
   if(fileBytes != nullptr && !fileBytes->isEmpty())
-  {
-    // LittleEndian
-    const char *data = fileBytes->constData();
-    unsigned short e0 = (static_cast<unsigned short>(data[fileOffset])) & 0xff;
-    unsigned short e1 = (static_cast<unsigned short>(data[fileOffset + 1]) << 8) & 0xff00;
-
-    return static_cast<float>(static_cast<qint16>(e0 | e1));
-  }
+    return bytesToElevation(reinterpret_cast<const uchar *>(fileBytes->constData()), fileOffset);
   else
     return ELEVATION_INVALID;
 }
 
 float GlobeReader::elevationFromIndexAndOffset(int fileIndex, int fileOffset)
 {
+  // Read directly from mapped file if available ===============
+  const uchar *mapped = dataMapped.at(fileIndex);
+  if(mapped != nullptr)
+    return bytesToElevation(mapped, fileOffset);
+
   float elevation = ELEVATION_INVALID;
   QByteArray *fileBytes = fileCache.object(fileIndex);
   if(fileBytes != nullptr)
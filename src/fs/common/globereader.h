@@ -75,6 +75,10 @@ public:
   void getElevations(geo::LineString& elevations, const atools::geo::LineString& linestring, float sampleRadiusMeter = 0.f,
                      bool precision = false);
 
+  /* Get elevations in meter for all positions in one call. elevations has the same size and order as positions.
+   * Unlike the method above no points are added or removed. */
+  void getElevations(QList<float>& elevations, const atools::geo::LineString& positions, float sampleRadiusMeter = 0.f);
+
   /* true if folder exists and files were found */
   bool isValid() const
   {
@@ -87,6 +91,19 @@ public:
   /* Clear memory cache */
   void clearCache();
 
+  /* Map all files read-only into memory instead of reading them completely into the cache.
+   * Samples are read directly from the mapping and pages are loaded by the operating system on demand.
+   * The cache size is not used in this mode. Call before openFiles(). Default is false. */
+  void setMemoryMapped(bool value)
+  {
+    memoryMapped = value;
+  }
+
+  bool isMemoryMapped() const
+  {
+    return memoryMapped;
+  }
+
 private:
   friend class ::DtmTest;
   friend int calcFileOffsetFromColRow(int gridCol, int gridRow, int& fileIndex);
@@ -109,6 +126,7 @@ private:
   static bool fileEntryValid(const QFileInfo& fileEntry);
   void closeFile(int i);
   void openFile(int i);
+  void mapFile(int i);
   float elevationFromIndexAndOffset(int fileIndex, int fileOffset);
   float elevationMax(const atools::geo::Pos& pos, float sampleRadiusMeter);
 
@@ -120,6 +138,10 @@ private:
   QList<QString> dataFilenames;
   QList<QFile *> dataFiles;
 
+  /* Pointers to memory mapped files or null if not mapped. */
+  QList<const uchar *> dataMapped;
+  bool memoryMapped = false;
+
   bool valid = false;
 };
 
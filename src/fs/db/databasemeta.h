@@ -33,6 +33,15 @@ namespace fs {
 namespace db {
 
 const static QLatin1String PROPERTYNAME_MSFS_NAVIGRAPH_FOUND("NavigraphUpdate");
+
+/* Hash over all scenery files and options used for incremental compilation */
+const static QLatin1String PROPERTYNAME_SCENERY_FINGERPRINT("SceneryFingerprint");
+
+/* Hash over options and versions only */
+const static QLatin1String PROPERTYNAME_SCENERY_OPTIONS_FINGERPRINT("SceneryOptionsFingerprint");
+
+/* Space separated hashes for each scenery area in load order */
+const static QLatin1String PROPERTYNAME_SCENERY_AREA_FINGERPRINTS("SceneryAreaFingerprints");
 /*
  * Maintains versions and load time for a navdatabases
  */
@@ -280,11 +289,12 @@ private:
    *    Tables "airport_medium", "airport_large", "route_node_radio", "route_edge_radio", "route_node_airway" and
    *    "route_edge_airway" removed for good.
    *    View creation now disabled.
+   * 30 Added column "file_id" to table "ils" to allow incremental updates.
    *
    *
    * VERSION_NUMBER_TODO update database version
    */
-  static const int DB_VERSION_MINOR = 29;
+  static const int DB_VERSION_MINOR = 30;
 
   /* Additionally checking for last schema change using minor version to avoid user. Usually version of last version change. */
   static const int DB_VERSION_MINOR_OUTDATED = 24;
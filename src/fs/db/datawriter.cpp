@@ -24,6 +24,7 @@
 #include "fs/scenery/materiallib.h"
 #include "fs/navdatabaseoptions.h"
 #include "sql/sqldatabase.h"
+#include "sql/sqlutil.h"
 #include "fs/db/nav/waypointwriter.h"
 #include "fs/db/nav/airwaysegmentwriter.h"
 #include "fs/db/nav/vorwriter.h"
@@ -61,7 +62,12 @@
 #include "exception.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+
+#include <deque>
 
 namespace atools {
 namespace fs {
@@ -70,6 +76,7 @@ namespace db {
 using bgl::BglFile;
 using atools::fs::common::MagDecReader;
 using atools::sql::SqlDatabase;
+using atools::sql::SqlUtil;
 using scenery::SceneryArea;
 using atools::fs::bgl::section::SectionType;
 
@@ -116,6 +123,14 @@ DataWriter::DataWriter(SqlDatabase& sqlDb, const NavDatabaseOptions& opts, atool
 
   runwayIndex = new RunwayIndex();
   magDecReader = new MagDecReader();
+
+  int threads = options.getCompileThreads() > 0 ? options.getCompileThreads() : QThread::idealThreadCount();
+  if(threads > 1)
+  {
+    qInfo() << Q_FUNC_INFO << "Reading BGL files using" << threads << "threads";
+    threadPool = new QThreadPool;
+    threadPool->setMaxThreadCount(threads);
+  }
 }
 
 DataWriter::~DataWriter()
@@ -125,6 +140,10 @@ DataWriter::~DataWriter()
 
 void DataWriter::close()
 {
+  if(threadPool != nullptr)
+    threadPool->waitForDone();
+  ATOOLS_DELETE(threadPool);
+
   ATOOLS_DELETE(bglFileWriter);
   ATOOLS_DELETE(sceneryAreaWriter);
   ATOOLS_DELETE(airportWriter);
@@ -181,6 +200,39 @@ QString DataWriter::getSurface(const QUuid& key)
     return QStringLiteral();
 }
 
+void DataWriter::setIdsFromDatabase()
+{
+  SqlUtil util(db);
+  bglFileWriter->setCurrentId(util.getMaxId(QStringLiteral("bgl_file")));
+  sceneryAreaWriter->setCurrentId(util.getMaxId(QStringLiteral("scenery_area")));
+
+  airportWriter->setCurrentId(util.getMaxId(QStringLiteral("airport")));
+  airportFileWriter->setCurrentId(util.getMaxId(QStringLiteral("airport_file")));
+  runwayWriter->setCurrentId(util.getMaxId(QStringLiteral("runway")));
+  runwayEndWriter->setCurrentId(util.getMaxId(QStringLiteral("runway_end")));
+  parkingWriter->setCurrentId(util.getMaxId(QStringLiteral("parking")));
+  airportComWriter->setCurrentId(util.getMaxId(QStringLiteral("com")));
+  airportHelipadWriter->setCurrentId(util.getMaxId(QStringLiteral("helipad")));
+  airportStartWriter->setCurrentId(util.getMaxId(QStringLiteral("start")));
+  airportApronWriter->setCurrentId(util.getMaxId(QStringLiteral("apron")));
+  airportTaxiPathWriter->setCurrentId(util.getMaxId(QStringLiteral("taxi_path")));
+
+  // SID and STAR writers share the ids of the approach writers
+  approachWriter->setCurrentId(util.getMaxId(QStringLiteral("approach")));
+  approachLegWriter->setCurrentId(util.getMaxId(QStringLiteral("approach_leg")));
+  approachTransWriter->setCurrentId(util.getMaxId(QStringLiteral("transition")));
+  approachTransLegWriter->setCurrentId(util.getMaxId(QStringLiteral("transition_leg")));
+
+  // TACAN writer uses the ids of the VOR writer
+  waypointWriter->setCurrentId(util.getMaxId(QStringLiteral("waypoint")));
+  airwaySegmentWriter->setCurrentId(util.getMaxId(QStringLiteral("tmp_airway_point")));
+  vorWriter->setCurrentId(util.getMaxId(QStringLiteral("vor")));
+  ndbWriter->setCurrentId(util.getMaxId(QStringLiteral("ndb")));
+  markerWriter->setCurrentId(util.getMaxId(QStringLiteral("marker")));
+  ilsWriter->setCurrentId(util.getMaxId(QStringLiteral("ils")));
+  boundaryWriter->setCurrentId(util.getMaxId(QStringLiteral("boundary")));
+}
+
 int DataWriter::getNextSceneryId() const
 {
   return sceneryAreaWriter->getNextId();
@@ -204,7 +256,7 @@ QString DataWriter::getLanguage(const QString& key)
     return key;
 }
 
-void DataWriter::writeSceneryArea(const SceneryArea& area)
+void DataWriter::writeSceneryArea(const SceneryArea& area, const QSet<QString>& filter)
 {
   QStringList filepaths, filenames;
 
@@ -212,6 +264,18 @@ void DataWriter::writeSceneryArea(const SceneryArea& area)
   atools::fs::scenery::FileResolver resolver(options);
   resolver.getFiles(area, &filepaths, &filenames);
 
+  if(!filter.isEmpty())
+  {
+    // Keep only requested files in resolver order
+    QStringList filteredPaths;
+    for(const QString& filepath : std::as_const(filepaths))
+    {
+      if(filter.contains(atools::nativeCleanPath(filepath).toLower()))
+        filteredPaths.append(filepath);
+    }
+    filepaths = filteredPaths;
+  }
+
   if(sceneryErrors != nullptr)
     sceneryErrors->appendSceneryErrorMessages(resolver.getErrorMessages());
   progressHandler->reportErrors(resolver.getErrorMessages().size());
@@ -221,117 +285,48 @@ void DataWriter::writeSceneryArea(const SceneryArea& area)
     // Write the scenery area metadata
     sceneryAreaWriter->writeOne(area);
 
+    // Files queued for reading in the thread pool in file order
+    std::deque<std::future<BglFilePtr> > readAheadFiles;
+    int readAheadIndex = 0;
+    int readAheadMax = threadPool != nullptr ? threadPool->maxThreadCount() * 2 : 0;
+
     for(int i = 0; i < filepaths.size(); i++)
     {
-      progressHandler->setNumFiles(numFiles);
-
-      // Do not reset airport counter which was read before from MSFS 2024 SimConnect
-      progressHandler->setNumAirports(airportIdents.size());
-      progressHandler->setNumNamelists(numNamelists);
-      progressHandler->setNumVors(numVors);
-      progressHandler->setNumIls(numIls);
-      progressHandler->setNumNdbs(numNdbs);
-      progressHandler->setNumMarker(numMarker);
-      progressHandler->setNumBoundaries(numBoundaries);
-      progressHandler->setNumWaypoints(numWaypoints);
-      progressHandler->setNumObjectsWritten(numObjectsWritten);
+      updateProgressCounters();
 
       QString currentBglFilePath = filepaths.at(i);
 
       if((aborted = progressHandler->reportBglFile(currentBglFilePath)) == true)
-        return;
+        break;
+
+      // Keep the read ahead queue filled to give the pool threads work while writing
+      if(threadPool != nullptr)
+      {
+        while(readAheadIndex < filepaths.size() && readAheadIndex < i + readAheadMax)
+          readAheadFiles.push_back(readBglFileAsync(filepaths.at(readAheadIndex++), area));
+      }
 
       try
       {
         // ================================================================================
         // Read all records into a internal object tree (atools::fs::bgl namespace)
-        BglFile bglFile(&options);
-        bglFile.setSupportedSectionTypes(SUPPORTED_SECTION_TYPES);
-        bglFile.readFile(currentBglFilePath, area);
-
-        if(bglFile.hasContent() && bglFile.isValid())
+        BglFilePtr bglFile;
+        if(readAheadFiles.empty())
+          bglFile = readBglFile(currentBglFilePath, area);
+        else
         {
-          // ================================================================================
-          // Write to the database
-
-          // if(!bglFile.getHeader().hasValidMagicNumber())
-          // qWarning() << "Content in file with invalid magic number";
-
-          // Write BGL file metadata
-          bglFileWriter->writeOne(bglFile);
-
-          // Clear the indexes
-          runwayIndex->clear();
-
-          // Execution order is important due to dependencies between the writers
-          // (i.e. ILS writer looks for runway end ids)
-          // Writer also need to access the ids of their parent record objects
-          // (i.e. runway needs the current airport ID
-
-          airportWriter->setNameLists(bglFile.getNamelists());
-
-          // Write airport and all subrecords like runways, approaches, parking and so on
-          airportWriter->write(bglFile.getAirports());
-
-          airportFileWriter->write(bglFile.getAirports());
-
-          // Ignore navaids from the Navigraph update
-          if(!area.isMsfsNavigraphNavdata() && options.isIncludedNavDbObject(type::NAVAIDS))
-          {
-            // Write all navaids to the database
-            waypointWriter->write(bglFile.getWaypoints());
-            vorWriter->write(bglFile.getVors());
-            tacanWriter->write(bglFile.getTacans());
-            ndbWriter->write(bglFile.getNdbs());
-            markerWriter->write(bglFile.getMarker());
-          }
-
-          ilsWriter->write(bglFile.getIls());
-
-          if(!area.isMsfsNavigraphNavdata())
-            // Ignore boundaries from the Navigraph update
-            boundaryWriter->write(bglFile.getBoundaries());
-
-          for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
-            airportIdents.insert(ap->getIdent());
-
-          numNamelists += bglFile.getNamelists().size();
-
-          // Ignore navaids from the Navigraph update
-          if(!area.isMsfsNavigraphNavdata())
-          {
-            numVors += bglFile.getVors().size() + bglFile.getTacans().size();
-            numNdbs += bglFile.getNdbs().size();
-            numMarker += bglFile.getMarker().size();
-            numWaypoints += bglFile.getWaypoints().size();
-            numBoundaries += bglFile.getBoundaries().size();
-          }
-          numIls += bglFile.getIls().size();
-          numFiles++;
+          // Wait for the pool - rethrows exceptions from reading
+          std::future<BglFilePtr> future = std::move(readAheadFiles.front());
+          readAheadFiles.pop_front();
+          bglFile = future.get();
         }
 
-        // Print a one line short report on airports that were found in the BGL
-        if(!bglFile.getAirports().isEmpty())
-        {
-          QStringList apIcaos;
-#ifdef DEBUG_INFORMATION
-          for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
-            apIcaos.append(ap->getIdent());
-#else
-          for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
-          {
-            // Truncate at 20
-            if(apIcaos.size() < 20)
-              apIcaos.append(ap->getIdent());
-            else
-              break;
-          }
-          if(bglFile.getAirports().size() > 20)
-            apIcaos.append("...");
-#endif
-
-          qDebug() << "Found" << bglFile.getAirports().size() << "airports. idents:" << apIcaos.join(",");
-        }
+        // ================================================================================
+        // Write to the database
+        QElapsedTimer writeTimer;
+        writeTimer.start();
+        writeBglFile(*bglFile, area);
+        bglWriteTimeNs += writeTimer.nsecsElapsed();
       }
       catch(atools::Exception& e)
       {
@@ -348,10 +343,159 @@ void DataWriter::writeSceneryArea(const SceneryArea& area)
           sceneryErrors->appendFileError(SceneryFileError(currentBglFilePath, QStringLiteral()));
       }
     }
-    db.commit();
+
+    // Remaining tasks refer to area - wait until all are finished if aborted
+    if(threadPool != nullptr)
+      threadPool->waitForDone();
+
+    if(!aborted)
+    {
+      QElapsedTimer commitTimer;
+      commitTimer.start();
+      db.commit();
+      bglWriteTimeNs += commitTimer.nsecsElapsed();
+    }
   }
 }
 
+const QSet<SectionType>& DataWriter::getSupportedSectionTypes()
+{
+  return SUPPORTED_SECTION_TYPES;
+}
+
+DataWriter::BglFilePtr DataWriter::readBglFile(const QString& filepath, const SceneryArea& area) const
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  BglFilePtr bglFile(new BglFile(&options));
+  bglFile->setSupportedSectionTypes(SUPPORTED_SECTION_TYPES);
+  bglFile->readFile(filepath, area);
+
+  bglReadTimeNs += timer.nsecsElapsed();
+  return bglFile;
+}
+
+std::future<DataWriter::BglFilePtr> DataWriter::readBglFileAsync(const QString& filepath, const SceneryArea& area)
+{
+  // Promise has to be shared since the pool needs a copyable function object
+  std::shared_ptr<std::promise<BglFilePtr> > promise = std::make_shared<std::promise<BglFilePtr> >();
+  std::future<BglFilePtr> future = promise->get_future();
+
+  threadPool->start([this, promise, filepath, &area]() -> void
+  {
+    try
+    {
+      promise->set_value(readBglFile(filepath, area));
+    }
+    catch(...)
+    {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return future;
+}
+
+void DataWriter::writeBglFile(const BglFile& bglFile, const SceneryArea& area)
+{
+  if(bglFile.hasContent() && bglFile.isValid())
+  {
+    // if(!bglFile.getHeader().hasValidMagicNumber())
+    // qWarning() << "Content in file with invalid magic number";
+
+    // Write BGL file metadata
+    bglFileWriter->writeOne(bglFile);
+
+    // Clear the indexes
+    runwayIndex->clear();
+
+    // Execution order is important due to dependencies between the writers
+    // (i.e. ILS writer looks for runway end ids)
+    // Writer also need to access the ids of their parent record objects
+    // (i.e. runway needs the current airport ID
+
+    airportWriter->setNameLists(bglFile.getNamelists());
+
+    // Write airport and all subrecords like runways, approaches, parking and so on
+    airportWriter->write(bglFile.getAirports());
+
+    airportFileWriter->write(bglFile.getAirports());
+
+    // Ignore navaids from the Navigraph update
+    if(!area.isMsfsNavigraphNavdata() && options.isIncludedNavDbObject(type::NAVAIDS))
+    {
+      // Write all navaids to the database
+      waypointWriter->write(bglFile.getWaypoints());
+      vorWriter->write(bglFile.getVors());
+      tacanWriter->write(bglFile.getTacans());
+      ndbWriter->write(bglFile.getNdbs());
+      markerWriter->write(bglFile.getMarker());
+    }
+
+    ilsWriter->write(bglFile.getIls());
+
+    if(!area.isMsfsNavigraphNavdata())
+      // Ignore boundaries from the Navigraph update
+      boundaryWriter->write(bglFile.getBoundaries());
+
+    for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
+      airportIdents.insert(ap->getIdent());
+
+    numNamelists += bglFile.getNamelists().size();
+
+    // Ignore navaids from the Navigraph update
+    if(!area.isMsfsNavigraphNavdata())
+    {
+      numVors += bglFile.getVors().size() + bglFile.getTacans().size();
+      numNdbs += bglFile.getNdbs().size();
+      numMarker += bglFile.getMarker().size();
+      numWaypoints += bglFile.getWaypoints().size();
+      numBoundaries += bglFile.getBoundaries().size();
+    }
+    numIls += bglFile.getIls().size();
+    numFiles++;
+  }
+
+  // Print a one line short report on airports that were found in the BGL
+  if(!bglFile.getAirports().isEmpty())
+  {
+    QStringList apIcaos;
+#ifdef DEBUG_INFORMATION
+    for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
+      apIcaos.append(ap->getIdent());
+#else
+    for(const atools::fs::bgl::Airport *ap : bglFile.getAirports())
+    {
+      // Truncate at 20
+      if(apIcaos.size() < 20)
+        apIcaos.append(ap->getIdent());
+      else
+        break;
+    }
+    if(bglFile.getAirports().size() > 20)
+      apIcaos.append("...");
+#endif
+
+    qDebug() << "Found" << bglFile.getAirports().size() << "airports. idents:" << apIcaos.join(",");
+  }
+}
+
+void DataWriter::updateProgressCounters()
+{
+  progressHandler->setNumFiles(numFiles);
+
+  // Do not reset airport counter which was read before from MSFS 2024 SimConnect
+  progressHandler->setNumAirports(airportIdents.size());
+  progressHandler->setNumNamelists(numNamelists);
+  progressHandler->setNumVors(numVors);
+  progressHandler->setNumIls(numIls);
+  progressHandler->setNumNdbs(numNdbs);
+  progressHandler->setNumMarker(numMarker);
+  progressHandler->setNumBoundaries(numBoundaries);
+  progressHandler->setNumWaypoints(numWaypoints);
+  progressHandler->setNumObjectsWritten(numObjectsWritten);
+}
+
 void DataWriter::readMagDeclBgl(const QString& fileScenery, bool forceWmm)
 {
   QString file;
@@ -439,6 +583,10 @@ void DataWriter::logResults()
                     << numBoundaries << " boundaries and "
                     << numWaypoints << " waypoints.";
   qInfo().nospace() << "Wrote " << numObjectsWritten << " objects.";
+  qInfo().nospace() << "Reading BGL files took " << bglReadTimeNs / 1000000L << " ms in all threads using "
+                    << (options.isBglStreamReader() ? "stream" : "memory mapped") << " reader.";
+  qInfo().nospace() << "Writing to database took " << bglWriteTimeNs / 1000000L << " ms"
+                    << (options.isBulkLoad() ? " in bulk load mode." : ".");
 }
 
 } // namespace writer
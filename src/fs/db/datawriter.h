@@ -19,12 +19,19 @@
 #define ATOOLS_FS_DB_DATAWRITER_H
 
 #include "fs/navdatabaseerrors.h"
+#include "fs/bgl/sectiontype.h"
 
 #include <QList>
 #include <QSet>
 #include <QString>
 #include <QCoreApplication>
 
+#include <atomic>
+#include <future>
+#include <memory>
+
+class QThreadPool;
+
 namespace atools {
 namespace sql {
 class SqlDatabase;
@@ -43,6 +50,9 @@ class SceneryArea;
 class LanguageJson;
 class MaterialLib;
 }
+namespace bgl {
+class BglFile;
+}
 class ProgressHandler;
 
 namespace db {
@@ -81,6 +91,10 @@ class BoundaryWriter;
 
 /*
  * Keeps all writer objects and calls them in order to write BGL records to the database.
+ *
+ * BGL files of a scenery area can optionally be read by a thread pool
+ * (see NavDatabaseOptions::getCompileThreads()). Writing is always done in file order in the calling
+ * thread which owns the database connection. This keeps database IDs the same as for sequential reading.
  */
 class DataWriter
 {
@@ -96,8 +110,16 @@ public:
 
   /*
    * @param area all BGL file content of this scenery area will be written to the database
+   * @param filter load only files with the given lowercase native paths if not empty. Used for incremental updates.
    */
-  void writeSceneryArea(const atools::fs::scenery::SceneryArea& area);
+  void writeSceneryArea(const atools::fs::scenery::SceneryArea& area, const QSet<QString>& filter = QSet<QString>());
+
+  /* Continue ids of all writers after the largest ids found in the database.
+   * Needed when adding files to a copied database in incremental updates. */
+  void setIdsFromDatabase();
+
+  /* Section types which are read from BGL files */
+  static const QSet<atools::fs::bgl::section::SectionType>& getSupportedSectionTypes();
 
   void readMagDeclBgl(const QString& fileScenery, bool forceWmm = false);
 
@@ -302,8 +324,29 @@ public:
   }
 
 private:
+  typedef std::unique_ptr<atools::fs::bgl::BglFile> BglFilePtr;
+
+  /* Read a BGL file into memory. Thread safe. */
+  BglFilePtr readBglFile(const QString& filepath, const atools::fs::scenery::SceneryArea& area) const;
+
+  /* Queue a BGL file for reading in the thread pool. Exceptions are passed on to the caller of future get(). */
+  std::future<BglFilePtr> readBglFileAsync(const QString& filepath, const atools::fs::scenery::SceneryArea& area);
+
+  /* Write a BGL file which was read before into the database and update counters */
+  void writeBglFile(const atools::fs::bgl::BglFile& bglFile, const atools::fs::scenery::SceneryArea& area);
+
+  /* Copy counters into progress handler */
+  void updateProgressCounters();
+
   int numFiles = 0, numNamelists = 0, numVors = 0, numIls = 0,
       numNdbs = 0, numMarker = 0, numWaypoints = 0, numBoundaries = 0, numObjectsWritten = 0;
+
+  /* Accumulated time for reading BGL files in all threads. Used to compare memory mapped and stream reading. */
+  mutable std::atomic<qint64> bglReadTimeNs = 0L;
+
+  /* Accumulated time for writing and committing in the main thread */
+  qint64 bglWriteTimeNs = 0L;
+
   bool aborted = false;
 
   QSet<QString> airportIdents;
@@ -351,6 +394,9 @@ private:
   atools::fs::common::MagDecReader *magDecReader = nullptr;
   atools::fs::db::CountryUpdater *countryUpdater = nullptr;
 
+  /* Reads BGL files ahead of the writer. Null if sequential */
+  QThreadPool *threadPool = nullptr;
+
   const atools::fs::NavDatabaseOptions& options;
   const atools::fs::scenery::LanguageJson *languageIndex = nullptr;
   const atools::fs::scenery::MaterialLib *materialLib = nullptr, *materialLibScenery = nullptr;
@@ -50,6 +50,7 @@ void IlsWriter::writeObject(const Ils *type)
 
   QString name = type->getName().trimmed();
   bind(QStringLiteral(":ils_id"), getNextId());
+  bind(QStringLiteral(":file_id"), getDataWriter().getBglFileWriter()->getCurrentId());
   bind(QStringLiteral(":ident"), type->getIdent().trimmed());
   bind(QStringLiteral(":name"), name);
   bind(QStringLiteral(":region"), type->getRegion());
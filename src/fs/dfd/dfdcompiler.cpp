@@ -38,11 +38,13 @@
 #include <QCoreApplication>
 #include <QDataStream>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFileInfo>
 
 using atools::fs::common::MagDecReader;
 using atools::fs::common::MetadataWriter;
 using atools::sql::SqlQuery;
+using atools::sql::SqlColumnBatch;
 using atools::sql::SqlUtil;
 using atools::sql::SqlScript;
 using atools::sql::SqlRecordList;
@@ -1180,6 +1182,9 @@ void DfdCompiler::writeAirways()
 {
   progress->reportOther("Writing airways");
 
+  QElapsedTimer timer;
+  timer.start();
+
   // Get airways joined with waypoints
   QString query(
     "select  a.route_identifier, a.seqno, a.flightlevel, a.waypoint_description_code, w.waypoint_id, "
@@ -1196,94 +1201,139 @@ void DfdCompiler::writeAirways()
   SqlQuery insert(db);
   insert.prepare(SqlUtil(db).buildInsertStatement("airway", QStringLiteral(), {"airway_id"}));
 
-  SqlRecord lastRec;
-  QString lastName;
+  // Column indexes
+  enum
+  {
+    ROUTE_IDENTIFIER,
+    SEQNO,
+    FLIGHTLEVEL,
+    WAYPOINT_DESCRIPTION_CODE,
+    WAYPOINT_ID,
+    DIRECTION_RESTRICTION,
+    ROUTE_TYPE,
+    MINIMUM_ALTITUDE1,
+    MINIMUM_ALTITUDE2,
+    MAXIMUM_ALTITUDE,
+    LONX,
+    LATY
+  };
+
+  // Read in chunks by column to avoid copying a record for each row
+  SqlColumnBatch batch;
+  int nameIdx = batch.addStr(ROUTE_IDENTIFIER), codeIdx = batch.addStr(WAYPOINT_DESCRIPTION_CODE),
+      flightlevelIdx = batch.addStr(FLIGHTLEVEL), routeTypeIdx = batch.addStr(ROUTE_TYPE),
+      directionIdx = batch.addStr(DIRECTION_RESTRICTION);
+  int waypointIdIdx = batch.addInt(WAYPOINT_ID), minAltIdx = batch.addInt(MINIMUM_ALTITUDE1),
+      maxAltIdx = batch.addInt(MAXIMUM_ALTITUDE);
+  int lonxIdx = batch.addFloat(LONX), latyIdx = batch.addFloat(LATY);
+
+  // Values of the previous row which might be in the previous chunk
+  QString lastName, lastFlightlevel, lastRouteType, lastDirection;
+  int lastWaypointId = 0, lastMinAlt = 0, lastMaxAlt = 0;
+  Pos lastPos;
   bool lastEndOfRoute = true;
+
+  airways.setForwardOnly(true);
   airways.exec();
-  int sequenceNumber = 1, fragmentNumber = 1;
-  while(airways.next())
+  int sequenceNumber = 1, fragmentNumber = 1, rows;
+  while((rows = airways.fetchColumns(batch, 10000)) > 0)
   {
-    QString name = airways.valueStr("route_identifier");
-    QString code = airways.valueStr("waypoint_description_code");
-    bool nameChange = !lastName.isEmpty() && name != lastName;
+    const QStringList& names = batch.strs(nameIdx), & codes = batch.strs(codeIdx);
+    const QList<int>& waypointIds = batch.ints(waypointIdIdx);
+    const QList<float>& lonxs = batch.floats(lonxIdx), & latys = batch.floats(latyIdx);
 
-    if(!lastName.isEmpty())
+    for(int row = 0; row < rows; row++)
     {
-      // Not the first iteration
+      const QString& name = names.at(row);
+      const QString& code = codes.at(row);
+      Pos pos(lonxs.at(row), latys.at(row));
+      bool nameChange = !lastName.isEmpty() && name != lastName;
 
-      if(!nameChange && lastEndOfRoute)
+      if(!lastName.isEmpty())
       {
-        // No name change but the last row indicated end of route - new fragment
-        fragmentNumber++;
-        sequenceNumber = 1;
+        // Not the first iteration
+
+        if(!nameChange && lastEndOfRoute)
+        {
+          // No name change but the last row indicated end of route - new fragment
+          fragmentNumber++;
+          sequenceNumber = 1;
+        }
+
+        if(!lastEndOfRoute && !nameChange)
+        {
+          // Nothing has changed or ended - insert from/to pair
+
+          const Pos& fromPos = lastPos, & toPos = pos;
+          Rect rect(fromPos);
+          rect.extend(toPos);
+
+          insert.bindValue(":airway_name", lastName);
+
+          // -- V = victor, J = jet, B = both
+          // B = All Altitudes, H = High Level Airways, L = Low Level Airways
+          if(lastFlightlevel == "H")
+            insert.bindValue(":airway_type", "J");
+          else if(lastFlightlevel == "L")
+            insert.bindValue(":airway_type", "V");
+          else
+            insert.bindValue(":airway_type", "B");
+
+          insert.bindValue(":route_type", lastRouteType);
+
+          insert.bindValue(":airway_fragment_no", fragmentNumber);
+          insert.bindValue(":sequence_no", sequenceNumber++);
+          insert.bindValue(":from_waypoint_id", lastWaypointId);
+          insert.bindValue(":to_waypoint_id", waypointIds.at(row));
+
+          // -- N = none, B = backward, F = forward
+          // F =  One way in direction route is coded (Forward),
+          // B = One way in opposite direction route is coded (backwards)
+          // blank = // no restrictions on direction
+          QString dir = lastDirection;
+          if(dir.isEmpty() || dir == " ")
+            dir = "N";
+
+          insert.bindValue(":direction", dir);
+
+          insert.bindValue(":minimum_altitude", lastMinAlt);
+          insert.bindValue(":maximum_altitude", lastMaxAlt);
+
+          insert.bindValue(":left_lonx", rect.getTopLeft().getLonX());
+          insert.bindValue(":top_laty", rect.getTopLeft().getLatY());
+          insert.bindValue(":right_lonx", rect.getBottomRight().getLonX());
+          insert.bindValue(":bottom_laty", rect.getBottomRight().getLatY());
+
+          insert.bindValue(":from_lonx", fromPos.getLonX());
+          insert.bindValue(":from_laty", fromPos.getLatY());
+          insert.bindValue(":to_lonx", toPos.getLonX());
+          insert.bindValue(":to_laty", toPos.getLatY());
+          insert.exec();
+        }
       }
 
-      if(!lastEndOfRoute && !nameChange)
+      lastName = name;
+      lastFlightlevel = batch.strs(flightlevelIdx).at(row);
+      lastRouteType = batch.strs(routeTypeIdx).at(row);
+      lastDirection = batch.strs(directionIdx).at(row);
+      lastWaypointId = waypointIds.at(row);
+      lastMinAlt = batch.ints(minAltIdx).at(row);
+      lastMaxAlt = batch.ints(maxAltIdx).at(row);
+      lastPos = pos;
+      lastEndOfRoute = code.size() > 1 && code.at(1) == 'E';
+
+      if(nameChange)
       {
-        // Nothing has changed or ended - insert from/to pair
-
-        Pos fromPos(lastRec.valueFloat("lonx"), lastRec.valueFloat("laty"));
-        Pos toPos(airways.valueFloat("lonx"), airways.valueFloat("laty"));
-        Rect rect(fromPos);
-        rect.extend(toPos);
-
-        insert.bindValue(":airway_name", lastRec.valueStr("route_identifier"));
-
-        // -- V = victor, J = jet, B = both
-        // B = All Altitudes, H = High Level Airways, L = Low Level Airways
-        QString awType = lastRec.valueStr("flightlevel");
-        if(awType == "H")
-          insert.bindValue(":airway_type", "J");
-        else if(awType == "L")
-          insert.bindValue(":airway_type", "V");
-        else
-          insert.bindValue(":airway_type", "B");
-
-        insert.bindValue(":route_type", lastRec.valueStr("route_type"));
-
-        insert.bindValue(":airway_fragment_no", fragmentNumber);
-        insert.bindValue(":sequence_no", sequenceNumber++);
-        insert.bindValue(":from_waypoint_id", lastRec.valueInt("waypoint_id"));
-        insert.bindValue(":to_waypoint_id", airways.valueInt("waypoint_id"));
-
-        // -- N = none, B = backward, F = forward
-        // F =  One way in direction route is coded (Forward),
-        // B = One way in opposite direction route is coded (backwards)
-        // blank = // no restrictions on direction
-        QString dir = lastRec.valueStr("direction_restriction");
-        if(dir.isEmpty() || dir == " ")
-          dir = "N";
-
-        insert.bindValue(":direction", dir);
-
-        insert.bindValue(":minimum_altitude", lastRec.valueInt("minimum_altitude1"));
-        insert.bindValue(":maximum_altitude", lastRec.valueInt("maximum_altitude"));
-
-        insert.bindValue(":left_lonx", rect.getTopLeft().getLonX());
-        insert.bindValue(":top_laty", rect.getTopLeft().getLatY());
-        insert.bindValue(":right_lonx", rect.getBottomRight().getLonX());
-        insert.bindValue(":bottom_laty", rect.getBottomRight().getLatY());
-
-        insert.bindValue(":from_lonx", fromPos.getLonX());
-        insert.bindValue(":from_laty", fromPos.getLatY());
-        insert.bindValue(":to_lonx", toPos.getLonX());
-        insert.bindValue(":to_laty", toPos.getLatY());
-        insert.exec();
+        // Name has changed - reset all
+        fragmentNumber = 1;
+        sequenceNumber = 1;
       }
-    }
-
-    lastRec = airways.record();
-    lastName = name;
-    lastEndOfRoute = code.size() > 1 && code.at(1) == 'E';
-
-    if(nameChange)
-    {
-      // Name has changed - reset all
-      fragmentNumber = 1;
-      sequenceNumber = 1;
-    }
-  }
+    } // for(int row = 0; row < rows; row++)
+    batch.clearValues();
+  } // while(fetchColumns)
   db.commit();
+
+  qDebug() << Q_FUNC_INFO << "airways written in" << timer.elapsed() << "ms";
 }
 
 void DfdCompiler::writeProcedures()
@@ -32,6 +32,9 @@
 #include <QTimeZone>
 #include <QXmlStreamReader>
 
+#include <cmath>
+#include <cstring>
+
 using atools::geo::Pos;
 using atools::geo::PosD;
 using atools::fs::pln::Flightplan;
@@ -41,6 +44,207 @@ namespace atools {
 namespace fs {
 namespace gpx {
 
+// Binary format ========================================================================
+const static char BINARY_MAGIC[] = "GPXB";
+const static qsizetype BINARY_MAGIC_SIZE = 4;
+const static char BINARY_VERSION = 2;
+
+// Set in the level byte of track points and in the flags byte of flight plan entries if the position is invalid.
+// Coordinates and altitude are omitted for invalid positions.
+const static quint8 BINARY_FLAG_INVALID = 0x80;
+
+// Coordinates are saved in 1/10^7 degree and altitude in 1/10 feet
+const static double BINARY_COORD_FACTOR = 1.e7;
+const static double BINARY_ALT_FACTOR = 10.;
+
+// Douglas-Peucker tolerances in meter for simplification levels 1 to 3
+const static double SIMPLIFY_TOLERANCE_METER[GpxIO::NUM_SIMPLIFY_LEVELS - 1] = {25., 250., 2500.};
+
+// 60 NM for local projection in simplifyLevels()
+const static double METER_PER_DEGREE = 111120.;
+
+/* Returns 0 for values which cannot be represented like invalid or huge altitudes */
+inline qint64 quantize(double value, double factor)
+{
+  double scaled = value * factor;
+  if(!std::isfinite(scaled) || std::abs(scaled) > 1.e15)
+    return 0;
+
+  return std::llround(scaled);
+}
+
+inline void writeVarint(QByteArray& bytes, quint64 value)
+{
+  while(value >= 0x80)
+  {
+    bytes.append(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  bytes.append(static_cast<char>(value));
+}
+
+/* Zigzag encoding maps small negative numbers to small varints */
+inline void writeSigned(QByteArray& bytes, qint64 value)
+{
+  writeVarint(bytes, (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63));
+}
+
+/* Reads varints from binary format. Sets ok to false for truncated or corrupt data and returns 0 then. */
+class BinaryReader
+{
+public:
+  BinaryReader(const QByteArray& bytes, qsizetype offset)
+    : cur(bytes.constData() + offset), end(bytes.constData() + bytes.size())
+  {
+  }
+
+  quint64 readVarint()
+  {
+    quint64 value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+      if(cur >= end)
+        break;
+
+      quint8 byte = static_cast<quint8>(*cur++);
+      value |= static_cast<quint64>(byte & 0x7f) << shift;
+      if((byte & 0x80) == 0)
+        return value;
+    }
+    ok = false;
+    return 0;
+  }
+
+  qint64 readSigned()
+  {
+    quint64 value = readVarint();
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+  }
+
+  quint8 readByte()
+  {
+    if(cur < end)
+      return static_cast<quint8>(*cur++);
+
+    ok = false;
+    return 0;
+  }
+
+  QByteArrayView readBytes(quint64 size)
+  {
+    if(size <= static_cast<quint64>(end - cur))
+    {
+      QByteArrayView view(cur, static_cast<qsizetype>(size));
+      cur += size;
+      return view;
+    }
+
+    ok = false;
+    return QByteArrayView();
+  }
+
+  /* Sanity check for counts to avoid huge allocations on corrupt data. Each element needs at least one byte. */
+  bool isValidCount(quint64 count) const
+  {
+    return ok && count <= static_cast<quint64>(end - cur);
+  }
+
+  bool isOk() const
+  {
+    return ok;
+  }
+
+private:
+  const char *cur, *end;
+  bool ok = true;
+};
+
+/* Distance in meter from point p to the segment a to b in the local plane */
+inline double segmentDistance(double px, double py, double ax, double ay, double bx, double by)
+{
+  double dx = bx - ax, dy = by - ay;
+  double lengthSq = dx * dx + dy * dy;
+  double t = lengthSq > 0. ? std::clamp(((px - ax) * dx + (py - ay) * dy) / lengthSq, 0., 1.) : 0.;
+  return std::hypot(px - (ax + t * dx), py - (ay + t * dy));
+}
+
+/* Assigns the highest Douglas-Peucker simplification level to each point where the point is still kept.
+ * Each point gets the distance where it was selected limited by the distance of its parent. This makes
+ * the levels consistent with a separate Douglas-Peucker run for each tolerance.
+ * Points are projected to a plane around the first point which is sufficient for simplification.
+ * Invalid points get level 0 and are not used for simplification. */
+void simplifyLevels(QList<quint8>& levels, const TrailPoints& points)
+{
+  const quint8 MAX_LEVEL = GpxIO::NUM_SIMPLIFY_LEVELS - 1;
+  levels.fill(0, points.size());
+
+  // Indexes of valid points
+  QList<int> valid;
+  valid.reserve(points.size());
+  for(int i = 0; i < points.size(); i++)
+  {
+    if(points.at(i).pos.isValid())
+      valid.append(i);
+  }
+
+  int size = static_cast<int>(valid.size());
+  if(size == 0)
+    return;
+
+  // Always keep first and last point
+  levels[valid.constFirst()] = levels[valid.constLast()] = MAX_LEVEL;
+  if(size < 3)
+    return;
+
+  double xScale = std::cos(atools::geo::toRadians(points.at(valid.constFirst()).pos.getLatY())) * METER_PER_DEGREE;
+  QList<double> x(size), y(size);
+  for(int i = 0; i < size; i++)
+  {
+    x[i] = points.at(valid.at(i)).pos.getLonX() * xScale;
+    y[i] = points.at(valid.at(i)).pos.getLatY() * METER_PER_DEGREE;
+  }
+
+  struct Segment
+  {
+    int first, last;
+    double significance;
+  };
+
+  QList<Segment> stack({Segment{0, size - 1, std::numeric_limits<double>::max()}});
+  while(!stack.isEmpty())
+  {
+    Segment segment = stack.takeLast();
+
+    // Find point with largest distance to segment
+    double maxDist = -1.;
+    int maxIndex = -1;
+    for(int i = segment.first + 1; i < segment.last; i++)
+    {
+      double dist = segmentDistance(x.at(i), y.at(i), x.at(segment.first), y.at(segment.first),
+                                    x.at(segment.last), y.at(segment.last));
+      if(dist > maxDist)
+      {
+        maxDist = dist;
+        maxIndex = i;
+      }
+    }
+
+    if(maxIndex == -1)
+      continue;
+
+    double significance = std::min(maxDist, segment.significance);
+    quint8 level = 0;
+    while(level < MAX_LEVEL && significance >= SIMPLIFY_TOLERANCE_METER[level])
+      level++;
+    levels[valid.at(maxIndex)] = level;
+
+    if(maxIndex - segment.first > 1)
+      stack.append(Segment{segment.first, maxIndex, significance});
+    if(segment.last - maxIndex > 1)
+      stack.append(Segment{maxIndex, segment.last, significance});
+  }
+}
+
 GpxIO::GpxIO()
 {
   errorMsg = tr("Cannot open file %1. Reason: %2");
@@ -285,6 +489,217 @@ void GpxIO::loadGpx(atools::fs::gpx::GpxData& gpxData, const QString& filename)
     throw Exception(errorMsg.arg(filename, gpxFile.errorString()));
 }
 
+QByteArray GpxIO::saveGpxBinary(const GpxData& gpxData)
+{
+  const Flightplan& flightplan = gpxData.getFlightplan();
+  const Trails& trails = gpxData.getTrails();
+
+  QByteArray bytes;
+  bytes.reserve(16 + flightplan.size() * 20 + gpxData.getNumPoints() * 8);
+  bytes.append(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+  bytes.append(BINARY_VERSION);
+
+  // Flight plan ========================================================
+  writeVarint(bytes, static_cast<quint64>(flightplan.size()));
+  qint64 lastLon = 0, lastLat = 0, lastAlt = 0;
+  for(const FlightplanEntry& entry : flightplan)
+  {
+    const QByteArray ident = entry.getIdent().toUtf8();
+    writeVarint(bytes, static_cast<quint64>(ident.size()));
+    bytes.append(ident);
+
+    const Pos& pos = entry.getPosition();
+    if(!pos.isValid())
+    {
+      bytes.append(static_cast<char>(BINARY_FLAG_INVALID));
+      continue;
+    }
+    bytes.append('\0');
+
+    qint64 lon = quantize(pos.getLonX(), BINARY_COORD_FACTOR), lat = quantize(pos.getLatY(), BINARY_COORD_FACTOR),
+           alt = quantize(pos.getAltitude(), BINARY_ALT_FACTOR);
+    writeSigned(bytes, lon - lastLon);
+    writeSigned(bytes, lat - lastLat);
+    writeSigned(bytes, alt - lastAlt);
+    lastLon = lon;
+    lastLat = lat;
+    lastAlt = alt;
+  }
+
+  // Trails ========================================================
+  writeVarint(bytes, static_cast<quint64>(trails.size()));
+  QList<quint8> levels;
+  for(const TrailPoints& points : trails)
+  {
+    simplifyLevels(levels, points);
+    writeVarint(bytes, static_cast<quint64>(points.size()));
+
+    qint64 lastTime = 0;
+    lastLon = lastLat = lastAlt = 0;
+    for(int i = 0; i < points.size(); i++)
+    {
+      const TrailPoint& point = points.at(i);
+      writeSigned(bytes, point.timestampMs - lastTime);
+      lastTime = point.timestampMs;
+
+      if(!point.pos.isValid())
+      {
+        bytes.append(static_cast<char>(BINARY_FLAG_INVALID));
+        continue;
+      }
+      bytes.append(static_cast<char>(levels.at(i)));
+
+      qint64 lon = quantize(point.pos.getLonX(), BINARY_COORD_FACTOR), lat = quantize(point.pos.getLatY(), BINARY_COORD_FACTOR),
+             alt = quantize(point.pos.getAltitude(), BINARY_ALT_FACTOR);
+      writeSigned(bytes, lon - lastLon);
+      writeSigned(bytes, lat - lastLat);
+      writeSigned(bytes, alt - lastAlt);
+      lastLon = lon;
+      lastLat = lat;
+      lastAlt = alt;
+    }
+  }
+
+#ifdef DEBUG_GPX_BINARY_VERIFY
+  verifyGpxBinary(gpxData, bytes);
+#endif
+
+  return bytes;
+}
+
+bool GpxIO::loadGpxBinary(GpxData& gpxData, const QByteArray& bytes, int simplifyLevel)
+{
+  gpxData.clear();
+
+  if(bytes.size() < BINARY_MAGIC_SIZE + 1 || std::memcmp(bytes.constData(), BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0)
+    return false;
+
+  char version = bytes.at(BINARY_MAGIC_SIZE);
+  if(version != BINARY_VERSION)
+  {
+    qWarning() << Q_FUNC_INFO << "Unknown binary version" << static_cast<int>(version);
+    return false;
+  }
+
+  BinaryReader reader(bytes, BINARY_MAGIC_SIZE + 1);
+
+  // Flight plan ========================================================
+  quint64 numEntries = reader.readVarint();
+  if(!reader.isValidCount(numEntries))
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid flight plan size" << numEntries;
+    return false;
+  }
+
+  qint64 lon = 0, lat = 0, alt = 0;
+  for(quint64 i = 0; i < numEntries && reader.isOk(); i++)
+  {
+    FlightplanEntry entry;
+    entry.setIdent(QString::fromUtf8(reader.readBytes(reader.readVarint())));
+
+    if(reader.readByte() & BINARY_FLAG_INVALID)
+      entry.setPosition(Pos());
+    else
+    {
+      lon += reader.readSigned();
+      lat += reader.readSigned();
+      alt += reader.readSigned();
+      entry.setPosition(Pos(lon / BINARY_COORD_FACTOR, lat / BINARY_COORD_FACTOR, alt / BINARY_ALT_FACTOR));
+    }
+    gpxData.appendFlightplanEntry(entry);
+  }
+
+  // Trails ========================================================
+  quint64 numTrails = reader.readVarint();
+  if(!reader.isValidCount(numTrails))
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid number of trails" << numTrails;
+    gpxData.clear();
+    return false;
+  }
+
+  TrailPoints points;
+  for(quint64 i = 0; i < numTrails && reader.isOk(); i++)
+  {
+    quint64 numPoints = reader.readVarint();
+    if(!reader.isValidCount(numPoints))
+    {
+      qWarning() << Q_FUNC_INFO << "Invalid number of trail points" << numPoints;
+      gpxData.clear();
+      return false;
+    }
+
+    points.clear();
+    if(simplifyLevel == 0)
+      points.reserve(static_cast<qsizetype>(numPoints));
+
+    qint64 time = 0;
+    lon = lat = alt = 0;
+    for(quint64 j = 0; j < numPoints && reader.isOk(); j++)
+    {
+      time += reader.readSigned();
+      quint8 level = reader.readByte();
+      if(level & BINARY_FLAG_INVALID)
+      {
+        // Invalid positions are only kept at full resolution
+        if(simplifyLevel == 0)
+          points.append(TrailPoint(PosD(), time));
+        continue;
+      }
+      lon += reader.readSigned();
+      lat += reader.readSigned();
+      alt += reader.readSigned();
+
+      if(level >= simplifyLevel)
+        points.append(TrailPoint(PosD(lon / BINARY_COORD_FACTOR, lat / BINARY_COORD_FACTOR, alt / BINARY_ALT_FACTOR), time));
+    }
+    gpxData.appendTrailPoints(points);
+  }
+
+  if(!reader.isOk())
+  {
+    qWarning() << Q_FUNC_INFO << "Truncated or invalid binary data";
+    gpxData.clear();
+    return false;
+  }
+
+  gpxData.adjustDepartureAndDestinationFlightplan();
+  return true;
+}
+
+void GpxIO::verifyGpxBinary(const GpxData& gpxData, const QByteArray& bytes)
+{
+  // Compare positions after a round trip at full resolution. Invalid positions have to stay invalid.
+  GpxData loaded;
+  if(!loadGpxBinary(loaded, bytes))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot load binary data";
+    return;
+  }
+
+  auto equal = [](const PosD& pos1, const PosD& pos2) -> bool {
+                 if(!pos1.isValid() || !pos2.isValid())
+                   return pos1.isValid() == pos2.isValid();
+                 return std::abs(pos1.getLonX() - pos2.getLonX()) < 1.e-6 && std::abs(pos1.getLatY() - pos2.getLatY()) < 1.e-6;
+               };
+
+  const Flightplan& plan = gpxData.getFlightplan(), & loadedPlan = loaded.getFlightplan();
+  bool ok = plan.size() == loadedPlan.size() && gpxData.getTrails().size() == loaded.getTrails().size();
+  for(int i = 0; ok && i < plan.size(); i++)
+    ok = equal(PosD(plan.at(i).getPosition()), PosD(loadedPlan.at(i).getPosition()));
+
+  for(int i = 0; ok && i < gpxData.getTrails().size(); i++)
+  {
+    const TrailPoints& points = gpxData.getTrails().at(i), & loadedPoints = loaded.getTrails().at(i);
+    ok = points.size() == loadedPoints.size();
+    for(int j = 0; ok && j < points.size(); j++)
+      ok = equal(points.at(j).pos, loadedPoints.at(j).pos) && points.at(j).timestampMs == loadedPoints.at(j).timestampMs;
+  }
+
+  if(!ok)
+    qWarning() << Q_FUNC_INFO << "Binary round trip differs";
+}
+
 void GpxIO::loadGpxInternal(atools::fs::gpx::GpxData& gpxData, atools::util::XmlStreamReader& xmlStream)
 {
   xmlStream.readUntilElement(QStringLiteral("gpx"));
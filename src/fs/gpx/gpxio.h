@@ -73,9 +73,26 @@ public:
   void loadGpxGz(atools::fs::gpx::GpxData& gpxData, const QByteArray& bytes);
   void loadGpx(atools::fs::gpx::GpxData& gpxData, const QString& filename);
 
+  /* Compact binary format for logbook BLOBs which can be read without XML parsing.
+   * Coordinates, altitudes and timestamps are delta and varint encoded. Each track point carries a
+   * Douglas-Peucker simplification level which allows to load fewer points for overview display.
+   * Flight plan entries are saved with ident and position only like loadGpx() reads them.
+   * Invalid positions are saved with a flag and without coordinates. */
+  QByteArray saveGpxBinary(const atools::fs::gpx::GpxData& gpxData);
+
+  /* Load binary format. Skips all track points below simplifyLevel. Level 0 loads all points.
+   * Returns false if bytes are empty or invalid. gpxData is cleared in this case. */
+  bool loadGpxBinary(atools::fs::gpx::GpxData& gpxData, const QByteArray& bytes, int simplifyLevel = 0);
+
+  /* Number of simplification levels in binary format. 0 is full resolution and 3 the coarsest. */
+  static const int NUM_SIMPLIFY_LEVELS = 4;
+
 private:
   void saveGpxInternal(QXmlStreamWriter& writer, const atools::fs::gpx::GpxData& gpxData);
   void loadGpxInternal(atools::fs::gpx::GpxData& gpxData, util::XmlStreamReader& xmlStream);
+
+  /* Loads binary data again and prints a warning if positions differ. Used with DEBUG_GPX_BINARY_VERIFY. */
+  void verifyGpxBinary(const atools::fs::gpx::GpxData& gpxData, const QByteArray& bytes);
   void readPosGpx(atools::geo::PosD& pos, QString& name, util::XmlStreamReader& xmlStream, QDateTime *timestamp = nullptr);
 
   QString errorMsg;
@@ -19,6 +19,9 @@
 
 #include "atools.h"
 #include "exception.h"
+#include "fs/bgl/bglfile.h"
+#include "fs/bgl/ap/airport.h"
+#include "fs/bgl/nav/waypoint.h"
 #include "fs/common/metadatawriter.h"
 #include "fs/db/airwayresolver.h"
 #include "fs/db/countryupdater.h"
@@ -43,6 +46,7 @@
 #include "sql/sqltransaction.h"
 #include "sql/sqlutil.h"
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QElapsedTimer>
 #include <QProcessEnvironment>
@@ -71,6 +75,57 @@ static const int PROGRESS_NUM_RESOLVE_AIRWAY_STEPS = 1000;
 // createSchemaInternal()
 static const int PROGRESS_NUM_SCHEMA_STEPS = 8;
 
+// Used for the whole compilation if NavDatabaseOptions::isBulkLoad() is set. Journal in memory, no fsync,
+// 256 MB page cache and memory mapping. Previous values are restored after compilation.
+const static QStringList BULK_LOAD_PRAGMAS({"PRAGMA journal_mode=MEMORY", "PRAGMA synchronous=OFF",
+                                            "PRAGMA cache_size=-262144", "PRAGMA mmap_size=268435456",
+                                            "PRAGMA temp_store=MEMORY"});
+
+/* Restores saved pragmas when leaving createInternal() also on abort or exception */
+class PragmaRestorer
+{
+public:
+  explicit PragmaRestorer(atools::sql::SqlDatabase& dbParam)
+    : db(dbParam)
+  {
+  }
+
+  ~PragmaRestorer()
+  {
+    try
+    {
+      restore();
+    }
+    catch(std::exception& e)
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot restore pragmas" << e.what();
+    }
+  }
+
+  /* Save current values and apply new pragmas */
+  void apply(const QStringList& pragmas)
+  {
+    saved = db.getPragmas(pragmas);
+    db.executePragmas(pragmas);
+    qInfo() << Q_FUNC_INFO << "Applied" << pragmas << "saved" << saved;
+  }
+
+  void restore()
+  {
+    if(!saved.isEmpty())
+    {
+      QStringList pragmas;
+      pragmas.swap(saved);
+      db.executePragmas(pragmas);
+      qInfo() << Q_FUNC_INFO << "Restored" << pragmas;
+    }
+  }
+
+private:
+  atools::sql::SqlDatabase& db;
+  QStringList saved;
+};
+
 using atools::sql::SqlScript;
 using atools::sql::SqlQuery;
 using atools::sql::SqlUtil;
@@ -114,7 +169,7 @@ atools::fs::ResultFlags NavDatabase::compileDatabase()
     result |= COMPILE_CANCELED;
     db.rollback();
   }
-  else
+  else if(!result.testFlag(atools::fs::COMPILE_UNCHANGED))
     createDatabaseReportShort();
 
   if(result.testFlag(atools::fs::COMPILE_BASIC_VALIDATION_ERROR))
@@ -172,7 +227,7 @@ void NavDatabase::createSchemaInternal(ProgressHandler *progress)
   script.executeScript(":/atools/resources/sql/fs/db/create_boundary_schema.sql");
   script.executeScript(":/atools/resources/sql/fs/db/create_nav_schema.sql");
   script.executeScript(":/atools/resources/sql/fs/db/create_ap_schema.sql");
-  if(options.getSimulatorType() != FsPaths::MSFS_2024)
+  if(!isAirportIndexDeferred())
     script.executeScript(":/atools/resources/sql/fs/db/create_ap_schema_index.sql");
   script.executeScript(":/atools/resources/sql/fs/db/create_meta_schema.sql");
   transaction.commit();
@@ -593,11 +648,20 @@ int NavDatabase::countMsSimSteps()
 atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfigCodec)
 {
   result = atools::fs::COMPILE_NONE;
+  sceneryUpdate = false;
   SceneryCfg sceneryCfg(sceneryConfigCodec);
 
   QElapsedTimer timer;
   timer.start();
 
+  // Time per phase for logging
+  QElapsedTimer phaseTimer;
+  phaseTimer.start();
+  QList<std::pair<QString, qint64> > phaseTimes;
+  auto phaseFinished = [&phaseTimer, &phaseTimes](const QString& phase) -> void {
+                         phaseTimes.append(std::make_pair(phase, phaseTimer.restart()));
+                       };
+
   ProgressHandler progress;
   progress.setProgressCallback(options.getProgressCallback());
   progress.setCallDefaultCallback(options.isCallDefaultCallback());
@@ -605,7 +669,12 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
   progress.setTotal(1000000000);
 
   if(options.isAutocommit())
-    db.setAutocommit(true);
+  {
+    if(options.isBulkLoad())
+      qWarning() << Q_FUNC_INFO << "Autocommit ignored in bulk load mode";
+    else
+      db.setAutocommit(true);
+  }
 
   // Create and register SimConnect API
   if(options.getSimulatorType() == FsPaths::MSFS_2024)
@@ -674,14 +743,57 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
   if(aborted)
     return result;
 
+  if(options.isIncremental())
+  {
+    // Skip compilation if scenery library did not change ==========================================
+    if(FsPaths::isAnyXplane(sim) || sim == FsPaths::NAVIGRAPH || sim == FsPaths::MSFS_2024)
+      qInfo() << Q_FUNC_INFO << "Incremental compilation not supported for" << FsPaths::typeToShortName(sim);
+    else
+    {
+      switch(checkSceneryLibraryChanges(sceneryCfg.getAreas()))
+      {
+        case SCENERY_UNCHANGED:
+          qInfo() << Q_FUNC_INFO << "Scenery library unchanged. Skipping compilation.";
+          result |= atools::fs::COMPILE_UNCHANGED;
+          progress.reportFinish();
+          return result;
+
+        case SCENERY_UPDATE:
+          // Copy previous database and load changed files only
+          qInfo() << Q_FUNC_INFO << "Scenery library changed. Updating previous database.";
+          result |= atools::fs::COMPILE_UPDATED;
+          sceneryUpdate = true;
+          break;
+
+        case SCENERY_REBUILD:
+          break;
+      }
+    }
+  }
+
   qDebug() << "=P=== Total Progress" << total;
 
   progress.reset();
   progress.setTotal(total);
+  phaseFinished("Preparation");
+
+  // Switch pragmas for bulk loading - restored when done or on exception
+  PragmaRestorer pragmaRestorer(db);
+  if(options.isBulkLoad())
+    pragmaRestorer.apply(BULK_LOAD_PRAGMAS);
 
   createSchemaInternal(&progress);
   if(aborted)
     return result;
+  phaseFinished("Schema");
+
+  if(sceneryUpdate)
+  {
+    // Fill schema with previous database and remove content of changed files
+    if(prepareSceneryUpdate(&progress))
+      return result;
+    phaseFinished("Copying previous");
+  }
 
   // -----------------------------------------------------------------------
   // Create empty data writer pointers which will read all files and fill the database
@@ -780,11 +892,13 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
 
   if(aborted)
     return result;
+  phaseFinished("Loading");
 
   // ===========================================================================
   // Loading is done here - now continue with the post process steps
 
-  if(options.isResolveAirways() && sim != FsPaths::NAVIGRAPH)
+  // Airways are copied unchanged in incremental updates
+  if(options.isResolveAirways() && sim != FsPaths::NAVIGRAPH && !sceneryUpdate)
   {
     // All simulators including DFD and X-Plane ====================
     // Read tmp_airway_point table, connect all waypoints and write the ordered result into the airway table
@@ -800,64 +914,73 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
       return result;
   }
 
-  if(!FsPaths::isAnyXplane(sim) && sim != FsPaths::NAVIGRAPH && sim != FsPaths::MSFS && sim != FsPaths::MSFS_2024)
+  if(sceneryUpdate)
   {
-    // Create VORTACs
-    if((aborted = runScript(&progress, "fs/db/update_vor.sql", tr("Merging VOR and TACAN to VORTAC"))))
+    // Update only new rows and rows referencing airports from changed files
+    if(postProcessSceneryUpdate(&progress))
       return result;
   }
-
-  // Set the nav_ids (VOR, NDB) in the waypoint table and update the airway counts
-  if((aborted = runScript(&progress, "fs/db/update_wp_ids.sql", tr("Updating waypoints"))))
-    return result;
-
-  if(!FsPaths::isAnyXplane(sim) && sim != FsPaths::NAVIGRAPH)
+  else
   {
-    // Assign airport ids based on stored idents for waypoint and ndb
-    if((aborted = runScript(&progress, "fs/db/update_nav_ids.sql", tr("Updating Navaids"))))
-      return result;
-  }
+    if(!FsPaths::isAnyXplane(sim) && sim != FsPaths::NAVIGRAPH && sim != FsPaths::MSFS && sim != FsPaths::MSFS_2024)
+    {
+      // Create VORTACs
+      if((aborted = runScript(&progress, "fs/db/update_vor.sql", tr("Merging VOR and TACAN to VORTAC"))))
+        return result;
+    }
 
-  if(sim == FsPaths::NAVIGRAPH)
-  {
-    // Remove all unreferenced dummy waypoints that were added for airway generation
-    if((aborted = runScript(&progress, "fs/db/dfd/clean_waypoints.sql", tr("Cleaning up waypoints"))))
+    // Set the nav_ids (VOR, NDB) in the waypoint table and update the airway counts
+    if((aborted = runScript(&progress, "fs/db/update_wp_ids.sql", tr("Updating waypoints"))))
       return result;
-  }
 
-  // Set the runway_end_ids in the approach table
-  if((aborted = runScript(&progress, "fs/db/update_approaches.sql", tr("Updating approaches"))))
-    return result;
+    if(!FsPaths::isAnyXplane(sim) && sim != FsPaths::NAVIGRAPH)
+    {
+      // Assign airport ids based on stored idents for waypoint and ndb
+      if((aborted = runScript(&progress, "fs/db/update_nav_ids.sql", tr("Updating Navaids"))))
+        return result;
+    }
 
-  // Assign region to airports by best guess from nearby navaids
-  if((aborted = runScript(&progress, "fs/db/update_airport.sql", tr("Updating Airports"))))
-    return result;
+    if(sim == FsPaths::NAVIGRAPH)
+    {
+      // Remove all unreferenced dummy waypoints that were added for airway generation
+      if((aborted = runScript(&progress, "fs/db/dfd/clean_waypoints.sql", tr("Cleaning up waypoints"))))
+        return result;
+    }
 
-  if(sim == FsPaths::DFD)
-  {
-    if((aborted = runScript(&progress, "fs/db/dfd/update_airport_ils.sql", tr("Updating ILS"))))
-      return result;
-  }
-  else if(sim == FsPaths::MSFS || sim == FsPaths::MSFS_2024)
-  {
-    if((aborted = runScript(&progress, "fs/db/update_airport_ils_msfs.sql", tr("Updating ILS"))))
+    // Set the runway_end_ids in the approach table
+    if((aborted = runScript(&progress, "fs/db/update_approaches.sql", tr("Updating approaches"))))
       return result;
-  }
-  else if(!FsPaths::isAnyXplane(sim))
-  {
-    // The ids are already updated when reading the X-Plane data
-    // Set runway end ids into the ILS
-    if((aborted = runScript(&progress, "fs/db/update_airport_ils.sql", tr("Updating ILS"))))
+
+    // Assign region to airports by best guess from nearby navaids
+    if((aborted = runScript(&progress, "fs/db/update_airport.sql", tr("Updating Airports"))))
       return result;
-  }
 
-  // update the ILS count in the airport table
-  if((aborted = runScript(&progress, "fs/db/update_num_ils.sql", tr("Updating ILS Count"))))
-    return result;
+    if(sim == FsPaths::DFD)
+    {
+      if((aborted = runScript(&progress, "fs/db/dfd/update_airport_ils.sql", tr("Updating ILS"))))
+        return result;
+    }
+    else if(sim == FsPaths::MSFS || sim == FsPaths::MSFS_2024)
+    {
+      if((aborted = runScript(&progress, "fs/db/update_airport_ils_msfs.sql", tr("Updating ILS"))))
+        return result;
+    }
+    else if(!FsPaths::isAnyXplane(sim))
+    {
+      // The ids are already updated when reading the X-Plane data
+      // Set runway end ids into the ILS
+      if((aborted = runScript(&progress, "fs/db/update_airport_ils.sql", tr("Updating ILS"))))
+        return result;
+    }
 
-  // Prepare the search table
-  if((aborted = runScript(&progress, "fs/db/populate_nav_search.sql", tr("Collecting navaids for search"))))
-    return result;
+    // update the ILS count in the airport table
+    if((aborted = runScript(&progress, "fs/db/update_num_ils.sql", tr("Updating ILS Count"))))
+      return result;
+
+    // Prepare the search table
+    if((aborted = runScript(&progress, "fs/db/populate_nav_search.sql", tr("Collecting navaids for search"))))
+      return result;
+  }
 
   if(!FsPaths::isAnyXplane(sim) && sim != FsPaths::NAVIGRAPH)
   {
@@ -866,6 +989,7 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
 
     calculateRating(sim);
   }
+  phaseFinished("Post processing");
 
   if((aborted = runScript(&progress, "fs/db/finish_airport_schema.sql", tr("Creating indexes for airport"))))
     return result;
@@ -880,6 +1004,7 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
                            {"fs/db/finish_schema.sql", options.isDropTempTables() ? "fs/db/finish_schema_drop_temp.sql" : ""},
                            tr("Creating indexes for search"))))
     return result;
+  phaseFinished("Finishing schema");
 
   if(sim == FsPaths::MSFS)
   {
@@ -899,6 +1024,13 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
   if((sim == FsPaths::MSFS || sim == FsPaths::MSFS_2024) && result.testFlag(atools::fs::COMPILE_MSFS_NAVIGRAPH_FOUND))
     databaseMetadata.addProperty(atools::fs::db::PROPERTYNAME_MSFS_NAVIGRAPH_FOUND, "true");
 
+  if(!sceneryFingerprint.isEmpty())
+  {
+    databaseMetadata.addProperty(atools::fs::db::PROPERTYNAME_SCENERY_FINGERPRINT, sceneryFingerprint);
+    databaseMetadata.addProperty(atools::fs::db::PROPERTYNAME_SCENERY_OPTIONS_FINGERPRINT, sceneryOptionsFingerprint);
+    databaseMetadata.addProperty(atools::fs::db::PROPERTYNAME_SCENERY_AREA_FINGERPRINTS, sceneryAreaFingerprints);
+  }
+
   if(xpDataCompiler)
     databaseMetadata.setAiracCycle(xpDataCompiler->getAiracCycle());
   if(dfdCompiler)
@@ -916,6 +1048,10 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
     // database is kept locked by queries - need to close this late to avoid statistics generation for attached
     dfdCompiler->detachDatabase();
 
+  // Back to normal journal and synchronous mode before vacuum and analyze
+  pragmaRestorer.restore();
+  phaseFinished("Metadata");
+
   // ================================================================================================
   // Done here - now only some options statistics and reports are left
 
@@ -950,6 +1086,8 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
 
     dropAllIndexes();
   }
+  phaseFinished("Validation and report");
+
   if(options.isVacuumDatabase())
   {
     if((aborted = progress.reportOtherInc(tr("Vacuum Database"), PROGRESS_NUM_TASK_STEPS)))
@@ -968,8 +1106,12 @@ atools::fs::ResultFlags NavDatabase::createInternal(const QString& sceneryConfig
 
   // Send the final progress report
   progress.reportFinish();
+  phaseFinished("Vacuum and analyze");
 
-  qDebug() << "Time" << timer.elapsed() / 1000 << "seconds";
+  for(const std::pair<QString, qint64>& phaseTime : std::as_const(phaseTimes))
+    qInfo().nospace().noquote() << "Phase " << phaseTime.first << " took " << phaseTime.second << " ms";
+
+  qDebug() << "Time" << timer.elapsed() / 1000 << "seconds" << (options.isBulkLoad() ? "in bulk load mode" : "");
 
   return result;
 }
@@ -1016,7 +1158,8 @@ bool NavDatabase::loadDfd(ProgressHandler *progress, ng::DfdCompiler *dfdCompile
 
   dfdCompiler->writeCom();
 
-  if((aborted = runScript(progress, "fs/db/create_indexes_post_load.sql", tr("Creating indexes"))))
+  if((aborted = runScripts(progress, {isAirportIndexDeferred() ? "fs/db/create_ap_schema_index.sql" : "",
+                                      "fs/db/create_indexes_post_load.sql"}, tr("Creating indexes"))))
     return true;
 
   if((aborted = runScript(progress, "fs/db/create_indexes_post_load_boundary.sql", tr("Creating boundary indexes"))))
@@ -1150,7 +1293,8 @@ bool NavDatabase::loadXplane(ProgressHandler *progress, atools::fs::xp::XpDataCo
       return true;
   }
 
-  if((aborted = runScript(progress, "fs/db/create_indexes_post_load.sql", tr("Creating indexes"))))
+  if((aborted = runScripts(progress, {isAirportIndexDeferred() ? "fs/db/create_ap_schema_index.sql" : "",
+                                      "fs/db/create_indexes_post_load.sql"}, tr("Creating indexes"))))
     return true;
 
   if((aborted = runScript(progress, "fs/db/create_indexes_post_load_boundary.sql", tr("Creating boundary indexes"))))
@@ -1258,8 +1402,16 @@ bool NavDatabase::loadFsxP3dMsfsSimulator(ProgressHandler *progress, db::DataWri
   SceneryErrors materialLibErrors;
   scenery::MaterialLib materialLib(options, progress, &materialLibErrors);
 
+  if(sceneryUpdate)
+    // Continue after the ids of the copied database
+    fsDataWriter->setIdsFromDatabase();
+
   for(const SceneryArea& area : areas)
   {
+    // Load only areas with changed files in incremental updates
+    if(sceneryUpdate && !sceneryUpdateFiles.contains(&area))
+      continue;
+
     if(area.isActive() || options.isReadInactive())
     {
       if((aborted = progress->reportSceneryArea(&area)))
@@ -1359,7 +1511,7 @@ bool NavDatabase::loadFsxP3dMsfsSimulator(ProgressHandler *progress, db::DataWri
 
         // Read all BGL files in the scenery area into classes of the bgl namespace and
         // write the contents to the database
-        fsDataWriter->writeSceneryArea(area);
+        fsDataWriter->writeSceneryArea(area, sceneryUpdate ? sceneryUpdateFiles.value(&area) : QSet<QString>());
 
         if(sceneryError.hasFileOrSceneryErrors() && errors != nullptr)
         {
@@ -1385,7 +1537,7 @@ bool NavDatabase::loadFsxP3dMsfsSimulator(ProgressHandler *progress, db::DataWri
 bool NavDatabase::loadFsxP3dMsfsPost(ProgressHandler *progress)
 {
   QStringList scripts;
-  if(options.getSimulatorType() == FsPaths::MSFS_2024)
+  if(isAirportIndexDeferred())
     scripts.append("fs/db/create_ap_schema_index.sql");
   scripts.append("fs/db/create_indexes_post_load.sql");
 
@@ -1592,12 +1744,15 @@ bool NavDatabase::runScripts(ProgressHandler *progress, const QStringList& scrip
       return true;
   }
 
+  QElapsedTimer timer;
+  timer.start();
   for(const QString& scriptFile : scriptFiles)
   {
     if(!scriptFile.isEmpty())
     {
       script.executeScript(":/atools/resources/sql/" % scriptFile);
       db.commit();
+      qDebug() << Q_FUNC_INFO << scriptFile << "took" << timer.restart() << "ms";
     }
   }
 
@@ -1614,11 +1769,23 @@ bool NavDatabase::runScript(ProgressHandler *progress, const QString& scriptFile
       return true;
   }
 
+  QElapsedTimer timer;
+  timer.start();
   script.executeScript(":/atools/resources/sql/" % scriptFile);
   db.commit();
+  qDebug() << Q_FUNC_INFO << scriptFile << "took" << timer.elapsed() << "ms";
   return false;
 }
 
+bool NavDatabase::isAirportIndexDeferred() const
+{
+  FsPaths::SimulatorType sim = options.getSimulatorType();
+
+  // MSFS 2024, X-Plane and Navigraph do not query airports while loading. Defer the latter two only in bulk mode.
+  // FSX, P3D and MSFS 2020 need the index for the delete processor.
+  return sim == FsPaths::MSFS_2024 || (options.isBulkLoad() && (FsPaths::isAnyXplane(sim) || sim == FsPaths::NAVIGRAPH));
+}
+
 void NavDatabase::calculateRating(FsPaths::SimulatorType sim)
 {
   // Get all airports which have no rating yet. MSFS star airports are already assigned 5 n AirportWriter
@@ -2239,6 +2406,381 @@ int NavDatabase::nextAreaNum(const QList<atools::fs::scenery::SceneryArea>& area
   return areaNum;
 }
 
+NavDatabase::SceneryLibraryChange NavDatabase::checkSceneryLibraryChanges(const QList<atools::fs::scenery::SceneryArea>& areas)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  sceneryUpdateFileIds.clear();
+  sceneryUpdateFiles.clear();
+
+  // Hash options affecting content and versions ===========================================
+  QCryptographicHash optionsHash(QCryptographicHash::Sha1);
+  optionsHash.addData(options.getContentFingerprint().toUtf8());
+  optionsHash.addData(QStringLiteral("%1 %2 %3").arg(atools::version(), atools::gitRevision(), gitRevision).toUtf8());
+  sceneryOptionsFingerprint = QString::fromLatin1(optionsHash.result().toHex());
+
+  // Hash each area with layer and path, size and modification time of all files ====================
+  struct AreaFiles
+  {
+    const SceneryArea *area;
+    QString fingerprint;
+    QStringList filepaths;
+  };
+  QList<AreaFiles> areaFilesList;
+
+  // Map lowercase file path to size, modification time and area
+  struct CurrentFile
+  {
+    qint64 size, modified;
+    const SceneryArea *area;
+  };
+  QHash<QString, CurrentFile> currentFiles;
+  QStringList areaFingerprints;
+  atools::fs::scenery::FileResolver resolver(options, true /* noWarnings */);
+  for(const SceneryArea& area : areas)
+  {
+    if(area.isSimconnect())
+    {
+      qInfo() << Q_FUNC_INFO << "Cannot detect changes for SimConnect" << area;
+      return SCENERY_REBUILD;
+    }
+
+    AreaFiles areaFiles;
+    areaFiles.area = &area;
+    resolver.getFiles(area, &areaFiles.filepaths);
+    areaFiles.filepaths.sort();
+
+    QCryptographicHash areaHash(QCryptographicHash::Sha1);
+    areaHash.addData(QStringLiteral("%1 %2 %3").arg(area.getLayer()).arg(area.getTitle()).arg(area.getLocalPath()).toUtf8());
+    for(const QString& filepath : std::as_const(areaFiles.filepaths))
+    {
+      QFileInfo fileinfo(filepath);
+      QString path = atools::nativeCleanPath(filepath);
+      qint64 size = fileinfo.size(), modified = fileinfo.lastModified().toSecsSinceEpoch();
+      currentFiles.insert(path.toLower(), {size, modified, &area});
+      areaHash.addData(QStringLiteral("%1 %2 %3").arg(path).arg(size).arg(modified).toUtf8());
+    }
+    areaFiles.fingerprint = QString::fromLatin1(areaHash.result().toHex());
+    areaFingerprints.append(areaFiles.fingerprint);
+    areaFilesList.append(areaFiles);
+  }
+
+  // Store per area fingerprints in load order and combine them with options into one fingerprint
+  sceneryAreaFingerprints = areaFingerprints.join(' ');
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(sceneryOptionsFingerprint.toLatin1());
+  hash.addData(sceneryAreaFingerprints.toLatin1());
+  sceneryFingerprint = QString::fromLatin1(hash.result().toHex());
+
+  if(previousDb == nullptr || !previousDb->isOpen())
+  {
+    qInfo() << Q_FUNC_INFO << "No previous database";
+    return SCENERY_REBUILD;
+  }
+
+  atools::fs::db::DatabaseMeta previousMeta(previousDb);
+  if(!previousMeta.isValid() || !previousMeta.hasData() ||
+     previousMeta.getDatabaseVersion() != atools::fs::db::DatabaseMeta::getApplicationVersion() ||
+     previousMeta.getDataSource() != FsPaths::typeToShortName(options.getSimulatorType()))
+  {
+    qInfo() << Q_FUNC_INFO << "Previous database not usable" << previousMeta;
+    return SCENERY_REBUILD;
+  }
+
+  if(previousMeta.getPropertyValue(atools::fs::db::PROPERTYNAME_SCENERY_FINGERPRINT) == sceneryFingerprint)
+  {
+    qInfo() << Q_FUNC_INFO << "Unchanged files" << currentFiles.size() << "time" << timer.elapsed() << "ms";
+    return SCENERY_UNCHANGED;
+  }
+
+  if(previousMeta.getPropertyValue(atools::fs::db::PROPERTYNAME_SCENERY_OPTIONS_FINGERPRINT) != sceneryOptionsFingerprint)
+  {
+    qInfo() << Q_FUNC_INFO << "Options or version changed";
+    return SCENERY_REBUILD;
+  }
+
+  // Files containing navdata in the previous database ===========================================
+  // Removed files are deleted and changed files are deleted and loaded again
+  QSet<int> deleteFileIds;
+  QSet<QString> loadFiles, previousNavdataFiles;
+  SqlQuery query(previousDb);
+  query.exec("select f.bgl_file_id, f.filepath, f.size, f.file_modification_time, s.layer, s.title "
+             "from bgl_file f join scenery_area s on f.scenery_area_id = s.scenery_area_id");
+  while(query.next())
+  {
+    QString path = query.valueStr("filepath").toLower();
+    int fileId = query.valueInt("bgl_file_id");
+    auto it = currentFiles.constFind(path);
+    if(it == currentFiles.constEnd())
+    {
+      qInfo() << Q_FUNC_INFO << "Removed" << path;
+      deleteFileIds.insert(fileId);
+    }
+    else if(it->area->getLayer() != query.valueInt("layer") || it->area->getTitle() != query.valueStr("title"))
+    {
+      // Load order and area references change
+      qInfo() << Q_FUNC_INFO << "Changed area with navdata" << *it->area;
+      return SCENERY_REBUILD;
+    }
+    else if(it->size != query.value("size").toLongLong() || it->modified != query.value("file_modification_time").toLongLong())
+    {
+      qInfo() << Q_FUNC_INFO << "Changed" << path;
+      deleteFileIds.insert(fileId);
+      loadFiles.insert(path);
+    }
+    previousNavdataFiles.insert(path);
+  }
+
+  // Read changed files and files in new or changed areas which had no navdata before ===========================================
+  const QStringList previousList = previousMeta.getPropertyValue(atools::fs::db::PROPERTYNAME_SCENERY_AREA_FINGERPRINTS).
+                                   split(' ', Qt::SkipEmptyParts);
+  const QSet<QString> previousAreaFingerprints(previousList.constBegin(), previousList.constEnd());
+  QSet<QString> airportIdents;
+  bool loadedNavaids = false;
+  int numChangedAreas = 0, numCheckedFiles = 0;
+  for(const AreaFiles& areaFiles : std::as_const(areaFilesList))
+  {
+    bool changedArea = !previousAreaFingerprints.contains(areaFiles.fingerprint);
+    if(changedArea)
+      numChangedAreas++;
+
+    for(const QString& filepath : std::as_const(areaFiles.filepaths))
+    {
+      QString path = atools::nativeCleanPath(filepath).toLower();
+      if(!loadFiles.contains(path) && !(changedArea && !previousNavdataFiles.contains(path)))
+        continue;
+
+      atools::fs::bgl::BglFile bglFile(&options);
+      bglFile.setSupportedSectionTypes(atools::fs::db::DataWriter::getSupportedSectionTypes());
+      try
+      {
+        bglFile.readFile(filepath, *areaFiles.area);
+      }
+      catch(std::exception& e)
+      {
+        // Let the full compilation report the error
+        qWarning() << Q_FUNC_INFO << "Error reading" << filepath << e.what();
+        return SCENERY_REBUILD;
+      }
+      numCheckedFiles++;
+
+      if(bglFile.isValid() && bglFile.hasContent())
+      {
+        // Airways are resolved across all files
+        for(const atools::fs::bgl::Waypoint *waypoint : bglFile.getWaypoints())
+        {
+          if(!waypoint->getAirways().isEmpty())
+          {
+            qInfo() << Q_FUNC_INFO << "Airways in" << filepath;
+            return SCENERY_REBUILD;
+          }
+        }
+
+        for(const atools::fs::bgl::Airport *airport : bglFile.getAirports())
+          airportIdents.insert(airport->getIdent());
+
+        loadedNavaids |= !bglFile.getWaypoints().isEmpty() || !bglFile.getVors().isEmpty() || !bglFile.getTacans().isEmpty() ||
+                         !bglFile.getNdbs().isEmpty() || !bglFile.getMarker().isEmpty() || !bglFile.getIls().isEmpty();
+
+        if(!loadFiles.contains(path))
+          qInfo() << Q_FUNC_INFO << "New navdata in" << filepath << "area" << *areaFiles.area;
+        loadFiles.insert(path);
+      }
+    }
+  }
+
+  if(deleteFileIds.isEmpty() && loadFiles.isEmpty())
+  {
+    // Only files and areas without navdata were added, changed or removed
+    qInfo() << Q_FUNC_INFO << "Unchanged navdata files" << currentFiles.size() << "changed areas without navdata" << numChangedAreas
+            << "checked files" << numCheckedFiles << "time" << timer.elapsed() << "ms";
+
+    // Store fingerprints to avoid reading the changed areas again on next compilation
+    try
+    {
+      previousMeta.addProperty(atools::fs::db::PROPERTYNAME_SCENERY_FINGERPRINT, sceneryFingerprint);
+      previousMeta.addProperty(atools::fs::db::PROPERTYNAME_SCENERY_AREA_FINGERPRINTS, sceneryAreaFingerprints);
+      previousMeta.updateProperties();
+    }
+    catch(std::exception& e)
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot update fingerprints in previous database" << e.what();
+    }
+    return SCENERY_UNCHANGED;
+  }
+
+  // Add all files containing airports with the same idents as deleted or loaded airports ======================
+  // The delete processor replaces airports by ident in load order which needs all files of an ident
+  SqlQuery identQuery(previousDb);
+  identQuery.prepare("select ident from airport_file where file_id = :id");
+  for(int fileId : std::as_const(deleteFileIds))
+  {
+    identQuery.bindValue(":id", fileId);
+    identQuery.exec();
+    while(identQuery.next())
+      airportIdents.insert(identQuery.valueStr(0));
+  }
+
+  SqlQuery fileQuery(previousDb);
+  fileQuery.prepare("select f.bgl_file_id, f.filepath from airport_file a join bgl_file f on a.file_id = f.bgl_file_id "
+                    "where a.ident = :ident");
+  QStringList identQueue(airportIdents.constBegin(), airportIdents.constEnd());
+  while(!identQueue.isEmpty())
+  {
+    fileQuery.bindValue(":ident", identQueue.takeLast());
+    fileQuery.exec();
+    while(fileQuery.next())
+    {
+      int fileId = fileQuery.valueInt("bgl_file_id");
+      if(deleteFileIds.contains(fileId))
+        continue;
+
+      // Unchanged file - delete and load again
+      deleteFileIds.insert(fileId);
+      loadFiles.insert(fileQuery.valueStr("filepath").toLower());
+
+      identQuery.bindValue(":id", fileId);
+      identQuery.exec();
+      while(identQuery.next())
+      {
+        QString ident = identQuery.valueStr(0);
+        if(!airportIdents.contains(ident))
+        {
+          airportIdents.insert(ident);
+          identQueue.append(ident);
+        }
+      }
+    }
+  }
+
+  // Loading more than a quarter of all files is not much faster than a full compilation
+  if(loadFiles.size() > previousNavdataFiles.size() / 4)
+  {
+    qInfo() << Q_FUNC_INFO << "Too many files to update" << loadFiles.size() << "of" << previousNavdataFiles.size();
+    return SCENERY_REBUILD;
+  }
+
+  // Check previous content of files to delete ===========================================
+  QStringList idList;
+  for(int fileId : std::as_const(deleteFileIds))
+    idList.append(QString::number(fileId));
+  QString fileCriteria = "file_id in (" % idList.join(',') % ")";
+
+  SqlUtil previousUtil(previousDb);
+  if(previousUtil.rowCount("waypoint", fileCriteria % " and (num_victor_airway > 0 or num_jet_airway > 0)") > 0)
+  {
+    qInfo() << Q_FUNC_INFO << "Airways in changed files";
+    return SCENERY_REBUILD;
+  }
+
+  if(options.isDeduplicate())
+  {
+    // Duplicates are removed by keeping the last loaded navaid
+    const static QStringList NAVAID_TABLES({"waypoint", "vor", "ndb", "marker", "ils"});
+    bool deletedNavaids = false;
+    for(const QString& table : NAVAID_TABLES)
+      deletedNavaids |= previousUtil.rowCount(table, fileCriteria) > 0;
+
+    if(deletedNavaids || loadedNavaids)
+    {
+      qInfo() << Q_FUNC_INFO << "Changed navaids with deduplication";
+      return SCENERY_REBUILD;
+    }
+  }
+
+  // Collect files to load per area in area order ===========================================
+  sceneryUpdateFileIds = QList<int>(deleteFileIds.constBegin(), deleteFileIds.constEnd());
+  std::sort(sceneryUpdateFileIds.begin(), sceneryUpdateFileIds.end());
+  for(const QString& path : std::as_const(loadFiles))
+  {
+    auto it = currentFiles.constFind(path);
+    if(it != currentFiles.constEnd())
+      sceneryUpdateFiles[it->area].insert(path);
+  }
+
+  qInfo() << Q_FUNC_INFO << "Files to delete" << deleteFileIds.size() << "files to load" << loadFiles.size()
+          << "airport idents" << airportIdents.size() << "checked files" << numCheckedFiles << "time" << timer.elapsed() << "ms";
+  return SCENERY_UPDATE;
+}
+
+bool NavDatabase::prepareSceneryUpdate(ProgressHandler *progress)
+{
+  if((aborted = progress->reportOther(tr("Copying previous database"))))
+    return true;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Tables which are filled on each compilation
+  const static QStringList EXCLUDED_TABLES({"metadata", "script", "magdecl", "translation"});
+
+  // Get tables and columns of the new schema before attaching
+  SqlUtil util(db);
+  QList<std::pair<QString, QString> > tableColumns;
+  const QStringList tables = db.tables();
+  for(const QString& table : tables)
+  {
+    if(!EXCLUDED_TABLES.contains(table) && !table.startsWith("sqlite_"))
+      tableColumns.append(std::make_pair(table, util.buildColumnList(table).join(", ")));
+  }
+
+  // Copy all data from the previous database which has the same schema version
+  db.commit();
+  db.attachDatabase(previousDb->databaseName(), "prev");
+  for(const std::pair<QString, QString>& tableColumn : std::as_const(tableColumns))
+    db.exec("insert into " % tableColumn.first % " (" % tableColumn.second % ") select " % tableColumn.second %
+            " from prev." % tableColumn.first);
+  db.commit();
+  db.detachDatabase("prev");
+
+  // Remove content of changed and removed files ===================
+  db.exec("drop table if exists tmp_incremental_file");
+  db.exec("create table tmp_incremental_file (file_id integer primary key)");
+  SqlQuery insert(db);
+  insert.prepare("insert into tmp_incremental_file (file_id) values(:id)");
+  for(int fileId : std::as_const(sceneryUpdateFileIds))
+  {
+    insert.bindValue(":id", fileId);
+    insert.exec();
+  }
+  db.commit();
+
+  qDebug() << Q_FUNC_INFO << "Copying took" << timer.elapsed() << "ms";
+
+  return runScript(progress, "fs/db/incremental_delete.sql", tr("Removing changed scenery"));
+}
+
+bool NavDatabase::postProcessSceneryUpdate(ProgressHandler *progress)
+{
+  FsPaths::SimulatorType sim = options.getSimulatorType();
+
+  if(sim != FsPaths::MSFS && sim != FsPaths::MSFS_2024)
+  {
+    // Create VORTACs - TACANs of unchanged files are already merged and removed
+    if((aborted = runScript(progress, "fs/db/update_vor.sql", tr("Merging VOR and TACAN to VORTAC"))))
+      return true;
+  }
+
+  // Set the nav_ids, airport ids, runway ids and region for new rows and rows referencing changed airports
+  if((aborted = runScript(progress, "fs/db/incremental_update.sql", tr("Updating waypoints, navaids and airports"))))
+    return true;
+
+  if(sim == FsPaths::MSFS || sim == FsPaths::MSFS_2024)
+  {
+    if((aborted = runScript(progress, "fs/db/incremental_update_ils_msfs.sql", tr("Updating ILS"))))
+      return true;
+  }
+  else
+  {
+    if((aborted = runScript(progress, "fs/db/incremental_update_ils.sql", tr("Updating ILS"))))
+      return true;
+  }
+
+  // Update ILS count, nav_search table and scenery areas
+  return runScript(progress, "fs/db/incremental_finish.sql", tr("Collecting navaids for search"));
+}
+
 void NavDatabase::countFiles(ProgressHandler *progress, const QList<atools::fs::scenery::SceneryArea>& areas,
                              int& numFiles, int& numSceneryAreas)
 {
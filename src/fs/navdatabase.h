@@ -24,6 +24,8 @@
 #include <QDebug>
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QSet>
+#include <QHash>
 
 namespace atools {
 namespace win {
@@ -132,6 +134,17 @@ public:
     libraryName = libraryNameParam;
   }
 
+  /* Previous database compiled for the same simulator. Used to detect changes in the scenery library if
+   * NavDatabaseOptions::isIncremental() is set. compileDatabase() returns COMPILE_UNCHANGED without writing
+   * anything if the scenery library did not change. Only the fingerprints in the metadata of the previous database
+   * are updated in this case.
+   * compileDatabase() copies the previous database and loads only changed files if possible and returns COMPILE_UPDATED.
+   * Not owned. */
+  void setPreviousDatabase(atools::sql::SqlDatabase *value)
+  {
+    previousDb = value;
+  }
+
 private:
   /* Creates database schema only */
   void createSchemaInternal(atools::fs::ProgressHandler *progress = nullptr);
@@ -164,6 +177,33 @@ private:
 
   bool loadFsxP3dMsfsPost(ProgressHandler *progress);
 
+  /* true if airport indexes are not created with the schema but after loading the airports */
+  bool isAirportIndexDeferred() const;
+
+  /* Result of checkSceneryLibraryChanges() */
+  enum SceneryLibraryChange
+  {
+    SCENERY_REBUILD, /* Full compilation needed */
+    SCENERY_UNCHANGED, /* Previous database can be kept */
+    SCENERY_UPDATE /* Previous database can be copied and updated with the files in sceneryUpdateFiles */
+  };
+
+  /* Calculates fingerprints from options affecting content and from layer, path, size and modification time
+   * of all files for each area and compares them with the previous database.
+   * Returns SCENERY_UNCHANGED if all fingerprints are equal or if options are equal and only areas without navdata changed.
+   * Stores the new fingerprints in the previous database in the latter case.
+   * Returns SCENERY_UPDATE if files with navdata were added, changed or removed. Files to delete and to load again
+   * are stored in sceneryUpdateFileIds and sceneryUpdateFiles. All files containing airports with the same idents
+   * are loaded again too to keep the replacement order of add-on airports.
+   * Changes which affect airways, navaids if deduplication is enabled or areas moved to another layer need a rebuild. */
+  SceneryLibraryChange checkSceneryLibraryChanges(const QList<atools::fs::scenery::SceneryArea>& areas);
+
+  /* Copy previous database into the empty schema and remove content of changed and removed files */
+  bool prepareSceneryUpdate(atools::fs::ProgressHandler *progress);
+
+  /* Update references for new rows after loading changed files. Replaces the full post processing. */
+  bool postProcessSceneryUpdate(atools::fs::ProgressHandler *progress);
+
   /* Navigraph / DFD */
   bool loadDfd(atools::fs::ProgressHandler *progress, atools::fs::ng::DfdCompiler *dfdCompiler,
                const atools::fs::scenery::SceneryArea& area);
@@ -227,6 +267,16 @@ private:
   bool aborted = false;
   QString gitRevision;
   atools::fs::ResultFlags result = atools::fs::COMPILE_NONE;
+
+  /* Used for incremental compilation */
+  atools::sql::SqlDatabase *previousDb = nullptr;
+  QString sceneryFingerprint, sceneryOptionsFingerprint, sceneryAreaFingerprints;
+
+  /* Incremental update. bgl_file_id of changed and removed files in the previous database and lowercase native paths
+   * of files to load per area */
+  bool sceneryUpdate = false;
+  QList<int> sceneryUpdateFileIds;
+  QHash<const atools::fs::scenery::SceneryArea *, QSet<QString> > sceneryUpdateFiles;
 };
 
 } // namespace fs
@@ -33,6 +33,9 @@ enum ResultFlag : quint32
   COMPILE_MSFS_NAVIGRAPH_FOUND = 1 << 1, /* Found MSFS Navigraph installation during compilation */
   COMPILE_CANCELED = 1 << 2, /* User clicked cancel on progress */
   COMPILE_FAILED = 1 << 3, /* Caught exception */
+  COMPILE_UNCHANGED = 1 << 4, /* Incremental mode and scenery library did not change. Nothing was written and
+                               * the previous database is still valid. */
+  COMPILE_UPDATED = 1 << 5, /* Incremental mode and the previous database was copied and updated with changed files only */
 };
 
 ATOOLS_DECLARE_FLAGS_32(ResultFlags, atools::fs::ResultFlag)
@@ -25,6 +25,8 @@
 #include <QDir>
 #include <QSettings>
 
+#include <algorithm>
+
 namespace atools {
 namespace fs {
 
@@ -256,6 +258,11 @@ void NavDatabaseOptions::loadFromSettings(QSettings& settings)
   setFlag(type::ANALYZE_DATABASE, settings.value("Options/AnalyzeDatabase", true).toBool());
   setFlag(type::DROP_INDEXES, settings.value("Options/DropAllIndexes", false).toBool());
   setFlag(type::DROP_TEMP_TABLES, settings.value("Options/DropTempTables", true).toBool());
+  setFlag(type::BGL_STREAM_READER, settings.value("Options/BglStreamReader", false).toBool());
+  setFlag(type::INCREMENTAL, settings.value("Options/Incremental", false).toBool());
+  setFlag(type::BULK_LOAD, settings.value("Options/BulkLoad", false).toBool());
+  setCompileThreads(settings.value("Options/CompileThreads", 1).toInt());
+  setCacheDirectory(settings.value("Options/CacheDirectory").toString());
 
   setSimConnectAirportFetchDelay(settings.value("Options/SimConnectAirportFetchDelay", 100).toInt());
   setSimConnectNavaidFetchDelay(settings.value("Options/SimConnectNavaidFetchDelay", 50).toInt());
@@ -367,6 +374,54 @@ QString patternStr(const QList<QRegularExpression>& list)
   return retval.join(", ");
 }
 
+QString NavDatabaseOptions::getContentFingerprint() const
+{
+  // Flags which do not change content
+  const type::OptionFlags IGNORED_FLAGS = type::VERBOSE | type::AUTOCOMMIT | type::DATABASE_REPORT | type::BASIC_VALIDATION |
+                                          type::VACUUM_DATABASE | type::ANALYZE_DATABASE | type::BGL_STREAM_READER |
+                                          type::INCREMENTAL | type::BULK_LOAD | type::DROP_INDEXES;
+
+  auto sortedPatterns = [](const QList<QRegularExpression>& list) -> QString {
+                          QStringList patterns;
+                          for(const QRegularExpression& regexp : list)
+                            patterns.append(regexp.pattern());
+                          patterns.sort();
+                          return patterns.join('\n');
+                        };
+
+  auto sortedTypes = [](const QSet<type::NavDbObjectType>& set) -> QString {
+                       QList<int> types;
+                       for(type::NavDbObjectType type : set)
+                         types.append(static_cast<int>(type));
+                       std::sort(types.begin(), types.end());
+
+                       QStringList typeStr;
+                       for(int type : std::as_const(types))
+                         typeStr.append(QString::number(type));
+                       return typeStr.join(',');
+                     };
+
+  QStringList dirIncludes(dirIncludesGui);
+  dirIncludes.sort();
+
+  QStringList values;
+  values << QString::number((flags & ~IGNORED_FLAGS).asFlagType(), 16)
+         << FsPaths::typeToShortName(simulatorType) << language
+         << sceneryFile << basepath << msfsCommunityPath << msfsOfficialPath << sourceDatabase << timeZoneDatabase
+         << sortedPatterns(fileFiltersInc) << sortedPatterns(fileFiltersExcl)
+         << sortedPatterns(pathFiltersInc) << sortedPatterns(pathFiltersExcl)
+         << sortedPatterns(airportIcaoFiltersInc) << sortedPatterns(airportIcaoFiltersExcl)
+         << sortedPatterns(addonFiltersInc) << sortedPatterns(addonFiltersExcl)
+         << sortedPatterns(highPriorityFiltersInc)
+         << dirIncludes.join('\n')
+         << sortedPatterns(dirExcludesGui) << sortedPatterns(fileExcludesGui)
+         << sortedPatterns(dirAddonExcludesGui) << sortedPatterns(fileAddonExcludesGui)
+         << sortedTypes(navDbObjectTypeFiltersInc) << sortedTypes(navDbObjectTypeFiltersExcl);
+
+  // Use a separator which does not appear in paths or patterns
+  return values.join(QChar(0x1f));
+}
+
 QDebug operator<<(QDebug out, const NavDatabaseOptions& opts)
 {
   QDebugStateSaver saver(out);
@@ -378,6 +433,7 @@ QDebug operator<<(QDebug out, const NavDatabaseOptions& opts)
   out << ", SimConnectBatchSize \"" << opts.simConnectBatchSize << "\"";
   out << ", SimConnectLoadDisconnected \"" << opts.simConnectLoadDisconnected << "\"";
   out << ", SimConnectLoadDisconnectedFile \"" << opts.simConnectLoadDisconnectedFile << "\"";
+  out << ", CompileThreads \"" << opts.compileThreads << "\"";
   out << ", sceneryFile \"" << opts.sceneryFile << "\"";
   out << ", basepath \"" << opts.basepath << "\"";
   out << ", msfsCommunityPath \"" << opts.msfsCommunityPath << "\"";
@@ -146,6 +146,18 @@ enum OptionFlag : quint32
 
   /* Remove temporary tables */
   DROP_TEMP_TABLES = 1 << 16,
+
+  /* Read BGL files through QDataStream instead of memory mapping them. Only for comparison and debugging. */
+  BGL_STREAM_READER = 1 << 17,
+
+  /* Compare the scenery library with the previous database given in NavDatabase::setPreviousDatabase()
+   * and skip compilation if options are equal and no file containing navdata was added, changed or removed.
+   * FSX, P3D and MSFS 2020 only. */
+  INCREMENTAL = 1 << 18,
+
+  /* Compile with SQLite pragmas tuned for bulk loading and create more indexes after loading.
+   * Journal is kept in memory and synchronous writing is off. Pragmas are restored when done. */
+  BULK_LOAD = 1 << 19,
 };
 
 ATOOLS_DECLARE_FLAGS_32(OptionFlags, atools::fs::type::OptionFlag)
@@ -260,6 +272,15 @@ public:
     flags.setFlag(type::AUTOCOMMIT, value);
   }
 
+  /*
+   * True: Use pragmas for bulk loading and defer index creation where possible. Default is false.
+   * Autocommit is ignored in this mode.
+   */
+  void setBulkLoad(bool value)
+  {
+    flags.setFlag(type::BULK_LOAD, value);
+  }
+
   /*
    * Fill the airway table and connect all waypoints of a route. Default is true.
    */
@@ -366,11 +387,31 @@ public:
     return flags.testFlag(type::VERBOSE);
   }
 
+  bool isBglStreamReader() const
+  {
+    return flags.testFlag(type::BGL_STREAM_READER);
+  }
+
+  bool isIncremental() const
+  {
+    return flags.testFlag(type::INCREMENTAL);
+  }
+
+  /* Canonical text of all options which change the content of the database. Used for incremental compilation.
+   * Options which change only performance or logging like threads and verbose are omitted.
+   * Lists and sets are sorted to be independent of the order of insertion. */
+  QString getContentFingerprint() const;
+
   bool isAutocommit() const
   {
     return flags.testFlag(type::AUTOCOMMIT);
   }
 
+  bool isBulkLoad() const
+  {
+    return flags.testFlag(type::BULK_LOAD);
+  }
+
   bool isIncomplete() const
   {
     return flags.testFlag(type::INCOMPLETE);
@@ -523,6 +564,19 @@ public:
     simConnectBatchSize = value;
   }
 
+  /* Number of threads used to read BGL files of a scenery area or X-Plane custom apt.dat files concurrently.
+   * 1 reads sequentially and 0 uses the number of available cores. Default is 1.
+   * Database writing and ID assignment is always done in file order in the calling thread. */
+  int getCompileThreads() const
+  {
+    return compileThreads;
+  }
+
+  void setCompileThreads(int value)
+  {
+    compileThreads = value;
+  }
+
   bool getSimConnectLoadDisconnected() const
   {
     return simConnectLoadDisconnected;
@@ -553,6 +607,17 @@ public:
     timeZoneDatabase = newTimezoneDatabase;
   }
 
+  /* Directory for caching parsed data like airspace geometry across compilations. Disabled if empty. Default is empty. */
+  const QString& getCacheDirectory() const
+  {
+    return cacheDirectory;
+  }
+
+  void setCacheDirectory(const QString& value)
+  {
+    cacheDirectory = value;
+  }
+
 private:
   friend QDebug operator<<(QDebug out, const atools::fs::NavDatabaseOptions& opts);
 
@@ -595,7 +660,7 @@ private:
   /* Elements set from GUI. Not loaded from config file */
   QList<QRegularExpression> dirExcludesGui, fileExcludesGui, dirAddonExcludesGui, fileAddonExcludesGui;
   QStringList dirIncludesGui;
-  QString timeZoneDatabase;
+  QString timeZoneDatabase, cacheDirectory;
 
   QSet<atools::fs::type::NavDbObjectType> navDbObjectTypeFiltersInc, navDbObjectTypeFiltersExcl;
 
@@ -603,6 +668,7 @@ private:
   bool callDefaultCallback = true;
 
   int simConnectAirportFetchDelay = 100, simConnectNavaidFetchDelay = 50, simConnectBatchSize = 2000;
+  int compileThreads = 1;
   bool simConnectLoadDisconnected = true, simConnectLoadDisconnectedFile = false;
 
   atools::fs::FsPaths::SimulatorType simulatorType = atools::fs::FsPaths::FSX;
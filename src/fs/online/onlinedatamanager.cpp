@@ -32,6 +32,7 @@
 
 using atools::sql::SqlDatabase;
 using atools::sql::SqlQuery;
+using atools::sql::SqlColumnBatch;
 using atools::sql::SqlTransaction;
 using atools::sql::SqlUtil;
 using atools::sql::SqlRecord;
@@ -215,20 +216,42 @@ sql::SqlRecordList OnlinedataManager::getClientRecordsByCallsign(const QString&
 
 QList<OnlineAircraft> OnlinedataManager::getClientCallsignAndPosMap()
 {
-  QList<OnlineAircraft> clientMap;
+  // Column indexes
+  enum
+  {
+    CLIENT_ID,
+    VID,
+    CALLSIGN,
+    GROUNDSPEED,
+    HEADING,
+    ALTITUDE,
+    LONX,
+    LATY
+  };
+
   SqlQuery query(QStringLiteral("select client_id, vid, callsign, groundspeed, heading, altitude, lonx, laty from client"), db);
+  query.setForwardOnly(true);
   query.exec();
-  while(query.next())
-    clientMap.append(OnlineAircraft(query.valueInt(QStringLiteral("client_id")),
-                                    query.valueStr(QStringLiteral("vid")),
-                                    query.valueStr(QStringLiteral("callsign")),
-                                    atools::fs::sc::SimConnectAircraft::airplaneRegistrationToKey(query.valueStr(QStringLiteral(
-                                                                                                                   "callsign"))),
-                                    query.valueFloat(QStringLiteral("groundspeed")),
-                                    query.valueFloat(QStringLiteral("heading")),
-                                    atools::geo::Pos(query.valueFloat(QStringLiteral("lonx")),
-                                                     query.valueFloat(QStringLiteral("laty")),
-                                                     query.valueFloat(QStringLiteral("altitude")))));
+
+  // Read all rows by column at once
+  SqlColumnBatch batch;
+  int clientIdIdx = batch.addInt(CLIENT_ID), vidIdx = batch.addStr(VID), callsignIdx = batch.addStr(CALLSIGN);
+  int groundspeedIdx = batch.addFloat(GROUNDSPEED), headingIdx = batch.addFloat(HEADING), altitudeIdx = batch.addFloat(ALTITUDE),
+      lonxIdx = batch.addFloat(LONX), latyIdx = batch.addFloat(LATY);
+  int rows = query.fetchColumns(batch);
+
+  const QList<int>& clientIds = batch.ints(clientIdIdx);
+  const QStringList& vids = batch.strs(vidIdx), & callsigns = batch.strs(callsignIdx);
+  const QList<float>& groundspeeds = batch.floats(groundspeedIdx), & headings = batch.floats(headingIdx),
+  & altitudes = batch.floats(altitudeIdx), & lonxs = batch.floats(lonxIdx), & latys = batch.floats(latyIdx);
+
+  QList<OnlineAircraft> clientMap;
+  clientMap.reserve(rows);
+  for(int row = 0; row < rows; row++)
+    clientMap.append(OnlineAircraft(clientIds.at(row), vids.at(row), callsigns.at(row),
+                                    atools::fs::sc::SimConnectAircraft::airplaneRegistrationToKey(callsigns.at(row)),
+                                    groundspeeds.at(row), headings.at(row),
+                                    atools::geo::Pos(lonxs.at(row), latys.at(row), altitudes.at(row))));
   return clientMap;
 }
 
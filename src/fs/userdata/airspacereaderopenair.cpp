@@ -24,8 +24,13 @@
 #include "exception.h"
 #include "sql/sqlquery.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
 #include <QFile>
 #include <QRegularExpression>
+#include <QSaveFile>
 
 using atools::sql::SqlQuery;
 using atools::geo::Pos;
@@ -40,6 +45,16 @@ namespace userdata {
 // Extract values from AH and AL values
 static QRegularExpression MATCH_ALT("^(FL)?\\s*([0-9]+)\\s*(FL|FT|M[ $])?\\s*(AMSL|MSL|AGL|GND|AAGL|ASFC)?");
 
+// Cache file header - increment version if parsing or tessellation changes
+const static quint32 CACHE_MAGIC = 0x4F50414Eu;
+const static quint32 CACHE_VERSION = 1;
+
+// Cache files not used for this time are deleted
+const static int CACHE_MAX_AGE_DAYS = 90;
+
+// Least recently used cache files are deleted if all files exceed this size
+const static qint64 CACHE_MAX_SIZE_BYTES = 256L * 1024L * 1024L;
+
 AirspaceReaderOpenAir::AirspaceReaderOpenAir(atools::sql::SqlDatabase *sqlDb)
   : AirspaceReaderBase(sqlDb)
 {
@@ -57,6 +72,9 @@ bool AirspaceReaderOpenAir::readFile(const QString& filenameParam)
 
   filename = filenameParam;
 
+  if(readCachedFile(filename, fileId))
+    return true;
+
   QFile file(filename);
   if(file.open(QIODevice::ReadOnly | QIODevice::Text))
   {
@@ -167,6 +185,9 @@ void AirspaceReaderOpenAir::writeBoundary()
       insertAirspaceQuery->bindNullStr(":multiple_code");
       insertAirspaceQuery->bindValue(":time_code", "U");
 
+      if(!cacheFilepath.isEmpty())
+        cacheAirspaces.append(insertAirspaceQuery->boundPlaceholderAndValueMap());
+
       insertAirspaceQuery->exec();
 
       numAirspacesRead++;
@@ -392,6 +413,128 @@ void AirspaceReaderOpenAir::bindAltitude(const QStringList& line, bool isMax)
 void AirspaceReaderOpenAir::finish()
 {
   writeBoundary();
+
+  if(!cacheFilepath.isEmpty())
+    saveCache();
+}
+
+bool AirspaceReaderOpenAir::readCachedFile(const QString& filenameParam, int fileIdParam)
+{
+  cacheFilepath.clear();
+  cacheAirspaces.clear();
+
+  if(cacheDirectory.isEmpty())
+    return false;
+
+  filename = filenameParam;
+  fileId = fileIdParam;
+
+  // Build key from file content and table layout ================
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray::number(CACHE_VERSION));
+  hash.addData(insertAirspaceQuery->getPlaceholderList().join(',').toUtf8());
+  hash.addData(&file);
+  file.close();
+
+  cacheFilepath = QDir(cacheDirectory).filePath(QString::fromLatin1(hash.result().toHex()) + ".openair");
+
+  QFile cacheFile(cacheFilepath);
+  if(!cacheFile.open(QIODevice::ReadOnly))
+    // Not cached yet - collect airspaces in writeBoundary() and save in finish()
+    return false;
+
+  QDataStream in(&cacheFile);
+  in.setVersion(QDataStream::Qt_5_5);
+
+  quint32 magic = 0, version = 0;
+  QList<QMap<QString, QVariant> > airspaces;
+  in >> magic >> version >> airspaces;
+
+  if(in.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION)
+  {
+    qWarning() << Q_FUNC_INFO << "Invalid cache file" << cacheFilepath;
+    return false;
+  }
+
+  // Write cached airspaces using current ids ================
+  for(const QMap<QString, QVariant>& values : std::as_const(airspaces))
+  {
+    for(auto it = values.constBegin(); it != values.constEnd(); ++it)
+    {
+      if(insertAirspaceQuery->hasPlaceholder(it.key()))
+        insertAirspaceQuery->bindValue(it.key(), it.value());
+    }
+
+    insertAirspaceQuery->bindValue(":boundary_id", airspaceId++);
+    insertAirspaceQuery->bindValue(":file_id", fileId);
+    insertAirspaceQuery->exec();
+    numAirspacesRead++;
+  }
+  insertAirspaceQuery->clearBoundValues();
+
+  qDebug() << Q_FUNC_INFO << "Read" << airspaces.size() << "airspaces for" << filename << "from cache" << cacheFilepath;
+
+  // Modification time marks last use for cleanCache()
+  cacheFile.close();
+  if(cacheFile.open(QIODevice::ReadWrite))
+  {
+    cacheFile.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    cacheFile.close();
+  }
+
+  cacheFilepath.clear();
+  return true;
+}
+
+void AirspaceReaderOpenAir::saveCache()
+{
+  QDir().mkpath(cacheDirectory);
+
+  QSaveFile cacheFile(cacheFilepath);
+  if(cacheFile.open(QIODevice::WriteOnly))
+  {
+    QDataStream out(&cacheFile);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << CACHE_MAGIC << CACHE_VERSION << cacheAirspaces;
+
+    if(!cacheFile.commit())
+      qWarning() << Q_FUNC_INFO << "Cannot write cache file" << cacheFilepath << cacheFile.errorString();
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "Cannot open cache file" << cacheFilepath << cacheFile.errorString();
+
+  cacheFilepath.clear();
+  cacheAirspaces.clear();
+
+  cleanCache();
+}
+
+void AirspaceReaderOpenAir::cleanCache()
+{
+  // Newest first
+  QFileInfoList entries = QDir(cacheDirectory).entryInfoList({QStringLiteral("*.openair")}, QDir::Files, QDir::Time);
+
+  QDateTime oldest = QDateTime::currentDateTimeUtc().addDays(-CACHE_MAX_AGE_DAYS);
+  qint64 size = 0;
+  int removed = 0;
+  for(const QFileInfo& entry : std::as_const(entries))
+  {
+    size += entry.size();
+    if(entry.lastModified() < oldest || size > CACHE_MAX_SIZE_BYTES)
+    {
+      if(QFile::remove(entry.absoluteFilePath()))
+        removed++;
+      else
+        qWarning() << Q_FUNC_INFO << "Cannot remove cache file" << entry.absoluteFilePath();
+    }
+  }
+
+  if(removed > 0)
+    qDebug() << Q_FUNC_INFO << "Removed" << removed << "cache files from" << cacheDirectory;
 }
 
 void AirspaceReaderOpenAir::reset()
@@ -22,6 +22,9 @@
 
 #include "fs/userdata/airspacereaderbase.h"
 
+#include <QMap>
+#include <QVariant>
+
 namespace atools {
 
 namespace sql {
@@ -57,7 +60,31 @@ public:
   /* reset internal values back */
   virtual void reset() override;
 
+  /* Directory for the binary cache of parsed and tessellated airspaces. Cache files are keyed by a hash of the
+   * airspace file content. Caching is disabled if empty which is the default.
+   * Files unused for 90 days and least recently used files above 256 MB in total are deleted when saving. */
+  void setCacheDirectory(const QString& value)
+  {
+    cacheDirectory = value;
+  }
+
+  const QString& getCacheDirectory() const
+  {
+    return cacheDirectory;
+  }
+
+  /* Writes all airspaces of the file to the table from the cache if the file content is unchanged since it was read last.
+   * Returns false if caching is disabled or file is not cached. Airspaces written by following readLine()
+   * and finish() calls are saved to the cache in the latter case. Called by readFile().
+   * Warnings are not repeated when reading from cache. */
+  bool readCachedFile(const QString& filenameParam, int fileIdParam);
+
 private:
+  /* Write values collected by writeBoundary() to cache file */
+  void saveCache();
+
+  /* Delete cache files by age and total size. Modification time is last use. */
+  void cleanCache();
   void writeBoundary();
   void bindAltitude(const QStringList& line, bool isMax);
   void bindClass(const QString& cls);
@@ -68,6 +95,12 @@ private:
   atools::geo::LineString curLine;
   atools::geo::Pos center;
   bool clockwise = true;
+
+  /* Cache file path for current file. Empty if not caching. */
+  QString cacheDirectory, cacheFilepath;
+
+  /* Bound values for each airspace written since readCachedFile() */
+  QList<QMap<QString, QVariant> > cacheAirspaces;
 };
 
 } // namespace userdata
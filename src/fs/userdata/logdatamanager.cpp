@@ -31,7 +31,9 @@
 
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QStringBuilder>
+#include <QThreadPool>
 
 namespace atools {
 namespace fs {
@@ -593,6 +595,14 @@ void LogdataManager::updateSchema()
   addColumnIf("flightplan", "blob");
   addColumnIf("aircraft_perf", "blob");
   addColumnIf("aircraft_trail", "blob");
+  addColumnIf("aircraft_trail_bin", "blob");
+
+  // Binary track is outdated if the GPX track changes - clear it to have it converted again
+  SqlTransaction transaction(db);
+  db->exec("create trigger if not exists trg_logbook_aircraft_trail after update of aircraft_trail on logbook "
+           "begin update logbook set aircraft_trail_bin = null where logbook_id = new.logbook_id; end");
+  transaction.commit();
+  trackBinary = true;
 
   repairDateTime("departure_time");
   repairDateTime("destination_time");
@@ -708,20 +718,103 @@ bool LogdataManager::hasTrackAttached(int id)
   return hasBlob(id, "aircraft_trail");
 }
 
-const gpx::GpxData *LogdataManager::getGpxData(int id)
+const gpx::GpxData *LogdataManager::getGpxData(int id, int simplifyLevel)
 {
-  loadGpx(id);
-  return cache.object(id);
+  loadGpx(id, simplifyLevel);
+  return cache.object(std::make_pair(id, simplifyLevel));
 }
 
-void LogdataManager::loadGpx(int id)
+void LogdataManager::loadGpx(int id, int simplifyLevel)
 {
-  if(!cache.contains(id))
+  std::pair<int, int> key(id, simplifyLevel);
+  if(!cache.contains(key))
   {
     gpx::GpxData *entry = new gpx::GpxData;
-    atools::fs::gpx::GpxIO().loadGpxGz(*entry, getValue(id, "aircraft_trail").toByteArray());
-    cache.insert(id, entry);
+    atools::fs::gpx::GpxIO gpxIO;
+
+    // Try binary first and fall back to Gzipped GPX if not converted yet
+    if(!trackBinary || !gpxIO.loadGpxBinary(*entry, getValue(id, "aircraft_trail_bin").toByteArray(), simplifyLevel))
+      gpxIO.loadGpxGz(*entry, getValue(id, "aircraft_trail").toByteArray());
+    cache.insert(key, entry);
+  }
+}
+
+int LogdataManager::updateTrackBinary(int maxRows)
+{
+  if(!trackBinary)
+    return 0;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Read GPX BLOBs for all entries which have no binary track yet ===================
+  QList<int> ids;
+  QList<QByteArray> gpxList;
+  SqlQuery query(db);
+  query.prepare("select logbook_id, aircraft_trail from logbook "
+                "where aircraft_trail_bin is null and length(aircraft_trail) > 0 limit ?");
+  query.bindValue(0, maxRows);
+  query.exec();
+  while(query.next())
+  {
+    ids.append(query.valueInt(0));
+    gpxList.append(query.value(1).toByteArray());
   }
+
+  if(ids.isEmpty())
+    return 0;
+
+  // Parse GPX and convert in parallel - each task writes into its own element ===================
+  QList<QByteArray> binaries(gpxList.size());
+  QByteArray *binaryArr = binaries.data();
+  const QByteArray *gpxArr = gpxList.constData();
+  const int *idArr = ids.constData();
+  QThreadPool pool;
+  for(qsizetype i = 0; i < gpxList.size(); i++)
+  {
+    pool.start([binaryArr, gpxArr, idArr, i]() -> void {
+          // Exceptions must not leave the thread pool task
+          gpx::GpxData gpxData;
+          gpx::GpxIO gpxIO;
+          try
+          {
+            gpxIO.loadGpxGz(gpxData, gpxArr[i]);
+          }
+          catch(atools::Exception& e)
+          {
+            qWarning() << Q_FUNC_INFO << "Error reading GPX for logbook_id" << idArr[i] << e.what();
+            gpxData.clear();
+          }
+          catch(...)
+          {
+            qWarning() << Q_FUNC_INFO << "Unknown error reading GPX for logbook_id" << idArr[i];
+            gpxData.clear();
+          }
+
+          // Also saved for invalid files as empty track to avoid converting them again
+          binaryArr[i] = gpxIO.saveGpxBinary(gpxData);
+        });
+  }
+  pool.waitForDone();
+
+  // Write binary tracks ===================
+  SqlTransaction transaction(db);
+  SqlQuery update(db);
+  update.prepare("update logbook set aircraft_trail_bin = ? where logbook_id = ?");
+  qsizetype gpxBytes = 0, binaryBytes = 0;
+  for(qsizetype i = 0; i < ids.size(); i++)
+  {
+    update.bindValue(0, binaries.at(i));
+    update.bindValue(1, ids.at(i));
+    update.exec();
+    gpxBytes += gpxList.at(i).size();
+    binaryBytes += binaries.at(i).size();
+  }
+  transaction.commit();
+
+  qDebug() << Q_FUNC_INFO << "Converted" << ids.size() << "tracks from" << gpxBytes << "to" << binaryBytes << "bytes in"
+           << timer.elapsed() << "ms";
+  return static_cast<int>(ids.size());
 }
 
 void LogdataManager::getFlightStatsTime(QDateTime& earliest, QDateTime& latest, QDateTime& earliestSim,
@@ -65,8 +65,16 @@ public:
   virtual void updateSchema() override;
 
   /* Get flight plan and track and route points from GPX attachment or database BLOB. Request is cached.
-   *  Also includes route waypoint names. */
-  const atools::fs::gpx::GpxData *getGpxData(int id);
+   *  Also includes route waypoint names.
+   * Uses the binary track if available and falls back to parsing the GPX otherwise.
+   * simplifyLevel > 0 loads fewer track points. See GpxIO::NUM_SIMPLIFY_LEVELS. Only used for binary tracks. */
+  const atools::fs::gpx::GpxData *getGpxData(int id, int simplifyLevel = 0);
+
+  /* Converts the GPX track of up to maxRows logbook entries without binary track into the compact binary format.
+   * GPX files are parsed in a thread pool. Commits changes and returns the number of converted entries.
+   * 0 means that all are done. Call repeatedly with a small number from a timer to migrate existing
+   * logbooks in the background. Needs updateSchema() to be called before. */
+  int updateTrackBinary(int maxRows);
 
   /* Clear cache used by getRouteGeometry and getTrackGeometry */
   void clearGeometryCache();
@@ -131,12 +139,15 @@ private:
   QString cleanupWhere(bool departureAndDestEqual, bool departureOrDestEmpty, float minFlownDistance);
 
   /* Prime cache by loading the GpxCacheEntry */
-  void loadGpx(int id);
+  void loadGpx(int id, int simplifyLevel);
 
   void repairDateTime(const QString& column);
 
-  /* Cache to avoid reading BLOBs */
-  QCache<int, atools::fs::gpx::GpxData> cache;
+  /* Cache to avoid reading BLOBs. Key is id and simplification level. */
+  QCache<std::pair<int, int>, atools::fs::gpx::GpxData> cache;
+
+  /* Column aircraft_trail_bin and trigger are present. Set in updateSchema(). */
+  bool trackBinary = false;
 
 };
 
@@ -23,13 +23,17 @@
 #include "geo/calculations.h"
 #include "geo/pos.h"
 #include "geo/spatialindex.h"
-#include "util/contextsaver.h"
 
 #include <QTimeZone>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QFile>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+
+#include <mutex>
 
 namespace atools {
 namespace fs {
@@ -54,7 +58,7 @@ public:
   }
 
   atools::geo::Pos pos;
-  int index; /* Index to "metarVector" or "metarInterpolatedVector" */
+  int index; /* Index to "metarList" */
 };
 
 } // namespace weather
@@ -67,6 +71,94 @@ namespace atools {
 namespace fs {
 namespace weather {
 
+/* Unparsed METAR line as found by the scanner */
+struct MetarLine
+{
+  QByteArray ident, metar;
+  QDateTime timestamp;
+};
+
+/* Result of scanning a range of lines in one thread */
+struct MetarScanResult
+{
+  QList<MetarLine> lines;
+  int futureDates = 0, invalidDates = 0;
+};
+
+/* Station METARs with ident map and spatial index. Not modified after being published.
+ * METARs are kept unparsed in metarList and parsed copies are created exactly once on first access. */
+struct MetarSnapshot
+{
+  /* Build spatial index and prepare for parsing. Has to be called before publishing. */
+  void finish();
+
+  /* Get METAR at index and parse it if not done yet. Thread safe. */
+  const Metar& parsedMetar(int index) const;
+
+  /* Get a parsed METAR. Empty if not available. Thread safe. */
+  const Metar& fetchMetar(const QByteArray& ident) const;
+
+  /* Map containing all loaded METARs airport idents mapped to the position in metarList */
+  QHash<QByteArray, int> identIndexMap;
+
+  /* Index containing all stations which could be resolved to a coordinate. */
+  atools::geo::SpatialIndex<PosIndex> spatialIndex;
+
+  /* Unparsed METARs. Can be shared with the next snapshot when merging. */
+  QList<atools::fs::weather::Metar> metarList;
+
+private:
+  /* Parsed METARs having the same index as metarList. Null if not accessed yet. */
+  std::unique_ptr<std::unique_ptr<Metar>[]> parsedMetars;
+  std::unique_ptr<std::once_flag[]> parseOnce;
+};
+
+/* Part of the interpolated METAR cache. Key is the position rounded to the distance tolerance. */
+struct MetarCacheShard
+{
+  QMutex mutex;
+  QHash<quint64, Metar> metars;
+};
+
+void MetarSnapshot::finish()
+{
+  spatialIndex.clear();
+  for(int i = 0; i < metarList.size(); i++)
+  {
+    // Add only valid positions to spatial index
+    const atools::geo::Pos& pos = metarList.at(i).getPosition();
+    if(pos.isValid())
+      spatialIndex.append(PosIndex(pos, i));
+  }
+  spatialIndex.updateIndex();
+
+  parsedMetars.reset(new std::unique_ptr<Metar>[static_cast<size_t>(metarList.size())]);
+  parseOnce.reset(new std::once_flag[static_cast<size_t>(metarList.size())]);
+}
+
+const Metar& MetarSnapshot::parsedMetar(int index) const
+{
+  std::call_once(parseOnce[index], [this, index]() -> void {
+        std::unique_ptr<Metar> metar(new Metar(metarList.at(index)));
+        metar->parseAll(false /* useTimestamp */);
+        parsedMetars[index] = std::move(metar);
+      });
+  return *parsedMetars[index];
+}
+
+const Metar& MetarSnapshot::fetchMetar(const QByteArray& ident) const
+{
+  if(!ident.isEmpty())
+  {
+    int idx = identIndexMap.value(ident, -1);
+
+    if(idx != -1)
+      return parsedMetar(idx);
+  }
+
+  return Metar::EMPTY;
+}
+
 inline bool isDigit(char c)
 {
   return c >= '0' && c <= '9';
@@ -77,18 +169,109 @@ inline bool isLetterOrDigit(char c)
   return isDigit(c) || (c >= 'A' && c <= 'Z');
 }
 
+/* Do not start threads for small files */
+const static qsizetype MIN_LINES_PER_THREAD = 4000;
+
+/* Number of interpolated cache shards */
+const static int NUM_CACHE_SHARDS = 16;
+
+/* Round position to a grid having the tolerance as cell size and use it as key for the interpolated cache */
+inline quint64 cacheKey(const atools::geo::Pos& pos, float toleranceMeter)
+{
+  double cellDeg = std::max(static_cast<double>(atools::geo::meterToNm(toleranceMeter)) / 60., 0.0001);
+  quint32 x = static_cast<quint32>(static_cast<qint32>(std::round(pos.getLonX() / cellDeg)));
+  quint32 y = static_cast<quint32>(static_cast<qint32>(std::round(pos.getLatY() / cellDeg)));
+  return (static_cast<quint64>(y) << 32) | x;
+}
+
+/* Split data into lines without copying. Views are valid as long as data is not modified. */
+void splitLines(QList<QByteArrayView>& lines, const QByteArray& data)
+{
+  lines.reserve(data.count('\n') + 1);
+
+  qsizetype start = 0, index;
+  while((index = data.indexOf('\n', start)) != -1)
+  {
+    lines.append(QByteArrayView(data).sliced(start, index - start));
+    start = index + 1;
+  }
+
+  if(start < data.size())
+    lines.append(QByteArrayView(data).sliced(start));
+}
+
+/* Get timestamp from NOAA date line like "2017/10/29 11:45". Returns invalid date if line is not a date line. */
+QDateTime noaaDate(const QByteArray& line)
+{
+  // static const QRegularExpression DATE_REGEXP("^[\\d]{4}/[\\d]{2}/[\\d]{2}");
+  if(line.size() > 15 &&
+     // 2017/07/30 18:55 - detect only date part
+     line.at(0) == '2' && isDigit(line.at(1)) && isDigit(line.at(2)) && isDigit(line.at(3)) &&
+     line.at(4) == '/' &&
+     isDigit(line.at(5)) && isDigit(line.at(6)) &&
+     line.at(7) == '/' &&
+     isDigit(line.at(8)) && isDigit(line.at(9)) &&
+     line.at(10) == ' ')
+  {
+    // lastTimestamp = QDateTime::fromString(line, QStringLiteral("yyyy/MM/dd hh:mm")); // Slow
+    // Found line containing date like "2017/10/29 11:45"
+    // ................................ 0123 56 89 12 45
+    return QDateTime(QDate(line.sliced(0, 4).toInt(), line.sliced(5, 2).toInt(), line.sliced(8, 2).toInt()),
+                     QTime(line.sliced(11, 2).toInt(), line.sliced(14, 2).toInt()), QTimeZone::utc());
+  }
+  return QDateTime();
+}
+
+/* Scan lines in chunks distributed over all cores. Calls scan(result, from, to) for each chunk.
+ * results are in the same order as the lines. */
+template<typename SCAN>
+void scanParallel(QList<MetarScanResult>& results, qsizetype numLines, const SCAN& scan)
+{
+  int numThreads = static_cast<int>(std::clamp(numLines / MIN_LINES_PER_THREAD, qsizetype(1),
+                                               qsizetype(QThread::idealThreadCount())));
+  results.resize(numThreads);
+
+  if(numThreads == 1)
+    scan(results[0], 0, numLines);
+  else
+  {
+    qsizetype chunkSize = (numLines + numThreads - 1) / numThreads;
+
+    // Threads write into distinct elements - get pointer once to avoid detaching
+    MetarScanResult *resultArr = results.data();
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    for(int i = 0; i < numThreads; i++)
+    {
+      qsizetype from = i * chunkSize, to = std::min(from + chunkSize, numLines);
+      pool.start([&scan, resultArr, i, from, to]() -> void {
+            scan(resultArr[i], from, to);
+          });
+    }
+    pool.waitForDone();
+  }
+}
+
 // ====================================================================================================
 MetarIndex::MetarIndex(MetarFormat formatParam, bool verboseLogging)
   : verbose(verboseLogging), format(formatParam)
 {
-  spatialIndex = new atools::geo::SpatialIndex<PosIndex>;
-  spatialIndexInterpolated = new atools::geo::SpatialIndex<PosIndex>;
+  std::shared_ptr<MetarSnapshot> empty = std::make_shared<MetarSnapshot>();
+  empty->finish();
+  snapshot = empty;
+
+  cacheShards.reset(new MetarCacheShard[NUM_CACHE_SHARDS]);
 }
 
 MetarIndex::~MetarIndex()
 {
-  ATOOLS_DELETE_LOG(spatialIndex);
-  ATOOLS_DELETE_LOG(spatialIndexInterpolated);
+
+}
+
+std::shared_ptr<const MetarSnapshot> MetarIndex::getSnapshot() const
+{
+  QMutexLocker locker(&snapshotMutex);
+  return snapshot;
 }
 
 int MetarIndex::read(const QString& filename, bool merge)
@@ -112,9 +295,18 @@ int MetarIndex::read(QTextStream& stream, const QString& fileOrUrl, bool merge)
   Q_ASSERT(format != UNKNOWN);
   Q_ASSERT(airportCoordFunction);
 
-  // Set reading flag to forbid fetching METARs while index is invalid
-  atools::util::ContextSaverBool readingContext(reading);
+  QMutexLocker writeLocker(&writeMutex);
+
+  // Build a new snapshot while readers continue to use the current one
+  std::shared_ptr<MetarSnapshot> newSnapshot = std::make_shared<MetarSnapshot>();
+  if(merge)
+  {
+    std::shared_ptr<const MetarSnapshot> current = getSnapshot();
+    newSnapshot->metarList = current->metarList;
+    newSnapshot->identIndexMap = current->identIndexMap;
+  }
 
+  int found = 0;
   switch(format)
   {
     case atools::fs::weather::UNKNOWN:
@@ -122,16 +314,50 @@ int MetarIndex::read(QTextStream& stream, const QString& fileOrUrl, bool merge)
 
     case atools::fs::weather::NOAA:
     case atools::fs::weather::XPLANE:
-      return readNoaaXplane(stream, fileOrUrl, merge);
+      found = readNoaaXplane(*newSnapshot, stream, fileOrUrl);
+      break;
 
     case atools::fs::weather::FLAT:
-      return readFlat(stream, fileOrUrl, merge);
+      found = readFlat(*newSnapshot, stream, fileOrUrl);
+      break;
 
     case atools::fs::weather::JSON:
-      return readJson(stream, fileOrUrl, merge);
+      found = readJson(*newSnapshot, stream, fileOrUrl);
+      break;
+  }
+
+  newSnapshot->finish();
+
+  {
+    // Publish - old snapshot is deleted after unlocking or when the last reader is done
+    std::shared_ptr<const MetarSnapshot> published(newSnapshot);
+    QMutexLocker locker(&snapshotMutex);
+    snapshot.swap(published);
+  }
+  clearCache();
+
+  if(verbose)
+  {
+    logSizes(*newSnapshot);
+    qDebug() << Q_FUNC_INFO << fileOrUrl << "merge" << merge;
+  }
+
+  return found;
+}
+
+void MetarIndex::logSizes(const MetarSnapshot& snapshotParam) const
+{
+  int cacheSize = 0;
+  for(int i = 0; i < NUM_CACHE_SHARDS; i++)
+  {
+    QMutexLocker locker(&cacheShards[i].mutex);
+    cacheSize += cacheShards[i].metars.size();
   }
 
-  return 0;
+  qDebug() << "spatialIndex.size()" << snapshotParam.spatialIndex.size();
+  qDebug() << "identIndexMap.size()" << snapshotParam.identIndexMap.size();
+  qDebug() << "metars.size()" << snapshotParam.metarList.size();
+  qDebug() << "metarsInterpolated.size()" << cacheSize;
 }
 
 // 2017/07/30 18:45
@@ -142,128 +368,82 @@ int MetarIndex::read(QTextStream& stream, const QString& fileOrUrl, bool merge)
 //
 // 2017/07/30 18:47
 // KADS 301847Z 06005G14KT 13SM SKC 32/19 A3007
-int MetarIndex::readNoaaXplane(QTextStream& stream, const QString& fileOrUrl, bool merge)
+int MetarIndex::readNoaaXplane(MetarSnapshot& snapshotParam, QTextStream& stream, const QString& fileOrUrl)
 {
-  if(!merge)
-    clear();
-  else
-    clearCache();
+  QElapsedTimer timer;
+  timer.start();
 
-  QDateTime latest, oldest;
-  QByteArray latestIdent, oldestIdent;
+  const QByteArray data = stream.readAll().toLatin1();
+  QList<QByteArrayView> lines;
+  splitLines(lines, data);
 
-  int lineNum = 1;
-  QByteArray line;
-  QDateTime lastTimestamp, now = QDateTime::currentDateTimeUtc();
-  int futureDates = 0, invalidDates = 0, found = 0;
+  const QDateTime now = QDateTime::currentDateTimeUtc();
 
-  while(!stream.atEnd())
-  {
-    line = stream.readLine().toLatin1().simplified().toUpper();
+  // Scan lines in parallel and collect METAR strings without parsing ===========================
+  QList<MetarScanResult> results;
+  scanParallel(results, lines.size(), [&lines, &now, &fileOrUrl, this](MetarScanResult& result, qsizetype from,
+                                                                        qsizetype to) -> void {
+        // Get date for first METAR in chunk by looking back for the last date line
+        QDateTime lastTimestamp;
+        for(qsizetype i = from - 1; i >= 0 && !lastTimestamp.isValid(); i--)
+          lastTimestamp = noaaDate(lines.at(i).toByteArray().simplified());
 
-    if(line.isEmpty() || line.size() > 256)
-    {
-      lineNum++;
-      continue;
-    }
+        for(qsizetype lineIdx = from; lineIdx < to; lineIdx++)
+        {
+          qsizetype lineNum = lineIdx + 1;
+          const QByteArray line = lines.at(lineIdx).toByteArray().simplified().toUpper();
 
-    if(format == XPLANE && (line.startsWith("MDEG ") || line.startsWith("DEG ")))
-    {
-      lineNum++;
-      // Ignore X-Plane's special coordinate format
-      continue;
-    }
+          if(line.isEmpty() || line.size() > 256)
+            continue;
 
-    if(line.size() >= 4)
-    {
-      // static const QRegularExpression DATE_REGEXP("^[\\d]{4}/[\\d]{2}/[\\d]{2}");
-      if(line.size() > 15 &&
-         // 2017/07/30 18:55 - detect only date part
-         line.at(0) == '2' && isDigit(line.at(1)) && isDigit(line.at(2)) && isDigit(line.at(3)) &&
-         line.at(4) == '/' &&
-         isDigit(line.at(5)) && isDigit(line.at(6)) &&
-         line.at(7) == '/' &&
-         isDigit(line.at(8)) && isDigit(line.at(9)) &&
-         line.at(10) == ' ')
-      {
-        // lastTimestamp = QDateTime::fromString(line, QStringLiteral("yyyy/MM/dd hh:mm")); // Slow
-        // Found line containing date like "2017/10/29 11:45"
-        // ................................ 0123 56 89 12 45
-        lastTimestamp = QDateTime(QDate(line.sliced(0, 4).toInt(), line.sliced(5, 2).toInt(), line.sliced(8, 2).toInt()),
-                                  QTime(line.sliced(11, 2).toInt(), line.sliced(14, 2).toInt()), QTimeZone::utc());
-        lineNum++;
-        continue;
-      }
+          if(format == XPLANE && (line.startsWith("MDEG ") || line.startsWith("DEG ")))
+            // Ignore X-Plane's special coordinate format
+            continue;
 
-      if(!lastTimestamp.isValid())
-      {
-        // Ignore invalid dates
-        invalidDates++;
-        lineNum++;
-        continue;
-      }
+          if(line.size() >= 4)
+          {
+            QDateTime timestamp = noaaDate(line);
+            if(timestamp.isValid())
+            {
+              lastTimestamp = timestamp;
+              continue;
+            }
 
-      if(lastTimestamp > now)
-      {
-        // Ignore METARs with future UTC time
-        futureDates++;
-        lineNum++;
-        continue;
-      }
+            if(!lastTimestamp.isValid())
+            {
+              // Ignore invalid dates
+              result.invalidDates++;
+              continue;
+            }
 
-      qsizetype idx = line.indexOf(' '); // should be 4
-      if(idx != -1)
-      {
-        const QByteArray ident = line.sliced(0, idx);
-        // Recognize METAR airport ident
-        // static const QRegularExpression IDENT_REGEXP("^[A-Z0-9]{2,5}$");
-        if(ident.size() >= 3 &&
-           // KPRO 301855Z AUTO 11003KT 10SM CLR 26/14 A3022 RMK AO2 T02570135
-           isLetterOrDigit(ident.at(0)) && isLetterOrDigit(ident.at(1)) && isLetterOrDigit(ident.at(2)))
-        {
-          // Found METAR line
-          if(verbose)
-          {
-            if(!latest.isValid() || lastTimestamp > latest)
+            if(lastTimestamp > now)
             {
-              latest = lastTimestamp;
-              latestIdent = ident;
+              // Ignore METARs with future UTC time
+              result.futureDates++;
+              continue;
             }
-            if(!oldest.isValid() || lastTimestamp < oldest)
+
+            qsizetype idx = line.indexOf(' '); // should be 4
+            if(idx != -1)
             {
-              oldest = lastTimestamp;
-              oldestIdent = ident;
+              const QByteArray ident = line.sliced(0, idx);
+              // Recognize METAR airport ident
+              // static const QRegularExpression IDENT_REGEXP("^[A-Z0-9]{2,5}$");
+              if(ident.size() >= 3 &&
+                 // KPRO 301855Z AUTO 11003KT 10SM CLR 26/14 A3022 RMK AO2 T02570135
+                 isLetterOrDigit(ident.at(0)) && isLetterOrDigit(ident.at(1)) && isLetterOrDigit(ident.at(2)))
+                // Found METAR line
+                result.lines.append(MetarLine{ident, line, lastTimestamp});
+              else
+                qWarning() << "Ident in METAR does not match in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
             }
+            else
+              qWarning() << "Wrongly formatted METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
           }
-
-          found++;
-          updateOrInsert(line, ident, lastTimestamp);
         }
-        else
-          qWarning() << "Ident in METAR does not match in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
-      }
-      else
-        qWarning() << "Wrongly formatted METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
-    }
-    lineNum++;
-  }
+      });
 
-  updateIndex();
-
-  if(verbose)
-  {
-    qDebug() << "spatialIndex->size()" << spatialIndex->size();
-    qDebug() << "spatialIndexInterpolated->size()" << spatialIndexInterpolated->size();
-    qDebug() << "identIndexMap.size()" << identIndexMap.size();
-    qDebug() << "metars.size()" << metarList.size();
-    qDebug() << "metarsInterpolated.size()" << metarInterpolatedList.size();
-    qDebug() << "found " << found << "futureDates " << futureDates << "invalidDates" << invalidDates;
-    qDebug() << "Latest" << latestIdent << latest;
-    qDebug() << "Oldest" << oldestIdent << oldest;
-    qDebug() << Q_FUNC_INFO << fileOrUrl << spatialIndex->size();
-  }
-
-  return found;
+  return insertScanResults(snapshotParam, results, fileOrUrl, timer);
 }
 
 // KC99 100906Z AUTO 30022G42KT 10SM CLR M01/M04 A3035 RMK AO2
@@ -273,128 +453,140 @@ int MetarIndex::readNoaaXplane(QTextStream& stream, const QString& fileOrUrl, bo
 // AGGH 100900Z 16003KT 9999 FEW016 FEW017CB SCT300 27/25 Q1010
 // ANYN 100900Z 08005KT 9999 FEW020 27/23 Q1010
 // AYMH 100800Z 16015KT 9999 SHRA BKN090 18/16 Q1018 RMK
-int MetarIndex::readFlat(QTextStream& stream, const QString& fileOrUrl, bool merge)
+int MetarIndex::readFlat(MetarSnapshot& snapshotParam, QTextStream& stream, const QString& fileOrUrl)
 {
-  if(!merge)
-    clear();
-  else
-    clearCache();
+  QElapsedTimer timer;
+  timer.start();
 
-  QDateTime latest, oldest;
-  QByteArray latestIdent, oldestIdent;
+  const QByteArray data = stream.readAll().toLatin1();
+  QList<QByteArrayView> lines;
+  splitLines(lines, data);
 
-  int lineNum = 1;
-  QByteArray line;
   const QDateTime now = QDateTime::currentDateTimeUtc();
-  int futureDates = 0, invalidDates = 0, found = 0;
-
-  while(!stream.atEnd())
-  {
-    line = stream.readLine().toLatin1().simplified().toUpper();
-
-    if(line.isEmpty() || line.size() > 256)
-    {
-      lineNum++;
-      continue;
-    }
 
-    if(line.size() >= 4)
-    {
-      int idx = line.indexOf(' ');
-      if(idx != -1)
-      {
-        const QByteArray ident = line.sliced(0, idx);
-
-        QByteArray date = line.sliced(idx + 1);
-        int idxDate = date.indexOf(' ');
-        if(idxDate != -1)
+  // Scan lines in parallel and collect METAR strings without parsing ===========================
+  QList<MetarScanResult> results;
+  scanParallel(results, lines.size(), [&lines, &now, &fileOrUrl, this](MetarScanResult& result, qsizetype from,
+                                                                        qsizetype to) -> void {
+        for(qsizetype lineIdx = from; lineIdx < to; lineIdx++)
         {
-          date = date.sliced(0, idxDate);
-
-          if(ident.size() >= 3 && ident.size() <= 4 && date.size() >= 5)
-          {
-            if(date.endsWith('Z'))
-              date.chop(1);
+          qsizetype lineNum = lineIdx + 1;
+          const QByteArray line = lines.at(lineIdx).toByteArray().simplified().toUpper();
 
-            if(date.size() == 5)
-              date.prepend('0');
+          if(line.isEmpty() || line.size() > 256)
+            continue;
 
-            int day = -1, hour = -1, minute = -1;
-            if(date.size() >= 2)
+          if(line.size() >= 4)
+          {
+            qsizetype idx = line.indexOf(' ');
+            if(idx != -1)
             {
-              day = date.sliced(0, 2).toInt();
-              if(date.size() >= 4)
+              const QByteArray ident = line.sliced(0, idx);
+
+              QByteArray date = line.sliced(idx + 1);
+              qsizetype idxDate = date.indexOf(' ');
+              if(idxDate != -1)
               {
-                hour = date.sliced(2, 2).toInt();
-                if(date.size() >= 6)
-                  minute = date.sliced(4, 2).toInt();
+                date = date.sliced(0, idxDate);
+
+                if(ident.size() >= 3 && ident.size() <= 4 && date.size() >= 5)
+                {
+                  if(date.endsWith('Z'))
+                    date.chop(1);
+
+                  if(date.size() == 5)
+                    date.prepend('0');
+
+                  int day = -1, hour = -1, minute = -1;
+                  if(date.size() >= 2)
+                  {
+                    day = date.sliced(0, 2).toInt();
+                    if(date.size() >= 4)
+                    {
+                      hour = date.sliced(2, 2).toInt();
+                      if(date.size() >= 6)
+                        minute = date.sliced(4, 2).toInt();
+                    }
+                  }
+
+                  QDateTime metarDateTime = atools::correctDate(day, hour, minute);
+
+                  if(!metarDateTime.isValid())
+                  {
+                    if(verbose)
+                      qWarning() << Q_FUNC_INFO << "Invalid date in METAR" << line;
+
+                    // Ignore invalid dates
+                    result.invalidDates++;
+                    continue;
+                  }
+
+                  if(metarDateTime > now)
+                  {
+                    // Ignore METARs with future UTC time
+                    result.futureDates++;
+                    continue;
+                  }
+
+                  // Found METAR line
+                  result.lines.append(MetarLine{ident, line, metarDateTime});
+                }
+                else if(verbose)
+                  qWarning() << "Invalid METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
               }
+              else if(verbose)
+                qWarning() << "Invalid METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
             }
+            else if(verbose)
+              qWarning() << "Wrongly formatted METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
+          }
+        }
+      });
 
-            QDateTime metarDateTime = atools::correctDate(day, hour, minute);
-
-            if(!metarDateTime.isValid())
-            {
-              if(verbose)
-                qWarning() << Q_FUNC_INFO << "Invalid date in METAR" << line;
-
-              // Ignore invalid dates
-              invalidDates++;
-              lineNum++;
-              continue;
-            }
+  return insertScanResults(snapshotParam, results, fileOrUrl, timer);
+}
 
-            if(metarDateTime > now)
-            {
-              // Ignore METARs with future UTC time
-              futureDates++;
-              lineNum++;
-              continue;
-            }
+int MetarIndex::insertScanResults(MetarSnapshot& snapshotParam, const QList<MetarScanResult>& results,
+                                  const QString& fileOrUrl, const QElapsedTimer& timer)
+{
+  QDateTime latest, oldest;
+  QByteArray latestIdent, oldestIdent;
+  int futureDates = 0, invalidDates = 0, found = 0;
 
-            // Found METAR line
-            if(verbose)
-            {
-              if(!latest.isValid() || metarDateTime > latest)
-              {
-                latest = metarDateTime;
-                latestIdent = ident;
-              }
-              if(!oldest.isValid() || metarDateTime < oldest)
-              {
-                oldest = metarDateTime;
-                oldestIdent = ident;
-              }
-            }
+  // Merge results in line order since later lines replace older ones with the same timestamp ===========
+  // Coordinate callback is not thread safe and is called here
+  for(const MetarScanResult& result : results)
+  {
+    futureDates += result.futureDates;
+    invalidDates += result.invalidDates;
 
-            found++;
-            updateOrInsert(line, ident, metarDateTime);
-          }
-          else if(verbose)
-            qWarning() << "Invalid METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
+    for(const MetarLine& line : result.lines)
+    {
+      if(verbose)
+      {
+        if(!latest.isValid() || line.timestamp > latest)
+        {
+          latest = line.timestamp;
+          latestIdent = line.ident;
+        }
+        if(!oldest.isValid() || line.timestamp < oldest)
+        {
+          oldest = line.timestamp;
+          oldestIdent = line.ident;
         }
-        else if(verbose)
-          qWarning() << "Invalid METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
       }
-      else if(verbose)
-        qWarning() << "Wrongly formatted METAR in file/URL" << fileOrUrl << "line num" << lineNum << "line" << line;
+
+      found++;
+      updateOrInsert(snapshotParam, line.metar, line.ident, line.timestamp);
     }
-    lineNum++;
   }
 
-  updateIndex();
-
   if(verbose)
   {
-    qDebug() << "spatialIndex->size()" << spatialIndex->size();
-    qDebug() << "spatialIndexInterpolated->size()" << spatialIndexInterpolated->size();
-    qDebug() << "identIndexMap.size()" << identIndexMap.size();
-    qDebug() << "metars.size()" << metarList.size();
-    qDebug() << "metarsInterpolated.size()" << metarInterpolatedList.size();
     qDebug() << "found " << found << "futureDates " << futureDates << "invalidDates" << invalidDates;
     qDebug() << "Latest" << latestIdent << latest;
     qDebug() << "Oldest" << oldestIdent << oldest;
-    qDebug() << Q_FUNC_INFO << fileOrUrl << spatialIndex->size();
+    qDebug() << Q_FUNC_INFO << fileOrUrl << "chunks" << results.size() << "in" << timer.elapsed() << "ms";
   }
 
   return found;
@@ -416,13 +608,8 @@ int MetarIndex::readFlat(QTextStream& stream, const QString& fileOrUrl, bool mer
 // .    "metar": "AYMH 090800Z VRB04KT 9999 -SHRA SCT008 BKN030 -/- Q1019",
 // .    "updatedAt": "2022-03-09T08:00:00.000Z"
 // .  },
-int MetarIndex::readJson(QTextStream& stream, const QString& fileOrUrl, bool merge)
+int MetarIndex::readJson(MetarSnapshot& snapshotParam, QTextStream& stream, const QString& fileOrUrl)
 {
-  if(!merge)
-    clear();
-  else
-    clearCache();
-
   QDateTime latest, oldest;
   QByteArray latestIdent, oldestIdent;
 
@@ -466,169 +653,189 @@ int MetarIndex::readJson(QTextStream& stream, const QString& fileOrUrl, bool mer
     }
 
     found++;
-    updateOrInsert(metar, ident, metarDateTime);
+    updateOrInsert(snapshotParam, metar, ident, metarDateTime);
   }
 
-  updateIndex();
-
   if(verbose)
   {
-    qDebug() << "spatialIndex->size()" << spatialIndex->size();
-    qDebug() << "spatialIndexInterpolated->size()" << spatialIndexInterpolated->size();
-    qDebug() << "identIndexMap.size()" << identIndexMap.size();
-    qDebug() << "metars.size()" << metarList.size();
-    qDebug() << "metarsInterpolated.size()" << metarInterpolatedList.size();
     qDebug() << "found " << found << "futureDates " << futureDates << "invalidDates" << invalidDates;
     qDebug() << "Latest" << latestIdent << latest;
     qDebug() << "Oldest" << oldestIdent << oldest;
-    qDebug() << Q_FUNC_INFO << fileOrUrl << spatialIndex->size();
+    qDebug() << Q_FUNC_INFO << fileOrUrl;
   }
 
   return found;
 }
 
-void MetarIndex::updateOrInsert(const QByteArray& metarString, const QByteArray& ident, const QDateTime& lastTimestamp)
+void MetarIndex::updateOrInsert(MetarSnapshot& snapshotParam, const QByteArray& metarString, const QByteArray& ident,
+                                const QDateTime& lastTimestamp)
 {
-  if(identIndexMap.contains(ident))
+  int idx = snapshotParam.identIndexMap.value(ident, -1);
+  if(idx != -1)
   {
-    int idx = identIndexMap.value(ident, -1);
-    if(idx != -1)
+    // Already in list - get writeable reference to entry
+    Metar& metar = snapshotParam.metarList[idx];
+    if((!metar.getTimestamp().isValid() || metar.getTimestamp() < lastTimestamp) && metar.getStationMetar() != metarString)
     {
-      // Already in list - get writeable reference to entry
-      Metar& metar = metarList[idx];
-      if((!metar.getTimestamp().isValid() || metar.getTimestamp() < lastTimestamp) && metar.getStationMetar() != metarString)
-      {
-        // This one is newer - update
-        metar.setMetarForStation(metarString);
-        metar.setTimestamp(lastTimestamp);
-        metar.parseAll(false /* useTimestamp */);
-      }
+      // This one is newer - update. Resets parsed values.
+      metar.setMetarForStation(metarString);
+      metar.setTimestamp(lastTimestamp);
     }
   }
   else
   {
-    // Insert new record
+    // Insert new record - parsed on first access
     atools::geo::Pos pos = airportCoordFunction(ident, airportCoordObject);
-
-    Metar metar(ident, pos, lastTimestamp, metarString);
-    metar.parseAll(false /* useTimestamp */);
-
-    metarList.append(metar);
-    identIndexMap.insert(ident, metarList.size() - 1);
-
-    // Add only valid positions to spatial index
-    if(pos.isValid())
-      spatialIndex->append(PosIndex(pos, metarList.size() - 1));
+    snapshotParam.metarList.append(Metar(ident, pos, lastTimestamp, metarString));
+    snapshotParam.identIndexMap.insert(ident, snapshotParam.metarList.size() - 1);
   }
 }
 
 void MetarIndex::clear()
 {
-  spatialIndex->clearIndex();
-  identIndexMap.clear();
-  metarList.clear();
+  QMutexLocker writeLocker(&writeMutex);
+
+  std::shared_ptr<MetarSnapshot> empty = std::make_shared<MetarSnapshot>();
+  empty->finish();
+
+  {
+    std::shared_ptr<const MetarSnapshot> published(empty);
+    QMutexLocker locker(&snapshotMutex);
+    snapshot.swap(published);
+  }
   clearCache();
 }
 
 void MetarIndex::clearCache()
 {
-  spatialIndexInterpolated->clearIndex();
-  metarInterpolatedList.clear();
+  // Invalidate interpolations which are still running on the previous snapshot
+  cacheGeneration.fetch_add(1);
+
+  for(int i = 0; i < NUM_CACHE_SHARDS; i++)
+  {
+    QMutexLocker locker(&cacheShards[i].mutex);
+    cacheShards[i].metars.clear();
+  }
 }
 
 bool MetarIndex::isEmpty() const
 {
-  return metarList.isEmpty();
+  return getSnapshot()->metarList.isEmpty();
 }
 
 int MetarIndex::numStationMetars() const
 {
-  return metarList.size();
+  return static_cast<int>(getSnapshot()->metarList.size());
 }
 
-const atools::fs::weather::Metar& MetarIndex::getMetar(const QString& station, atools::geo::Pos pos)
+Metar MetarIndex::getMetar(const QString& station, atools::geo::Pos pos) const
 {
-  if(!reading)
+  // Read generation before snapshot - a snapshot published later always increments the generation
+  quint64 generation = cacheGeneration.load();
+
+  // Keep snapshot alive until done
+  std::shared_ptr<const MetarSnapshot> current = getSnapshot();
+
+  const QByteArray stationBytes = station.toLatin1();
+  const Metar& metar = current->fetchMetar(stationBytes);
+
+  if(metar.hasAnyMetar())
+    return metar;
+  else
   {
-    const QByteArray stationBytes = station.toLatin1();
-    const Metar& metar = fetchMetar(stationBytes);
+    if(!pos.isValid() && !stationBytes.isEmpty())
+      pos = airportCoordFunction(stationBytes, airportCoordObject);
 
-    if(metar.hasAnyMetar())
-      return metar;
-    else
+    if(pos.isValid())
     {
-      if(!pos.isValid() && !stationBytes.isEmpty())
-        pos = airportCoordFunction(stationBytes, airportCoordObject);
+      quint64 key = cacheKey(pos, maxDistanceToleranceMeter);
+      MetarCacheShard& shard = cacheShards[qHash(key) % NUM_CACHE_SHARDS];
 
-      if(pos.isValid())
       {
-        int index = spatialIndexInterpolated->getNearestIndex(pos);
+        // Found one interpolated near position - return if close enough ======================
+        QMutexLocker locker(&shard.mutex);
+        auto it = shard.metars.constFind(key);
+        if(it != shard.metars.constEnd() && it->hasAnyMetar() &&
+           it->getRequestPos().distanceMeterTo(pos) < maxDistanceToleranceMeter)
+          return *it;
+      }
 
-        if(index != -1)
-        {
-          // Found one interpolated near position - return if close enough ======================
-          const Metar& metarInterpolated = metarInterpolatedList.at(index);
-          if(metarInterpolated.hasAnyMetar() && metarInterpolated.getRequestPos().distanceMeterTo(pos) < maxDistanceToleranceMeter)
-            return metarInterpolated;
-        }
+      // Interpolate all nearest outside of lock ======================
+      QList<int> nearestIndexes;
+      current->spatialIndex.getNearestIndexes(nearestIndexes, pos, numInterpolation);
 
-        // Interpolate all nearest ======================
-        QList<PosIndex> posIndexes;
-        spatialIndex->getNearest(posIndexes, pos, numInterpolation);
-
-        // Collect positions ====================
-        atools::fs::weather::MetarPtrList metars;
-        for(const PosIndex& posIndex : std::as_const(posIndexes))
-          metars.append(&metarList.at(posIndex.index));
-
-        // Sort by distance to request point ====================
-        std::sort(metars.begin(), metars.end(), [&pos](const Metar *t1, const Metar *t2) -> bool {
-                return t1->getPosition().distanceMeterTo(pos) < t2->getPosition().distanceMeterTo(pos);
-              });
-
-        // Truncate above maximum distance, not parsed and having errors ===================
-        float maxDistanceMeter = atools::geo::nmToMeter(maxDistanceInterpolationNm);
-        metars.erase(std::remove_if(metars.begin(), metars.end(), [maxDistanceMeter, &pos](const Metar *m) -> bool {
-                return m->getPosition().distanceMeterTo(pos) > maxDistanceMeter || !m->hasStationMetar() || m->getStation().hasErrors();
-              }), metars.end());
-
-        // Interpolate nearest metars =================================
-        Metar metarInterpolatedNew = Metar(stationBytes, pos, metars);
-        metarInterpolatedNew.parseAll(false /* useTimestamp */);
-
-        // Clear full cache if too large
-        if(metarInterpolatedList.size() > maxInterpolatedCacheSize)
-          clearCache();
-
-        // Add to cache and return reference =======================
-        metarInterpolatedList.append(metarInterpolatedNew);
-        spatialIndexInterpolated->append(PosIndex(pos, metarInterpolatedList.size() - 1));
-        return metarInterpolatedList.constLast();
+      // Collect metars and drop the ones above maximum distance, not parsed and having errors ====================
+      // Distance is calculated only once per metar for filtering and sorting
+      float maxDistanceMeter = atools::geo::nmToMeter(maxDistanceInterpolationNm);
+      QList<std::pair<float, const Metar *> > distMetars;
+      for(int nearestIndex : std::as_const(nearestIndexes))
+      {
+        const Metar *nearestMetar = &current->parsedMetar(current->spatialIndex.at(nearestIndex).index);
+        float distanceMeter = nearestMetar->getPosition().distanceMeterTo(pos);
+        if(distanceMeter <= maxDistanceMeter && nearestMetar->hasStationMetar() && !nearestMetar->getStation().hasErrors())
+          distMetars.append(std::make_pair(distanceMeter, nearestMetar));
       }
-      else
-        qWarning() << Q_FUNC_INFO << "Cannot find METAR" << pos << stationBytes;
-    } // if(metar.hasAnyMetar()) return metar; else
-  } // if(!reading)
+
+      // Sort by distance to request point ====================
+      std::sort(distMetars.begin(), distMetars.end(), [](const std::pair<float, const Metar *>& m1,
+                                                         const std::pair<float, const Metar *>& m2) -> bool {
+              return m1.first < m2.first;
+            });
+
+      atools::fs::weather::MetarPtrList metars;
+      for(const std::pair<float, const Metar *>& distMetar : std::as_const(distMetars))
+        metars.append(distMetar.second);
+
+      // Interpolate nearest metars =================================
+      Metar metarInterpolatedNew = Metar(stationBytes, pos, metars);
+      metarInterpolatedNew.parseAll(false /* useTimestamp */);
+
+      {
+        QMutexLocker locker(&shard.mutex);
+
+        // Clear full shard if too large
+        if(shard.metars.size() > maxInterpolatedCacheSize / NUM_CACHE_SHARDS)
+          shard.metars.clear();
+
+        // Add to cache if not cleared in the meantime =======================
+        if(cacheGeneration.load() == generation)
+          shard.metars.insert(key, metarInterpolatedNew);
+      }
+      return metarInterpolatedNew;
+    }
+    else
+      qWarning() << Q_FUNC_INFO << "Cannot find METAR" << pos << stationBytes;
+  } // if(metar.hasAnyMetar()) return metar; else
 
   return Metar::EMPTY;
 }
 
-void MetarIndex::updateIndex()
+void MetarIndex::getNearestMetars(QList<Metar>& metars, const QList<atools::geo::Pos>& positions, int numThreads) const
 {
-  spatialIndex->updateIndex();
-}
+  // Keep snapshot alive until done
+  std::shared_ptr<const MetarSnapshot> current = getSnapshot();
 
-const Metar& MetarIndex::fetchMetar(const QByteArray& ident) const
-{
-  if(!ident.isEmpty())
-  {
-    int idx = identIndexMap.value(ident, -1);
+  // Query nearest stations for all positions in parallel
+  QList<int> nearestIndexes;
+  current->spatialIndex.getNearestIndexesBatch(nearestIndexes, positions, numThreads);
 
-    if(idx != -1)
-      return metarList.at(idx);
+  float maxDistanceMeter = atools::geo::nmToMeter(maxDistanceInterpolationNm);
+  metars.clear();
+  metars.reserve(positions.size());
+  for(int i = 0; i < nearestIndexes.size(); i++)
+  {
+    int nearestIndex = nearestIndexes.at(i);
+    if(nearestIndex != -1)
+    {
+      const Metar& nearestMetar = current->parsedMetar(current->spatialIndex.at(nearestIndex).index);
+      if(nearestMetar.getPosition().distanceMeterTo(positions.at(i)) <= maxDistanceMeter)
+      {
+        metars.append(nearestMetar);
+        continue;
+      }
+    }
+    metars.append(Metar::EMPTY);
   }
-
-  return Metar::EMPTY;
 }
 
 } // namespace weather
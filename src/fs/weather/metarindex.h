@@ -22,23 +22,27 @@
 #include "fs/util/airportcoordtypes.h"
 
 #include <QList>
+#include <QMutex>
 
-class QTextStream;
+#include <atomic>
+#include <memory>
 
+class QTextStream;
+class QElapsedTimer;
 class QDateTime;
 
 namespace atools {
 namespace geo {
 class Pos;
-template<typename TYPE>
-class SpatialIndex;
 }
 
 namespace fs {
 namespace weather {
 
-class PosIndex;
 class Metar;
+struct MetarScanResult;
+struct MetarSnapshot;
+struct MetarCacheShard;
 
 /*
  * Reads, caches and indexes (by position) METAR reports in NOAA style as also used by X-Plane.
@@ -59,6 +63,14 @@ class Metar;
  *
  * KC99 100906Z AUTO 30022G42KT 10SM CLR M01/M04 A3035 RMK AO2
  * LCEN 100920Z 16004KT 090V230 CAVOK 31/10 Q1010 NOSIG
+ *
+ * Lines of NOAA, X-Plane and flat files are scanned in parallel. METARs are stored unparsed and
+ * parsed when first accessed by getMetar().
+ *
+ * getMetar(), isEmpty() and numStationMetars() are thread safe and can be called while another thread
+ * reads files. Readers work on an immutable snapshot of the station METARs which is replaced as a whole
+ * once read() or clear() is done. Interpolated METARs are cached in shards having their own lock.
+ * Setters have to be called before using the index.
  */
 class MetarIndex
 {
@@ -70,7 +82,7 @@ public:
   MetarIndex& operator=(const MetarIndex& other) = delete;
 
   /* Read METARs from stream and add them to the index. Merges into current list or clears list before.
-   * Older of duplicates are ignored/removed.
+   * Older of duplicates are ignored/removed. The new list is published when reading is done.
    * Returns number of METARs read. */
   int read(QTextStream& stream, const QString& fileName, bool merge);
   int read(const QString& filename, bool merge);
@@ -89,8 +101,16 @@ public:
    * - Station will be saved as request ident if given. Only interpolated and/or nearest are returned if station is not given.
    * - Nearest is returned if no station can be found.
    * - Interpolated is returned if no station found and nearest is not close to pos.
-   * Position and ident of original request are kept.*/
-  const Metar& getMetar(const QString& station, atools::geo::Pos pos);
+   * Position and ident of original request are kept.
+   * Returns a copy since the underlying data can be replaced at any time by another thread.
+   * The airport coordinate callback is called if pos is invalid. It has to be thread safe in this case. */
+  Metar getMetar(const QString& station, atools::geo::Pos pos) const;
+
+  /* Get the station METAR nearest to each position for many positions at once, e.g. for all airports on a map.
+   * metars has the same size and order as positions. Contains an empty METAR if no station is found within the
+   * interpolation distance. Spatial queries are distributed over numThreads. 0 uses the number of cores. Thread safe. */
+  void getNearestMetars(QList<atools::fs::weather::Metar>& metars, const QList<atools::geo::Pos>& positions,
+                        int numThreads = 0) const;
 
   /* Set to a function that returns the coordinates for an airport ident. Needed to find the nearest if no position is given. */
   void setFetchAirportCoords(atools::fs::util::AirportCoordFuncType function, void *object)
@@ -111,7 +131,7 @@ public:
     maxDistanceInterpolationNm = value;
   }
 
-  /* Maximum number of interpolated METARs in cache */
+  /* Maximum number of interpolated METARs in cache. Split evenly between shards. */
   void setMaxInterpolatedCacheSize(int value)
   {
     maxInterpolatedCacheSize = value;
@@ -124,37 +144,48 @@ public:
   }
 
 private:
-  /* Get a METAR string. Empty if not available */
-  const atools::fs::weather::Metar& fetchMetar(const QByteArray& ident) const;
+  /* Get current snapshot. Never null. */
+  std::shared_ptr<const atools::fs::weather::MetarSnapshot> getSnapshot() const;
 
   /* Read NOAA or XPLANE format */
-  int readNoaaXplane(QTextStream& stream, const QString& fileOrUrl, bool merge);
+  int readNoaaXplane(atools::fs::weather::MetarSnapshot& snapshot, QTextStream& stream, const QString& fileOrUrl);
 
   /* Read flat file format like VATSIM */
-  int readFlat(QTextStream& stream, const QString& fileOrUrl, bool merge);
+  int readFlat(atools::fs::weather::MetarSnapshot& snapshot, QTextStream& stream, const QString& fileOrUrl);
 
-  /* Read JSON file format from IVAO */
-  int readJson(QTextStream& stream, const QString& fileOrUrl, bool merge);
+  /* Add lines from scanner to index in order. Returns number of METARs found. */
+  int insertScanResults(atools::fs::weather::MetarSnapshot& snapshot, const QList<atools::fs::weather::MetarScanResult>& results,
+                        const QString& fileOrUrl, const QElapsedTimer& timer);
 
-  /* Copy airports from the complete list to the index with coordinates.
-   * Copies only airports that exist in the current simulator database, i.e. where fetchAirportCoords returns
-   * a valid coordinate. */
-  void updateIndex();
+  /* Read JSON file format from IVAO */
+  int readJson(atools::fs::weather::MetarSnapshot& snapshot, QTextStream& stream, const QString& fileOrUrl);
 
   /* Update or insert a METAR entry */
-  void updateOrInsert(const QByteArray& metarString, const QByteArray& ident, const QDateTime& lastTimestamp);
+  void updateOrInsert(atools::fs::weather::MetarSnapshot& snapshot, const QByteArray& metarString, const QByteArray& ident,
+                      const QDateTime& lastTimestamp);
+
+  /* Print sizes after reading */
+  void logSizes(const atools::fs::weather::MetarSnapshot& snapshot) const;
 
   /* Callback to get airport coodinates by ICAO ident */
   // std::function<atools::geo::Pos(const QByteArray&)> fetchAirportCoords;
   atools::fs::util::AirportCoordFuncType airportCoordFunction = nullptr;
   void *airportCoordObject = nullptr;
 
-  /* Map containing all loaded METARs airport idents mapped to the position in metarList */
-  QHash<QByteArray, int> identIndexMap;
+  /* Station METARs, ident map and spatial index. Replaced as a whole. */
+  std::shared_ptr<const atools::fs::weather::MetarSnapshot> snapshot;
+
+  /* Guards only the snapshot pointer copy and swap */
+  mutable QMutex snapshotMutex;
 
-  /* Index containing all stations which could be resolved to a coordinate. */
-  atools::geo::SpatialIndex<PosIndex> *spatialIndex = nullptr, *spatialIndexInterpolated = nullptr;
-  QList<atools::fs::weather::Metar> metarList, metarInterpolatedList;
+  /* Serializes calls to read() and clear() */
+  QMutex writeMutex;
+
+  /* Cache for interpolated METARs split into shards by position */
+  std::unique_ptr<atools::fs::weather::MetarCacheShard[]> cacheShards;
+
+  /* Incremented by clearCache(). Interpolated METARs are not cached if the generation changed while calculating. */
+  std::atomic<quint64> cacheGeneration = 0;
 
   int maxInterpolatedCacheSize = 40000;
   float maxDistanceToleranceMeter = 100.f;
@@ -164,9 +195,6 @@ private:
 
   bool verbose = false;
   atools::fs::weather::MetarFormat format = atools::fs::weather::UNKNOWN;
-
-  // Block fetching METARs while reading files. Can happen if input events are processes while reading.
-  bool reading = false;
 };
 
 } // namespace weather
@@ -46,7 +46,7 @@ WeatherDownloadBase::~WeatherDownloadBase()
   delete metarIndex;
 }
 
-const Metar& WeatherDownloadBase::getMetar(const QString& airportIcao, const geo::Pos& pos)
+Metar WeatherDownloadBase::getMetar(const QString& airportIcao, const geo::Pos& pos)
 {
   // Trigger download only if the error grace period is not active and the index is empty
   if(!isErrorState() && metarIndex->isEmpty())
@@ -60,6 +60,17 @@ const Metar& WeatherDownloadBase::getMetar(const QString& airportIcao, const geo
   return metarIndex->getMetar(airportIcao, pos);
 }
 
+void WeatherDownloadBase::getNearestMetars(QList<Metar>& metars, const QList<geo::Pos>& positions)
+{
+  if(!isErrorState() && metarIndex->isEmpty())
+  {
+    if(!isDownloading())
+      startDownload();
+  }
+
+  metarIndex->getNearestMetars(metars, positions);
+}
+
 void WeatherDownloadBase::setRequestUrl(const QString& url)
 {
   downloader->setUrl(url);
@@ -58,7 +58,10 @@ public:
    *
    * Download and timer is triggered on first call.
    */
-  virtual const atools::fs::weather::Metar& getMetar(const QString& airportIcao, const atools::geo::Pos& pos);
+  virtual atools::fs::weather::Metar getMetar(const QString& airportIcao, const atools::geo::Pos& pos);
+
+  /* Nearest station METAR for each position. See MetarIndex::getNearestMetars(). Triggers download like getMetar(). */
+  void getNearestMetars(QList<atools::fs::weather::Metar>& metars, const QList<atools::geo::Pos>& positions);
 
   /* Set download request URL */
   virtual void setRequestUrl(const QString& url);
@@ -73,7 +73,7 @@ void XpWeatherReader::load()
   }
 }
 
-const atools::fs::weather::Metar& XpWeatherReader::getXplaneMetar(const QString& station, const atools::geo::Pos& pos)
+atools::fs::weather::Metar XpWeatherReader::getXplaneMetar(const QString& station, const atools::geo::Pos& pos)
 {
   if(needsLoading())
     load();
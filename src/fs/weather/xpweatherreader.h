@@ -54,7 +54,7 @@ public:
 
   /* Get METAR for airport ICAO or empty string if file or airport is not available.
    * Get station and/or nearest METAR */
-  const atools::fs::weather::Metar& getXplaneMetar(const QString& station, const atools::geo::Pos& pos);
+  atools::fs::weather::Metar getXplaneMetar(const QString& station, const atools::geo::Pos& pos);
 
   /* File is loaded on demand on first call here. X-Plane 11 uses a file and X-Plane 12 a folder. */
   void setWeatherPath(const QString& path, atools::fs::weather::XpWeatherType type);
@@ -19,6 +19,9 @@
 
 #include "fs/progresshandler.h"
 #include "fs/userdata/airspacereaderopenair.h"
+#include "fs/navdatabaseoptions.h"
+
+#include <QDir>
 
 namespace atools {
 namespace fs {
@@ -30,6 +33,9 @@ XpAirspaceReader::XpAirspaceReader(atools::sql::SqlDatabase& sqlDb,
   : XpReader(sqlDb, opts, progressHandler, navdatabaseErrors)
 {
   airspaceReader = new atools::fs::userdata::AirspaceReaderOpenAir(&sqlDb);
+
+  if(!opts.getCacheDirectory().isEmpty())
+    airspaceReader->setCacheDirectory(QDir(opts.getCacheDirectory()).filePath("airspaces"));
 }
 
 XpAirspaceReader::~XpAirspaceReader()
@@ -37,6 +43,14 @@ XpAirspaceReader::~XpAirspaceReader()
   delete airspaceReader;
 }
 
+bool XpAirspaceReader::readCached(const XpReaderContext& context)
+{
+  ctx = &context;
+  bool cached = airspaceReader->readCachedFile(ctx->filePath, ctx->curFileId);
+  postWrite();
+  return cached;
+}
+
 void XpAirspaceReader::read(const QStringList& line, const XpReaderContext& context)
 {
   ctx = &context;
@@ -58,6 +58,7 @@ public:
   XpAirspaceReader(const XpAirspaceReader& other) = delete;
   XpAirspaceReader& operator=(const XpAirspaceReader& other) = delete;
 
+  virtual bool readCached(const XpReaderContext& context) override;
   virtual void read(const QStringList& line, const XpReaderContext& context) override;
   virtual void finish(const XpReaderContext& context) override;
   virtual void reset() override;
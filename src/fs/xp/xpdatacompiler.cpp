@@ -35,6 +35,7 @@
 #include "sql/sqlutil.h"
 #include "settings/settings.h"
 #include "fs/xp/xpairwaypostprocess.h"
+#include "fs/xp/xplinereader.h"
 #include "fs/progresshandler.h"
 #include "exception.h"
 #include "atools.h"
@@ -50,6 +51,10 @@
 #include <QRegularExpression>
 #include <QStandardPaths>
 #include <QQueue>
+#include <QThread>
+#include <QThreadPool>
+
+#include <deque>
 
 using atools::sql::SqlQuery;
 using atools::sql::SqlUtil;
@@ -236,31 +241,84 @@ bool XpDataCompiler::compileCustomApt()
   // X-Plane 11/Custom Scenery/LFPG Paris - Charles de Gaulle/Earth Nav data/apt.dat
   const QStringList aptDatFiles = findCustomAptDatFiles(buildPathNoCase({options.getBasepath(), "Custom Scenery"}),
                                                         options, errors, progress, true /* verbose */, false /* userInclude */);
-  for(const QString& aptdat : aptDatFiles)
-  {
-    // Only one progress report per file
-    if(readDataFile(aptdat, 1, airportReader, IS_ADDON | READ_SHORT_REPORT, 1))
-      return true;
-  }
+  if(readAptDatFiles(aptDatFiles))
+    return true;
+
   db.commit();
   return false;
 }
 
 bool XpDataCompiler::compileUserIncludeApt()
 {
+  QStringList aptDatFiles;
   for(const QString& path : options.getDirIncludesGui())
-  {
     // Find all apt.dat in the included folder
-    const QStringList aptDatFiles = findCustomAptDatFiles(path, options, errors, progress, true /* verbose */, true /* userInclude */);
+    aptDatFiles.append(findCustomAptDatFiles(path, options, errors, progress, true /* verbose */, true /* userInclude */));
+
+  if(readAptDatFiles(aptDatFiles))
+    return true;
+
+  db.commit();
+  return false;
+}
+
+bool XpDataCompiler::readAptDatFiles(const QStringList& aptDatFiles)
+{
+  int threads = options.getCompileThreads() > 0 ? options.getCompileThreads() : QThread::idealThreadCount();
+  if(threads <= 1 || aptDatFiles.size() <= 1)
+  {
     for(const QString& aptdat : aptDatFiles)
     {
       // Only one progress report per file
       if(readDataFile(aptdat, 1, airportReader, IS_ADDON | READ_SHORT_REPORT, 1))
         return true;
     }
+    return false;
   }
-  db.commit();
-  return false;
+
+  qInfo() << Q_FUNC_INFO << "Reading" << aptDatFiles.size() << "files using" << threads << "threads";
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+
+  // Files queued for splitting in the thread pool in file order
+  std::deque<std::future<TokenizedFilePtr> > readAheadFiles;
+  int readAheadIndex = 0, readAheadMax = threads * 2;
+  bool aborted = false;
+
+  for(int i = 0; i < aptDatFiles.size() && !aborted; i++)
+  {
+    // Keep the read ahead queue filled to give the pool threads work while the reader writes to the database
+    while(readAheadIndex < aptDatFiles.size() && readAheadIndex < i + readAheadMax)
+    {
+      // Promise has to be shared since the pool needs a copyable function object
+      std::shared_ptr<std::promise<TokenizedFilePtr> > promise = std::make_shared<std::promise<TokenizedFilePtr> >();
+      readAheadFiles.push_back(promise->get_future());
+
+      QString filepath = aptDatFiles.at(readAheadIndex++);
+      pool.start([promise, filepath]() -> void
+      {
+        try
+        {
+          promise->set_value(tokenizeDataFile(filepath, IS_ADDON | READ_SHORT_REPORT, 1));
+        }
+        catch(...)
+        {
+          promise->set_exception(std::current_exception());
+        }
+      });
+    }
+
+    std::future<TokenizedFilePtr> future = std::move(readAheadFiles.front());
+    readAheadFiles.pop_front();
+
+    // Only one progress report per file - database is updated in file order
+    aborted = readDataFile(aptDatFiles.at(i), 1, airportReader, IS_ADDON | READ_SHORT_REPORT, 1, &future);
+  }
+
+  // Remaining tasks are discarded
+  pool.waitForDone();
+  return aborted;
 }
 
 bool XpDataCompiler::compileCustomGlobalApt()
@@ -418,17 +476,21 @@ bool XpDataCompiler::compileMagDeclBgl()
 }
 
 bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpReader *reader, atools::fs::xp::ContextFlags flags,
-                                  int numReportSteps)
+                                  int numReportSteps, std::future<TokenizedFilePtr> *tokenized)
 {
-  QFile file;
-  QTextStream stream;
+  XpLineReader lineReader;
   bool aborted = false;
 
   QString progressMsg = tr("Reading: %1").arg(atools::nativeCleanPath(filepath));
   QFileInfo fileinfo(filepath);
 
   if(!includeFile(fileinfo))
+  {
+    if(tokenized != nullptr)
+      // Wait for the pool before discarding the result
+      tokenized->wait();
     return false;
+  }
 
   if(!options.isAddonGui(fileinfo))
     // Clear add-on flag if directory is excluded
@@ -438,8 +500,21 @@ bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpRea
 
   try
   {
-    // Open file and read header - throws exception on error
-    if(openFile(stream, file, filepath, flags, lineNum, totalNumLines, fileVersion))
+    // Lines read and split by pool - rethrows exceptions from reading
+    TokenizedFilePtr tokenizedFile = tokenized != nullptr ? tokenized->get() : nullptr;
+
+    bool opened;
+    if(tokenizedFile != nullptr)
+    {
+      lineNum = tokenizedFile->headerLineNum;
+      totalNumLines = tokenizedFile->totalNumLines;
+      opened = checkHeader(filepath, flags, tokenizedFile->header, lineNum, tokenizedFile->totalNumLines, fileVersion);
+    }
+    else
+      // Open file and read header - throws exception on error
+      opened = openFile(lineReader, filepath, flags, lineNum, totalNumLines, fileVersion);
+
+    if(opened)
     {
       XpReaderContext context;
       context.curFileId = curFileId;
@@ -479,7 +554,14 @@ bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpRea
         context.cifpAirportId = airportIndex->getAirportId(context.cifpAirportIdent, true /* allIdents */);
       }
 
-      QString line;
+      if(reader->readCached(context))
+      {
+        reader->reset();
+        return aborted;
+      }
+
+      // Line is a view into the file and fields are reused for each line
+      QByteArrayView line;
       QStringList fields;
 
       QElapsedTimer timer;
@@ -494,9 +576,22 @@ bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpRea
       int row = 0, steps = 0;
 
       // Read lines
-      while(!stream.atEnd() && line != "99")
+      qsizetype tokenizedIndex = 0;
+      while(tokenizedFile != nullptr ? tokenizedIndex < tokenizedFile->lines.size() :
+            !lineReader.atEnd() && line != QByteArrayView("99"))
       {
-        line = stream.readLine().trimmed();
+        const QStringList *lineFields = nullptr;
+        if(tokenizedFile != nullptr)
+        {
+          lineNum = tokenizedFile->lineNumbers.at(tokenizedIndex);
+          lineFields = &tokenizedFile->lines.at(tokenizedIndex++);
+        }
+        else
+        {
+          line = lineReader.readLine().trimmed();
+          if(splitLine(lineReader, line, fields, flags, minColumns))
+            lineFields = &fields;
+        }
 
         if(!flags.testFlag(READ_SHORT_REPORT) && numReportSteps > 0)
         {
@@ -514,52 +609,22 @@ bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpRea
           }
         }
 
-        if(flags.testFlag(READ_AIRSPACE) && !line.startsWith(QStringLiteral("AN")))
-        {
-          // Strip OpenAirport file comments except for airport names
-          int idx = line.indexOf(QStringLiteral("*"));
-          if(idx != -1)
-            line = line.left(line.indexOf(QStringLiteral("*")));
-        }
-        else if(!flags.testFlag(READ_CIFP))
+        if(lineFields != nullptr)
         {
-          // Strip dat-file comments
-          if(line.startsWith(QStringLiteral("#")))
-            line.clear();
-        }
-
-        if(!line.isEmpty())
-        {
-          if(flags.testFlag(READ_CIFP))
-            fields = line.split(QStringLiteral(","));
-          else
-            fields = line.simplified().split(QStringLiteral(" "));
+          context.lineNumber = lineNum;
 
-          if(fields.size() >= minColumns)
-          {
-            if(flags.testFlag(READ_CIFP))
-            {
-              // Extract colon separated row code
-              QString first = fields.takeFirst();
-              QStringList rowCode = first.split(QStringLiteral(":"));
-              if(rowCode.size() == 2)
-              {
-                fields.prepend(rowCode.at(1));
-                fields.prepend(rowCode.at(0));
-              }
-            }
-            context.lineNumber = lineNum;
-
-            // Call writer
-            reader->read(fields, context);
-          }
+          // Call writer
+          reader->read(*lineFields, context);
         }
         lineNum++;
       }
       if(!aborted)
         reader->finish(context);
 
-      file.close();
+      lineReader.close();
+
+      if(!flags.testFlag(READ_SHORT_REPORT))
+        qInfo() << Q_FUNC_INFO << "Reading" << lineNum << "lines from" << fileinfo.fileName() << "took" << timer.elapsed() << "ms";
 
       if(!flags.testFlag(READ_SHORT_REPORT) && numReportSteps > 0)
         // Eat up any remaining progress steps
@@ -586,91 +651,167 @@ bool XpDataCompiler::readDataFile(const QString& filepath, int minColumns, XpRea
   return aborted;
 }
 
-bool XpDataCompiler::openFile(QTextStream& stream, QFile& filepath, const QString& filename, atools::fs::xp::ContextFlags flags,
+bool XpDataCompiler::openFile(XpLineReader& reader, const QString& filename, atools::fs::xp::ContextFlags flags,
                               int& lineNum, int& totalNumLines, int& fileVersion)
 {
-  bool retval = false;
-
-  filepath.setFileName(filename);
   lineNum = 1;
 
-  if(filepath.open(QIODevice::ReadOnly | QIODevice::Text))
+  if(reader.open(filename))
   {
-    stream.setDevice(&filepath);
-
+    QString header;
     if(!(flags & READ_CIFP) && !(flags & READ_AIRSPACE))
     {
-      // Read file header =============================
-      // Skip empty lines which can appear in some malformed add-on airport files
-      // Byte order identifier ===========
-      QString line;
-      do
-      {
-        line = stream.readLine().simplified();
-        lineNum++;
-      } while(line.isEmpty() && !stream.atEnd() && line != QStringLiteral("99"));
-      qInfo() << Q_FUNC_INFO << line;
-
-      // Metadata and copyright ===========
-      do
-      {
-        line = stream.readLine().simplified();
-        lineNum++;
-      } while(line.isEmpty() && !stream.atEnd() && line != QStringLiteral("99"));
-      qInfo() << Q_FUNC_INFO << line;
+      readHeader(reader, lineNum, header);
 
-      QStringList fields = line.simplified().split(QStringLiteral(" "));
-      if(!fields.isEmpty())
-        fileVersion = fields.constFirst().toInt();
+      qInfo() << Q_FUNC_INFO << "Counting lines for" << filename;
+      totalNumLines = reader.countLines();
+      qInfo() << Q_FUNC_INFO << "Num lines" << totalNumLines;
+    }
 
-      if(!fields.isEmpty() && fileVersion < minFileVersion)
-      {
-        qWarning() << "Version of" << filename << "is" << fields.constFirst() << "but expected a minimum of" << minFileVersion;
-        throw atools::Exception(QStringLiteral("Found file version %1. Minimum supported is %2.").arg(fields.constFirst()).arg(
-                                  minFileVersion));
-      }
+    return checkHeader(filename, flags, header, lineNum, totalNumLines, fileVersion);
+  }
+  else
+    throw atools::Exception("Cannot open file. Reason: " + reader.errorString() + ".");
+}
 
-      metadataWriter->writeFile(filename, QStringLiteral(), curSceneryId, ++curFileId);
-      progress->incNumFiles();
-      retval = true;
+void XpDataCompiler::readHeader(XpLineReader& reader, int& lineNum, QString& header)
+{
+  // Read file header =============================
+  // Skip empty lines which can appear in some malformed add-on airport files
+  // Byte order identifier ===========
+  QString line;
+  do
+  {
+    line = QString::fromUtf8(reader.readLine()).simplified();
+    lineNum++;
+  } while(line.isEmpty() && !reader.atEnd() && line != QStringLiteral("99"));
+  qInfo() << Q_FUNC_INFO << line;
 
-      if(flags & UPDATE_CYCLE)
-        updateAiracCycleFromHeader(line, filename, lineNum);
+  // Metadata and copyright ===========
+  do
+  {
+    line = QString::fromUtf8(reader.readLine()).simplified();
+    lineNum++;
+  } while(line.isEmpty() && !reader.atEnd() && line != QStringLiteral("99"));
+  qInfo() << Q_FUNC_INFO << line;
 
-      qInfo() << Q_FUNC_INFO << "Counting lines for" << filename;
-      qint64 pos = stream.pos();
-      int lines = 0;
-      while(!stream.atEnd())
-      {
-        line = stream.readLine();
-        if(line == QStringLiteral("99"))
-          break;
-        lines++;
-      }
+  header = line;
+}
 
-      if(lines == 0)
-      {
-        qWarning() << Q_FUNC_INFO << "Empty file" << filepath.fileName();
-        retval = false;
-      }
+bool XpDataCompiler::checkHeader(const QString& filename, atools::fs::xp::ContextFlags flags, const QString& header,
+                                 int lineNum, int totalNumLines, int& fileVersion)
+{
+  bool retval = true;
+  if(!(flags & READ_CIFP) && !(flags & READ_AIRSPACE))
+  {
+    QStringList fields = header.split(QStringLiteral(" "));
+    if(!fields.isEmpty())
+      fileVersion = fields.constFirst().toInt();
 
-      totalNumLines = lines;
-      stream.seek(pos);
-      qInfo() << Q_FUNC_INFO << "Num lines" << lines;
+    if(!fields.isEmpty() && fileVersion < minFileVersion)
+    {
+      qWarning() << "Version of" << filename << "is" << fields.constFirst() << "but expected a minimum of" << minFileVersion;
+      throw atools::Exception(QStringLiteral("Found file version %1. Minimum supported is %2.").arg(fields.constFirst()).arg(
+                                minFileVersion));
     }
-    else
+
+    metadataWriter->writeFile(filename, QStringLiteral(), curSceneryId, ++curFileId);
+    progress->incNumFiles();
+
+    if(flags & UPDATE_CYCLE)
+      updateAiracCycleFromHeader(header, filename, lineNum);
+
+    if(totalNumLines == 0)
     {
-      metadataWriter->writeFile(filename, QStringLiteral(), curSceneryId, ++curFileId);
-      progress->incNumFiles();
-      retval = true;
+      qWarning() << Q_FUNC_INFO << "Empty file" << filename;
+      retval = false;
     }
   }
   else
-    throw atools::Exception("Cannot open file. Reason: " + filepath.errorString() + ".");
+  {
+    metadataWriter->writeFile(filename, QStringLiteral(), curSceneryId, ++curFileId);
+    progress->incNumFiles();
+  }
 
   return retval;
 }
 
+bool XpDataCompiler::splitLine(XpLineReader& reader, QByteArrayView& line, QStringList& fields,
+                               atools::fs::xp::ContextFlags flags, int minColumns)
+{
+  if(flags.testFlag(READ_AIRSPACE) && !line.startsWith(QByteArrayView("AN")))
+  {
+    // Strip OpenAirport file comments except for airport names
+    qsizetype idx = line.indexOf('*');
+    if(idx != -1)
+      line = line.first(idx);
+  }
+  else if(!flags.testFlag(READ_CIFP))
+  {
+    // Strip dat-file comments
+    if(line.startsWith('#'))
+      line = QByteArrayView();
+  }
+
+  if(line.isEmpty())
+    return false;
+
+  if(flags.testFlag(READ_CIFP))
+    reader.split(fields, line, ',');
+  else
+    reader.split(fields, line);
+
+  if(fields.size() < minColumns)
+    return false;
+
+  if(flags.testFlag(READ_CIFP))
+  {
+    // Extract colon separated row code
+    QString first = fields.takeFirst();
+    QStringList rowCode = first.split(QStringLiteral(":"));
+    if(rowCode.size() == 2)
+    {
+      fields.prepend(rowCode.at(1));
+      fields.prepend(rowCode.at(0));
+    }
+  }
+  return true;
+}
+
+XpDataCompiler::TokenizedFilePtr XpDataCompiler::tokenizeDataFile(const QString& filepath, atools::fs::xp::ContextFlags flags,
+                                                                  int minColumns)
+{
+  TokenizedFilePtr file = std::make_shared<TokenizedFile>();
+  XpLineReader reader;
+
+  if(!reader.open(filepath))
+    throw atools::Exception("Cannot open file. Reason: " + reader.errorString() + ".");
+
+  if(!(flags & READ_CIFP) && !(flags & READ_AIRSPACE))
+  {
+    readHeader(reader, file->headerLineNum, file->header);
+    file->totalNumLines = reader.countLines();
+  }
+
+  // Same loop as in readDataFile() but collects lines
+  int lineNum = file->headerLineNum;
+  QByteArrayView line;
+  while(!reader.atEnd() && line != QByteArrayView("99"))
+  {
+    line = reader.readLine().trimmed();
+
+    // New list for each line since it is kept
+    QStringList fields;
+    if(splitLine(reader, line, fields, flags, minColumns))
+    {
+      file->lines.append(fields);
+      file->lineNumbers.append(lineNum);
+    }
+    lineNum++;
+  }
+  return file;
+}
+
 void XpDataCompiler::close()
 {
   ATOOLS_DELETE_LOG(fixReader);
@@ -22,8 +22,9 @@
 
 #include <QCoreApplication>
 
-class QTextStream;
-class QFile;
+#include <future>
+#include <memory>
+
 class QFileInfo;
 
 namespace atools {
@@ -58,6 +59,7 @@ class XpCifpReader;
 class XpAirspaceReader;
 class XpReader;
 class XpAirwayPostProcess;
+class XpLineReader;
 
 /*
  * Provides methods to read X-Plane data from text files into the database.
@@ -246,13 +248,45 @@ private:
   void initQueries();
   void deInitQueries();
 
+  /* All lines of a dat file split into fields. Filled by tokenizeDataFile() in a background thread. */
+  struct TokenizedFile
+  {
+    QString header; /* Simplified header line with version and cycle. Empty for CIFP and airspaces. */
+    int headerLineNum = 1, totalNumLines = 0;
+
+    QList<QStringList> lines; /* Lines having at least minColumns fields */
+    QList<int> lineNumbers; /* Line number in file for each entry in lines */
+  };
+
+  typedef std::shared_ptr<TokenizedFile> TokenizedFilePtr;
+
   /* Open file and read header */
-  bool openFile(QTextStream& stream, QFile& filepath, const QString& filename, ContextFlags flags,
+  bool openFile(atools::fs::xp::XpLineReader& reader, const QString& filename, ContextFlags flags,
                 int& lineNum, int& totalNumLines, int& fileVersion);
 
-  /* Read file line by line and call reader for each one */
+  /* Check version, write metadata and update cycle from header read by readHeader() */
+  bool checkHeader(const QString& filename, ContextFlags flags, const QString& header, int lineNum, int totalNumLines,
+                   int& fileVersion);
+
+  /* Skip empty lines and read byte order identifier and header line with version */
+  static void readHeader(atools::fs::xp::XpLineReader& reader, int& lineNum, QString& header);
+
+  /* Strip comments from line and split it into fields. Returns false if line is empty or has less than minColumns
+   * fields. Shared by sequential and background reading. */
+  static bool splitLine(atools::fs::xp::XpLineReader& reader, QByteArrayView& line, QStringList& fields,
+                        atools::fs::xp::ContextFlags flags, int minColumns);
+
+  /* Read file line by line and call reader for each one. Uses the lines from tokenized if not null. */
   bool readDataFile(const QString& filepath, int minColumns, atools::fs::xp::XpReader *reader,
-                    atools::fs::xp::ContextFlags flags, int numReportSteps);
+                    atools::fs::xp::ContextFlags flags, int numReportSteps,
+                    std::future<TokenizedFilePtr> *tokenized = nullptr);
+
+  /* Read and split whole file. Thread safe. Throws exception on error. */
+  static TokenizedFilePtr tokenizeDataFile(const QString& filepath, atools::fs::xp::ContextFlags flags, int minColumns);
+
+  /* Read apt.dat files in the given order. Files are split into fields ahead in a thread pool if configured
+   * while the airport reader is called sequentially in file order. */
+  bool readAptDatFiles(const QStringList& aptDatFiles);
   static QString buildBasePath(const NavDatabaseOptions& opts, const QString& filename);
 
   /* FInd custom apt.dat like X-Plane 11/Custom Scenery/LFPG Paris - Charles de Gaulle/Earth Nav data/apt.dat */
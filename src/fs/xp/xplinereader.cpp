@@ -0,0 +1,211 @@
+/*****************************************************************************
+* Copyright 2015-2026 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "fs/xp/xplinereader.h"
+
+#include <QDebug>
+
+#include <cstring>
+
+namespace atools {
+namespace fs {
+namespace xp {
+
+/* Same as QChar::isSpace() for ASCII characters */
+inline bool isSpace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* true if line contains only 7-bit ASCII characters */
+inline bool isAscii(QByteArrayView line)
+{
+  for(char c : line)
+  {
+    if(static_cast<unsigned char>(c) >= 0x80)
+      return false;
+  }
+  return true;
+}
+
+XpLineReader::XpLineReader()
+{
+
+}
+
+XpLineReader::~XpLineReader()
+{
+  close();
+}
+
+bool XpLineReader::open(const QString& filename)
+{
+  close();
+
+  file.setFileName(filename);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+
+  size = file.size();
+  uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+  if(mapped != nullptr)
+    data = reinterpret_cast<const char *>(mapped);
+  else
+  {
+    // Mapping not supported for this file - read into memory
+    if(size > 0)
+      qWarning() << Q_FUNC_INFO << "Cannot map" << filename << file.errorString();
+
+    fileBytes = file.readAll();
+    data = fileBytes.constData();
+    size = fileBytes.size();
+  }
+
+  // Skip UTF-8 byte order mark like QTextStream
+  if(size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    pos = 3;
+
+  return true;
+}
+
+void XpLineReader::close()
+{
+  // Also unmaps file
+  file.close();
+  fileBytes.clear();
+  data = nullptr;
+  pos = size = 0;
+}
+
+QByteArrayView XpLineReader::readLine()
+{
+  if(pos >= size)
+    return QByteArrayView();
+
+  const char *start = data + pos;
+  const char *end = static_cast<const char *>(std::memchr(start, '\n', static_cast<size_t>(size - pos)));
+
+  qsizetype length;
+  if(end != nullptr)
+  {
+    length = end - start;
+    pos += length + 1;
+  }
+  else
+  {
+    // Last line without line feed
+    length = size - pos;
+    pos = size;
+  }
+
+  // Remove carriage return from Windows line endings
+  if(length > 0 && start[length - 1] == '\r')
+    length--;
+
+  return QByteArrayView(start, length);
+}
+
+int XpLineReader::countLines() const
+{
+  int lines = 0;
+  qint64 curPos = pos;
+  while(curPos < size)
+  {
+    const char *start = data + curPos;
+    const char *end = static_cast<const char *>(std::memchr(start, '\n', static_cast<size_t>(size - curPos)));
+    qsizetype length = end != nullptr ? end - start : size - curPos;
+    curPos += length + 1;
+
+    if(length > 0 && start[length - 1] == '\r')
+      length--;
+
+    if(QByteArrayView(start, length) == QByteArrayView("99"))
+      break;
+    lines++;
+  }
+  return lines;
+}
+
+void XpLineReader::split(QStringList& fields, QByteArrayView line)
+{
+  if(!isAscii(line))
+  {
+    // Rare case - leave handling of unicode whitespace to QString
+    fields = QString::fromUtf8(line).simplified().split(QStringLiteral(" "));
+    return;
+  }
+
+  views.clear();
+  qsizetype i = 0, length = line.size();
+  while(i < length)
+  {
+    // Skip whitespace
+    while(i < length && isSpace(line.at(i)))
+      i++;
+
+    qsizetype start = i;
+    while(i < length && !isSpace(line.at(i)))
+      i++;
+
+    if(i > start)
+      views.append(line.sliced(start, i - start));
+  }
+
+  toStrings(fields);
+}
+
+void XpLineReader::split(QStringList& fields, QByteArrayView line, char separator)
+{
+  if(!isAscii(line))
+  {
+    fields = QString::fromUtf8(line).split(QLatin1Char(separator));
+    return;
+  }
+
+  views.clear();
+  qsizetype start = 0, index;
+  while((index = line.indexOf(separator, start)) != -1)
+  {
+    views.append(line.sliced(start, index - start));
+    start = index + 1;
+  }
+  views.append(line.sliced(start));
+
+  toStrings(fields);
+}
+
+void XpLineReader::toStrings(QStringList& fields)
+{
+  fields.resize(views.size());
+
+  // Overwrite strings in place - resize() keeps the allocated memory if the string is not shared
+  QString *fieldArr = fields.data();
+  for(qsizetype i = 0; i < views.size(); i++)
+  {
+    const QByteArrayView& view = views.at(i);
+    QString& field = fieldArr[i];
+    field.resize(view.size());
+
+    QChar *chars = field.data();
+    for(qsizetype j = 0; j < view.size(); j++)
+      chars[j] = QLatin1Char(view.at(j));
+  }
+}
+
+} // namespace xp
+} // namespace fs
+} // namespace atools
@@ -0,0 +1,92 @@
+/*****************************************************************************
+* Copyright 2015-2026 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef ATOOLS_FS_XP_LINEREADER_H
+#define ATOOLS_FS_XP_LINEREADER_H
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QStringList>
+
+namespace atools {
+namespace fs {
+namespace xp {
+
+/*
+ * Reads X-Plane dat and CIFP files line by line from a memory mapped file. Falls back to reading the whole file
+ * if mapping fails.
+ *
+ * Lines are returned as views on the UTF-8 bytes and are split into fields without creating
+ * intermediate line strings. Field strings in the given list are overwritten in place which reuses their memory
+ * if the list or strings were not copied by the caller.
+ *
+ * Not thread safe.
+ */
+class XpLineReader
+{
+public:
+  XpLineReader();
+  ~XpLineReader();
+
+  XpLineReader(const XpLineReader& other) = delete;
+  XpLineReader& operator=(const XpLineReader& other) = delete;
+
+  /* Open and map file. Skips UTF-8 byte order mark. Returns false on error. */
+  bool open(const QString& filename);
+  void close();
+
+  QString errorString() const
+  {
+    return file.errorString();
+  }
+
+  bool atEnd() const
+  {
+    return pos >= size;
+  }
+
+  /* Read next line excluding line feed and carriage return. View is valid until close() is called. */
+  QByteArrayView readLine();
+
+  /* Number of lines from the current position up to but not including a line "99" or the end of file.
+   * Does not change the read position. */
+  int countLines() const;
+
+  /* Split line at whitespace like QString::simplified().split(" ") */
+  void split(QStringList& fields, QByteArrayView line);
+
+  /* Split line at separator like QString::split(separator) */
+  void split(QStringList& fields, QByteArrayView line, char separator);
+
+private:
+  /* Copy views into fields reusing the strings. Lines with non ASCII characters are converted from UTF-8. */
+  void toStrings(QStringList& fields);
+
+  QFile file;
+  QByteArray fileBytes; /* Only used if mapping failed */
+  const char *data = nullptr;
+  qint64 pos = 0, size = 0;
+
+  /* Reused for each line */
+  QList<QByteArrayView> views;
+};
+
+} // namespace xp
+} // namespace fs
+} // namespace atools
+
+#endif // ATOOLS_FS_XP_LINEREADER_H
@@ -331,6 +331,7 @@ void XpNavReader::writeIlsSbasGbas(const QStringList& line, NavRowCode rowCode,
   Pos pos(at(line, LONX).toFloat(), at(line, LATY).toFloat());
 
   insertIlsQuery->bindValue(QStringLiteral(":ils_id"), curIlsId);
+  insertIlsQuery->bindValue(QStringLiteral(":file_id"), context.curFileId);
 
   ilsName = line.mid(NAME).join(QStringLiteral(" ")).simplified().toUpper();
   float heading = at(line, HDG).toFloat();
@@ -53,6 +53,14 @@ public:
            atools::fs::NavDatabaseErrors *navdatabaseErrors);
   virtual ~XpReader();
 
+  /* Called before reading the lines of a dat file. Returns true if the file content was written from a cache
+   * in which case read() and finish() are not called for this file. Default does nothing. */
+  virtual bool readCached(const atools::fs::xp::XpReaderContext& context)
+  {
+    Q_UNUSED(context)
+    return false;
+  }
+
   /* Called for each line read from a dat file */
   virtual void read(const QStringList& line, const atools::fs::xp::XpReaderContext& context) = 0;
 
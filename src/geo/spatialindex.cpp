@@ -19,6 +19,9 @@
 #include "geo/nanoflann.h"
 #include "geo/pos.h"
 
+#include <QThread>
+#include <QThreadPool>
+
 using namespace std;
 using namespace nanoflann;
 using atools::geo::Pos;
@@ -123,24 +126,20 @@ void SpatialIndexPrivate::nearestPoints(QList<int>& indexes, const Pos& pos, int
   indexes.resize(static_cast<int>(numFound));
 }
 
-struct IndexEntry
-{
-  int index;
-  float distance;
-};
-
-/* Callback for radius searches. Does min and max distance comparison. All distances in meter. */
+/* Result set for radius searches. Does max distance comparison and calls the filter for each point
+ * inside the radius. Adds indexes directly to the result list. All distances in meter. */
+template<typename FILTER>
 class RadiusResults
 {
 public:
-  RadiusResults(QList<IndexEntry>& resultParam, float radiusMaxParam, const RadiusCallbackType& radiusCallback)
-    : radiusMax(radiusMaxParam), result(resultParam), callback(radiusCallback)
+  RadiusResults(QList<int>& resultParam, float radiusMaxParam, const FILTER& filterParam)
+    : radiusMax(radiusMaxParam), result(resultParam), filter(filterParam)
   {
   }
 
   size_t size() const
   {
-    return static_cast<size_t>(result.size());
+    return static_cast<size_t>(numFound);
   }
 
   bool full() const
@@ -155,8 +154,11 @@ public:
    */
   bool addPoint(float dist, int index)
   {
-    if(dist < radiusMax && (!callback || callback(dist, index)))
-      result.push_back({index, dist});
+    if(dist < radiusMax && filter(dist, index))
+    {
+      result.append(index);
+      numFound++;
+    }
 
     // keep adding points
     return true;
@@ -169,28 +171,108 @@ public:
 
 private:
   float radiusMax;
-  QList<IndexEntry>& result;
-  RadiusCallbackType callback;
+  int numFound = 0;
+  QList<int>& result;
+  const FILTER& filter;
 };
 
+/* Run the query for all indexes on numThreads threads in chunks */
+template<typename QUERY>
+void runBatch(int size, int numThreads, const QUERY& query)
+{
+  if(numThreads <= 0)
+    numThreads = QThread::idealThreadCount();
+
+  // Do not start threads for small batches
+  const int MIN_CHUNK_SIZE = 64;
+  numThreads = std::max(1, std::min(numThreads, size / MIN_CHUNK_SIZE));
+
+  if(numThreads == 1)
+  {
+    for(int i = 0; i < size; i++)
+      query(i);
+  }
+  else
+  {
+    int chunkSize = (size + numThreads - 1) / numThreads;
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    for(int start = 0; start < size; start += chunkSize)
+    {
+      int end = std::min(start + chunkSize, size);
+      pool.start([&query, start, end]() -> void {
+            for(int i = start; i < end; i++)
+              query(i);
+          });
+    }
+    pool.waitForDone();
+  }
+}
+
 void SpatialIndexPrivate::pointsInRadius(QList<int>& indexes, const Pos& origin, float radiusMaxMeter,
                                          const RadiusCallbackType& callback) const
 {
   float originPtArr[3];
   origin.toCartesian(originPtArr[0], originPtArr[1], originPtArr[2]);
-  Point3D originPt(originPtArr[0], originPtArr[1], originPtArr[2]);
 
-  QList<IndexEntry> indicesDists;
-  indicesDists.reserve(100000);
-  RadiusResults resultCallback(indicesDists, radiusMaxMeter, callback);
+  nanoflann::SearchParams params;
+  params.sorted = false;
+
+  if(callback)
+  {
+    auto filter = [&callback](float dist, int index) -> bool {
+                    return callback(dist, index);
+                  };
+    RadiusResults<decltype(filter)> resultSet(indexes, radiusMaxMeter, filter);
+    p->index.radiusSearchCustomCallback(originPtArr, resultSet, params);
+  }
+  else
+  {
+    auto filter = [](float, int) -> bool {
+                    return true;
+                  };
+    RadiusResults<decltype(filter)> resultSet(indexes, radiusMaxMeter, filter);
+    p->index.radiusSearchCustomCallback(originPtArr, resultSet, params);
+  }
+}
+
+void SpatialIndexPrivate::pointsInRadius(QList<int>& indexes, const Pos& origin, float radiusMaxMeter,
+                                         RadiusPredicateType predicate, const void *context) const
+{
+  float originPtArr[3];
+  origin.toCartesian(originPtArr[0], originPtArr[1], originPtArr[2]);
 
   nanoflann::SearchParams params;
   params.sorted = false;
 
-  int num = static_cast<int>(p->index.radiusSearchCustomCallback(originPtArr, resultCallback, params));
+  auto filter = [predicate, context](float, int index) -> bool {
+                  return predicate(context, index);
+                };
+  RadiusResults<decltype(filter)> resultSet(indexes, radiusMaxMeter, filter);
+  p->index.radiusSearchCustomCallback(originPtArr, resultSet, params);
+}
+
+void SpatialIndexPrivate::nearestPointsBatch(QList<int>& indexes, const QList<Pos>& positions, int numThreads) const
+{
+  indexes.fill(-1, positions.size());
+
+  // Threads write into distinct elements - get pointer once to avoid detaching
+  int *indexArr = indexes.data();
+  runBatch(static_cast<int>(positions.size()), numThreads, [this, indexArr, &positions](int i) -> void {
+        indexArr[i] = nearestPoint(positions.at(i));
+      });
+}
+
+void SpatialIndexPrivate::pointsInRadiusBatch(QList<QList<int> >& indexes, const QList<Pos>& origins,
+                                              float radiusMaxMeter, int numThreads) const
+{
+  indexes.clear();
+  indexes.resize(origins.size());
 
-  for(int i = 0; i < num; i++)
-    indexes.append(indicesDists.at(i).index);
+  QList<int> *indexArr = indexes.data();
+  runBatch(static_cast<int>(origins.size()), numThreads, [this, indexArr, &origins, radiusMaxMeter](int i) -> void {
+        pointsInRadius(indexArr[i], origins.at(i), radiusMaxMeter, RadiusCallbackType());
+      });
 }
 
 void SpatialIndexPrivate::buildIndex()
@@ -233,4 +315,3 @@ SpatialIndexPrivate::~SpatialIndexPrivate()
 } // namespace geo
 } // namespace atools
 
-Q_DECLARE_TYPEINFO(atools::geo::internal::IndexEntry, Q_PRIMITIVE_TYPE);
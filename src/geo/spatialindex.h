@@ -34,6 +34,9 @@ class SpatialIndex;
  * after filtering by manhattan distance to origin. */
 typedef std::function<bool (float, int)> RadiusCallbackType;
 
+/* Plain function used internally by SpatialIndex::getRadiusIndexesIf(). context points to the predicate. */
+typedef bool (*RadiusPredicateType)(const void *context, int index);
+
 /* Private parts *************************************************************************************/
 
 namespace internal {
@@ -53,6 +56,13 @@ class SpatialIndexPrivate
   void nearestPoints(QList<int>& indexes, const atools::geo::Pos& pos, int number) const;
   void pointsInRadius(QList<int>& indexes, const atools::geo::Pos& origin, float radiusMaxMeter,
                       const RadiusCallbackType& callback) const;
+  void pointsInRadius(QList<int>& indexes, const atools::geo::Pos& origin, float radiusMaxMeter,
+                      RadiusPredicateType predicate, const void *context) const;
+
+  /* Batch queries distributed over numThreads */
+  void nearestPointsBatch(QList<int>& indexes, const QList<atools::geo::Pos>& positions, int numThreads) const;
+  void pointsInRadiusBatch(QList<QList<int> >& indexes, const QList<atools::geo::Pos>& origins, float radiusMaxMeter,
+                           int numThreads) const;
   void set(const Point3D& point, int index);
   void buildIndex();
   void clear();
@@ -125,6 +135,34 @@ public:
 
   void getRadius(QList<T>& objects, const atools::geo::Pos& pos, float radiusMeter) const;
 
+  /* Same as getRadiusIndexes() but filters with a predicate having the signature bool(int index).
+   * The predicate is called for each point inside the radius and does not prune the KD-tree traversal.
+   * It only avoids the std::function call of RadiusCallbackType for each of these points. */
+  template<typename PREDICATE>
+  void getRadiusIndexesIf(QList<int>& indexes, const atools::geo::Pos& pos, float radiusMaxMeter,
+                          const PREDICATE& predicate) const
+  {
+    p->pointsInRadius(indexes, pos, radiusMaxMeter, [](const void *context, int index) -> bool {
+          return (*static_cast<const PREDICATE *>(context))(index);
+        }, &predicate);
+  }
+
+  /* Batch version of getNearestIndex(). indexes has the same size and order as positions and contains -1
+   * if nothing was found. Queries are distributed over numThreads threads. 0 uses the number of cores.
+   * 1 runs all queries in the calling thread. */
+  void getNearestIndexesBatch(QList<int>& indexes, const QList<atools::geo::Pos>& positions, int numThreads = 1) const
+  {
+    p->nearestPointsBatch(indexes, positions, numThreads);
+  }
+
+  /* Batch version of getRadiusIndexes() without callback. indexes has the same size and order as positions.
+   * Threads are used as in getNearestIndexesBatch(). */
+  void getRadiusIndexesBatch(QList<QList<int> >& indexes, const QList<atools::geo::Pos>& positions, float radiusMaxMeter,
+                             int numThreads = 1) const
+  {
+    p->pointsInRadiusBatch(indexes, positions, radiusMaxMeter, numThreads);
+  }
+
   void getRadiusIndexes(QList<int>& indexes, const atools::geo::Pos& pos, float radiusMaxMeter) const
   {
     p->pointsInRadius(indexes, pos, radiusMaxMeter, RadiusCallbackType());
@@ -31,6 +31,7 @@ QDebug operator<<(QDebug out, const atools::grib::GribDataset& type)
 
   out.noquote().nospace() << "GribDataset["
                           << type.getDatetime()
+                          << ", forecast " << type.getForecastHours() << " h"
                           << ", surface " << type.getSurface()
                           << ", type " << type.getSurfaceType()
                           << ", param type " << type.getParameterType()
@@ -68,6 +68,18 @@ public:
     return datetime;
   }
 
+  /* Forecast time in hours after analysis time. 0 for analysis files. */
+  int getForecastHours() const
+  {
+    return forecastHours;
+  }
+
+  /* Time the data is valid for. Analysis time plus forecast hours. */
+  QDateTime getValidTime() const
+  {
+    return datetime.addSecs(forecastHours * 3600L);
+  }
+
   /* Wind vectors in meters per second organized in 360 columns (0-359) and 181 rows (0-180)
    * Index 0,0 contains information for 90° North and 0° E/W
    *
@@ -111,6 +123,7 @@ private:
   atools::grib::SurfaceType surfaceType;
 
   QDateTime datetime;
+  int forecastHours = 0;
   QList<float> data;
 };
 
@@ -147,6 +147,7 @@ void GribDownloader::downloadFinished(const QByteArray& data, QString downloadUr
 #endif
 
     GribReader reader(verbose);
+    reader.setSurfaceFilter(surfaces);
     reader.readData(atools::zip::gzipDecompressIf(data, Q_FUNC_INFO));
 
 #ifdef DEBUG_INFORMATION
@@ -23,6 +23,9 @@
 #include <QList>
 #include <QCoreApplication>
 
+/* g2clib field structure */
+struct gribfield;
+
 namespace atools {
 namespace grib {
 
@@ -31,6 +34,8 @@ namespace grib {
  * Only U/V wind, full earth bounding rectangle and one-degree raster supported.
  * Throws atools::Exception if parameters are not correct.
  *
+ * Product metadata of each field is read first and only fields matching the filters are unpacked.
+ *
  * https://www.nco.ncep.noaa.gov/pmb/docs/grib2/grib2_doc/
  * https://www.nco.ncep.noaa.gov/pmb/docs/grib2/grib2_doc/grib2_table3-1.shtml
  */
@@ -49,6 +54,34 @@ public:
   /* Clear dataset for reuse */
   void clear();
 
+  /* Decode only fields for the given surfaces. Same format as GribDownloader::setSurfaces(): Positive values are
+   * mbar and negative values are meter above ground. Other fields are skipped before unpacking the data.
+   * All surfaces are decoded if empty which is the default. */
+  void setSurfaceFilter(const QList<int>& value)
+  {
+    surfaceFilter = value;
+  }
+
+  /* Decode only fields for the given parameters. All if empty which is the default. */
+  void setParameterFilter(const QList<atools::grib::ParameterType>& value)
+  {
+    parameterFilter = value;
+  }
+
+  /* Number of threads used to unpack data fields. 1 unpacks in the calling thread which is the default.
+   * 0 uses the number of cores. */
+  void setNumThreads(int value)
+  {
+    numThreads = value;
+  }
+
+  /* Read only time, grid, parameter and surface of fields and skip unpacking the data.
+   * Datasets returned by getDatasets() have no data then. Default is false. */
+  void setMetadataOnly(bool value)
+  {
+    metadataOnly = value;
+  }
+
   /* Get decoded datasets for read file */
   const atools::grib::GribDatasetList& getDatasets() const
   {
@@ -60,8 +93,28 @@ public:
   static bool validateGribData(QByteArray bytes);
 
 private:
+  /* Decode all GRIB2 messages in bytes. source is used for messages. */
+  void readBytes(QByteArray bytes, const QString& source);
+
+  /* Read time, grid, parameter and surface of field number fieldNum (starting at 1) in message cgrib
+   * without unpacking data. Returns false if not supported. */
+  bool readFieldMetadata(atools::grib::GribDataset& dataset, unsigned char *cgrib, long fieldNum) const;
+  bool readFieldMetadata(atools::grib::GribDataset& dataset, gribfield *field) const;
+
+  /* true if dataset matches filters */
+  bool isFieldRequested(const atools::grib::GribDataset& dataset) const;
+
+  /* Unpack data of field into dataset. Thread safe. Returns false on error. */
+  bool unpackField(atools::grib::GribDataset& dataset, unsigned char *cgrib, long fieldNum) const;
+  bool unpackField(atools::grib::GribDataset& dataset, gribfield *field) const;
+
   atools::grib::GribDatasetList datasets;
   bool verbose = false;
+
+  QList<int> surfaceFilter;
+  QList<atools::grib::ParameterType> parameterFilter;
+  int numThreads = 1;
+  bool metadataOnly = false;
 };
 
 } // namespace grib
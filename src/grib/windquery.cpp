@@ -29,6 +29,13 @@
 #include "fs/util/fsutil.h"
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <functional>
+#include <memory>
 
 using atools::grib::GribDownloader;
 using atools::geo::Rect;
@@ -36,7 +43,6 @@ using atools::geo::Pos;
 using atools::geo::Line;
 using atools::geo::LineString;
 using atools::geo::normalizeCourse;
-using atools::interpolate;
 using atools::geo::windSpeedFromUV;
 using atools::geo::windUComponent;
 using atools::geo::windVComponent;
@@ -45,6 +51,17 @@ using atools::geo::windDirectionFromUV;
 namespace atools {
 namespace grib {
 
+/* Size of the one degree wind grid from 90° north to 90° south and 0° to 359° east */
+const static int GRID_COLUMNS = 360;
+const static int GRID_ROWS = 181;
+const static int GRID_SIZE = GRID_COLUMNS * GRID_ROWS;
+
+/* Resolution of quantized wind components in knots. Covers +/-655 knots. */
+const static float WIND_QUANTUM = 0.02f;
+
+/* Default maximum memory for decoded datasets */
+const static qint64 DEFAULT_MEMORY_BUDGET = 64L * 1024L * 1024L;
+
 /* Internal data structure for wind U/V components */
 struct WindData
 {
@@ -74,12 +91,22 @@ struct WindData
 
 };
 
-/* Internal data structure for wind direction and speed computed from U/V speeds */
+const static atools::grib::WindData EMPTY_WIND_DATA = {0.f, 0.f};
+
+/* Convert wind component in knots to quantized value */
+inline qint16 quantize(float value)
+{
+  return static_cast<qint16>(std::clamp(std::round(value / WIND_QUANTUM), -32767.f, 32767.f));
+}
+
+/* Internal data structure for one altitude layer. U and V components are stored quantized in separate flat arrays
+ * having GRID_SIZE values each. Index is column + row * GRID_COLUMNS where row 0 is 90° north and column 0 is 0° east.
+ * Empty arrays denote zero wind. */
 struct WindAltLayer
 {
   int altitude = 0;
-  QList<WindData> winds;
-  float surface;
+  QList<qint16> u, v;
+  float surface = 0.f;
 
   bool operator<(const WindAltLayer& l) const
   {
@@ -98,25 +125,112 @@ struct WindAltLayer
 
   bool isValid() const
   {
-    return !winds.isEmpty();
+    return !u.isEmpty();
+  }
+
+  /* Wind in knots at grid index */
+  WindData at(int index) const
+  {
+    return isValid() ? WindData{u.at(index) * WIND_QUANTUM, v.at(index) * WIND_QUANTUM} : EMPTY_WIND_DATA;
+  }
+
+  /* Fill all grid cells with the same wind in knots */
+  void fill(float windU, float windV)
+  {
+    u.fill(quantize(windU), GRID_SIZE);
+    v.fill(quantize(windV), GRID_SIZE);
   }
 
   /* Allowed altitude inaccuracy when comparing layer altitudes. */
   const static int ALTITUDE_EPSILON = 50.f;
 };
 
-const static atools::grib::WindData EMPTY_WIND_DATA = {0.f, 0.f};
+/* Zero wind at ground used for interpolation below the lowest layer */
+const static atools::grib::WindAltLayer GROUND_LAYER;
 
-/* One grid cell with all wind values at the corners for interpolation. top left corresponds to queried position. */
-struct WindRect
+/* All layers of one dataset. Maps rounded altitude to wind layer data. Sorted by altitude.
+ * Not modified after being published in WindQueryPrivate. */
+struct WindLayerSet
 {
-  WindData topLeft, topRight, bottomRight, bottomLeft;
+  QMap<int, WindAltLayer> layers;
+
+  qint64 memoryBytes() const
+  {
+    qint64 bytes = 0;
+    for(const WindAltLayer& layer : layers)
+      bytes += (layer.u.size() + layer.v.size()) * static_cast<qint64>(sizeof(qint16));
+    return bytes;
+  }
+
 };
 
-/* One grid cell with all grid positions values at the corners for interpolation. top left corresponds to queried position. */
-struct GridRect
+typedef std::shared_ptr<const WindLayerSet> WindLayerSetPtr;
+
+/* One dataset valid at a point in time. Either decoded or only known by file and decoded on demand. */
+struct WindCycle
 {
-  QPoint topLeft, topRight, bottomRight, bottomLeft;
+  /* Valid time. Invalid for fixed models. */
+  QDateTime time;
+
+  /* Source file for decoding on demand. Empty for downloads and fixed models which cannot be decoded again. */
+  QString filename;
+  QDateTime fileModified;
+
+  /* Null if not decoded yet or released due to memory budget */
+  WindLayerSetPtr layerSet;
+
+  /* Decoding in background is pending or running */
+  bool decoding = false;
+
+  /* Usage counter value on last query */
+  qint64 lastUsed = 0;
+};
+
+/* Layer sets for a query time. later is null if no interpolation in time is needed. */
+struct WindTimeSets
+{
+  WindLayerSetPtr earlier, later;
+
+  /* Weight of later from 0 to 1 */
+  float weight = 0.f;
+
+  bool isValid() const
+  {
+    return earlier != nullptr && !earlier->layers.isEmpty();
+  }
+
+};
+
+/* Grid indexes and weights for the bilinear interpolation of a list of positions.
+ * Kept as structure of arrays to allow the compiler to vectorize the interpolation loops.
+ * Reused between calls to avoid allocations. */
+struct WindSamples
+{
+  /* Grid index of top left, top right, bottom left and bottom right corner of the cell containing the position */
+  QList<int> topLeft, topRight, bottomLeft, bottomRight;
+
+  /* Position within cell from 0 to 1. x from west to east and y from north to south. */
+  QList<float> fracX, fracY;
+
+  /* Interpolated wind for lower and upper layer and weight of the upper layer */
+  QList<float> lowerU, lowerV, upperU, upperV, altWeight;
+
+  /* Layers for each position */
+  QList<const WindAltLayer *> lowerLayer, upperLayer;
+
+  /* Wind from later dataset for interpolation in time */
+  QList<WindData> laterWind;
+
+  void resize(qsizetype size)
+  {
+    for(QList<int> *list : {&topLeft, &topRight, &bottomLeft, &bottomRight})
+      list->resize(size);
+    for(QList<float> *list : {&fracX, &fracY, &lowerU, &lowerV, &upperU, &upperV, &altWeight})
+      list->resize(size);
+    lowerLayer.resize(size);
+    upperLayer.resize(size);
+  }
+
 };
 
 // Debug IO =======================================================================
@@ -134,13 +248,436 @@ QDebug operator<<(QDebug out, const Wind& wind)
   return out;
 }
 
+// GRIB conversion =======================================================================
+
+// Required GRIB parameters:
+// shapeOfTheEarth = 6;
+// Ni = 360;
+// Nj = 181;
+// iScansNegatively = 0;
+// jScansPositively = 0;
+// jPointsAreConsecutive = 0;
+// alternativeRowScanning = 0;
+// latitudeOfFirstGridPointInDegrees = 90;
+// longitudeOfFirstGridPointInDegrees = 0;
+// latitudeOfLastGridPointInDegrees = -90;
+// longitudeOfLastGridPointInDegrees = 359;
+// iDirectionIncrementInDegrees = 1;
+// jDirectionIncrementInDegrees = 1;
+// Ni - number of points along a parallel - 360
+// Nj - number of points along a meridian - 181
+// multiplying Ni (octets 31-34) by Nj (octets 35-38) yields the total number of points
+// i direction - west to east along a parallel or left to right along an x-axis.
+// j direction - south to north along a meridian, or bottom to top along a y-axis.
+// V component of wind; northward_wind;
+// U component of wind; eastward_wind;
+/* Convert data from U/V components in m/s to quantized layers in knots. Throws atools::Exception on error. */
+WindLayerSetPtr layerSetFromDatasets(const GribDatasetList& datasets, QDateTime& analysisTime, QDateTime& validTime)
+{
+  std::shared_ptr<WindLayerSet> layerSet = std::make_shared<WindLayerSet>();
+
+  for(int dsidx = 0; dsidx < datasets.size(); dsidx += 2)
+  {
+    const GribDataset& datasetUWind = datasets.at(dsidx);
+    const GribDataset& datasetVWind = datasets.value(dsidx + 1);
+
+    // Need parametes ordered by U and V
+    if(dsidx + 1 < datasets.size() && datasetUWind.getParameterType() == atools::grib::U_WIND &&
+       datasetVWind.getParameterType() == atools::grib::V_WIND)
+    {
+      if(datasetUWind.getDatetime().isValid())
+      {
+        analysisTime = datasetUWind.getDatetime();
+        validTime = datasetUWind.getValidTime();
+      }
+
+      const QList<float>& dataU = datasetUWind.getData();
+      const QList<float>& dataV = datasetVWind.getData();
+      if(dataU.size() < GRID_SIZE || dataV.size() < GRID_SIZE)
+        throw atools::Exception("Invalid grid size for U and V wind component");
+
+      WindAltLayer layer;
+      layer.altitude = roundToInt(datasetUWind.getAltFeetRounded());
+      layer.surface = datasetUWind.getSurface();
+      layer.u.resize(GRID_SIZE);
+      layer.v.resize(GRID_SIZE);
+
+      // Grid is ordered by rows from north to south like the layer arrays
+      qint16 *u = layer.u.data(), *v = layer.v.data();
+      const float *srcU = dataU.constData(), *srcV = dataV.constData();
+      for(int i = 0; i < GRID_SIZE; i++)
+      {
+        u[i] = quantize(atools::geo::meterPerSecToKnots(srcU[i]));
+        v[i] = quantize(atools::geo::meterPerSecToKnots(srcV[i]));
+      }
+      layerSet->layers.insert(atools::roundToInt(layer.altitude), layer);
+    }
+    else
+      throw atools::Exception("Invalid dataset order for  U and V wind component");
+  }
+  return layerSet;
+}
+
+/* Read and convert GRIB file. Throws atools::Exception on error. */
+WindLayerSetPtr layerSetFromFile(const QString& filename, QDateTime& analysisTime, QDateTime& validTime)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  GribReader reader;
+  reader.readFile(filename);
+  WindLayerSetPtr layerSet = layerSetFromDatasets(reader.getDatasets(), analysisTime, validTime);
+
+  qDebug() << Q_FUNC_INFO << filename << layerSet->layers.size() << "layers valid" << validTime
+           << "in" << timer.elapsed() << "ms";
+  return layerSet;
+}
+
+/* Read only the field metadata of a GRIB file without unpacking and return the valid time of the first U wind field.
+ * Same time base as validTime of layerSetFromFile(). Returns an invalid time on error. */
+QDateTime validTimeFromFile(const QString& filename)
+{
+  try
+  {
+    GribReader reader;
+    reader.setMetadataOnly(true);
+    reader.setParameterFilter({atools::grib::U_WIND});
+    reader.readFile(filename);
+    return reader.getDatasets().constFirst().getValidTime();
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Error reading" << filename << e.what();
+  }
+  catch(...)
+  {
+    qWarning() << Q_FUNC_INFO << "Unknown error reading" << filename;
+  }
+  return QDateTime();
+}
+
 // Private structure to hide above structs =======================================================================
+/* Holds all datasets sorted by time. Queries take snapshots of the layer set pointers and work on them without locking.
+ * Updates replace the pointers and old sets are deleted when the last query using them is done.
+ * Datasets of files are decoded in a background thread when first queried and released again if the memory
+ * budget is exceeded. */
 struct WindQueryPrivate
 {
-  /* Maps rounded altitude to wind layer data. Sorted by altitude. */
-  QMap<int, WindAltLayer> windLayers;
+  WindQueryPrivate()
+  {
+    // Decode one file at a time
+    decodePool.setMaxThreadCount(1);
+  }
+
+  ~WindQueryPrivate()
+  {
+    waitForDecoding();
+  }
+
+  /* Get layer sets before and after time and the interpolation weight. Uses latest dataset if time is invalid.
+   * Starts decoding of files in the background if needed and uses the nearest decoded dataset meanwhile.
+   * Never blocks on decoding. */
+  WindTimeSets getTimeSets(const QDateTime& time);
+
+  /* Drop pending decoding tasks and wait for the running one */
+  void waitForDecoding()
+  {
+    decodePool.clear();
+    decodePool.waitForDone();
+  }
+
+  /* Valid time of an already known file or invalid if file is not known or was modified */
+  QDateTime getFileTime(const QString& filename, const QDateTime& fileModified) const;
+
+  /* Called in the decoding thread after a dataset was decoded in the background */
+  std::function<void()> decodeFinished;
+
+  /* Replace all datasets. Keeps decoded data of files which did not change. */
+  void setCycles(QList<WindCycle> value);
+
+  /* Add dataset or replace dataset having the same time */
+  void addCycle(const WindCycle& cycle);
+
+  void clear()
+  {
+    setCycles(QList<WindCycle>());
+  }
+
+  bool hasCycles() const
+  {
+    QMutexLocker locker(&mutex);
+    return !cycles.isEmpty();
+  }
+
+  QList<QDateTime> getTimes() const;
+
+  void setMemoryBudget(qint64 value)
+  {
+    QMutexLocker locker(&mutex);
+    memoryBudget = value;
+    releaseMemory();
+  }
+
+private:
+  /* Start decoding of the file in the background if not already done. Mutex has to be locked. */
+  void startDecode(WindCycle& cycle);
+
+  /* Decode cycle file and store result. Called in the decoding thread.
+   * Removes the cycle on error or if the valid time in the file does not match the cycle time anymore. */
+  void decode(const QString& filename, const QDateTime& time);
+
+  /* Index of the decoded dataset nearest to index or -1 if none. Mutex has to be locked. */
+  qsizetype nearestDecoded(qsizetype index) const;
+
+  /* Release least recently used datasets until memory is within budget. Latest and currently used are kept.
+   * Mutex has to be locked. */
+  void releaseMemory();
+
+  /* Guards only access to cycles and not the layer data */
+  mutable QMutex mutex;
+  QList<WindCycle> cycles;
+  qint64 usageCounter = 0, memoryBudget = DEFAULT_MEMORY_BUDGET;
+
+  QThreadPool decodePool;
 };
 
+WindTimeSets WindQueryPrivate::getTimeSets(const QDateTime& time)
+{
+  WindTimeSets sets;
+  QMutexLocker locker(&mutex);
+  if(cycles.isEmpty())
+    return sets;
+
+  // Find datasets enclosing time =====================
+  qsizetype earlierIndex = cycles.size() - 1, laterIndex = -1;
+  if(time.isValid() && cycles.size() > 1)
+  {
+    // Find first dataset after time
+    auto it = std::upper_bound(cycles.constBegin(), cycles.constEnd(), time,
+                               [](const QDateTime& t, const WindCycle& cycle) -> bool {
+          return t < cycle.time;
+        });
+
+    if(it == cycles.constBegin())
+      earlierIndex = 0;
+    else if(it != cycles.constEnd())
+    {
+      laterIndex = std::distance(cycles.constBegin(), it);
+      earlierIndex = laterIndex - 1;
+
+      const QDateTime& from = cycles.at(earlierIndex).time, & to = cycles.at(laterIndex).time;
+      sets.weight = static_cast<float>(from.secsTo(time)) / static_cast<float>(std::max(from.secsTo(to), 1LL));
+      if(sets.weight <= 0.f)
+        laterIndex = -1;
+    }
+  }
+
+  // Get decoded data or start decoding =====================
+  usageCounter++;
+  WindCycle& earlier = cycles[earlierIndex];
+  earlier.lastUsed = usageCounter;
+  sets.earlier = earlier.layerSet;
+  if(sets.earlier == nullptr)
+    startDecode(earlier);
+
+  if(laterIndex != -1)
+  {
+    WindCycle& later = cycles[laterIndex];
+    later.lastUsed = usageCounter;
+    sets.later = later.layerSet;
+    if(sets.later == nullptr)
+      startDecode(later);
+  }
+
+  if(sets.later == nullptr)
+    sets.weight = 0.f;
+  else if(sets.earlier == nullptr)
+  {
+    // Earlier not decoded yet - use later only
+    sets.earlier = sets.later;
+    sets.later.reset();
+    sets.weight = 0.f;
+  }
+
+  if(sets.earlier == nullptr)
+  {
+    // Use nearest decoded dataset until decoding is finished
+    qsizetype index = nearestDecoded(earlierIndex);
+    if(index != -1)
+    {
+      cycles[index].lastUsed = usageCounter;
+      sets.earlier = cycles.at(index).layerSet;
+    }
+  }
+  return sets;
+}
+
+void WindQueryPrivate::startDecode(WindCycle& cycle)
+{
+  if(cycle.decoding || cycle.filename.isEmpty())
+    return;
+
+  cycle.decoding = true;
+  QString filename = cycle.filename;
+  QDateTime time = cycle.time;
+  decodePool.start([this, filename, time]() -> void {
+        decode(filename, time);
+
+        if(decodeFinished)
+          decodeFinished();
+      });
+}
+
+void WindQueryPrivate::decode(const QString& filename, const QDateTime& time)
+{
+  WindLayerSetPtr layerSet;
+  QDateTime analysisTime, validTime;
+  try
+  {
+    layerSet = layerSetFromFile(filename, analysisTime, validTime);
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Error decoding" << filename << e.what();
+  }
+  catch(...)
+  {
+    qWarning() << Q_FUNC_INFO << "Unknown error decoding" << filename;
+  }
+
+  QMutexLocker locker(&mutex);
+  for(qsizetype i = 0; i < cycles.size(); i++)
+  {
+    WindCycle& cycle = cycles[i];
+    if(cycle.filename == filename && cycle.time == time)
+    {
+      cycle.decoding = false;
+      if(layerSet == nullptr)
+        // Do not try again
+        cycles.removeAt(i);
+      else if(validTime != time)
+      {
+        // File was replaced after reading the metadata - drop it to keep the order by time consistent
+        qWarning() << Q_FUNC_INFO << filename << "valid time changed from" << time << "to" << validTime;
+        cycles.removeAt(i);
+      }
+      else if(cycle.layerSet == nullptr)
+        cycle.layerSet = layerSet;
+      break;
+    }
+  }
+  releaseMemory();
+}
+
+qsizetype WindQueryPrivate::nearestDecoded(qsizetype index) const
+{
+  for(qsizetype dist = 1; dist < cycles.size(); dist++)
+  {
+    if(index - dist >= 0 && cycles.at(index - dist).layerSet != nullptr)
+      return index - dist;
+    if(index + dist < cycles.size() && cycles.at(index + dist).layerSet != nullptr)
+      return index + dist;
+  }
+  return -1;
+}
+
+QDateTime WindQueryPrivate::getFileTime(const QString& filename, const QDateTime& fileModified) const
+{
+  QMutexLocker locker(&mutex);
+  for(const WindCycle& cycle : cycles)
+  {
+    if(cycle.filename == filename && cycle.fileModified == fileModified)
+      return cycle.time;
+  }
+  return QDateTime();
+}
+
+void WindQueryPrivate::setCycles(QList<WindCycle> value)
+{
+  std::sort(value.begin(), value.end(), [](const WindCycle& cycle1, const WindCycle& cycle2) -> bool {
+        return cycle1.time < cycle2.time;
+      });
+
+  // Old cycles are released after unlocking when value goes out of scope
+  QMutexLocker locker(&mutex);
+  for(WindCycle& cycle : value)
+  {
+    if(cycle.layerSet == nullptr && !cycle.filename.isEmpty())
+    {
+      // Keep already decoded data if file is unchanged
+      for(const WindCycle& oldCycle : std::as_const(cycles))
+      {
+        if(oldCycle.filename == cycle.filename && oldCycle.fileModified == cycle.fileModified &&
+           oldCycle.time == cycle.time)
+        {
+          cycle.layerSet = oldCycle.layerSet;
+          cycle.decoding = oldCycle.decoding;
+          break;
+        }
+      }
+    }
+  }
+
+  cycles.swap(value);
+  releaseMemory();
+}
+
+void WindQueryPrivate::addCycle(const WindCycle& cycle)
+{
+  QMutexLocker locker(&mutex);
+  auto it = std::lower_bound(cycles.begin(), cycles.end(), cycle.time, [](const WindCycle& c, const QDateTime& t) -> bool {
+        return c.time < t;
+      });
+
+  if(it != cycles.end() && it->time == cycle.time)
+    *it = cycle;
+  else
+    cycles.insert(it, cycle);
+  releaseMemory();
+}
+
+QList<QDateTime> WindQueryPrivate::getTimes() const
+{
+  QMutexLocker locker(&mutex);
+  QList<QDateTime> times;
+  for(const WindCycle& cycle : cycles)
+    times.append(cycle.time);
+  return times;
+}
+
+void WindQueryPrivate::releaseMemory()
+{
+  qint64 used = 0;
+  for(const WindCycle& cycle : std::as_const(cycles))
+    used += cycle.layerSet != nullptr ? cycle.layerSet->memoryBytes() : 0L;
+
+  while(used > memoryBudget)
+  {
+    // Find least recently used decoded dataset excluding the latest and the ones used by the last query
+    qsizetype lruIndex = -1;
+    for(qsizetype i = 0; i < cycles.size() - 1; i++)
+    {
+      const WindCycle& cycle = cycles.at(i);
+      if(cycle.layerSet != nullptr && cycle.lastUsed < usageCounter &&
+         (lruIndex == -1 || cycle.lastUsed < cycles.at(lruIndex).lastUsed))
+        lruIndex = i;
+    }
+
+    if(lruIndex == -1)
+      break;
+
+    used -= cycles.at(lruIndex).layerSet->memoryBytes();
+    qDebug() << Q_FUNC_INFO << "Releasing" << cycles.at(lruIndex).time << cycles.at(lruIndex).filename;
+
+    if(cycles.at(lruIndex).filename.isEmpty())
+      // Cannot be decoded again
+      cycles.removeAt(lruIndex);
+    else
+      cycles[lruIndex].layerSet.reset();
+  }
+}
+
+// Grid helpers =======================================================================
 /* Column number in grid */
 inline int colNum(const atools::geo::Pos& pos)
 {
@@ -159,33 +696,198 @@ inline QPoint gridPos(const atools::geo::Pos& pos)
   return QPoint(colNum(pos), rowNum(pos));
 }
 
-/* A rectangle at one degree cell boundaries covering the given position */
-inline atools::geo::Rect globalRect(const atools::geo::Pos& pos)
+/* Index into layer arrays for grid position */
+inline int gridIndex(const QPoint& point)
 {
-  atools::geo::Rect rect;
-  rect.setNorth(std::ceil(pos.getLatY()));
-  rect.setWest(std::floor(pos.getLonX()));
-  rect.setSouth(std::floor(pos.getLatY()));
-  rect.setEast(std::ceil(pos.getLonX()));
+  return point.x() + point.y() * GRID_COLUMNS;
+}
 
-  // Return at least a one degree width or height
-  if(atools::almostEqual(rect.getWidthDegree(), 0.f))
-    rect.setEast(rect.getEast() + 1.f);
-  if(atools::almostEqual(rect.getHeightMeter(), 0.f))
-    rect.setSouth(rect.getNorth() - 1.f);
+/* Get layer above and below (or at) altitude. Lower is a zero wind layer if altitude is below the lowest layer. */
+void layersByAlt(const WindLayerSet& layerSet, const WindAltLayer *& lower, const WindAltLayer *& upper, float altitude)
+{
+  const QMap<int, WindAltLayer>& windLayers = layerSet.layers;
+
+  if(windLayers.size() == 1)
+    // Only one wind layer
+    lower = upper = &windLayers.first();
+  else if(windLayers.size() > 1)
+  {
+    // Returns an iterator pointing to the first item with key key in the map.
+    // If the map contains no item with key key, the function returns an iterator to the nearest item with a greater key.
+    QMap<int, WindAltLayer>::const_iterator it = windLayers.lowerBound(atools::roundToInt(altitude));
+    if(it != windLayers.end())
+    {
+      if(atools::almostEqual(it->altitude, atools::roundToInt(altitude), WindAltLayer::ALTITUDE_EPSILON))
+        // Layer is at requested altitude - no need to interpolate
+        lower = upper = &(*it);
+      else if(it == windLayers.begin())
+      {
+        // First layer - use a zero wind layer for interpolation between layer and ground
+        upper = &(*it);
+        lower = &GROUND_LAYER;
+      }
+      else
+      {
+        lower = &(*std::prev(it));
+        upper = &(*it);
+      }
+    }
+    else
+      lower = upper = &windLayers.last();
+  }
+  else
+    lower = upper = &GROUND_LAYER;
+}
 
-  return rect;
+/* Weight of the upper layer for altitude. 0 if both layers are the same. */
+inline float altitudeWeight(const WindAltLayer *lower, const WindAltLayer *upper, float altitude)
+{
+  if(lower == upper || lower->altitude == upper->altitude)
+    return 0.f;
+  else
+    return (altitude - lower->altitude) / static_cast<float>(upper->altitude - lower->altitude);
 }
 
-/* Gives a rectangle for grid positions for the given world coordinate rect */
-inline GridRect gridRect(const atools::geo::Rect& rect)
+/* Linear interpolation between two winds. Used for altitude and time. */
+inline WindData interpolateWindData(const WindData& wind0, const WindData& wind1, float weight)
 {
-  GridRect retval;
-  retval.topLeft = gridPos(rect.getTopLeft());
-  retval.topRight = gridPos(rect.getTopRight());
-  retval.bottomRight = gridPos(rect.getBottomRight());
-  retval.bottomLeft = gridPos(rect.getBottomLeft());
-  return retval;
+  return {wind0.u + (wind1.u - wind0.u) * weight, wind0.v + (wind1.v - wind0.v) * weight};
+}
+
+/* Wind at grid index interpolated between layers */
+WindData windAtIndex(const WindLayerSet& layerSet, int index, float altitude)
+{
+  const WindAltLayer *lower, *upper;
+  layersByAlt(layerSet, lower, upper, altitude);
+  return interpolateWindData(lower->at(index), upper->at(index), altitudeWeight(lower, upper, altitude));
+}
+
+/* Calculate grid cell indexes and weights for bilinear interpolation for all positions */
+void prepareSamples(WindSamples& samples, const atools::geo::LineString& positions)
+{
+  samples.resize(positions.size());
+  int *topLeft = samples.topLeft.data(), *topRight = samples.topRight.data(),
+      *bottomLeft = samples.bottomLeft.data(), *bottomRight = samples.bottomRight.data();
+  float *fracX = samples.fracX.data(), *fracY = samples.fracY.data();
+
+  for(int i = 0; i < positions.size(); i++)
+  {
+    const Pos& pos = positions.at(i);
+    float west = std::floor(pos.getLonX()), north = std::ceil(pos.getLatY());
+
+    // Wrap around at anti-meridian and stay within grid at the poles
+    int col0 = (static_cast<int>(west) % GRID_COLUMNS + GRID_COLUMNS) % GRID_COLUMNS;
+    int col1 = (col0 + 1) % GRID_COLUMNS;
+    int row0 = std::clamp(90 - static_cast<int>(north), 0, GRID_ROWS - 1);
+    int row1 = std::min(row0 + 1, GRID_ROWS - 1);
+
+    topLeft[i] = col0 + row0 * GRID_COLUMNS;
+    topRight[i] = col1 + row0 * GRID_COLUMNS;
+    bottomLeft[i] = col0 + row1 * GRID_COLUMNS;
+    bottomRight[i] = col1 + row1 * GRID_COLUMNS;
+    fracX[i] = pos.getLonX() - west;
+    fracY[i] = north - pos.getLatY();
+  }
+}
+
+/* Bilinear interpolation of one quantized wind component for the samples from index "from" to "to" (exclusive).
+ * Plain loop over flat arrays which can be vectorized by the compiler. */
+inline void interpolateGrid(float *result, const qint16 *grid, const WindSamples& samples, int from, int to)
+{
+  const int *topLeft = samples.topLeft.constData(), *topRight = samples.topRight.constData(),
+            *bottomLeft = samples.bottomLeft.constData(), *bottomRight = samples.bottomRight.constData();
+  const float *fracX = samples.fracX.constData(), *fracY = samples.fracY.constData();
+
+  for(int i = from; i < to; i++)
+  {
+    float tl = grid[topLeft[i]], tr = grid[topRight[i]], bl = grid[bottomLeft[i]], br = grid[bottomRight[i]];
+    float top = tl + (tr - tl) * fracX[i];
+    float bottom = bl + (br - bl) * fracX[i];
+    result[i] = (top + (bottom - top) * fracY[i]) * WIND_QUANTUM;
+  }
+}
+
+/* Bilinear interpolation of U and V for the samples from index "from" to "to" (exclusive) in one layer */
+void interpolateSamples(float *resultU, float *resultV, const WindSamples& samples, const WindAltLayer& layer,
+                        int from, int to)
+{
+  if(layer.isValid())
+  {
+    interpolateGrid(resultU, layer.u.constData(), samples, from, to);
+    interpolateGrid(resultV, layer.v.constData(), samples, from, to);
+  }
+  else
+  {
+    // Zero wind layer at ground
+    std::fill(resultU + from, resultU + to, 0.f);
+    std::fill(resultV + from, resultV + to, 0.f);
+  }
+}
+
+/* Interpolate wind for all positions in one layer set within grid cells and between layers.
+ * Samples have to be prepared for positions. */
+void interpolateLayerSet(QList<WindData>& windData, WindSamples& samples, const WindLayerSet& layerSet,
+                         const geo::LineString& positions)
+{
+  int size = static_cast<int>(positions.size());
+  windData.resize(size);
+
+  // Get layers and altitude weights for all positions
+  const WindAltLayer **lowerLayer = samples.lowerLayer.data(), **upperLayer = samples.upperLayer.data();
+  float *altWeight = samples.altWeight.data();
+  for(int i = 0; i < size; i++)
+  {
+    float altitude = positions.at(i).getAltitude();
+    layersByAlt(layerSet, lowerLayer[i], upperLayer[i], altitude);
+    altWeight[i] = altitudeWeight(lowerLayer[i], upperLayer[i], altitude);
+  }
+
+  // Interpolate within grid cells for runs of positions sharing the same layers ======================
+  float *lowerU = samples.lowerU.data(), *lowerV = samples.lowerV.data(),
+        *upperU = samples.upperU.data(), *upperV = samples.upperV.data();
+  int from = 0;
+  while(from < size)
+  {
+    int to = from + 1;
+    while(to < size && lowerLayer[to] == lowerLayer[from] && upperLayer[to] == upperLayer[from])
+      to++;
+
+    interpolateSamples(lowerU, lowerV, samples, *lowerLayer[from], from, to);
+    if(upperLayer[from] != lowerLayer[from])
+      interpolateSamples(upperU, upperV, samples, *upperLayer[from], from, to);
+    else
+    {
+      std::copy(lowerU + from, lowerU + to, upperU + from);
+      std::copy(lowerV + from, lowerV + to, upperV + from);
+    }
+    from = to;
+  }
+
+  // Interpolate between layers ======================
+  WindData *wind = windData.data();
+  for(int i = 0; i < size; i++)
+  {
+    wind[i].u = lowerU[i] + (upperU[i] - lowerU[i]) * altWeight[i];
+    wind[i].v = lowerV[i] + (upperV[i] - lowerV[i]) * altWeight[i];
+  }
+}
+
+/* Interpolate wind for all normalized positions within grid cells, between layers and in time */
+void interpolatePositions(QList<WindData>& windData, WindSamples& samples, const WindTimeSets& sets,
+                          const geo::LineString& positions)
+{
+  prepareSamples(samples, positions);
+  interpolateLayerSet(windData, samples, *sets.earlier, positions);
+
+  if(sets.later != nullptr)
+  {
+    interpolateLayerSet(samples.laterWind, samples, *sets.later, positions);
+
+    WindData *wind = windData.data();
+    const WindData *laterWind = samples.laterWind.constData();
+    for(int i = 0; i < windData.size(); i++)
+      wind[i] = interpolateWindData(wind[i], laterWind[i], sets.weight);
+  }
 }
 
 // ===============================================================
@@ -194,6 +896,11 @@ WindQuery::WindQuery(QObject *parentObject, bool logVerbose)
 {
   p = new WindQueryPrivate;
 
+  // Called from the decoding thread - signal is delivered queued to receivers in other threads
+  p->decodeFinished = [this]() -> void {
+    emit windDataUpdated();
+  };
+
   downloader = new GribDownloader(parentObject, logVerbose);
 
   // Download or read U and V components of wind - will be used to calculated speed and direction
@@ -217,6 +924,9 @@ WindQuery::WindQuery(QObject *parentObject, bool logVerbose)
 
 WindQuery::~WindQuery()
 {
+  // Decoding thread emits signals on this object
+  p->waitForDecoding();
+
   delete downloader;
   delete fileWatcher;
   delete p;
@@ -239,7 +949,7 @@ void WindQuery::initFromPath(const QString& path, atools::fs::weather::XpWeather
 
   weatherPath = path;
   weatherType = type;
-  currentGribFile = collectGribFiles();
+  currentGribFile = collectGribFiles().value(0).absoluteFilePath();
 
   if(verbose)
     qDebug() << Q_FUNC_INFO << weatherPath << currentGribFile;
@@ -255,7 +965,7 @@ void WindQuery::initFromPath(const QString& path, atools::fs::weather::XpWeather
     fileWatcher->setFilenameAndStart(currentGribFile);
 }
 
-QString WindQuery::collectGribFiles()
+QFileInfoList WindQuery::collectGribFiles()
 {
   QFileInfoList gribFiles;
   if(weatherType == atools::fs::weather::WEATHER_XP11)
@@ -284,11 +994,7 @@ QString WindQuery::collectGribFiles()
   if(verbose)
     qDebug() << Q_FUNC_INFO << gribFiles;
 
-  // Return first and latest file since GRIB cannot be merged like METAR
-  if(!gribFiles.isEmpty())
-    return gribFiles.constFirst().absoluteFilePath();
-  else
-    return QStringLiteral();
+  return gribFiles;
 }
 
 void WindQuery::initFromFixedModel(float dir, float speed, float altitude)
@@ -302,34 +1008,40 @@ void WindQuery::initFromFixedModel(float dirLower, float speedLower, float altit
 {
   deinit();
 
+  std::shared_ptr<WindLayerSet> layerSet = std::make_shared<WindLayerSet>();
+
   // Add lower layer ==========================
   WindAltLayer groundLayer;
   groundLayer.altitude = roundToInt(altitudeLower);
-  groundLayer.winds.fill(WindData{windUComponent(speedLower, dirLower),
-                                  windVComponent(speedLower, dirLower)}, 360 * 181);
-  p->windLayers.insert(atools::roundToInt(groundLayer.altitude), groundLayer);
+  groundLayer.fill(windUComponent(speedLower, dirLower), windVComponent(speedLower, dirLower));
+  layerSet->layers.insert(atools::roundToInt(groundLayer.altitude), groundLayer);
 
   // Add upper layer ==========================
   WindAltLayer altLayer;
   altLayer.altitude = roundToInt(altitudeUpper);
-  altLayer.winds.fill(WindData{windUComponent(speedUpper, dirUpper),
-                               windVComponent(speedUpper, dirUpper)}, 360 * 181);
-  p->windLayers.insert(atools::roundToInt(altLayer.altitude), altLayer);
+  altLayer.fill(windUComponent(speedUpper, dirUpper), windVComponent(speedUpper, dirUpper));
+  layerSet->layers.insert(atools::roundToInt(altLayer.altitude), altLayer);
+
+  // Single dataset valid at all times
+  WindCycle cycle;
+  cycle.layerSet = layerSet;
+  p->setCycles({cycle});
 }
 
 void WindQuery::deinit()
 {
   analyisTime = QDateTime();
-  p->windLayers.clear();
+  p->clear();
   downloader->stopDownload();
   fileWatcher->stopWatching();
   weatherPath.clear();
   currentGribFile.clear();
 }
 
-Wind WindQuery::getWindForPos(atools::geo::Pos pos, bool interpolateValue) const
+Wind WindQuery::getWindForPos(atools::geo::Pos pos, bool interpolateValue, const QDateTime& time) const
 {
-  if(hasWindData())
+  WindTimeSets sets = p->getTimeSets(time);
+  if(sets.isValid())
   {
     pos.normalize();
 
@@ -338,84 +1050,92 @@ Wind WindQuery::getWindForPos(atools::geo::Pos pos, bool interpolateValue) const
       qWarning() << Q_FUNC_INFO << "invalid pos";
       return EMPTY_WIND;
     }
-    // Calculate grid position
-    QPoint gPos = gridPos(pos);
 
     if(verbose)
-      qDebug() << Q_FUNC_INFO << pos << gPos;
-
-    // Get next layers below and above altitude
-    WindAltLayer lower, upper;
-    layersByAlt(lower, upper, pos.getAltitude());
+      qDebug() << Q_FUNC_INFO << pos << gridPos(pos) << time << "weight" << sets.weight;
 
     if(!interpolateValue || pos.nearGrid(1.f, atools::geo::Pos::POS_EPSILON_500M))
     {
       // No need to interpolate within grid - use position as is
-      WindData lW = windForLayer(lower, gPos);
+      int index = gridIndex(gridPos(pos));
+      WindData wind = windAtIndex(*sets.earlier, index, pos.getAltitude());
 
-      if(upper != lower)
-      {
-        WindData uW = windForLayer(upper, gPos);
-        // Interpolate between upper and lower layer
-        return interpolateWind(lW, uW, lower.altitude, upper.altitude, pos.getAltitude()).toWind();
-      }
-      else
-        return lW.toWind();
+      if(sets.later != nullptr)
+        wind = interpolateWindData(wind, windAtIndex(*sets.later, index, pos.getAltitude()), sets.weight);
+      return wind.toWind();
     }
     else
     {
-      Rect global = globalRect(pos);
-      GridRect grid = gridRect(global);
-
-      // Interpolate wind within a grid rectangle for the lower layer
-      WindRect windRectLower;
-      windRectForLayer(windRectLower, lower, grid);
-      WindData lWind = interpolateRect(windRectLower, global, pos);
-
-      if(upper != lower)
-      {
-        // Interpolate wind within a grid rectangle for the upper layer if layers differ
-        WindRect windRectUpper;
-        windRectForLayer(windRectUpper, upper, grid);
-        WindData uWind = interpolateRect(windRectUpper, global, pos);
-
-        // Interpolate between upper and lower wind
-        return interpolateWind(lWind, uWind, lower.altitude, upper.altitude, pos.getAltitude()).toWind();
-      }
-      else
-        return lWind.toWind();
+      // Interpolate wind within a grid rectangle for all layers and datasets
+      WindSamples samples;
+      QList<WindData> windData;
+      interpolatePositions(windData, samples, sets, LineString(pos));
+      return windData.constFirst().toWind();
     }
   }
   return Wind();
 }
 
-WindPosList WindQuery::getWindForRect(const atools::geo::Rect& rect, float altFeet) const
+void WindQuery::getWindForPositions(QList<Wind>& winds, const atools::geo::LineString& positions,
+                                    const QDateTime& time) const
+{
+  winds.clear();
+
+  WindTimeSets sets = p->getTimeSets(time);
+  if(!sets.isValid())
+  {
+    winds.fill(Wind(), positions.size());
+    return;
+  }
+
+  WindSamples samples;
+  QList<WindData> windData;
+  interpolatePositions(windData, samples, sets, positions.normalized());
+
+  winds.reserve(windData.size());
+  for(const WindData& wind : std::as_const(windData))
+    winds.append(wind.toWind());
+}
+
+WindPosList WindQuery::getWindForRect(const atools::geo::Rect& rect, float altFeet, const QDateTime& time) const
 {
   WindPosList result;
-  getWindForRect(result, rect, altFeet, 1);
+  getWindForRect(result, rect, altFeet, 1, time);
   return result;
 }
 
-void WindQuery::getWindForRect(WindPosList& result, atools::geo::Rect rect, float altFeet, int gridSpacing) const
+void WindQuery::getWindForRect(WindPosList& result, atools::geo::Rect rect, float altFeet, int gridSpacing,
+                               const QDateTime& time) const
 {
-  if(p->windLayers.isEmpty())
+  WindTimeSets sets = p->getTimeSets(time);
+  if(!sets.isValid())
     return;
 
+  QElapsedTimer timer;
+  timer.start();
+
   rect.normalize();
 
   if(rect.isPoint(atools::geo::Pos::POS_EPSILON_100M))
   {
     // No need to interpolate for single point and very small rectangles
     WindPos wp;
-    wp.wind = getWindForPos(rect.getCenter().alt(altFeet)); // Set altitude into pos
+    wp.wind = getWindForPos(rect.getCenter().alt(altFeet), true, time); // Set altitude into pos
     wp.pos = rect.getTopLeft();
     result.append(wp);
   }
   else
   {
-    // Get next layers below and above altitude
-    WindAltLayer lower, upper;
-    layersByAlt(lower, upper, altFeet);
+    // Get next layers below and above altitude for both datasets
+    const WindAltLayer *lower, *upper, *laterLower = nullptr, *laterUpper = nullptr;
+    layersByAlt(*sets.earlier, lower, upper, altFeet);
+    float weight = altitudeWeight(lower, upper, altFeet), laterWeight = 0.f;
+
+    if(sets.later != nullptr)
+    {
+      layersByAlt(*sets.later, laterLower, laterUpper, altFeet);
+      laterWeight = altitudeWeight(laterLower, laterUpper, altFeet);
+    }
 
     // Split rectangle if it crosses the anti-meridian (date line)
     for(const atools::geo::Rect& splitRect : rect.splitAtAntiMeridian())
@@ -428,57 +1148,87 @@ void WindQuery::getWindForRect(WindPosList& result, atools::geo::Rect rect, floa
           if(gridSpacing > 1 && !cell.nearGrid(gridSpacing))
             continue;
 
-          QPoint gPos = gridPos(cell);
+          int index = gridIndex(gridPos(cell));
 
           WindPos wp;
           // Calculate grid cell upper left position (position for value)
           wp.pos = cell;
           wp.pos.setAltitude(altFeet);
 
-          if(upper != lower)
-            // Interpolate wind within a grid rectangle for the upper layer if layers differ
-            wp.wind = interpolateWind(windForLayer(lower, gPos), windForLayer(upper, gPos),
-                                      lower.altitude, upper.altitude, altFeet).toWind();
-          else
-            wp.wind = windForLayer(lower, gPos).toWind();
+          // Interpolate wind between layers - weight is 0 if layers are the same
+          WindData wind = interpolateWindData(lower->at(index), upper->at(index), weight);
 
+          if(sets.later != nullptr)
+            // Interpolate in time
+            wind = interpolateWindData(wind, interpolateWindData(laterLower->at(index), laterUpper->at(index), laterWeight),
+                                       sets.weight);
+
+          wp.wind = wind.toWind();
           result.append(wp);
         }
       }
     }
   }
+
+  if(verbose)
+    qDebug() << Q_FUNC_INFO << rect << "altitude" << altFeet << result.size() << "winds in"
+             << timer.nsecsElapsed() / 1000 << "µs";
 }
 
-Wind WindQuery::getWindAverageForLineString(const geo::LineString& linestring) const
+Wind WindQuery::getWindAverageForLineString(const geo::LineString& linestring, const QDateTime& time) const
 {
   if(linestring.size() == 1)
     // Only one position
-    return getWindForPos(linestring.getPos1());
+    return getWindForPos(linestring.getPos1(), true, time);
   else if(linestring.size() == 2)
     // Only one line
-    return getWindAverageForLine(linestring.toLine());
+    return getWindAverageForLine(linestring.toLine(), time);
   else
   {
-    WindData windData = EMPTY_WIND_DATA;
+    WindTimeSets sets = p->getTimeSets(time);
+    if(!sets.isValid())
+      return Wind();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Buffers are reused for all lines
+    WindSamples samples;
+    QList<WindData> windData;
+
+    WindData windSum = EMPTY_WIND_DATA;
     // Sum up values
     for(int i = 0; i < linestring.size() - 1; i++)
     {
-      WindData wd = windAverageForLine(linestring.at(i), linestring.at(i + 1));
-      windData.u += wd.u;
-      windData.v += wd.v;
+      WindData wd = windAverageForLine(windData, samples, sets, linestring.at(i), linestring.at(i + 1));
+      windSum.u += wd.u;
+      windSum.v += wd.v;
     }
 
     // Calculate average
-    windData.u = windData.u / (linestring.size() - 1);
-    windData.v = windData.v / (linestring.size() - 1);
+    windSum.u = windSum.u / (linestring.size() - 1);
+    windSum.v = windSum.v / (linestring.size() - 1);
 
-    return windData.toWind();
+    if(verbose)
+      qDebug() << Q_FUNC_INFO << linestring.size() << "positions in" << timer.nsecsElapsed() / 1000 << "µs";
+
+    return windSum.toWind();
   }
 }
 
 bool WindQuery::hasWindData() const
 {
-  return !p->windLayers.isEmpty();
+  return p->hasCycles();
+}
+
+QList<QDateTime> WindQuery::getDatasetTimes() const
+{
+  return p->getTimes();
+}
+
+void WindQuery::setMemoryBudget(qint64 bytes)
+{
+  p->setMemoryBudget(bytes);
 }
 
 QString WindQuery::getDebug(const geo::Pos& pos) const
@@ -488,18 +1238,23 @@ QString WindQuery::getDebug(const geo::Pos& pos) const
   out.setRealNumberPrecision(2);
   out.setRealNumberNotation(QTextStream::FixedNotation);
   out << "=================" << Qt::endl;
-  for(auto it = p->windLayers.begin(); it != p->windLayers.end(); ++it)
-  {
-    WindAltLayer layer = it.value();
-    QPoint grid = gridPos(pos);
-    WindData wind = windForLayer(layer, grid);
 
-    out << "altitude " << it.key() << " surface " << layer.surface
-        << " grid x " << grid.x() << " y " << grid.y() << Qt::endl;
-    out << "wind u " << wind.u << " v " << wind.v << " kts "
-        << " dir " << windDirectionFromUV(wind.u, wind.v) << " deg T"
-        << " speed " << windSpeedFromUV(wind.u, wind.v) << " kts" << Qt::endl;
-    out << "-----------" << Qt::endl;
+  WindTimeSets sets = p->getTimeSets(QDateTime());
+  if(sets.isValid())
+  {
+    for(auto it = sets.earlier->layers.begin(); it != sets.earlier->layers.end(); ++it)
+    {
+      const WindAltLayer& layer = it.value();
+      QPoint grid = gridPos(pos);
+      WindData wind = layer.at(gridIndex(grid));
+
+      out << "altitude " << it.key() << " surface " << layer.surface
+          << " grid x " << grid.x() << " y " << grid.y() << Qt::endl;
+      out << "wind u " << wind.u << " v " << wind.v << " kts "
+          << " dir " << windDirectionFromUV(wind.u, wind.v) << " deg T"
+          << " speed " << windSpeedFromUV(wind.u, wind.v) << " kts" << Qt::endl;
+      out << "-----------" << Qt::endl;
+    }
   }
   return retval;
 }
@@ -511,8 +1266,18 @@ void WindQuery::setIgnoreSslErrors(bool value)
 
 void WindQuery::getValidity(QDateTime& from, QDateTime& to) const
 {
-  from = analyisTime;
-  to = analyisTime.addSecs(3600 * 6);
+  QList<QDateTime> times = p->getTimes();
+  if(times.size() > 1 && times.constFirst().isValid())
+  {
+    // Range covered by all datasets
+    from = times.constFirst();
+    to = times.constLast().addSecs(3600 * 6);
+  }
+  else
+  {
+    from = analyisTime;
+    to = analyisTime.addSecs(3600 * 6);
+  }
 }
 
 void WindQuery::debugDumpContainerSizes() const
@@ -521,35 +1286,37 @@ void WindQuery::debugDumpContainerSizes() const
     downloader->debugDumpContainerSizes();
 }
 
-WindData WindQuery::windForLayer(const WindAltLayer& layer, const QPoint& point) const
+Wind WindQuery::getWindAverageForLine(const Line& line, const QDateTime& time) const
 {
-  return layer.isValid() ? layer.winds.at(point.x() + point.y() * 360) : EMPTY_WIND_DATA;
+  return getWindAverageForLine(line.getPos1(), line.getPos2(), time);
 }
 
-Wind WindQuery::getWindAverageForLine(const Line& line) const
+Wind WindQuery::getWindAverageForLine(const Pos& pos1, const Pos& pos2, const QDateTime& time) const
 {
-  return getWindAverageForLine(line.getPos1(), line.getPos2());
-}
+  WindTimeSets sets = p->getTimeSets(time);
+  if(!sets.isValid())
+    return Wind();
 
-Wind WindQuery::getWindAverageForLine(const Pos& pos1, const Pos& pos2) const
-{
-  return windAverageForLine(pos1, pos2).toWind();
+  WindSamples samples;
+  QList<WindData> windData;
+  return windAverageForLine(windData, samples, sets, pos1, pos2).toWind();
 }
 
-WindData WindQuery::windAverageForLine(geo::Pos pos1, geo::Pos pos2) const
+WindData WindQuery::windAverageForLine(QList<WindData>& windData, WindSamples& samples, const WindTimeSets& sets,
+                                       geo::Pos pos1, geo::Pos pos2) const
 {
-  WindData windData = EMPTY_WIND_DATA;
+  WindData windSum = EMPTY_WIND_DATA;
 
   if(!pos1.isValid())
   {
     qWarning() << Q_FUNC_INFO << "invalid pos1";
-    return windData;
+    return windSum;
   }
 
   if(!pos2.isValid())
   {
     qWarning() << Q_FUNC_INFO << "invalid pos2";
-    return windData;
+    return windSum;
   }
 
   pos1.normalize();
@@ -573,103 +1340,37 @@ WindData WindQuery::windAverageForLine(geo::Pos pos1, geo::Pos pos2) const
     // Only start and end needed
     positions << pos1 << pos2;
 
-  WindRect windRectLower, windRectUpper;
+  // Interpolate all positions in one batch
+  interpolatePositions(windData, samples, sets, positions);
 
-  for(const atools::geo::Pos& pos : std::as_const(positions))
+  for(const WindData& w : std::as_const(windData))
   {
-    Rect global = globalRect(pos);
-    GridRect grid = gridRect(global);
-
-    // Get next layers below and above altitude
-    WindAltLayer lower, upper;
-    layersByAlt(lower, upper, pos.getAltitude());
-
-    // Get interpolated wind in grid cell at lower layer
-    windRectForLayer(windRectLower, lower, grid);
-    WindData lW = interpolateRect(windRectLower, global, pos);
-
-    WindData w;
-    if(upper != lower)
-    {
-      // Get interpolated wind in grid cell at upper layer
-      windRectForLayer(windRectUpper, upper, grid);
-
-      // Interpolate at altitude between layers
-      w = interpolateWind(lW, interpolateRect(windRectUpper, global, pos),
-                          lower.altitude, upper.altitude, pos.getAltitude());
-    }
-    else
-      w = lW;
-
-    windData.u += w.u;
-    windData.v += w.v;
+    windSum.u += w.u;
+    windSum.v += w.v;
   }
 
-  windData.u /= positions.size();
-  windData.v /= positions.size();
-  return windData;
-}
-
-void WindQuery::layersByAlt(WindAltLayer& lower, WindAltLayer& upper, float altitude) const
-{
-  if(p->windLayers.size() == 1)
-    // Only one wind layer
-    lower = upper = p->windLayers.first();
-  else if(p->windLayers.size() > 1)
-  {
-    // Returns an iterator pointing to the first item with key key in the map.
-    // If the map contains no item with key key, the function returns an iterator to the nearest item with a greater key.
-    QMap<int, WindAltLayer>::const_iterator it = p->windLayers.lowerBound(atools::roundToInt(altitude));
-    if(it != p->windLayers.end())
-    {
-      if(atools::almostEqual(it->altitude, atools::roundToInt(altitude), WindAltLayer::ALTITUDE_EPSILON))
-        // Layer is at requested altitude - no need to interpolate
-        lower = upper = *it;
-      else if(it == p->windLayers.begin())
-      {
-        // First layer - add a zero wind layer for interpolation between layer and ground
-        upper = *it;
-
-        lower.altitude = 0.f;
-        lower.winds.fill(EMPTY_WIND_DATA, 360 * 181);
-      }
-      else
-      {
-        lower = *(std::prev(it));
-        upper = *it;
-      }
-    }
-    else
-      lower = upper = p->windLayers.last();
-  }
-}
-
-WindData WindQuery::interpolateRect(const WindRect& windRect, const atools::geo::Rect& rect, const geo::Pos& pos) const
-{
-  float left = rect.getWest(), right = rect.getEast(), top = rect.getNorth(), bottom = rect.getSouth();
-
-  // Interpolate at top and bottom between left and right
-  WindData wTop = interpolateWind(windRect.topLeft, windRect.topRight, left, right, pos.getLonX());
-  WindData wBottom = interpolateWind(windRect.bottomLeft, windRect.bottomRight, left, right, pos.getLonX());
-
-  // Interpolate between top and bottom
-  return interpolateWind(wTop, wBottom, top, bottom, pos.getLatY());
-}
-
-void WindQuery::windRectForLayer(WindRect& windRect, const WindAltLayer& layer, const GridRect& rect) const
-{
-  windRect.topLeft = windForLayer(layer, rect.topLeft);
-  windRect.topRight = windForLayer(layer, rect.topRight);
-  windRect.bottomRight = windForLayer(layer, rect.bottomRight);
-  windRect.bottomLeft = windForLayer(layer, rect.bottomLeft);
+  windSum.u /= positions.size();
+  windSum.v /= positions.size();
+  return windSum;
 }
 
 void WindQuery::gribDownloadFinished(const GribDatasetList& datasets, QString downloadUrl)
 {
   qDebug() << Q_FUNC_INFO << downloadUrl;
 
-  // Download finished - update coordinates
-  convertDataset(datasets);
+  // Download finished - add as new dataset and keep older ones within memory budget
+  try
+  {
+    WindCycle cycle;
+    cycle.layerSet = layerSetFromDatasets(datasets, analyisTime, cycle.time);
+    p->addCycle(cycle);
+  }
+  catch(atools::Exception& e)
+  {
+    emit windDownloadFailed(e.what(), 0);
+    return;
+  }
+
   emit windDataUpdated();
 }
 
@@ -684,7 +1385,7 @@ void WindQuery::gribDirUpdated(const QString& dir)
   if(verbose)
     qDebug() << Q_FUNC_INFO << dir;
 
-  QString gribFile = collectGribFiles();
+  QString gribFile = collectGribFiles().value(0).absoluteFilePath();
   if(gribFile != currentGribFile)
   {
     // Read file(s) again if updated and the list has changed
@@ -702,11 +1403,15 @@ void WindQuery::gribFileUpdated(const QStringList& filenames)
 
   if(!filename.isEmpty())
   {
+    QList<WindCycle> cycles;
     try
     {
-      GribReader reader(verbose);
-      reader.readFile(filename);
-      convertDataset(reader.getDatasets());
+      // Decode latest file now to report errors ==============================
+      WindCycle cycle;
+      cycle.filename = filename;
+      cycle.fileModified = QFileInfo(filename).lastModified();
+      cycle.layerSet = layerSetFromFile(filename, analyisTime, cycle.time);
+      cycles.append(cycle);
     }
     catch(atools::Exception& e)
     {
@@ -719,85 +1424,33 @@ void WindQuery::gribFileUpdated(const QStringList& filenames)
       return;
     }
 
-    emit windDataUpdated();
-  }
-}
-
-// Required GRIB parameters:
-// shapeOfTheEarth = 6;
-// Ni = 360;
-// Nj = 181;
-// iScansNegatively = 0;
-// jScansPositively = 0;
-// jPointsAreConsecutive = 0;
-// alternativeRowScanning = 0;
-// latitudeOfFirstGridPointInDegrees = 90;
-// longitudeOfFirstGridPointInDegrees = 0;
-// latitudeOfLastGridPointInDegrees = -90;
-// longitudeOfLastGridPointInDegrees = 359;
-// iDirectionIncrementInDegrees = 1;
-// jDirectionIncrementInDegrees = 1;
-// Ni - number of points along a parallel - 360
-// Nj - number of points along a meridian - 181
-// multiplying Ni (octets 31-34) by Nj (octets 35-38) yields the total number of points
-// i direction - west to east along a parallel or left to right along an x-axis.
-// j direction - south to north along a meridian, or bottom to top along a y-axis.
-// V component of wind; northward_wind;
-// U component of wind; eastward_wind;
-void WindQuery::convertDataset(const GribDatasetList& datasets)
-{
-  p->windLayers.clear();
-
-  for(int dsidx = 0; dsidx < datasets.size(); dsidx += 2)
-  {
-    const GribDataset& datasetUWind = datasets.at(dsidx);
-    const GribDataset& datasetVWind = datasets.at(dsidx + 1);
-
-    // Need parametes ordered by U and V
-    if(datasetUWind.getParameterType() == atools::grib::U_WIND &&
-       datasetVWind.getParameterType() == atools::grib::V_WIND)
+    if(weatherType == atools::fs::weather::WEATHER_XP12 && cycles.constFirst().time.isValid())
     {
-      if(datasetUWind.getDatetime().isValid())
-        analyisTime = datasetUWind.getDatetime();
+      // Add all other files for decoding on demand ==============================
+      // Valid time is read from the GRIB metadata like for the latest file and not from the filename
+      const QFileInfoList gribFiles = collectGribFiles();
+      for(const QFileInfo& gribFile : gribFiles)
+      {
+        WindCycle cycle;
+        cycle.filename = gribFile.absoluteFilePath();
+        cycle.fileModified = gribFile.lastModified();
 
-      const QList<float>& dataU = datasetUWind.getData();
-      const QList<float>& dataV = datasetVWind.getData();
-      WindAltLayer layer;
-      layer.altitude = roundToInt(datasetUWind.getAltFeetRounded());
-      layer.surface = datasetUWind.getSurface();
+        if(cycle.filename == QFileInfo(filename).absoluteFilePath())
+          continue;
 
-      for(int j = 0; j < 181; j++) // y
-      {
-        for(int i = 0; i < 360; i++) // x
-        {
-          WindData wind;
-          wind.u = atools::geo::meterPerSecToKnots(dataU.at(i + j * 360));
-          wind.v = atools::geo::meterPerSecToKnots(dataV.at(i + j * 360));
-          layer.winds.append(wind);
-        }
+        // Avoid reading files again which are already known
+        cycle.time = p->getFileTime(cycle.filename, cycle.fileModified);
+        if(!cycle.time.isValid())
+          cycle.time = validTimeFromFile(cycle.filename);
+
+        if(cycle.time.isValid() && cycle.time != cycles.constFirst().time)
+          cycles.append(cycle);
       }
-      p->windLayers.insert(atools::roundToInt(layer.altitude), layer);
     }
-    else
-      throw atools::Exception("Invalid dataset order for  U and V wind component");
-  }
-}
 
-/* Interpolate wind speed and direction between two altitude layers */
-WindData WindQuery::interpolateWind(const WindData& w0, const WindData& w1, float alt0, float alt1, float alt) const
-{
-  if(w0 == w1)
-    return w0;
-  else if(atools::almostEqual(alt0, alt))
-    return w0;
-  else if(atools::almostEqual(alt1, alt))
-    return w1;
-  else
-  {
-    WindData w;
-    w.u = interpolate(w0.u, w1.u, alt0, alt1, alt);
-    w.v = interpolate(w0.v, w1.v, alt0, alt1, alt);
-    return w;
+    p->setCycles(cycles);
+
+    emit windDataUpdated();
   }
 }
 
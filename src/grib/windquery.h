@@ -25,6 +25,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QFileInfo>
 
 class QObject;
 namespace atools {
@@ -42,10 +43,11 @@ namespace grib {
 
 class GribDownloader;
 
-struct WindRect;
-struct GridRect;
 struct WindData;
 struct WindAltLayer;
+struct WindLayerSet;
+struct WindTimeSets;
+struct WindSamples;
 struct WindQueryPrivate;
 
 /*
@@ -62,6 +64,17 @@ struct WindQueryPrivate;
  * All internal calculations the U and V components of the wind instead of speed and direction.
  * Most query methods use the altitude from the Pos parameter.
  *
+ * Layers are kept in flat U and V arrays. Positions are interpolated in batches for line queries.
+ * Query methods are thread safe. They work on a snapshot of the layers which is replaced as a whole when
+ * new data arrives.
+ *
+ * Several datasets for different times can be kept. These are X-Plane 12 files in the weather folder or previous
+ * NOAA downloads. Queries with a valid time interpolate linearly between the datasets before and after the time.
+ * Queries without time use the latest dataset. Wind components are stored quantized as 16 bit integers.
+ * The valid time of all datasets is taken from the GRIB metadata. X-Plane files are decoded in a background thread
+ * when first needed. Queries use the nearest decoded dataset until then and windDataUpdated() is emitted when
+ * decoding is finished. Least recently used datasets are released again if the memory budget is exceeded.
+ *
  * Downloaded/possible sets are:
  * Altitude | Act. pressure | Pressure param | Downloaded | Used by X-Plane
  * 10000 ft | 69.7 mb       | 700            | *          | XP
@@ -105,23 +118,42 @@ public:
   /* Clear data, stop periodic downloads and file watching */
   void deinit();
 
+  /* All methods below take an optional UTC time. Winds are interpolated between the datasets enclosing the time.
+   * The latest dataset is used if time is invalid. */
+
   /* Get interpolated wind data for single position. Altitude in feet is used from position. */
-  Wind getWindForPos(atools::geo::Pos pos, bool interpolateValue = true) const;
+  Wind getWindForPos(atools::geo::Pos pos, bool interpolateValue = true, const QDateTime& time = QDateTime()) const;
 
   /* Get an array of wind data for the given rectangle at the given altitude from the data grid.
    * Data is only interpolated between layers. Result is sorted by y and x coordinates. */
-  void getWindForRect(atools::grib::WindPosList& result, atools::geo::Rect rect, float altFeet, int gridSpacing) const;
-  atools::grib::WindPosList getWindForRect(const atools::geo::Rect& rect, float altFeet) const;
+  void getWindForRect(atools::grib::WindPosList& result, atools::geo::Rect rect, float altFeet, int gridSpacing,
+                      const QDateTime& time = QDateTime()) const;
+  atools::grib::WindPosList getWindForRect(const atools::geo::Rect& rect, float altFeet,
+                                           const QDateTime& time = QDateTime()) const;
 
   /* Get average wind for the great circle line between the two given positions at the given altitude.
    *  Wind data is fetched for a certain number of spots along the line and thus not perfectly accurate.
    * Uses altitude from positions and interpolates between altitudes too if they are different. */
-  Wind getWindAverageForLine(const atools::geo::Pos& pos1, const atools::geo::Pos& pos2) const;
-  Wind getWindAverageForLine(const atools::geo::Line& line) const;
-  Wind getWindAverageForLineString(const atools::geo::LineString& linestring) const;
+  Wind getWindAverageForLine(const atools::geo::Pos& pos1, const atools::geo::Pos& pos2,
+                             const QDateTime& time = QDateTime()) const;
+  Wind getWindAverageForLine(const atools::geo::Line& line, const QDateTime& time = QDateTime()) const;
+  Wind getWindAverageForLineString(const atools::geo::LineString& linestring, const QDateTime& time = QDateTime()) const;
+
+  /* Get interpolated wind for all positions in one call. Altitude in feet is used from positions.
+   * winds has the same size and order as positions. */
+  void getWindForPositions(QList<atools::grib::Wind>& winds, const atools::geo::LineString& positions,
+                           const QDateTime& time = QDateTime()) const;
 
   bool hasWindData() const;
 
+  /* Valid times of all available datasets sorted ascending. Contains one invalid time for fixed models. */
+  QList<QDateTime> getDatasetTimes() const;
+
+  /* Maximum memory in bytes for decoded datasets. Least recently used datasets are released if exceeded.
+   * The latest dataset is always kept. Default is 64 MB. A dataset on a 1 degree grid with nine layers uses
+   * about 2.3 MB (9 layers * 2 components * 65160 points * 2 bytes) which gives about 27 datasets. */
+  void setMemoryBudget(qint64 bytes);
+
   /* Samples per degree for wind interpolation along lines and line strings */
   void setSamplesPerDegree(int value)
   {
@@ -140,14 +172,15 @@ public:
     return analyisTime;
   }
 
-  /* Validity period */
+  /* Validity period covering all datasets */
   void getValidity(QDateTime& from, QDateTime& to) const;
 
   /* Print the size of all container classes to detect overflow or memory leak conditions */
   void debugDumpContainerSizes() const;
 
 signals:
-  /* Download successfully finished. Emitted for all init methods. */
+  /* Download successfully finished. Emitted for all init methods.
+   * Also emitted from the decoding thread when a dataset was decoded in the background. */
   void windDataUpdated();
 
   /* Download failed.  Only for void init() and initFromFile(). */
@@ -159,21 +192,6 @@ signals:
   void windDownloadProgress(qint64 bytesReceived, qint64 bytesTotal, QString downloadUrl);
 
 private:
-  /* Wind for grid position */
-  WindData windForLayer(const WindAltLayer& layer, const QPoint& point) const;
-
-  /* Get layer above and below (or at) altitude */
-  void layersByAlt(WindAltLayer& lower, WindAltLayer& upper, float altitude) const;
-
-  /* Fill cell rectangle with wind values at corners */
-  void windRectForLayer(WindRect& windRect, const WindAltLayer& layer, const atools::grib::GridRect& rect) const;
-
-  /* Quadratic interpolation- Returns wind for position in the grid cell */
-  WindData interpolateRect(const WindRect& windRect, const geo::Rect& rect, const geo::Pos& pos) const;
-
-  /* Convert data from U/V components to speed/heading */
-  void convertDataset(const atools::grib::GribDatasetList& datasets);
-
   void gribDownloadFinished(const atools::grib::GribDatasetList& datasets, QString downloadUrl);
   void gribDownloadFailed(const QString& error, int errorCode, QString downloadUrl);
 
@@ -181,14 +199,13 @@ private:
   void gribFileUpdated(const QStringList& filenames);
   void gribDirUpdated(const QString& dir);
 
-  /* get interpolated wind for two sets at two altitudes */
-  WindData interpolateWind(const WindData& w0, const WindData& w1, float alt0, float alt1, float alt) const;
-
   /* Get average wind for a line between two points. Uses only U and V components.
-   *  Normalizes positions to avoid overflow on grid access */
-  WindData windAverageForLine(atools::geo::Pos pos1, atools::geo::Pos pos2) const;
+   *  Normalizes positions to avoid overflow on grid access. windData and samples are buffers reused between calls. */
+  WindData windAverageForLine(QList<WindData>& windData, WindSamples& samples, const WindTimeSets& sets,
+                              atools::geo::Pos pos1, atools::geo::Pos pos2) const;
 
-  QString collectGribFiles();
+  /* Get GRIB files for simulator. Latest first. */
+  QFileInfoList collectGribFiles();
 
   /* Surfaces to download from NOAA. Negative value denotes AGL in ft and positive is millibar level.
    *
@@ -221,7 +238,7 @@ private:
 
   bool verbose = false;
 
-  /* Hides wind map and internal structures */
+  /* Hides wind layers and internal structures */
   WindQueryPrivate *p;
 
   QDateTime analyisTime;
@@ -260,12 +260,13 @@ void HttpConnectionHandler::read()
       if(!closeConnection)
       {
         // Maybe the request handler or mapper added a Connection:close header in the meantime
+        // or the body could not be sent completely
         bool closeResponse = QString::compare(response.getHeaders().value("Connection"), "close", Qt::CaseInsensitive) == 0;
-        if(closeResponse == true)
+        if(closeResponse == true || response.isCloseConnection())
         {
           closeConnection = true;
         }
-        else
+        else if(!response.isBodyless())
         {
           // If we have no Content-Length header and did not use chunked mode, then we have to close the
           // connection to tell the HTTP client that the end of the response has been reached.
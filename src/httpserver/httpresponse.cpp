@@ -15,6 +15,7 @@ HttpResponse::HttpResponse(QTcpSocket *socket)
   sentHeaders = false;
   sentLastPart = false;
   chunkedMode = false;
+  closeConnection = false;
 }
 
 void HttpResponse::setHeader(QByteArray name, QByteArray value)
@@ -76,7 +77,8 @@ void HttpResponse::writeHeaders()
 bool HttpResponse::writeToSocket(QByteArray data)
 {
   int remaining = data.size();
-  char *ptr = data.data();
+  // Do not detach - data may refer to raw data of a cached document
+  const char *ptr = data.constData();
   while(socket->isOpen() && remaining > 0)
   {
     // If the output buffer has become large, then wait until it has been sent.
@@ -107,8 +109,11 @@ void HttpResponse::write(QByteArray data, bool lastPart)
     // size of the response and therefore can set the Content-Length header automatically.
     if(lastPart)
     {
-      // Automatically set the Content-Length header
-      headers.insert("Content-Length", QByteArray::number(data.size()));
+      // Automatically set the Content-Length header - must not be sent for responses without body
+      if(!isBodyless())
+      {
+        headers.insert("Content-Length", QByteArray::number(data.size()));
+      }
     }
     // else if we will not close the connection at the end and there is no Content-Length header,
     // then we must use the chunked mode.
@@ -193,3 +198,18 @@ bool HttpResponse::isConnected() const
 {
   return socket->isOpen();
 }
+
+bool HttpResponse::isBodyless() const
+{
+  return (statusCode >= 100 && statusCode < 200) || statusCode == 204 || statusCode == 304;
+}
+
+void HttpResponse::setCloseConnection()
+{
+  closeConnection = true;
+}
+
+bool HttpResponse::isCloseConnection() const
+{
+  return closeConnection;
+}
@@ -81,7 +81,7 @@ public:
    *  The HTTP status line, headers and cookies are sent automatically before the body.
    *  <p>
    *  If the response contains only a single chunk (indicated by lastPart=true),
-   *  then a Content-Length header is automatically set.
+   *  then a Content-Length header is automatically set. Not for status codes which have no body.
    *  <p>
    *  Chunked mode is automatically selected if there is no Content-Length header
    *  and also no Connection:close header.
@@ -121,6 +121,21 @@ public:
    */
   bool isConnected() const;
 
+  /**
+   * True if the status code does not allow a body (1xx, 204 and 304).
+   * No Content-Length is sent for these and the connection can be kept open.
+   */
+  bool isBodyless() const;
+
+  /**
+   * Close the connection after this response even if headers were already sent.
+   * Needed if the body is shorter than the sent Content-Length.
+   */
+  void setCloseConnection();
+
+  /** Indicates whether setCloseConnection() was called */
+  bool isCloseConnection() const;
+
 private:
   /** Request headers */
   QMap<QByteArray, QByteArray> headers;
@@ -143,6 +158,9 @@ private:
   /** Whether the response is sent in chunked mode */
   bool chunkedMode;
 
+  /** Whether the connection has to be closed after the response */
+  bool closeConnection;
+
   /** Cookies */
   QMap<QByteArray, HttpCookie> cookies;
 
@@ -10,8 +10,15 @@
 #include <QThread>
 #include <QCoreApplication>
 
+#include <algorithm>
+
+#include "zip/gzip.h"
+
 using namespace stefanfrings;
 
+/** Size of chunks when streaming files */
+const static qint64 CHUNK_SIZE = 65536;
+
 StaticFileController::StaticFileController(const QHash<QString, QVariant>& settings, QObject *parent)
   : HttpRequestHandler(parent)
 {
@@ -33,8 +40,11 @@ StaticFileController::StaticFileController(const QHash<QString, QVariant>& setti
   maxCachedFileSize = settings.value("maxCachedFileSize", "65536").toInt();
   cache.setMaxCost(settings.value("cacheSize", "1000000").toInt());
   cacheTimeout = settings.value("cacheTime", "60000").toInt();
+  gzip = settings.value("gzip", true).toBool();
+  gzipMinSize = settings.value("gzipMinSize", "1024").toInt();
   long int cacheMaxCost = (long int)cache.maxCost();
   qDebug("StaticFileController: cache timeout=%i, size=%li", cacheTimeout, cacheMaxCost);
+  qDebug("StaticFileController: gzip=%i, gzipMinSize=%i", gzip, gzipMinSize);
 }
 
 StaticFileController::~StaticFileController()
@@ -45,33 +55,33 @@ StaticFileController::~StaticFileController()
 void StaticFileController::service(HttpRequest& request, HttpResponse& response)
 {
   QByteArray path = request.getPath();
+  // Forbid access to files outside the docroot directory
+  if(path.contains("/.."))
+  {
+    qWarning("StaticFileController: detected forbidden characters in path %s", path.data());
+    response.setStatus(403, "forbidden");
+    response.write("403 forbidden", true);
+    return;
+  }
+
   // Check if we have the file in cache
   qint64 now = QDateTime::currentMSecsSinceEpoch();
   mutex.lock();
   CacheEntry *entry = cache.object(path);
   if(entry && (cacheTimeout == 0 || entry->created > now - cacheTimeout))
   {
-    QByteArray document = entry->document; // copy the cached document, because other threads may destroy the cached entry immediately after mutex unlock.
-    QByteArray filename = entry->filename;
+    // Copy the cached entry, because other threads may destroy it immediately after mutex unlock.
+    // The byte arrays are implicitly shared, so this does not copy the data.
+    CacheEntry document = *entry;
     mutex.unlock();
     qDebug("StaticFileController: Cache hit for %s", path.data());
-    setContentType(filename, response);
-    response.setHeader("Cache-Control", "max-age=" + QByteArray::number(maxAge / 1000));
-    response.write(document, true);
+    sendDocument(request, response, document);
   }
   else
   {
     mutex.unlock();
     // The file is not in cache.
     qDebug("StaticFileController: Cache miss for %s", path.data());
-    // Forbid access to files outside the docroot directory
-    if(path.contains("/.."))
-    {
-      qWarning("StaticFileController: detected forbidden characters in path %s", path.data());
-      response.setStatus(403, "forbidden");
-      response.write("403 forbidden", true);
-      return;
-    }
     // If the filename is a directory, append index.html.
     if(QFileInfo(docroot + path).isDir())
     {
@@ -82,34 +92,37 @@ void StaticFileController::service(HttpRequest& request, HttpResponse& response)
     qDebug("StaticFileController: Open file %s", qPrintable(file.fileName()));
     if(file.open(QIODevice::ReadOnly))
     {
-      setContentType(path, response);
-      response.setHeader("Cache-Control", "max-age=" + QByteArray::number(maxAge / 1000));
-      response.setHeader("Content-Length", QByteArray::number(file.size()));
       if(file.size() <= maxCachedFileSize)
       {
-        // Return the file content and store it also in the cache
+        // Read the file content and store it also in the cache
         entry = new CacheEntry();
-        while(!file.atEnd() && !file.error())
-        {
-          QByteArray buffer = file.read(65536);
-          response.write(buffer);
-          entry->document.append(buffer);
-        }
+        entry->document = file.readAll();
         entry->created = now;
         entry->filename = path;
+        entry->etag = buildETag(file.size(), QFileInfo(file).lastModified());
+        if(gzip && entry->document.size() >= gzipMinSize && isCompressible(path))
+        {
+          // Keep compressed variant only if it saves space
+          QByteArray compressed = atools::zip::gzipCompress(entry->document, 9);
+          if(!compressed.isEmpty() && compressed.size() < entry->document.size())
+          {
+            entry->gzipDocument = compressed;
+          }
+        }
+        file.close();
+
+        CacheEntry document = *entry;
         mutex.lock();
-        cache.insert(request.getPath(), entry, entry->document.size());
+        cache.insert(request.getPath(), entry, entry->document.size() + entry->gzipDocument.size());
         mutex.unlock();
+        sendDocument(request, response, document);
       }
       else
       {
-        // Return the file content, do not store in cache
-        while(!file.atEnd() && !file.error())
-        {
-          response.write(file.read(65536));
-        }
+        // Stream the file content, do not store in cache
+        sendFile(request, response, file, path);
+        file.close();
       }
-      file.close();
     }
     else
     {
@@ -128,6 +141,257 @@ void StaticFileController::service(HttpRequest& request, HttpResponse& response)
   }
 }
 
+void StaticFileController::sendDocument(HttpRequest& request, HttpResponse& response, const CacheEntry& entry)
+{
+  setContentType(entry.filename, response);
+  response.setHeader("Cache-Control", "max-age=" + QByteArray::number(maxAge / 1000));
+  response.setHeader("Accept-Ranges", "bytes");
+  if(isCompressible(entry.filename))
+  {
+    response.setHeader("Vary", "Accept-Encoding");
+  }
+
+  qint64 start, end;
+  RangeResult range = parseRange(request, entry.etag, entry.document.size(), start, end);
+  if(range == RANGE_INVALID)
+  {
+    sendRangeInvalid(response, entry.document.size());
+  }
+  else if(range == RANGE_VALID)
+  {
+    // Ranges refer to the uncompressed document
+    if(!checkNotModified(request, response, entry.etag))
+    {
+      response.setStatus(206, "Partial Content");
+      response.setHeader("Content-Range", "bytes " + QByteArray::number(start) + "-" + QByteArray::number(end) +
+                         "/" + QByteArray::number(entry.document.size()));
+      response.setHeader("ETag", entry.etag);
+      // Refer to the cached data without copying
+      response.write(QByteArray::fromRawData(entry.document.constData() + start, end - start + 1), true);
+    }
+  }
+  else if(!entry.gzipDocument.isEmpty() && acceptsGzip(request))
+  {
+    // Compressed variant has its own ETag
+    QByteArray etag = entry.etag;
+    etag.insert(etag.size() - 1, "-gz");
+    if(!checkNotModified(request, response, etag))
+    {
+      response.setHeader("Content-Encoding", "gzip");
+      response.setHeader("ETag", etag);
+      response.write(entry.gzipDocument, true);
+    }
+  }
+  else if(!checkNotModified(request, response, entry.etag))
+  {
+    response.setHeader("ETag", entry.etag);
+    response.write(entry.document, true);
+  }
+}
+
+void StaticFileController::sendFile(HttpRequest& request, HttpResponse& response, QFile& file, const QByteArray& path)
+{
+  setContentType(path, response);
+  response.setHeader("Cache-Control", "max-age=" + QByteArray::number(maxAge / 1000));
+  response.setHeader("Accept-Ranges", "bytes");
+
+  QDateTime lastModified = QFileInfo(file).lastModified();
+  QByteArray etag = buildETag(file.size(), lastModified);
+  qint64 start = 0, end = file.size() - 1;
+  RangeResult range = parseRange(request, etag, file.size(), start, end);
+  if(range == RANGE_INVALID)
+  {
+    sendRangeInvalid(response, file.size());
+    return;
+  }
+
+  // Use precompressed file if available and not outdated
+  QFile gzipFile(file.fileName() + ".gz");
+  QFile *sourceFile = &file;
+  if(isCompressible(path))
+  {
+    response.setHeader("Vary", "Accept-Encoding");
+    if(range == RANGE_NONE && gzip && acceptsGzip(request) && gzipFile.exists() &&
+       QFileInfo(gzipFile).lastModified() >= lastModified &&
+       gzipFile.open(QIODevice::ReadOnly))
+    {
+      qDebug("StaticFileController: Using precompressed file %s", qPrintable(gzipFile.fileName()));
+      sourceFile = &gzipFile;
+      etag.insert(etag.size() - 1, "-gz");
+      start = 0;
+      end = gzipFile.size() - 1;
+      response.setHeader("Content-Encoding", "gzip");
+    }
+  }
+
+  if(checkNotModified(request, response, etag))
+  {
+    return;
+  }
+
+  if(range == RANGE_VALID)
+  {
+    response.setStatus(206, "Partial Content");
+    response.setHeader("Content-Range", "bytes " + QByteArray::number(start) + "-" + QByteArray::number(end) +
+                       "/" + QByteArray::number(file.size()));
+  }
+  response.setHeader("ETag", etag);
+  response.setHeader("Content-Length", QByteArray::number(end - start + 1));
+
+  // Stream the content in chunks
+  qint64 remaining = end - start + 1;
+  if(start > 0)
+  {
+    sourceFile->seek(start);
+  }
+  while(remaining > 0 && !sourceFile->atEnd() && !sourceFile->error() && response.isConnected())
+  {
+    QByteArray buffer = sourceFile->read(std::min(remaining, CHUNK_SIZE));
+    if(buffer.isEmpty())
+    {
+      break;
+    }
+    remaining -= buffer.size();
+    response.write(buffer, remaining <= 0);
+  }
+
+  if(remaining > 0)
+  {
+    // Content-Length was already sent - close connection since the client would wait for the missing bytes
+    // or read them from the next response
+    qWarning("StaticFileController: Incomplete transfer of file %s, %s", qPrintable(sourceFile->fileName()),
+             qPrintable(sourceFile->errorString()));
+    response.setCloseConnection();
+  }
+  gzipFile.close();
+}
+
+bool StaticFileController::checkNotModified(HttpRequest& request, HttpResponse& response, const QByteArray& etag) const
+{
+  QByteArray ifNoneMatch = request.getHeader("If-None-Match");
+  if(ifNoneMatch.isEmpty())
+  {
+    return false;
+  }
+
+  // Weak comparison as required for If-None-Match
+  foreach(QByteArray tag, ifNoneMatch.split(','))
+  {
+    tag = tag.trimmed();
+    if(tag.startsWith("W/"))
+    {
+      tag = tag.mid(2);
+    }
+
+    if(tag == "*" || tag == etag)
+    {
+      response.setStatus(304, "Not Modified");
+      response.setHeader("ETag", etag);
+      response.write(QByteArray(), true);
+      return true;
+    }
+  }
+  return false;
+}
+
+StaticFileController::RangeResult StaticFileController::parseRange(HttpRequest& request, const QByteArray& etag,
+                                                                   qint64 size, qint64& start, qint64& end) const
+{
+  QByteArray rangeHeader = request.getHeader("Range").trimmed();
+  if(!rangeHeader.startsWith("bytes="))
+  {
+    return RANGE_NONE;
+  }
+
+  // Send whole file if it was changed since the client got the first part
+  QByteArray ifRange = request.getHeader("If-Range").trimmed();
+  if(!ifRange.isEmpty() && ifRange != etag)
+  {
+    return RANGE_NONE;
+  }
+
+  QByteArray spec = rangeHeader.mid(6).trimmed();
+  if(spec.contains(','))
+  {
+    // Multiple ranges are not supported
+    return RANGE_NONE;
+  }
+
+  int dash = spec.indexOf('-');
+  if(dash < 0)
+  {
+    return RANGE_NONE;
+  }
+
+  QByteArray first = spec.left(dash).trimmed(), last = spec.mid(dash + 1).trimmed();
+  bool okFirst = true, okLast = true;
+  if(first.isEmpty())
+  {
+    // Suffix range "-500" for the last 500 bytes
+    qint64 suffix = last.toLongLong(&okLast);
+    if(!okLast || suffix <= 0)
+    {
+      return okLast ? RANGE_INVALID : RANGE_NONE;
+    }
+    start = std::max(qint64(0), size - suffix);
+    end = size - 1;
+  }
+  else
+  {
+    start = first.toLongLong(&okFirst);
+    end = last.isEmpty() ? size - 1 : last.toLongLong(&okLast);
+    if(!okFirst || !okLast || start < 0 || end < start)
+    {
+      return RANGE_NONE;
+    }
+    end = std::min(end, size - 1);
+  }
+
+  return start < size ? RANGE_VALID : RANGE_INVALID;
+}
+
+void StaticFileController::sendRangeInvalid(HttpResponse& response, qint64 size) const
+{
+  response.setStatus(416, "Range Not Satisfiable");
+  response.setHeader("Content-Range", "bytes */" + QByteArray::number(size));
+  response.write("416 range not satisfiable", true);
+}
+
+bool StaticFileController::acceptsGzip(HttpRequest& request)
+{
+  foreach(QByteArray coding, request.getHeader("Accept-Encoding").split(','))
+  {
+    QList<QByteArray> params = coding.split(';');
+    QByteArray name = params.value(0).trimmed().toLower();
+    if(name == "gzip" || name == "*")
+    {
+      // Not accepted if quality is zero like "gzip;q=0"
+      for(int i = 1; i < params.size(); i++)
+      {
+        QByteArray param = params.at(i).trimmed();
+        if(param.startsWith("q=") && param.mid(2).toDouble() <= 0.)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+QByteArray StaticFileController::buildETag(qint64 size, const QDateTime& lastModified)
+{
+  return '"' + QByteArray::number(size, 16) + '-' + QByteArray::number(lastModified.toMSecsSinceEpoch(), 16) + '"';
+}
+
+bool StaticFileController::isCompressible(const QString fileName) const
+{
+  return fileName.endsWith(".txt") || fileName.endsWith(".html") || fileName.endsWith(".htm") ||
+         fileName.endsWith(".css") || fileName.endsWith(".js") || fileName.endsWith(".svg") ||
+         fileName.endsWith(".json") || fileName.endsWith(".xml");
+}
+
 void StaticFileController::setContentType(const QString fileName, HttpResponse& response) const
 {
   if(fileName.endsWith(".png"))
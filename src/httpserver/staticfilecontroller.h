@@ -8,6 +8,8 @@
 
 #include <QCache>
 #include <QMutex>
+#include <QFile>
+#include <QDateTime>
 #include "httpglobal.h"
 #include "httprequest.h"
 #include "httpresponse.h"
@@ -27,6 +29,8 @@ namespace stefanfrings {
  *  cacheTime=60000
  *  cacheSize=1000000
  *  maxCachedFileSize=65536
+ *  gzip=true
+ *  gzipMinSize=1024
  *  </pre></code>
  *  The path is relative to the directory of the config file. In case of windows, if the
  *  settings are in the registry, the path is relative to the current working directory.
@@ -37,6 +41,15 @@ namespace stefanfrings {
  *  drive. Large files are not cached. Files are cached as long as possible,
  *  when cacheTime=0. The maxAge value (in msec!) controls the remote browsers cache.
  *  <p>
+ *  Cached text files are additionally kept gzip compressed if gzip=true and the file is
+ *  at least gzipMinSize bytes. The compressed variant is sent if the client accepts it.
+ *  Large files are streamed in chunks. For these a precompressed file with the
+ *  additional suffix ".gz" is sent instead if it exists and is not older.
+ *  <p>
+ *  An ETag is built from size and modification time. Requests with a matching
+ *  If-None-Match header get a 304 response. Single byte ranges are supported for the
+ *  uncompressed representation.
+ *  <p>
  *  Do not instantiate this class in each request, because this would make the file cache
  *  useless. Better create one instance during start-up and call it when the application
  *  received a related HTTP request.
@@ -78,8 +91,20 @@ private:
   struct CacheEntry
   {
     QByteArray document;
+
+    /** Gzip compressed document or empty if not compressible */
+    QByteArray gzipDocument;
     qint64 created;
     QByteArray filename;
+    QByteArray etag;
+  };
+
+  /** Result of parsing a range header */
+  enum RangeResult
+  {
+    RANGE_NONE, /**< No or unsupported range header - send whole file */
+    RANGE_VALID, /**< Send part of file */
+    RANGE_INVALID /**< Range cannot be satisfied */
   };
 
   /** Timeout for each cached file */
@@ -88,6 +113,12 @@ private:
   /** Maximum size of files in cache, larger files are not cached */
   int maxCachedFileSize;
 
+  /** Keep gzip compressed variants of cached text files */
+  bool gzip;
+
+  /** Minimum size of files to compress */
+  int gzipMinSize;
+
   /** Cache storage */
   QCache<QString, CacheEntry> cache;
 
@@ -97,6 +128,31 @@ private:
   /** Set a content-type header in the response depending on the ending of the filename */
   void setContentType(const QString file, HttpResponse& response) const;
 
+  /** true if the file type is worth compressing */
+  bool isCompressible(const QString fileName) const;
+
+  /** Send a cached document considering ETag, range and encoding */
+  void sendDocument(HttpRequest& request, HttpResponse& response, const CacheEntry& entry);
+
+  /** Stream a file in chunks considering ETag, range and encoding */
+  void sendFile(HttpRequest& request, HttpResponse& response, QFile& file, const QByteArray& path);
+
+  /** Sends a 304 response and returns true if the If-None-Match header matches the ETag */
+  bool checkNotModified(HttpRequest& request, HttpResponse& response, const QByteArray& etag) const;
+
+  /** Parse the range header for a file of the given size. If-Range is checked against the ETag. */
+  RangeResult parseRange(HttpRequest& request, const QByteArray& etag, qint64 size, qint64& start,
+                         qint64& end) const;
+
+  /** Set status 416 and send an error message */
+  void sendRangeInvalid(HttpResponse& response, qint64 size) const;
+
+  /** true if the Accept-Encoding header allows gzip */
+  static bool acceptsGzip(HttpRequest& request);
+
+  /** Build ETag from size and modification time */
+  static QByteArray buildETag(qint64 size, const QDateTime& lastModified);
+
 };
 
 } // end of namespace
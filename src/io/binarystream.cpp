@@ -23,6 +23,8 @@
 #include <QFileInfo>
 #include "exception.h"
 
+#include <cstring>
+
 namespace atools {
 namespace io {
 
@@ -37,8 +39,18 @@ BinaryStream::BinaryStream(QFile *binaryFile, QDataStream::ByteOrder order)
   checkStream("constructor");
 }
 
+BinaryStream::BinaryStream(const char *data, qint64 size, const QString& filepath, QDataStream::ByteOrder order)
+  : filename(filepath), filesize(size), memData(data), bigEndian(order == QDataStream::BigEndian)
+{
+  if(memData == nullptr)
+    throw Exception(tr("Memory buffer for file \"%1\" is null.").arg(filepath));
+}
+
 quint32 BinaryStream::readUInt()
 {
+  if(memData != nullptr)
+    return readMemory<quint32>("readInt");
+
   quint32 retval;
   is >> retval;
 
@@ -49,6 +61,9 @@ quint32 BinaryStream::readUInt()
 
 quint64 BinaryStream::readULong()
 {
+  if(memData != nullptr)
+    return readMemory<quint64>("readLong");
+
   quint64 retval;
   is >> retval;
 
@@ -59,6 +74,14 @@ quint64 BinaryStream::readULong()
 
 int BinaryStream::readBytes(char bytes[], int size)
 {
+  if(memData != nullptr)
+  {
+    checkMemory(size, "readBytes");
+    std::memcpy(bytes, memData + memPos, static_cast<size_t>(size));
+    memPos += size;
+    return size;
+  }
+
   int numRead = is.readRawData(bytes, size);
   checkStream("readBytes");
   return numRead;
@@ -66,6 +89,9 @@ int BinaryStream::readBytes(char bytes[], int size)
 
 int BinaryStream::readUBytes(unsigned char bytes[], int size)
 {
+  if(memData != nullptr)
+    return readBytes(reinterpret_cast<char *>(bytes), size);
+
   int numRead = is.readRawData(reinterpret_cast<char *>(bytes), size);
   checkStream("readBytes");
   return numRead;
@@ -85,12 +111,21 @@ QUuid BinaryStream::readUuid()
 
 qint64 BinaryStream::tellg() const
 {
+  if(memData != nullptr)
+    return memPos;
+
   checkStream("tellg");
   return is.device()->pos();
 }
 
 void BinaryStream::skip(qint64 bytes)
 {
+  if(memData != nullptr)
+  {
+    seekg(memPos + bytes);
+    return;
+  }
+
   checkStream("skip");
   if(bytes != 0)
     is.device()->seek(tellg() + bytes);
@@ -98,6 +133,16 @@ void BinaryStream::skip(qint64 bytes)
 
 void BinaryStream::seekg(qint64 pos)
 {
+  if(memData != nullptr)
+  {
+    // Same as QFile::seek() - position can be beyond end and reading fails then
+    if(pos >= 0)
+      memPos = pos;
+    else
+      qWarning() << Q_FUNC_INFO << "Invalid position" << pos << "for" << filename;
+    return;
+  }
+
   checkStream("seekg");
   is.device()->seek(pos);
 }
@@ -125,6 +170,9 @@ float BinaryStream::readFloat()
 
 quint16 BinaryStream::readUShort()
 {
+  if(memData != nullptr)
+    return readMemory<quint16>("readShort");
+
   quint16 retval;
   is >> retval;
 
@@ -135,6 +183,9 @@ quint16 BinaryStream::readUShort()
 
 quint8 BinaryStream::readUByte()
 {
+  if(memData != nullptr)
+    return readMemory<quint8>("readByte");
+
   quint8 retval;
   is >> retval;
 
@@ -145,6 +196,9 @@ quint8 BinaryStream::readUByte()
 
 qint16 BinaryStream::readShort()
 {
+  if(memData != nullptr)
+    return readMemory<qint16>("readShort");
+
   qint16 retval;
   is >> retval;
 
@@ -155,6 +209,9 @@ qint16 BinaryStream::readShort()
 
 qint32 BinaryStream::readInt()
 {
+  if(memData != nullptr)
+    return readMemory<qint32>("readInt");
+
   qint32 retval;
   is >> retval;
 
@@ -165,6 +222,9 @@ qint32 BinaryStream::readInt()
 
 qint64 BinaryStream::readLong()
 {
+  if(memData != nullptr)
+    return readMemory<qint64>("readLong");
+
   qint64 retval;
   is >> retval;
 
@@ -175,6 +235,9 @@ qint64 BinaryStream::readLong()
 
 qint8 BinaryStream::readByte()
 {
+  if(memData != nullptr)
+    return readMemory<qint8>("readByte");
+
   qint8 retval;
   is >> retval;
 
@@ -190,6 +253,26 @@ QChar BinaryStream::readChar()
 
 QString BinaryStream::readString(Encoding encoding)
 {
+  if(memData != nullptr)
+  {
+    // Find terminating null - string without null at end of buffer is an error like for the stream
+    qint64 remaining = filesize - memPos;
+    const char *str = memData + memPos;
+    const char *end = remaining > 0 ? static_cast<const char *>(std::memchr(str, '\0', static_cast<size_t>(remaining))) : nullptr;
+    if(end == nullptr)
+      throwReadPastEnd("readString");
+
+    qsizetype length = end - str;
+    memPos += length + 1;
+
+    if(encoding == UTF8)
+      return QString::fromUtf8(str, length);
+    else if(encoding == LATIN1)
+      return QString::fromLatin1(str, length);
+    else
+      return QString::fromLocal8Bit(str, length);
+  }
+
   QByteArray retval;
   char c = 0;
   do
@@ -213,6 +296,26 @@ QString BinaryStream::readString(Encoding encoding)
 
 QString BinaryStream::readString(int length, Encoding encoding)
 {
+  if(memData != nullptr)
+  {
+    checkMemory(length, "readBytes");
+    const char *str = memData + memPos;
+    memPos += length;
+
+    // Stop at null if any
+    const char *end = static_cast<const char *>(std::memchr(str, '\0', static_cast<size_t>(length)));
+    qsizetype strLength = end != nullptr ? end - str : length;
+
+    if(strLength == 0)
+      return QStringLiteral();
+    else if(encoding == UTF8)
+      return QString::fromUtf8(str, strLength);
+    else if(encoding == LATIN1)
+      return QString::fromLatin1(str, strLength);
+    else
+      return QString::fromLocal8Bit(str, strLength);
+  }
+
   // Read the whole length into memory
   char *buf = new char[static_cast<size_t>(length)];
   readBytes(buf, length);
@@ -238,6 +341,15 @@ QString BinaryStream::readString(int length, Encoding encoding)
     return QString::fromLocal8Bit(retval);
 }
 
+void BinaryStream::throwReadPastEnd(const char *what) const
+{
+  QString msg = tr("%1 for file \"%2\" failed. Reason: %3 (%4).").
+                arg(QString(what), getFilepath(), tr("Read past file end")).arg(QDataStream::ReadPastEnd);
+
+  qWarning() << msg << "Position" << Qt::hex << "0x" << memPos << Qt::dec << memPos;
+  throw Exception(msg);
+}
+
 void BinaryStream::checkStream(const QString& what) const
 {
   if(is.status() != QDataStream::Ok)
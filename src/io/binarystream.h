@@ -20,6 +20,7 @@
 
 #include <QDataStream>
 #include <QCoreApplication>
+#include <QtEndian>
 
 class QFile;
 
@@ -36,6 +37,9 @@ enum Encoding
  * Simple wrapper for binary file reading around QDataStream
  * that will throw an Exception in case of
  * errors.
+ *
+ * Can alternatively read from a memory buffer like a memory mapped file which avoids the QDataStream overhead
+ * for each field. Both backends have the same semantics.
  */
 class BinaryStream
 {
@@ -44,6 +48,18 @@ class BinaryStream
 public:
   BinaryStream(QFile *binaryFile, QDataStream::ByteOrder order = QDataStream::LittleEndian);
 
+  /* Read from memory buffer of size bytes which is not copied and has to be valid for the lifetime of this object.
+   * Usually a memory mapped file. filepath is used for error messages and getFilepath(). */
+  BinaryStream(const char *data, qint64 size, const QString& filepath,
+               QDataStream::ByteOrder order = QDataStream::LittleEndian);
+
+  /* Read from bytes which are not copied and have to be valid for the lifetime of this object. */
+  BinaryStream(const QByteArray& bytes, const QString& filepath,
+               QDataStream::ByteOrder order = QDataStream::LittleEndian)
+    : BinaryStream(bytes.constData(), bytes.size(), filepath, order)
+  {
+  }
+
   BinaryStream(const BinaryStream& other) = delete;
   BinaryStream& operator=(const BinaryStream& other) = delete;
 
@@ -93,12 +109,47 @@ public:
   /* Returns file name without path */
   QString getFilename() const;
 
+  /* true if reading from a memory buffer */
+  bool isMemory() const
+  {
+    return memData != nullptr;
+  }
+
 private:
   void checkStream(const QString& what) const;
 
+  /* Throws exception for memory buffer read past end */
+  [[noreturn]] void throwReadPastEnd(const char *what) const;
+
+  /* Check if size bytes can be read from the memory buffer and throw if not */
+  void checkMemory(qint64 size, const char *what) const
+  {
+    if(size < 0 || memPos + size > filesize)
+      throwReadPastEnd(what);
+  }
+
+  /* Read a value from the memory buffer and convert byte order */
+  template<typename TYPE>
+  TYPE readMemory(const char *what)
+  {
+    checkMemory(sizeof(TYPE), what);
+    const char *ptr = memData + memPos;
+    memPos += sizeof(TYPE);
+
+    if(bigEndian)
+      return qFromBigEndian<TYPE>(ptr);
+    else
+      return qFromLittleEndian<TYPE>(ptr);
+  }
+
   QDataStream is;
   QString filename;
   qint64 filesize;
+
+  /* Memory buffer and current read position. memData is null if reading from file. */
+  const char *memData = nullptr;
+  qint64 memPos = 0;
+  bool bigEndian = false;
 };
 
 } /* namespace io */
@@ -309,6 +309,8 @@ void LoggingConfig::readConfigurationSection(QSettings *settings)
   narrow = settings->value("configuration/narrow").toBool();
 #endif
 
+  async = settings->value("configuration/async", false).toBool();
+
   QString filesParameter = settings->value("configuration/files").toString();
   if(filesParameter == "truncate" || filesParameter == "roll")
     fileOpenMode = QIODevice::WriteOnly | QIODevice::Text;
@@ -61,6 +61,12 @@ private:
     return narrow;
   }
 
+  /* true if messages should be written by a separate thread */
+  bool isAsync() const
+  {
+    return async;
+  }
+
   /* get all default streams for the given level */
   ChannelList& getStream(QtMsgType type);
 
@@ -120,6 +126,9 @@ private:
   /* Shorten file and method names if true. */
   bool narrow = false;
 
+  /* Write messages in a separate thread */
+  bool async = false;
+
   QString logConfig, logDir, logPrefix;
 
   // Messages of this type or worse cause a call to abort()
@@ -42,6 +42,9 @@ void LoggingGuiAbortHandler::guiAbortFunction(const QString& msg)
   if(LoggingHandler::instance == nullptr)
     qWarning() << Q_FUNC_INFO << "LoggingHandler::instance==nullptr";
 
+  // Write queued messages before showing dialog and aborting
+  LoggingHandler::flush();
+
 #if defined(QT_WIDGETS_LIB)
   // Called by signal on main thread context
   if(atools::gui::Application::isShowExceptionDialog())
@@ -22,12 +22,180 @@
 #include <QDir>
 #include <QCoreApplication>
 #include <QThread>
+#include <QWaitCondition>
+
+#include <cstdlib>
+#include <memory>
 
 namespace atools {
 namespace logging {
 
 using internal::LoggingConfig;
 using internal::Channel;
+using internal::ChannelList;
+
+namespace internal {
+
+/* Number of messages in the queue. Has to be a power of two. */
+const static quint64 LOG_QUEUE_SIZE = 8192;
+
+/* Writer thread checks the queue at least in this interval */
+const static unsigned long LOG_WRITER_WAIT_MS = 100;
+
+/* Number of attempts to push into a full queue before dropping the message */
+const static int LOG_QUEUE_PUSH_ATTEMPTS = 1000;
+
+/* True while the current thread writes the queue and holds LoggingHandler::mutex */
+static thread_local bool writingQueue = false;
+
+/* Message waiting in the queue */
+struct LogEntry
+{
+  std::atomic<quint64> sequence;
+  const ChannelList *channels = nullptr;
+  QString message;
+};
+
+/*
+ * Bounded lock-free multi-producer ring buffer. The sequence number of each entry tells producers and
+ * consumer if the entry is free or filled for the current round.
+ * push() is thread safe. pop() has to be serialized by the caller using LoggingHandler::mutex.
+ */
+class LogQueue
+{
+public:
+  LogQueue()
+    : entries(new LogEntry[LOG_QUEUE_SIZE])
+  {
+    for(quint64 i = 0; i < LOG_QUEUE_SIZE; i++)
+      entries[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  /* Returns false if the queue is full */
+  bool push(const ChannelList *channels, const QString& message)
+  {
+    quint64 pos = enqueuePos.load(std::memory_order_relaxed);
+    while(true)
+    {
+      LogEntry& entry = entries[pos & MASK];
+      qint64 diff = static_cast<qint64>(entry.sequence.load(std::memory_order_acquire)) - static_cast<qint64>(pos);
+      if(diff == 0)
+      {
+        // Entry is free - try to claim it
+        if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          entry.channels = channels;
+          entry.message = message;
+          entry.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(diff < 0)
+        // Entry not released by consumer yet - full
+        return false;
+      else
+        // Other producer was faster
+        pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  /* Returns false if the queue is empty */
+  bool pop(const ChannelList *& channels, QString& message)
+  {
+    quint64 pos = dequeuePos.load(std::memory_order_relaxed);
+    LogEntry& entry = entries[pos & MASK];
+    if(entry.sequence.load(std::memory_order_acquire) != pos + 1)
+      return false;
+
+    channels = entry.channels;
+    message.swap(entry.message);
+    entry.message.clear();
+
+    // Release entry for the next round
+    entry.sequence.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+    dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool isEmpty() const
+  {
+    quint64 pos = dequeuePos.load(std::memory_order_relaxed);
+    return entries[pos & MASK].sequence.load(std::memory_order_acquire) != pos + 1;
+  }
+
+private:
+  const static quint64 MASK = LOG_QUEUE_SIZE - 1;
+
+  std::unique_ptr<LogEntry[]> entries;
+
+  // Keep producer and consumer positions in separate cache lines
+  alignas(64) std::atomic<quint64> enqueuePos = 0;
+  alignas(64) std::atomic<quint64> dequeuePos = 0;
+};
+
+/* Waits for messages and writes them in batches */
+class LogWriterThread :
+  public QThread
+{
+public:
+  LogWriterThread(LoggingHandler *handlerParam, LogQueue *queueParam)
+    : handler(handlerParam), queue(queueParam)
+  {
+    setObjectName("LogWriterThread");
+  }
+
+  /* Wake up thread if it is waiting. Called by producers after pushing. */
+  void wake()
+  {
+    // Order push before reading the flag - pairs with fence in run()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(waiting.load(std::memory_order_relaxed))
+    {
+      QMutexLocker locker(&waitMutex);
+      waitCondition.wakeOne();
+    }
+  }
+
+  void stop()
+  {
+    requestInterruption();
+    {
+      QMutexLocker locker(&waitMutex);
+      waitCondition.wakeOne();
+    }
+    wait();
+  }
+
+private:
+  virtual void run() override
+  {
+    while(!isInterruptionRequested())
+    {
+      {
+        QMutexLocker locker(&handler->mutex);
+        handler->writeQueued();
+      }
+
+      QMutexLocker locker(&waitMutex);
+      waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      // Timeout covers any missed wake up
+      if(queue->isEmpty() && !isInterruptionRequested())
+        waitCondition.wait(&waitMutex, LOG_WRITER_WAIT_MS);
+      waiting.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  LoggingHandler *handler;
+  LogQueue *queue;
+
+  QMutex waitMutex;
+  QWaitCondition waitCondition;
+  std::atomic_bool waiting = false;
+};
+
+} // namespace internal
 
 LoggingHandler *LoggingHandler::instance = nullptr;
 LoggingHandler::LogFunctionType LoggingHandler::logFunc;
@@ -43,6 +211,24 @@ LoggingHandler::LoggingHandler(const QString& logConfiguration,
   // Override category filter since some systems disable debug logging in the qtlogging.ini
   oldCategoryFilter = QLoggingCategory::installFilter(categoryFilter);
 
+  if(logConfig->isAsync())
+  {
+    // Start writer thread before installing message handler
+    queue = new internal::LogQueue;
+    writerThread = new internal::LogWriterThread(this, queue);
+    writerThread->start();
+    asyncActive.store(true);
+
+    // Write remaining messages at exit and continue synchronously for late messages
+    std::atexit([]() -> void {
+          if(instance != nullptr)
+          {
+            instance->asyncActive.store(false);
+            flush();
+          }
+        });
+  }
+
   // Install callback function
   if(logConfig->narrow)
     oldMessageHandler = qInstallMessageHandler(LoggingHandler::messageHandlerNarrow);
@@ -53,6 +239,77 @@ LoggingHandler::LoggingHandler(const QString& logConfiguration,
 LoggingHandler::~LoggingHandler()
 {
   qInfo() << Q_FUNC_INFO;
+
+  if(writerThread != nullptr)
+  {
+    asyncActive.store(false);
+    writerThread->stop();
+    flush();
+
+    delete writerThread;
+    writerThread = nullptr;
+    delete queue;
+    queue = nullptr;
+  }
+}
+
+void LoggingHandler::flush(int timeoutMs)
+{
+  // Writer thread cannot wait for itself and a thread already writing the queue holds the non-recursive mutex
+  if(internal::writingQueue)
+    return;
+
+  if(instance != nullptr && instance->queue != nullptr && !instance->isWriterThread())
+  {
+    if(instance->mutex.tryLock(timeoutMs))
+    {
+      instance->writeQueued();
+      instance->mutex.unlock();
+    }
+  }
+}
+
+bool LoggingHandler::isWriterThread() const
+{
+  return writerThread != nullptr && QThread::currentThread() == writerThread;
+}
+
+void LoggingHandler::writeQueued()
+{
+  // Messages logged while writing, e.g. by log rotation, are dropped if the queue is full
+  internal::writingQueue = true;
+
+  const ChannelList *channels = nullptr;
+  QString message;
+  ChannelList written;
+
+  // Limit batch size to avoid holding the lock forever while other threads keep logging
+  for(quint64 i = 0; i < internal::LOG_QUEUE_SIZE && queue->pop(channels, message); i++)
+  {
+    for(Channel *channel : *channels)
+    {
+      (*channel->stream) << message << '\n';
+      if(!written.contains(channel))
+        written.append(channel);
+    }
+  }
+
+  // Report dropped messages in all channels of this batch
+  quint64 dropped = written.isEmpty() ? 0 : droppedMessages.exchange(0);
+  if(dropped > 0)
+  {
+    for(Channel *channel : std::as_const(written))
+      (*channel->stream) << "LoggingHandler: Queue full. Dropped " << dropped << " messages." << '\n';
+  }
+
+  // Flush once per batch
+  for(Channel *channel : std::as_const(written))
+  {
+    channel->stream->flush();
+    logConfig->checkStreamSize(channel);
+  }
+
+  internal::writingQueue = false;
 }
 
 void LoggingHandler::initialize(const QString& logConfiguration, const QString& logDirectory, const QString& logFilePrefix)
@@ -104,6 +361,51 @@ const QStringList LoggingHandler::getLogFiles(bool includeBackups)
 void LoggingHandler::logToCatChannels(internal::ChannelMap& streamListCat,
                                       internal::ChannelList& streamList, const QString& message, const QString& category)
 {
+  if(asyncActive.load(std::memory_order_relaxed))
+  {
+    // Asynchronous - resolve channels and pass message to writer thread ==============
+    // Lists are not changed after reading the configuration and can be referenced in the queue
+    const ChannelList *channels = nullptr;
+    if(category.isEmpty())
+      channels = &streamList;
+    else
+    {
+      auto it = streamListCat.constFind(category);
+      if(it != streamListCat.constEnd())
+        channels = &it.value();
+    }
+
+    if(channels == nullptr || channels->isEmpty())
+      return;
+
+    for(int attempt = 0; !queue->push(channels, message); attempt++)
+    {
+      // Queue is full
+      if(internal::writingQueue || isWriterThread() || attempt >= internal::LOG_QUEUE_PUSH_ATTEMPTS)
+      {
+        // Cannot wait for itself or lock is held too long, e.g. by a crashed thread - drop message
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      if(mutex.tryLock())
+      {
+        // Help writing in this thread
+        writeQueued();
+        mutex.unlock();
+      }
+      else
+      {
+        writerThread->wake();
+        QThread::yieldCurrentThread();
+      }
+    }
+
+    writerThread->wake();
+    return;
+  }
+
+  // Synchronous ========================================
   QMutexLocker locker(&instance->mutex);
 
   if(category.isEmpty())
@@ -126,6 +428,10 @@ void LoggingHandler::logToCatChannels(internal::ChannelMap& streamListCat,
 
 void LoggingHandler::checkAbortType(QtMsgType type, const QMessageLogContext& context, const QString& msg)
 {
+  // Do not keep severe messages in the queue - application might terminate soon
+  if(type == QtCriticalMsg || type == QtFatalMsg)
+    flush();
+
   QtMsgType abortType = logConfig->getAbortType();
   bool doAbort = false;
   switch(type)
@@ -149,6 +455,8 @@ void LoggingHandler::checkAbortType(QtMsgType type, const QMessageLogContext& co
 
   if(doAbort)
   {
+    flush();
+
     if(abortFunc)
       abortFunc(type, context, msg);
     else
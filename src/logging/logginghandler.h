@@ -24,6 +24,8 @@
 #include <QMutex>
 #include <QObject>
 #include <QStringList>
+
+#include <atomic>
 #include <functional>
 
 class QTextStream;
@@ -34,6 +36,8 @@ namespace atools {
 namespace logging {
 namespace internal {
 class LoggingConfig;
+class LogQueue;
+class LogWriterThread;
 }
 
 class LoggingGuiAbortHandler;
@@ -54,6 +58,12 @@ class LoggingGuiAbortHandler;
  * files = roll
  * maxfiles = 2
  * abort = fatal
+ * async = true
+ *
+ * async = true passes messages through a lock-free queue to a writer thread which writes and flushes
+ * them in batches. Logging threads do not wait for each other and for file flushes then.
+ * The queue is written immediately for critical and fatal messages, before abort and at exit.
+ * Messages are dropped and counted if the queue stays full, e.g. if the writing thread is blocked.
  *
  * [channels]
  * console     = stdio
@@ -127,6 +137,11 @@ public:
     parentWidget = nullptr;
   }
 
+  /* Writes all queued messages in the calling thread if asynchronous logging is enabled.
+   * Waits at most timeoutMs for other threads writing. -1 waits forever.
+   * Called automatically for critical and fatal messages and at exit. Does nothing if not asynchronous. */
+  static void flush(int timeoutMs = -1);
+
 signals:
   /* Sent to main thread to allow GUI handling */
   void guiAbortSignal(const QString& msg);
@@ -134,6 +149,7 @@ signals:
 private:
   /* Moved GUI elements out to avoid linking to qwidgets */
   friend class LoggingGuiAbortHandler;
+  friend class atools::logging::internal::LogWriterThread;
 
   LoggingHandler(const QString& logConfiguration, const QString& logDirectory, const QString& logFilePrefix);
 
@@ -145,6 +161,11 @@ private:
 
   void checkAbortType(QtMsgType type, const QMessageLogContext& context, const QString& msg);
 
+  /* Write messages from queue to channels and flush them. mutex has to be locked. */
+  void writeQueued();
+
+  bool isWriterThread() const;
+
   static void messageHandler(QtMsgType type, const QMessageLogContext& context, const QString& msg);
   static void messageHandlerNarrow(QtMsgType type, const QMessageLogContext& context, const QString& msg);
   static void categoryFilter(QLoggingCategory *category);
@@ -156,8 +177,19 @@ private:
   QtMessageHandler oldMessageHandler = nullptr;
   QLoggingCategory::CategoryFilter oldCategoryFilter = nullptr;
 
+  /* Locks channels for writing */
   QMutex mutex;
 
+  /* Only used for asynchronous logging. Queue is cleared by the writer thread or flush(). */
+  atools::logging::internal::LogQueue *queue = nullptr;
+  atools::logging::internal::LogWriterThread *writerThread = nullptr;
+
+  /* Set to false at exit to write messages synchronously */
+  std::atomic_bool asyncActive = false;
+
+  /* Messages dropped since the queue was full. Reported and reset by writeQueued(). */
+  std::atomic<quint64> droppedMessages = 0;
+
   static LogFunctionType logFunc;
   static AbortFunctionType abortFunc;
   static QWidget *parentWidget;
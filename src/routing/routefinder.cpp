@@ -24,6 +24,10 @@
 
 #include <QDateTime>
 #include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <atomic>
 
 using atools::geo::Pos;
 
@@ -38,9 +42,11 @@ inline TYPE& at(TYPE *arr, int index)
 }
 
 RouteFinder::RouteFinder(RouteNetwork *routeNetwork)
-  : network(routeNetwork), openNodesHeap(10000)
+  : network(routeNetwork)
 {
-  successors.reserve(500);
+  // Thread for the backward search is kept for following calculations
+  searchThreadPool.setMaxThreadCount(1);
+  searchThreadPool.setExpiryTimeout(-1);
 }
 
 RouteFinder::~RouteFinder()
@@ -53,54 +59,356 @@ bool RouteFinder::calculateRoute(const atools::geo::Pos& from, const atools::geo
 {
   qDebug() << Q_FUNC_INFO << "from" << from << "to" << to << "altitude" << flownAltitude << "mode" << mode;
 
+  // Keep parameters in network for callers using getDepartureNode() and others
+  network->setParameters(from, to, flownAltitude, mode);
+  return calculateRoute(network->getQuery());
+}
+
+QList<RouteResult> RouteFinder::calculateRoutes(const QList<RouteRequest>& requests, int numThreads,
+                                                RouteBatchStatistics *statistics) const
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  QList<RouteResult> results(requests.size());
+
+  if(numThreads <= 0)
+    numThreads = QThread::idealThreadCount();
+  numThreads = std::max(1, std::min(numThreads, static_cast<int>(requests.size())));
+
+  if(!requests.isEmpty())
+  {
+    // Workers write into distinct elements - get pointer once to avoid detaching in threads
+    RouteResult *resultArr = results.data();
+    std::atomic<int> nextRequest(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    for(int i = 0; i < numThreads; i++)
+    {
+      pool.start([this, &requests, &nextRequest, resultArr]() -> void {
+        // One finder per thread keeps scratch arrays across requests
+        RouteFinder finder(network);
+        finder.costFactorForceAirways = costFactorForceAirways;
+        finder.useLandmarks = useLandmarks;
+
+        for(int index = nextRequest++; index < requests.size(); index = nextRequest++)
+        {
+          const RouteRequest& request = requests.at(index);
+          RouteResult& result = resultArr[index];
+
+          QElapsedTimer routeTimer;
+          routeTimer.start();
+
+          result.found = finder.calculateRoute(network->createQuery(request.from, request.to, request.altitude,
+                                                                    request.mode));
+          if(result.found)
+            finder.extractLegs(result.legs, result.distanceMeter);
+
+          result.timeUs = routeTimer.nsecsElapsed() / 1000L;
+        }
+      });
+    }
+    pool.waitForDone();
+  }
+
+  // Collect statistics ==============================================
+  RouteBatchStatistics stats;
+  stats.numRoutes = static_cast<int>(results.size());
+  stats.numThreads = numThreads;
+  stats.totalTimeMs = timer.elapsed();
+
+  qint64 sumTimeUs = 0L;
+  for(const RouteResult& result : std::as_const(results))
+  {
+    if(result.found)
+      stats.numFound++;
+
+    stats.minTimeUs = stats.minTimeUs == 0L ? result.timeUs : std::min(stats.minTimeUs, result.timeUs);
+    stats.maxTimeUs = std::max(stats.maxTimeUs, result.timeUs);
+    sumTimeUs += result.timeUs;
+  }
+  stats.averageTimeUs = results.isEmpty() ? 0L : sumTimeUs / results.size();
+
+  qDebug() << Q_FUNC_INFO << "routes" << stats.numRoutes << "found" << stats.numFound << "threads" << stats.numThreads
+           << "total" << stats.totalTimeMs << "ms" << "per route min" << stats.minTimeUs << "max" << stats.maxTimeUs
+           << "average" << stats.averageTimeUs << "us";
+
+  if(statistics != nullptr)
+    *statistics = stats;
+
+  return results;
+}
+
+bool RouteFinder::calculateRoute(const RouteNetworkQuery& routeQuery)
+{
+  bidirectional = routeQuery.mode.testFlag(MODE_BIDIRECTIONAL);
   allocArrays();
 
   QElapsedTimer timer;
   timer.start();
 
-  altitude = flownAltitude;
-  network->setParameters(from, to, altitude, mode);
-  startNode = network->getDepartureNode();
-  destNode = network->getDestinationNode();
+  query = routeQuery;
+  altitude = query.altitude;
+  startNode = query.departureNode;
+  destNode = query.destinationNode;
+
+  // Landmark distances cover only airway and track edges - direct waypoint connections would make them invalid
+  landmarksActive = useLandmarks && network->hasLandmarks() && !query.mode.testFlag(MODE_WAYPOINT);
+  if(landmarksActive)
+  {
+    network->getLandmarkDistances(destinationLandmarks, query, destNode.index);
+    if(bidirectional)
+      network->getLandmarkDistances(departureLandmarks, query, startNode.index);
+  }
   totalDist = atools::roundToInt(network->getDirectDistanceMeter(startNode, destNode));
   lastDist = totalDist;
 
-  openNodesHeap.pushData(startNode.index, 0);
-  at(nodeAltRangeMaxArr, startNode.index) = std::numeric_limits<quint16>::max();
+  meetingNodeIndex = Node::INVALID_INDEX;
+  meetingCosts = std::numeric_limits<int>::max();
+  cancelled = false;
 
   time = QDateTime::currentSecsSinceEpoch();
 
-  Node currentNode;
   bool destinationFound = false;
-  while(!openNodesHeap.isEmpty())
+  if(bidirectional)
+  {
+    destinationFound = runBidirectionalSearch();
+    if(destinationFound)
+      joinPaths();
+
+    qDebug() << Q_FUNC_INFO << "found" << destinationFound << "meeting node" << meetingNodeIndex
+             << "heap size" << forwardState.openNodesHeap.size() << backwardState.openNodesHeap.size()
+             << "expanded nodes" << forwardState.numExpandedNodes << backwardState.numExpandedNodes
+             << timer.restart() << "ms";
+  }
+  else
+  {
+    destinationFound = runSearch();
+
+    qDebug() << Q_FUNC_INFO << "found" << destinationFound << "heap size" << forwardState.openNodesHeap.size()
+             << "expanded nodes" << forwardState.numExpandedNodes << timer.restart() << "ms";
+  }
+
+#ifdef DEBUG_ROUTE_FINDER_VERIFY
+  if(!cancelled && (landmarksActive || bidirectional))
+    verifyRoute(destinationFound);
+#endif
+
+  return destinationFound;
+}
+
+int RouteFinder::getRouteCosts() const
+{
+  return bidirectional ? meetingCosts.load() : at(forwardState.nodeCostArr, destNode.index);
+}
+
+void RouteFinder::verifyRoute(bool found) const
+{
+  RouteFinder verifier(network);
+  verifier.costFactorForceAirways = costFactorForceAirways;
+  verifier.useLandmarks = false;
+
+  RouteNetworkQuery plainQuery = query;
+  plainQuery.mode.setFlag(MODE_BIDIRECTIONAL, false);
+
+  if(verifier.calculateRoute(plainQuery))
+  {
+    if(!found)
+    {
+      qWarning() << Q_FUNC_INFO << "No route found but plain A* found one. Landmarks" << landmarksActive
+                 << "bidirectional" << bidirectional << "mode" << query.mode;
+      return;
+    }
+
+    int costs = getRouteCosts(), plainCosts = verifier.getRouteCosts();
+    if(plainCosts < costs)
+      qWarning() << Q_FUNC_INFO << "Route not optimal. Costs" << costs << "plain A* costs" << plainCosts
+                 << "landmarks" << landmarksActive << "bidirectional" << bidirectional << "mode" << query.mode;
+    else
+      qDebug() << Q_FUNC_INFO << "Route costs" << costs << "plain A* costs" << plainCosts;
+  }
+  else if(found)
+    qWarning() << Q_FUNC_INFO << "Plain A* found no route";
+}
+
+bool RouteFinder::runSearch()
+{
+  forwardState.openNodesHeap.pushData(startNode.index, 0);
+  at(forwardState.nodeAltRangeMaxArr, startNode.index) = std::numeric_limits<quint16>::max();
+
+  Node currentNode;
+  while(!forwardState.openNodesHeap.isEmpty())
   {
     // Contains known nodes
-    int currentIndex = openNodesHeap.popData();
+    int currentIndex = forwardState.openNodesHeap.popData();
+    currentNode = network->getNode(query, currentIndex);
 
     if(currentIndex == destNode.index)
+      return true;
+
+    // Invoke user callback if set
+    if(!invokeCallback(currentNode))
+    {
+      cancelled = true;
+      return false;
+    }
+
+    // Contains nodes with known shortest path
+    at(forwardState.closedNodes, currentIndex) = true;
+    forwardState.numExpandedNodes++;
+
+    // Work on successors
+    if(!expandNode(forwardState, currentNode, false /* backward */))
     {
-      destinationFound = true;
+      cancelled = true;
+      return false;
+    }
+  }
+  return false;
+}
+
+bool RouteFinder::runBidirectionalSearch()
+{
+  forwardState.openNodesHeap.pushData(startNode.index, 0);
+  at(forwardState.nodeAltRangeMaxArr, startNode.index) = std::numeric_limits<quint16>::max();
+  backwardState.openNodesHeap.pushData(destNode.index, 0);
+  at(backwardState.nodeAltRangeMaxArr, destNode.index) = std::numeric_limits<quint16>::max();
+  stopSearch = false;
+
+  // Backward search runs in the second thread - forward search stays in the calling thread
+  // since it invokes the progress callback
+  searchThreadPool.start([this]() -> void {
+    runSearchDirection(backwardState, true /* backward */);
+  });
+  runSearchDirection(forwardState, false /* backward */);
+
+  // Forward search might have run out of open nodes while the backward search still finds cheaper meeting nodes
+  searchThreadPool.waitForDone();
+
+  return !cancelled && meetingNodeIndex != Node::INVALID_INDEX;
+}
+
+void RouteFinder::runSearchDirection(SearchState& state, bool backward)
+{
+  const int targetIndex = (backward ? startNode : destNode).index;
+  const quint8 closedFlag = backward ? CLOSED_BACKWARD : CLOSED_FORWARD;
+  const quint8 otherClosedFlag = backward ? CLOSED_FORWARD : CLOSED_BACKWARD;
+
+  // An empty heap ends only this search since the other one might still find a cheaper meeting node
+  Node currentNode;
+  while(!stopSearch.load(std::memory_order_relaxed) && !state.openNodesHeap.isEmpty())
+  {
+    int currentIndex = state.openNodesHeap.popData();
+    currentNode = network->getNode(query, currentIndex);
+    int currentCosts = at(state.nodeCostArr, currentIndex);
+
+    // Stop both searches if no path across the open nodes of this search can be cheaper than the best connection.
+    // A cheaper path would have to consist of closed nodes of this search only which is covered below.
+    if(currentCosts + estimateCosts(currentNode, backward) >= meetingCosts.load(std::memory_order_relaxed))
+    {
+      stopSearch = true;
       break;
     }
 
-    currentNode = network->getNode(currentIndex);
+    if(currentIndex == targetIndex)
+    {
+      // This search alone found a path - estimate is zero here and all other open nodes are not cheaper
+      QMutexLocker locker(&meetingMutex);
+      if(currentCosts < meetingCosts.load(std::memory_order_relaxed))
+      {
+        meetingCosts = currentCosts;
+        meetingNodeIndex = currentIndex;
+      }
+      stopSearch = true;
+      break;
+    }
 
     // Invoke user callback if set
-    if(!invokeCallback(currentNode))
+    if(!backward && !invokeCallback(currentNode))
+    {
+      cancelled = true;
+      stopSearch = true;
       break;
+    }
 
     // Contains nodes with known shortest path
-    at(closedNodes, currentNode.index) = true;
+    at(state.closedNodes, currentIndex) = true;
+    state.numExpandedNodes++;
+
+    // Costs, altitude range and edge of a closed node do not change anymore - publish them to the other thread.
+    // The search closing a node as second one checks the connection.
+    if(at(closedMaskArr, currentIndex).fetch_or(closedFlag, std::memory_order_acq_rel) & otherClosedFlag)
+      updateMeeting(currentIndex);
 
     // Work on successors
-    if(!expandNode(currentNode, at(edgePredecessorArr, currentNode.index)))
+    if(!expandNode(state, currentNode, backward))
+    {
+      cancelled = true;
+      stopSearch = true;
       break;
+    }
   }
+}
 
-  qDebug() << Q_FUNC_INFO << "found" << destinationFound << "heap size" << openNodesHeap.size()
-           << timer.restart() << "ms";
+int RouteFinder::estimateCosts(const atools::routing::Node& node, bool backward) const
+{
+  float estimate = network->getGcDistanceMeter(node, backward ? startNode : destNode);
+
+  if(landmarksActive && node.index >= 0)
+    // Lower bound for the costs between node and departure or destination
+    estimate = std::max(estimate, backward ?
+                        network->getLandmarkBoundMeter(departureLandmarks, node.index) :
+                        network->getLandmarkBoundMeter(node.index, destinationLandmarks));
+  return static_cast<int>(estimate);
+}
 
-  return destinationFound;
+void RouteFinder::updateMeeting(int index)
+{
+  // Check if altitude restrictions of both path parts overlap
+  quint16 altRangeMin = at(forwardState.nodeAltRangeMinArr, index);
+  quint16 altRangeMax = at(forwardState.nodeAltRangeMaxArr, index);
+  if(!combineRanges(altRangeMin, altRangeMax, at(backwardState.nodeAltRangeMinArr, index),
+                    at(backwardState.nodeAltRangeMaxArr, index)))
+    return;
+
+  int costs = at(forwardState.nodeCostArr, index) + at(backwardState.nodeCostArr, index);
+
+  // Forward search charges airway changes on the edge leaving a node and backward search on the edge entering a node.
+  // Add the change at the meeting node which is charged by neither search.
+  if(network->isAirwayRouting() && at(forwardState.edgeNameHashArr, index) != at(backwardState.edgeNameHashArr, index))
+    costs += static_cast<int>(at(backwardState.edgePredecessorArr, index).lengthMeter * (COST_FACTOR_AIRWAY_CHANGE - 1.f));
+
+  QMutexLocker locker(&meetingMutex);
+  if(costs < meetingCosts.load(std::memory_order_relaxed))
+  {
+    meetingCosts = costs;
+    meetingNodeIndex = index;
+  }
+}
+
+void RouteFinder::joinPaths()
+{
+  // Nodes of the path from departure to the meeting node
+  QSet<int> forwardPath;
+  for(int index = meetingNodeIndex; index != Node::INVALID_INDEX; index = at(forwardState.nodePredecessorArr, index))
+    forwardPath.insert(index);
+
+  // Follow successors from meeting node to destination and add them as predecessors to the forward search
+  // Keep predecessors of nodes already in the forward path to avoid loops
+  for(int index = meetingNodeIndex; index != destNode.index && index != Node::INVALID_INDEX;)
+  {
+    int next = at(backwardState.nodePredecessorArr, index);
+    if(next == Node::INVALID_INDEX)
+      break;
+
+    if(!forwardPath.contains(next))
+    {
+      at(forwardState.nodePredecessorArr, next) = index;
+      at(forwardState.edgePredecessorArr, next) = at(backwardState.edgePredecessorArr, index);
+    }
+    index = next;
+  }
 }
 
 bool RouteFinder::invokeCallback(const atools::routing::Node& currentNode)
@@ -122,65 +430,72 @@ bool RouteFinder::invokeCallback(const atools::routing::Node& currentNode)
   return true;
 }
 
-bool RouteFinder::expandNode(const atools::routing::Node& currentNode, const atools::routing::Edge& prevEdge)
+bool RouteFinder::expandNode(SearchState& state, const atools::routing::Node& currentNode, bool backward)
 {
-  successors.clear();
-  network->getNeighbours(successors, currentNode, &prevEdge);
+  // Get predecessors having an edge to the current node for backward search
+  state.successors.clear();
+  if(backward)
+    network->getPredecessors(state.successors, query, currentNode, &at(state.edgePredecessorArr, currentNode.index));
+  else
+    network->getNeighbours(state.successors, query, currentNode, &at(state.edgePredecessorArr, currentNode.index));
 
   quint32 currentEdgeAirwayHash = 0;
   if(network->isAirwayRouting())
-    currentEdgeAirwayHash = at(edgeNameHashArr, currentNode.index);
+    currentEdgeAirwayHash = at(state.edgeNameHashArr, currentNode.index);
 
-  for(int i = 0; i < successors.nodes.size(); i++)
+  for(int i = 0; i < state.successors.nodes.size(); i++)
   {
-    int successorIndex = successors.nodes.at(i);
+    int successorIndex = state.successors.nodes.at(i);
 
-    if(at(closedNodes, successorIndex))
+    if(at(state.closedNodes, successorIndex))
       // Already has a shortest path
       continue;
 
-    const Node& successor = network->getNode(successorIndex);
-    const Edge& edge = successors.edges.at(i);
+    const Node& successor = network->getNode(query, successorIndex);
+    const Edge& edge = state.successors.edges.at(i);
 
     // Invoke user callback if set
-    if(!invokeCallback(successor))
+    if(!backward && !invokeCallback(successor))
       return false;
 
-    int successorEdgeCosts = calculateEdgeCost(currentNode, successor, edge, currentEdgeAirwayHash);
+    // Edge leads from successor to current node in backward search
+    int successorEdgeCosts = backward ?
+                             calculateEdgeCost(successor, currentNode, edge, currentEdgeAirwayHash) :
+                             calculateEdgeCost(currentNode, successor, edge, currentEdgeAirwayHash);
 
-    int successorNodeCosts = at(nodeCostArr, currentNode.index) + successorEdgeCosts;
+    int successorNodeCosts = at(state.nodeCostArr, currentNode.index) + successorEdgeCosts;
     bool contains = true;
-    if(successorNodeCosts >= at(nodeCostArr, successorIndex))
+    if(successorNodeCosts >= at(state.nodeCostArr, successorIndex))
     {
-      contains = openNodesHeap.contains(successorIndex);
+      contains = state.openNodesHeap.contains(successorIndex);
       if(contains)
         // New path is not cheaper
         continue;
     }
 
-    quint16 successorNodeAltRangeMin = at(nodeAltRangeMinArr, currentNode.index);
-    quint16 successorNodeAltRangeMax = at(nodeAltRangeMaxArr, currentNode.index);
+    quint16 successorNodeAltRangeMin = at(state.nodeAltRangeMinArr, currentNode.index);
+    quint16 successorNodeAltRangeMax = at(state.nodeAltRangeMaxArr, currentNode.index);
 
     if(!combineRanges(successorNodeAltRangeMin, successorNodeAltRangeMax, edge.minAltFt, edge.maxAltFt))
       continue;
 
     // New path is cheaper - update node
-    at(edgePredecessorArr, successorIndex) = successors.edges.at(i);
+    at(state.edgePredecessorArr, successorIndex) = edge;
     if(network->isAirwayRouting())
-      at(edgeNameHashArr, successorIndex) = successors.edges.at(i).airwayHash;
-    at(nodePredecessorArr, successorIndex) = currentNode.index;
-    at(nodeCostArr, successorIndex) = successorNodeCosts;
-    at(nodeAltRangeMinArr, successorIndex) = successorNodeAltRangeMin;
-    at(nodeAltRangeMaxArr, successorIndex) = successorNodeAltRangeMax;
+      at(state.edgeNameHashArr, successorIndex) = edge.airwayHash;
+    at(state.nodePredecessorArr, successorIndex) = currentNode.index;
+    at(state.nodeCostArr, successorIndex) = successorNodeCosts;
+    at(state.nodeAltRangeMinArr, successorIndex) = successorNodeAltRangeMin;
+    at(state.nodeAltRangeMaxArr, successorIndex) = successorNodeAltRangeMax;
 
     // Costs from start to successor + estimate to destination = sort order in heap
-    int totalCost = successorNodeCosts + static_cast<int>(network->getGcDistanceMeter(successor, destNode));
+    int totalCost = successorNodeCosts + estimateCosts(successor, backward);
 
     if(contains)
       // Update node and resort heap or add node if not exists
-      openNodesHeap.changeOrPush(successorIndex, totalCost);
+      state.openNodesHeap.changeOrPush(successorIndex, totalCost);
     else
-      openNodesHeap.push(successorIndex, totalCost);
+      state.openNodesHeap.pushData(successorIndex, totalCost);
   }
   return true;
 }
@@ -223,7 +538,7 @@ int RouteFinder::calculateEdgeCost(const atools::routing::Node& currentNode,
       else if(edge.lengthMeter < atools::geo::nmToMeter(25))
         costs *= COST_FACTOR_NEAR_WAYPOINTS;
     }
-    else if(edge.isTrack() && network->getMode() & MODE_TRACK)
+    else if(edge.isTrack() && query.mode & MODE_TRACK)
       // Track ======================
       costs *= COST_FACTOR_TRACK;
   }
@@ -255,7 +570,7 @@ void RouteFinder::extractLegs(QList<RouteLeg>& routeLegs, float& distanceMeter)
   routeLegs.reserve(500);
 
   // Build route
-  Node pred = network->getDestinationNode();
+  Node pred = query.destinationNode;
   while(pred.index != -1)
   {
     if(pred.type != NODE_DEPARTURE && pred.type != NODE_DESTINATION)
@@ -263,12 +578,12 @@ void RouteFinder::extractLegs(QList<RouteLeg>& routeLegs, float& distanceMeter)
       RouteLeg leg;
       leg.navId = pred.id;
       leg.type = pred.type;
-      leg.airwayId = at(edgePredecessorArr, pred.index).id;
+      leg.airwayId = at(forwardState.edgePredecessorArr, pred.index).id;
       leg.pos = pred.pos;
       routeLegs.prepend(leg);
     }
 
-    Node next = network->getNode(at(nodePredecessorArr, pred.index));
+    Node next = network->getNode(query, at(forwardState.nodePredecessorArr, pred.index));
     if(next.pos.isValid())
       distanceMeter += pred.pos.distanceMeterTo(next.pos);
     pred = next;
@@ -277,21 +592,79 @@ void RouteFinder::extractLegs(QList<RouteLeg>& routeLegs, float& distanceMeter)
 
 void RouteFinder::allocArrays()
 {
-  freeArrays();
   // Reserve space at beginning for start and destination node
   // Relies on RouteNetwork::DEPARTURE_NODE_INDEX and RouteNetwork::DESTINATION_NODE_INDEX
   int num = network->getNodes().size() + 3;
 
-  edgeNameHashArr = atools::allocArray<quint32>(num);
-  nodeCostArr = atools::allocArray<int>(num);
-  nodeAltRangeMinArr = atools::allocArray<quint16>(num);
-  nodeAltRangeMaxArr = atools::allocArray<quint16>(num);
-  nodePredecessorArr = atools::allocArray<int>(num, -1);
-  edgePredecessorArr = atools::allocArray<Edge>(num, Edge());
-  closedNodes = atools::allocArray<bool>(num);
+  forwardState.allocArrays(num);
+  if(bidirectional)
+  {
+    backwardState.allocArrays(num);
+
+    if(num != numClosedMask)
+    {
+      atools::freeArray(closedMaskArr);
+      closedMaskArr = atools::allocArray<std::atomic<quint8> >(num);
+      numClosedMask = num;
+    }
+    else
+      std::fill_n(closedMaskArr, num, 0);
+  }
 }
 
 void RouteFinder::freeArrays()
+{
+  forwardState.freeArrays();
+  backwardState.freeArrays();
+  atools::freeArray(closedMaskArr);
+  numClosedMask = 0;
+}
+
+// =========================================================================================
+RouteFinder::SearchState::SearchState()
+  : openNodesHeap(10000)
+{
+  successors.reserve(500);
+}
+
+RouteFinder::SearchState::~SearchState()
+{
+  freeArrays();
+}
+
+void RouteFinder::SearchState::allocArrays(int num)
+{
+  if(num != numNodes)
+  {
+    freeArrays();
+    numNodes = num;
+
+    edgeNameHashArr = atools::allocArray<quint32>(num);
+    nodeCostArr = atools::allocArray<int>(num);
+    nodeAltRangeMinArr = atools::allocArray<quint16>(num);
+    nodeAltRangeMaxArr = atools::allocArray<quint16>(num);
+    nodePredecessorArr = atools::allocArray<int>(num, -1);
+    edgePredecessorArr = atools::allocArray<Edge>(num, Edge());
+    closedNodes = atools::allocArray<bool>(num);
+  }
+  else
+  {
+    // Reuse arrays from last calculation
+    std::fill_n(edgeNameHashArr, num, 0);
+    std::fill_n(nodeCostArr, num, 0);
+    std::fill_n(nodeAltRangeMinArr, num, 0);
+    std::fill_n(nodeAltRangeMaxArr, num, 0);
+    std::fill_n(nodePredecessorArr, num, -1);
+    std::fill_n(edgePredecessorArr, num, Edge());
+    std::fill_n(closedNodes, num, false);
+  }
+
+  // Uses the same offset as the arrays above
+  openNodesHeap.reset(num, 3);
+  numExpandedNodes = 0;
+}
+
+void RouteFinder::SearchState::freeArrays()
 {
   atools::freeArray(edgeNameHashArr);
   atools::freeArray(nodeCostArr);
@@ -300,6 +673,7 @@ void RouteFinder::freeArrays()
   atools::freeArray(nodePredecessorArr);
   atools::freeArray(edgePredecessorArr);
   atools::freeArray(closedNodes);
+  numNodes = 0;
 }
 
 QDebug operator<<(QDebug out, const RouteLeg& obj)
@@ -19,13 +19,16 @@
 #define ATOOLS_ROUTEFINDER_H
 
 #include "util/heap.h"
-#include "routing/routenetworktypes.h"
+#include "routing/routenetwork.h"
+
+#include <QMutex>
+#include <QThreadPool>
+
+#include <atomic>
 
 namespace atools {
 namespace routing {
 
-class RouteNetwork;
-
 struct RouteLeg
 {
   int navId, /* Network ID as used as node id in the network */
@@ -37,10 +40,41 @@ struct RouteLeg
 
 };
 
+/* One route calculation for RouteFinder::calculateRoutes() */
+struct RouteRequest
+{
+  atools::geo::Pos from, to;
+  int altitude = 0;
+  atools::routing::Modes mode = atools::routing::MODE_ALL;
+};
+
+/* Result of one route calculation by RouteFinder::calculateRoutes() */
+struct RouteResult
+{
+  QList<RouteLeg> legs; /* Legs not including departure and destination. Empty if no route was found. */
+  float distanceMeter = 0.f;
+  bool found = false;
+  qint64 timeUs = 0L; /* Calculation time for this route in microseconds */
+};
+
+/* Timing statistics for RouteFinder::calculateRoutes() */
+struct RouteBatchStatistics
+{
+  int numRoutes = 0, numFound = 0, numThreads = 0;
+  qint64 totalTimeMs = 0L; /* Wall clock time for the whole batch */
+  qint64 minTimeUs = 0L, maxTimeUs = 0L, averageTimeUs = 0L; /* Calculation time per route */
+};
+
 /*
  * Calculates flight plans within a route network which can be an airway or radio navaid network.
  * Uses A* algorithm and several cost factor adjustments to get reasonable routes.
  *
+ * Mode MODE_BIDIRECTIONAL runs a second A* search backward from the destination over reversed edges
+ * in a separate thread. Both searches stop when the frontiers meet and no cheaper connection is possible.
+ * Airway networks are searched backward over incoming edges with the same airway type, direction and
+ * altitude checks. Airway change costs and altitude ranges depend on the path and are combined at the meeting
+ * node. Therefore the result might differ slightly from a unidirectional search for airway networks.
+ *
  * The class has a state (i.e. start and destination) and is not re-entrant.
  */
 class RouteFinder
@@ -63,6 +97,17 @@ public:
   /* Extract legs of shortest route and distance not including departure and destination. */
   void extractLegs(QList<RouteLeg>& routeLegs, float& distanceMeter) const;
 
+  /*
+   * Calculates routes for all requests on numThreads threads. Uses number of cores if numThreads is 0.
+   * The network has to be loaded and is not modified. Each thread uses its own route finder with scratch arrays
+   * which are reused across requests. Cost factors are copied from this object. The progress callback is not used.
+   *
+   * Results are in the same order as requests. Timing is returned in statistics if not null.
+   */
+  QList<atools::routing::RouteResult> calculateRoutes(const QList<atools::routing::RouteRequest>& requests,
+                                                      int numThreads = 0,
+                                                      atools::routing::RouteBatchStatistics *statistics = nullptr) const;
+
   const RouteNetwork *getNetwork() const
   {
     return network;
@@ -84,16 +129,103 @@ public:
     costFactorForceAirways = value;
   }
 
+  /* Use the landmark (ALT) heuristic if the network has landmarks. Default is true.
+   * Landmarks are ignored for modes using direct waypoint connections since these edges are
+   * not part of the landmark distances. See RouteNetworkLoader::setNumLandmarks(). */
+  void setUseLandmarks(bool value)
+  {
+    useLandmarks = value;
+  }
+
 private:
-  /* Expands a node by investigating all successors */
-  bool expandNode(const atools::routing::Node& node, const Edge& prevEdge);
+  /* Scratch arrays and open nodes for one search direction.
+   * Using plain arrays to speed up access compared to hash tables.
+   * Positions 0 and 1 are reserved for departure and destination. 2 is invalid.
+   * 3 corresponds to first index in nodeIndex.*/
+  struct SearchState
+  {
+    SearchState();
+    ~SearchState();
+
+    /* Allocates arrays or only resets them if size did not change */
+    void allocArrays(int num);
+    void freeArrays();
+
+    /* Size of arrays below */
+    int numNodes = 0;
+
+    /* Heap structure storing the index of open nodes. Costs are based on meters plus factors as integer.
+     * Sort order is defined by costs from start to node + estimate to destination.
+     * Indexed to avoid linear searches in contains() and changeOrPush(). */
+    atools::util::IndexedHeap<int> openNodesHeap;
+
+    /* Nodes that have been processed already and have a known shortest path */
+    bool *closedNodes = nullptr;
+
+    /* Costs from start to this node. Maps node id to costs. Costs are distance in meter
+     * adjusted by factors. */
+    int *nodeCostArr = nullptr;
+
+    /* Min and maximum altitude range of airways to this node so far */
+    quint16 *nodeAltRangeMinArr = nullptr;
+    quint16 *nodeAltRangeMaxArr = nullptr;
+
+    /* Maps node index to predecessor node id. Successor towards destination for backward search. */
+    int *nodePredecessorArr = nullptr;
+
+    /* Maps node index to predecessor edge - similar as above */
+    atools::routing::Edge *edgePredecessorArr = nullptr;
+
+    /* Airway name hash value for edge at index */
+    quint32 *edgeNameHashArr = nullptr;
+
+    /* For RouteNetwork::getNeighbours to avoid instantiations */
+    atools::routing::Result successors;
+
+    /* Number of nodes moved to closed list - for logging */
+    int numExpandedNodes = 0;
+  };
+
+  /* Calculates a route using the given query without changing the network state */
+  bool calculateRoute(const atools::routing::RouteNetworkQuery& routeQuery);
+
+  /* Run A* loop from departure to destination. Returns true if the destination was found. */
+  bool runSearch();
+
+  /* Run A* loops from departure and from destination in two threads until the cheapest connection is found.
+   * Returns true if a meeting node was found. */
+  bool runBidirectionalSearch();
+
+  /* A* loop for one direction of the bidirectional search. Called in parallel for both directions. */
+  void runSearchDirection(SearchState& state, bool backward);
+
+  /* Expands a node by investigating all successors or predecessors if backward is true */
+  bool expandNode(SearchState& state, const atools::routing::Node& node, bool backward);
 
   /* Calculates the costs to travel from current to successor. Base is the distance between the nodes in meter that
    * will have several factors applied to get reasonable routes */
   int calculateEdgeCost(const atools::routing::Node& node, const atools::routing::Node& successorNode,
                         const Edge& edge, quint32 currentEdgeAirwayHash);
 
-  bool combineRanges(quint16& min1, quint16& max1, quint16 min, quint16 max)
+  /* Estimated costs from node to destination or to departure if backward is true.
+   * Great circle distance or landmark based lower bound if larger. */
+  int estimateCosts(const atools::routing::Node& node, bool backward) const;
+
+  /* Remember node closed by forward and backward search if the path is cheaper than the last one. Thread safe. */
+  void updateMeeting(int index);
+
+  /* Copy the backward path from meeting node to destination into the predecessor arrays of the forward search */
+  void joinPaths();
+
+  /* Costs of the found route */
+  int getRouteCosts() const;
+
+  /* Compare the result with a plain unidirectional A* search without landmarks and print a warning if
+   * the plain search found a cheaper route or found a route where this search did not.
+   * Only used if DEBUG_ROUTE_FINDER_VERIFY is defined. */
+  void verifyRoute(bool found) const;
+
+  bool combineRanges(quint16& min1, quint16& max1, quint16 min, quint16 max) const
   {
     if(max1 < min || min1 > max)
       return false;
@@ -104,20 +236,21 @@ private:
   }
 
   void freeArrays();
+
+  /* Allocates arrays if network size changed, otherwise resets them. Backward arrays only in bidirectional mode. */
   void allocArrays();
   bool invokeCallback(const Node& currentNode);
 
   /* Avoid direct waypoint connections when using airways */
   float costFactorForceAirways = 1.3f;
 
+  bool useLandmarks = true;
+
   /* Force algortihm to avoid direct route from start to destination */
   static Q_DECL_CONSTEXPR float COST_FACTOR_DIRECT = 2.f;
   static Q_DECL_CONSTEXPR float COST_FACTOR_NEAR_WAYPOINTS = 1.1f;
   static Q_DECL_CONSTEXPR float COST_FACTOR_FAR_WAYPOINTS = 1.1f;
 
-  /* Prefer tracks if enabled */
-  static Q_DECL_CONSTEXPR float COST_FACTOR_TRACK = 0.8f;
-
   /* Force algortihm to use close waypoints near start and destination */
   static Q_DECL_CONSTEXPR float COST_FACTOR_FORCE_CLOSE_NODES = 1.5f;
 
@@ -139,38 +272,39 @@ private:
   /* Used network */
   atools::routing::RouteNetwork *network;
 
-  /* Heap structure storing the index of open nodes. Costs are based on meters plus factors as integer.
-   * Sort order is defined by costs from start to node + estimate to destination */
-  atools::util::Heap<int, int> openNodesHeap;
-
-  /* Using plain arrays below to speed up access compared to hash tables
-   * Positions 0 and 1 are reserved for departure and destination. 2 is invalid.
-   * 3 corresponds to first index in nodeIndex.*/
+  /* Search from departure and search from destination for bidirectional mode */
+  SearchState forwardState, backwardState;
+  bool bidirectional = false;
 
-  /* Nodes that have been processed already and have a known shortest path */
-  bool *closedNodes = nullptr;
+  /* Node where the cheapest connection between forward and backward search was found and its total costs.
+   * Both are changed only while holding meetingMutex. Costs are read without lock for the stop condition. */
+  int meetingNodeIndex = Node::INVALID_INDEX;
+  std::atomic<int> meetingCosts = 0;
+  QMutex meetingMutex;
 
-  /* Costs from start to this node. Maps node id to costs. Costs are distance in meter
-   * adjusted by factors. */
-  int *nodeCostArr = nullptr;
+  /* Flags CLOSED_FORWARD and CLOSED_BACKWARD per node. Same index offset as the arrays in SearchState. */
+  static Q_DECL_CONSTEXPR quint8 CLOSED_FORWARD = 1;
+  static Q_DECL_CONSTEXPR quint8 CLOSED_BACKWARD = 2;
+  std::atomic<quint8> *closedMaskArr = nullptr;
+  int numClosedMask = 0;
 
-  /* Min and maximum altitude range of airways to this node so far */
-  quint16 *nodeAltRangeMinArr = nullptr;
-  quint16 *nodeAltRangeMaxArr = nullptr;
+  /* Set by one search to stop both searches in bidirectional mode */
+  std::atomic_bool stopSearch = false;
 
-  /* Maps node index to predecessor node id */
-  int *nodePredecessorArr = nullptr;
+  /* Runs the backward search in bidirectional mode */
+  QThreadPool searchThreadPool;
 
-  /* Maps node index to predecessor edge - similar as above */
-  atools::routing::Edge *edgePredecessorArr = nullptr;
+  /* Callback requested to stop */
+  bool cancelled = false;
 
-  /* Airway name hash value for edge at index */
-  quint32 *edgeNameHashArr = nullptr;
+  /* Departure, destination, altitude and mode for the current calculation */
+  atools::routing::RouteNetworkQuery query;
 
   atools::routing::Node startNode, destNode;
 
-  /* For RouteNetwork::getNeighbours to avoid instantiations */
-  atools::routing::Result successors;
+  /* Landmark distances of departure and destination for the ALT heuristic. Only valid if landmarksActive is true. */
+  atools::routing::LandmarkDistances departureLandmarks, destinationLandmarks;
+  bool landmarksActive = false;
 
   RouteFinderCallbackType callback;
   int totalDist = 0;
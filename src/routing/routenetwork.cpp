@@ -18,6 +18,9 @@
 #include "routing/routenetwork.h"
 
 #include "geo/calculations.h"
+#include "util/heap.h"
+
+#include <QThreadPool>
 
 using atools::geo::nmToMeter;
 using atools::geo::Point3D;
@@ -47,41 +50,47 @@ RouteNetwork::~RouteNetwork()
 {
 }
 
-void RouteNetwork::getNeighbours(Result& result, const Node& origin, const Edge *prevEdge) const
+void RouteNetwork::getNeighbours(Result& result, const RouteNetworkQuery& query, const Node& origin,
+                                 const Edge *prevEdge) const
 {
-  Q_ASSERT(destinationNode.isValid());
-  Q_ASSERT(departureNode.isValid());
+  Q_ASSERT(query.destinationNode.isValid());
+  Q_ASSERT(query.departureNode.isValid());
 
   // Node might be also departure or destination
-  Point3D originPoint = point3D(origin.index);
-  float originToDestDist = originPoint.directDistanceMeter(destinationPoint);
+  Point3D originPoint = point3D(query, origin.index);
+  float originToDestDist = originPoint.directDistanceMeter(query.destinationPoint);
 
   // Check for track/non-track or non-track/track transition if true
   // Limits neighbors if origin is in the middle of a track and not an endpoint
-  bool originNotTrackEnd = source == SOURCE_AIRWAY && mode & MODE_TRACK &&
+  bool originNotTrackEnd = source == SOURCE_AIRWAY && query.mode & MODE_TRACK &&
                            prevEdge != nullptr && !origin.isTrackStartEnd();
 
   if(source == SOURCE_AIRWAY)
   {
     // Add airway edges =======================================
-    result.nodes.reserve(origin.edges.size());
-    result.edges.reserve(origin.edges.size());
+    int edgesBegin = origin.index >= 0 && origin.index < edgeOffsets.size() - 1 ? edgeOffsets.at(origin.index) : 0;
+    int edgesEnd = origin.index >= 0 && origin.index < edgeOffsets.size() - 1 ? edgeOffsets.at(origin.index + 1) : 0;
+
+    result.nodes.reserve(edgesEnd - edgesBegin);
+    result.edges.reserve(edgesEnd - edgesBegin);
 
     // Avoid duplicates with direct neighbor search
     QSet<int> nodeIndexes;
 
-    if(mode & MODE_AIRWAY)
+    if(query.mode & MODE_AIRWAY)
     {
       // Look at all node edges/airways
-      for(const Edge& edge : origin.edges)
+      for(int edgeIndex = edgesBegin; edgeIndex < edgesEnd; edgeIndex++)
       {
         // Check if edge type matches criteria (altitude, RNAV and airway type)
-        if(!matchEdge(edge))
+        if(!matchEdge(query, edgeIndex))
           continue;
 
-        const Node& node = nodeIndex.at(edge.toIndex);
+        const Edge& edge = edges.at(edgeIndex);
+        int toIndex = edge.toIndex;
+        const Node& node = nodeIndex.at(toIndex);
         // Check if node type matches like airway type
-        if(!matchNode(node))
+        if(!matchNode(query, node))
           continue;
 
         // Avoid track transitions at the wrong points
@@ -93,8 +102,8 @@ void RouteNetwork::getNeighbours(Result& result, const Node& origin, const Edge
           continue;
 
         // Edge can have only another node - not departure or destination
-        Point3D curPoint = nodeIndex.atPoint3D(edge.toIndex);
-        float curToDestDist = curPoint.directDistanceMeter(destinationPoint);
+        Point3D curPoint = nodeIndex.atPoint3D(toIndex);
+        float curToDestDist = curPoint.directDistanceMeter(query.destinationPoint);
 
         // Add only nodes/edges that are ahead of the current node and lead towards the destination
         if(curToDestDist < originToDestDist)
@@ -102,29 +111,29 @@ void RouteNetwork::getNeighbours(Result& result, const Node& origin, const Edge
           float curToOriginDist = curPoint.directDistanceMeter(originPoint);
           if(curToDestDist + curToOriginDist < originToDestDist * directDistanceFactorAirway)
           {
-            result.nodes.append(edge.toIndex);
+            result.nodes.append(toIndex);
             result.edges.append(edge);
 
-            if(mode & MODE_WAYPOINT)
-              nodeIndexes.insert(edge.toIndex);
+            if(query.mode & MODE_WAYPOINT)
+              nodeIndexes.insert(toIndex);
           }
         }
       }
     }
 
     // Additionally search for direct waypoint connections if result is limited
-    if((mode & MODE_WAYPOINT && result.size() < 2) || origin.isDeparture())
+    if((query.mode & MODE_WAYPOINT && result.size() < 2) || origin.isDeparture())
     {
       // Use nearest of underlying waypoint if calculating for selected route legs or looking for
       // nearest airway point
       float minDist = origin.isDeparture() &&
-                      (mode.testFlag(MODE_POINT_TO_POINT) || mode & MODE_AIRWAY) ? 0.f : minNearestDistanceWpM;
+                      (query.mode.testFlag(MODE_POINT_TO_POINT) || query.mode & MODE_AIRWAY) ? 0.f : minNearestDistanceWpM;
 
-      int found = searchNearest(result, origin, minDist, maxNearestDistanceWpM, &nodeIndexes);
+      int found = searchNearest(result, query, origin, minDist, maxNearestDistanceWpM, &nodeIndexes);
 
       if(found < 6)
         // Not enough results - try with larger search radius
-        searchNearest(result, origin, minDist * 2, maxNearestDistanceWpM * 5, &nodeIndexes);
+        searchNearest(result, query, origin, minDist * 2, maxNearestDistanceWpM * 5, &nodeIndexes);
 
       // Check for track transitions and remove any edges/nodes beginning from the end of the list
       if(originNotTrackEnd)
@@ -143,7 +152,7 @@ void RouteNetwork::getNeighbours(Result& result, const Node& origin, const Edge
   }
   else
     // Find nearest navaids =======================================
-    searchNearest(result, origin, minNearestDistanceRadioM, maxNearestDistanceRadioM);
+    searchNearest(result, query, origin, minNearestDistanceRadioM, maxNearestDistanceRadioM);
 
   // Add destination node and calculate edges to it if in range ==========================================
   if(originToDestDist < nearestDestDistanceM)
@@ -151,23 +160,123 @@ void RouteNetwork::getNeighbours(Result& result, const Node& origin, const Edge
     // Avoid jumping directly into a track
     if(!(originNotTrackEnd && prevEdge->isTrack()))
     {
-      result.nodes.append(destinationNode.index);
-      result.edges.append(Edge(Node::DESTINATION_INDEX, originPoint.gcDistanceMeter(destinationPoint)));
+      result.nodes.append(query.destinationNode.index);
+      result.edges.append(Edge(Node::DESTINATION_INDEX, originPoint.gcDistanceMeter(query.destinationPoint)));
     }
   }
 }
 
-int RouteNetwork::searchNearest(Result& result, const Node& origin,
-                                float minDistanceMeter, float maxDistanceMeter, const QSet<int> *excludeIndexes) const
+void RouteNetwork::getPredecessors(Result& result, const RouteNetworkQuery& query, const Node& target,
+                                   const Edge *nextEdge) const
 {
-  /* Callback class used for secondary stage filtering in radius searches.
-   * Mainly used to keep all local variables accessible for the callback method. */
-  struct RadiusCallback
+  Q_ASSERT(query.destinationNode.isValid());
+  Q_ASSERT(query.departureNode.isValid());
+
+  // Mirrors getNeighbours() with departure and destination swapped
+  Point3D targetPoint = point3D(query, target.index);
+  float targetToDepartDist = targetPoint.directDistanceMeter(query.departurePoint);
+
+  bool targetNotTrackEnd = source == SOURCE_AIRWAY && query.mode & MODE_TRACK &&
+                           nextEdge != nullptr && !target.isTrackStartEnd();
+
+  if(source == SOURCE_AIRWAY)
+  {
+    // Add incoming airway edges =======================================
+    bool hasEdges = target.index >= 0 && target.index < reverseEdgeOffsets.size() - 1;
+    int edgesBegin = hasEdges ? reverseEdgeOffsets.at(target.index) : 0;
+    int edgesEnd = hasEdges ? reverseEdgeOffsets.at(target.index + 1) : 0;
+
+    result.nodes.reserve(edgesEnd - edgesBegin);
+    result.edges.reserve(edgesEnd - edgesBegin);
+
+    QSet<int> nodeIndexes;
+
+    if(query.mode & MODE_AIRWAY)
+    {
+      for(int i = edgesBegin; i < edgesEnd; i++)
+      {
+        int edgeIndex = reverseEdgeIndexArr.at(i);
+        if(!matchEdge(query, edgeIndex))
+          continue;
+
+        int fromIndex = edgeFromIndexArr.at(edgeIndex);
+        const Node& node = nodeIndex.at(fromIndex);
+        if(!matchNode(query, node))
+          continue;
+
+        const Edge& edge = edges.at(edgeIndex);
+
+        if(targetNotTrackEnd &&
+           (nextEdge->isTrack() != edge.isTrack() ||
+            (nextEdge->isTrack() && edge.isTrack() && nextEdge->airwayHash != edge.airwayHash)))
+          continue;
+
+        // Add only nodes/edges that are between departure and the current node
+        Point3D curPoint = nodeIndex.atPoint3D(fromIndex);
+        float curToDepartDist = curPoint.directDistanceMeter(query.departurePoint);
+        if(curToDepartDist < targetToDepartDist)
+        {
+          float curToTargetDist = curPoint.directDistanceMeter(targetPoint);
+          if(curToDepartDist + curToTargetDist < targetToDepartDist * directDistanceFactorAirway)
+          {
+            result.nodes.append(fromIndex);
+            result.edges.append(edge);
+
+            if(query.mode & MODE_WAYPOINT)
+              nodeIndexes.insert(fromIndex);
+          }
+        }
+      }
+    }
+
+    // Direct waypoint connections are symmetric
+    if((query.mode & MODE_WAYPOINT && result.size() < 2) || target.isDestination())
+    {
+      float minDist = target.isDestination() &&
+                      (query.mode.testFlag(MODE_POINT_TO_POINT) || query.mode & MODE_AIRWAY) ? 0.f : minNearestDistanceWpM;
+
+      int found = searchNearest(result, query, target, minDist, maxNearestDistanceWpM, &nodeIndexes, true /* reverse */);
+
+      if(found < 6)
+        searchNearest(result, query, target, minDist * 2, maxNearestDistanceWpM * 5, &nodeIndexes, true /* reverse */);
+
+      if(targetNotTrackEnd)
+      {
+        for(int i = result.edges.size() - 1; i >= 0; i--)
+        {
+          if(nextEdge->isTrack() != result.edges.at(i).isTrack())
+          {
+            result.nodes.removeAt(i);
+            result.edges.removeAt(i);
+          }
+        }
+      }
+    }
+  }
+  else
+    searchNearest(result, query, target, minNearestDistanceRadioM, maxNearestDistanceRadioM, nullptr, true /* reverse */);
+
+  // Add departure node if in range ==========================================
+  if(targetToDepartDist < nearestDepartureDistanceM && !target.isDeparture())
   {
-    bool callback(float dist, int index) const
+    if(!(targetNotTrackEnd && nextEdge->isTrack()))
     {
-      Q_UNUSED(dist) // Squared manhattan distance is unusable here
+      result.nodes.append(query.departureNode.index);
+      result.edges.append(Edge(target.index, targetPoint.gcDistanceMeter(query.departurePoint)));
+    }
+  }
+}
 
+int RouteNetwork::searchNearest(Result& result, const RouteNetworkQuery& query, const Node& origin,
+                                float minDistanceMeter, float maxDistanceMeter, const QSet<int> *excludeIndexes,
+                                bool reverse) const
+{
+  /* Predicate used for secondary stage filtering in radius searches.
+   * Mainly used to keep all local variables accessible for the predicate. */
+  struct RadiusCallback
+  {
+    bool operator()(int index) const
+    {
       bool ok = true;
 
       // Current back to origin distance - calculate later
@@ -232,15 +341,18 @@ int RouteNetwork::searchNearest(Result& result, const Node& origin,
   callbackObj.points = nodeIndex.getPoints3D();
   callbackObj.excludeIndexes = (excludeIndexes == nullptr || excludeIndexes->isEmpty()) ? nullptr : excludeIndexes;
   callbackObj.radionav = isRadionavRouting();
-  callbackObj.originDeparture = origin.isDeparture();
+
+  // Search is done towards the departure in reverse mode - origin is the start point in both cases
+  bool originStart = reverse ? origin.isDestination() : origin.isDeparture();
+  callbackObj.originDeparture = originStart;
 
   callbackObj.directDistFactor = isAirwayRouting() ? directDistanceFactorWp : directDistanceFactorRadio;
-  callbackObj.originToDestDist = getDirectDistanceMeter(origin, destinationNode);
-  callbackObj.dest = destinationPoint;
+  callbackObj.originToDestDist = getDirectDistanceMeter(origin, reverse ? query.departureNode : query.destinationNode);
+  callbackObj.dest = reverse ? query.departurePoint : query.destinationPoint;
 
   if(callbackObj.radionav)
   {
-    if(origin.isDeparture())
+    if(originStart)
       // Allow all points close to departure
       callbackObj.radiusMin = 0.f;
     else
@@ -249,7 +361,7 @@ int RouteNetwork::searchNearest(Result& result, const Node& origin,
   }
   else
   {
-    if(origin.isDeparture())
+    if(originStart)
       // Lower minimum distance for departure
       callbackObj.radiusMin = minDistanceMeter / 5.f;
     else
@@ -262,12 +374,9 @@ int RouteNetwork::searchNearest(Result& result, const Node& origin,
   if(!callbackObj.radionav)
     maxDistanceMeter = std::min(maxDistanceMeter, callbackObj.originToDestDist);
 
-  // Use a lambda instead of std::bind since this is faster
-  atools::geo::RadiusCallbackType callbackFunc = [&callbackObj](float dist, int index) -> bool {
-                                                   return callbackObj.callback(dist, index);
-                                                 };
+  // Pass callback object as predicate which avoids std::function calls for each point
   QList<int> indexes;
-  nodeIndex.getRadiusIndexes(indexes, origin.pos, maxDistanceMeter, callbackFunc);
+  nodeIndex.getRadiusIndexesIf(indexes, origin.pos, maxDistanceMeter, callbackObj);
 
   result.nodes.reserve(indexes.size());
   result.edges.reserve(indexes.size());
@@ -277,11 +386,11 @@ int RouteNetwork::searchNearest(Result& result, const Node& origin,
   Point3D originPoint = nodeToCartesian(origin);
   for(int idx : std::as_const(indexes))
   {
-    if(matchNode(nodeIndex.at(idx)))
+    if(matchNode(query, nodeIndex.at(idx)))
     {
       // Add node and edge leading to it
       result.nodes.append(idx);
-      result.edges.append(Edge(idx, originPoint.gcDistanceMeter(nodeIndex.atPoint3D(idx))));
+      result.edges.append(Edge(reverse ? origin.index : idx, originPoint.gcDistanceMeter(nodeIndex.atPoint3D(idx))));
       numFound++;
     }
   }
@@ -291,64 +400,63 @@ int RouteNetwork::searchNearest(Result& result, const Node& origin,
 void RouteNetwork::setParameters(const geo::Pos& departurePos, const geo::Pos& destinationPos, int altitudeParam,
                                  Modes modeParam)
 {
-  clearParameters();
+  currentQuery = createQuery(departurePos, destinationPos, altitudeParam, modeParam);
+}
 
-  altitude = altitudeParam;
-  mode = modeParam;
+RouteNetworkQuery RouteNetwork::createQuery(const geo::Pos& departurePos, const geo::Pos& destinationPos,
+                                            int altitudeParam, Modes modeParam) const
+{
+  RouteNetworkQuery query;
+  query.altitude = altitudeParam;
+  query.mode = modeParam;
 
   if(departurePos.isValid())
   {
     // Add departure node to network ====================
-    departureNode.index = Node::DEPARTURE_INDEX;
-    departureNode.pos = departurePos;
-    departureNode.type = NODE_DEPARTURE;
-    departureNode.range = 0;
-    departureNode.subtype = NODE_NONE;
-    departureNode.con = CONNECTION_NONE;
-    departurePos.toCartesian(departurePoint);
+    query.departureNode.index = Node::DEPARTURE_INDEX;
+    query.departureNode.pos = departurePos;
+    query.departureNode.type = NODE_DEPARTURE;
+    query.departureNode.range = 0;
+    query.departureNode.subtype = NODE_NONE;
+    query.departureNode.con = CONNECTION_NONE;
+    departurePos.toCartesian(query.departurePoint);
   }
 
   if(destinationPos.isValid())
   {
     // Add destination node to network ====================
-    destinationNode.index = Node::DESTINATION_INDEX;
-    destinationNode.pos = destinationPos;
-    destinationNode.type = NODE_DESTINATION;
-    destinationNode.range = 0;
-    destinationNode.subtype = NODE_NONE;
-    destinationNode.con = CONNECTION_NONE;
-    destinationPos.toCartesian(destinationPoint);
+    query.destinationNode.index = Node::DESTINATION_INDEX;
+    query.destinationNode.pos = destinationPos;
+    query.destinationNode.type = NODE_DESTINATION;
+    query.destinationNode.range = 0;
+    query.destinationNode.subtype = NODE_NONE;
+    query.destinationNode.con = CONNECTION_NONE;
+    destinationPos.toCartesian(query.destinationPoint);
 
     if(departurePos.isValid())
     {
-      routeDirectDistance = getDirectDistanceMeter(departureNode, destinationNode);
-      routeGcDistance = getGcDistanceMeter(departureNode, destinationNode);
+      query.routeDirectDistance = getDirectDistanceMeter(query.departureNode, query.destinationNode);
+      query.routeGcDistance = getGcDistanceMeter(query.departureNode, query.destinationNode);
     }
   }
+  return query;
 }
 
 void RouteNetwork::clearParameters()
 {
-  altitude = 0;
-  mode = MODE_ALL;
-  departureNode = Node();
-  departurePoint = Point3D();
-
-  destinationNode = Node();
-  destinationPoint = Point3D();
-  routeDirectDistance = routeGcDistance = 0.f;
+  currentQuery = RouteNetworkQuery();
 }
 
-const Node& RouteNetwork::getNode(int index) const
+const Node& RouteNetwork::getNode(const RouteNetworkQuery& query, int index) const
 {
   const static atools::routing::Node INVALID;
 
   if(index >= 0)
     return nodeIndex.at(index);
   else if(index == Node::DEPARTURE_INDEX)
-    return departureNode;
+    return query.departureNode;
   else if(index == Node::DESTINATION_INDEX)
-    return destinationNode;
+    return query.destinationNode;
   else
     return INVALID;
 }
@@ -383,21 +491,21 @@ void RouteNetwork::setNearestDestDistanceNm(float value)
   nearestDestDistanceM = nmToMeter(value);
 }
 
-const geo::Point3D& RouteNetwork::point3D(int index) const
+const geo::Point3D& RouteNetwork::point3D(const RouteNetworkQuery& query, int index) const
 {
   const static Point3D INVALID;
 
   if(index >= 0)
     return nodeIndex.atPoint3D(index);
   else if(index == Node::DEPARTURE_INDEX)
-    return departurePoint;
+    return query.departurePoint;
   else if(index == Node::DESTINATION_INDEX)
-    return destinationPoint;
+    return query.destinationPoint;
   else
     return INVALID;
 }
 
-bool RouteNetwork::matchNode(const Node& node) const
+bool RouteNetwork::matchNode(const RouteNetworkQuery& query, const Node& node) const
 {
   atools::routing::NodeType nodeType = node.type;
   bool ok = true;
@@ -407,16 +515,16 @@ bool RouteNetwork::matchNode(const Node& node) const
     case atools::routing::NODE_VOR:
     case atools::routing::NODE_VORDME:
     case atools::routing::NODE_DME:
-      ok &= mode.testFlag(MODE_RADIONAV_VOR);
+      ok &= query.mode.testFlag(MODE_RADIONAV_VOR);
       break;
 
     case atools::routing::NODE_NDB:
-      ok &= mode.testFlag(MODE_RADIONAV_NDB);
+      ok &= query.mode.testFlag(MODE_RADIONAV_NDB);
       break;
 
     case atools::routing::NODE_WAYPOINT:
 
-      if(mode.testFlag(MODE_WAYPOINT))
+      if(query.mode.testFlag(MODE_WAYPOINT))
         // Can use any waypoint in this mode
         ok = true;
       else
@@ -426,13 +534,13 @@ bool RouteNetwork::matchNode(const Node& node) const
         // Check if track or airway type matches filter mode
         atools::routing::NodeConnections con = node.con;
 
-        if(mode.testFlag(MODE_JET) && con.testFlag(CONNECTION_JET))
+        if(query.mode.testFlag(MODE_JET) && con.testFlag(CONNECTION_JET))
           ok = true;
 
-        if(mode.testFlag(MODE_VICTOR) && con.testFlag(CONNECTION_VICTOR))
+        if(query.mode.testFlag(MODE_VICTOR) && con.testFlag(CONNECTION_VICTOR))
           ok = true;
 
-        if(mode.testFlag(MODE_TRACK) && con.testFlag(CONNECTION_TRACK))
+        if(query.mode.testFlag(MODE_TRACK) && con.testFlag(CONNECTION_TRACK))
           ok = true;
       }
       break;
@@ -445,41 +553,277 @@ bool RouteNetwork::matchNode(const Node& node) const
   return ok;
 }
 
-bool RouteNetwork::matchEdge(const Edge& edge) const
+bool RouteNetwork::matchEdge(const RouteNetworkQuery& query, int edgeIndex) const
 {
-  bool ok = (altitude == 0 || (altitude >= edge.minAltFt && altitude <= edge.maxAltFt));
+  const Edge& edge = edges.at(edgeIndex);
+  bool ok = (query.altitude == 0 || (query.altitude >= edge.minAltFt && query.altitude <= edge.maxAltFt));
 
   // Check if RNAV has to be excluded
-  if(mode & MODE_NO_RNAV)
+  if(query.mode & MODE_NO_RNAV)
     ok &= edge.routeType != RNAV;
 
   // Check if track or airway type matches filter mode
   if(ok)
-    ok &= (edge.isJetAirway() && mode.testFlag(MODE_JET)) ||
-          (edge.isVictorAirway() && mode.testFlag(MODE_VICTOR)) ||
-          (edge.isNoConnection() && mode.testFlag(MODE_WAYPOINT)) ||
-          (edge.isTrack() && mode.testFlag(MODE_TRACK));
+  {
+    EdgeType type = edge.type;
+    ok &= ((type == EDGE_JET || type == EDGE_BOTH) && query.mode.testFlag(MODE_JET)) ||
+          ((type == EDGE_VICTOR || type == EDGE_BOTH) && query.mode.testFlag(MODE_VICTOR)) ||
+          (type == EDGE_NONE && query.mode.testFlag(MODE_WAYPOINT)) ||
+          (type == EDGE_TRACK && query.mode.testFlag(MODE_TRACK));
+  }
 
-  // Test altitude levels if attached - independent of direction
-  if(ok && altitude > 0 && edge.hasAltLevels)
+  // Test altitude levels if attached - independent of direction. Levels exist only for tracks.
+  if(ok && query.altitude > 0 && edge.type == EDGE_TRACK)
   {
-    int level = altitude / 100;
+    if(edge.hasAltLevels)
+    {
+      int level = query.altitude / 100;
 
-    if(altLevelsEast.contains(edge.id))
-      ok &= altLevelsEast.value(edge.id).contains(static_cast<quint16>(level));
-    if(altLevelsWest.contains(edge.id))
-      ok &= altLevelsWest.value(edge.id).contains(static_cast<quint16>(level));
+      if(altLevelsEast.contains(edge.id))
+        ok &= altLevelsEast.value(edge.id).contains(static_cast<quint16>(level));
+      if(altLevelsWest.contains(edge.id))
+        ok &= altLevelsWest.value(edge.id).contains(static_cast<quint16>(level));
+    }
   }
 
   return ok;
 }
 
+void RouteNetwork::updateReverseEdges()
+{
+  // Build reverse adjacency by counting incoming edges per node =========================
+  int numNodes = std::max(static_cast<int>(edgeOffsets.size()) - 1, 0);
+  edgeFromIndexArr.fill(-1, edges.size());
+  reverseEdgeIndexArr.fill(-1, edges.size());
+  reverseEdgeOffsets.fill(0, edges.isEmpty() ? 0 : numNodes + 1);
+
+  for(int nodeIdx = 0; nodeIdx < numNodes; nodeIdx++)
+  {
+    for(int edgeIndex = edgeOffsets.at(nodeIdx); edgeIndex < edgeOffsets.at(nodeIdx + 1); edgeIndex++)
+    {
+      edgeFromIndexArr[edgeIndex] = nodeIdx;
+      reverseEdgeOffsets[edges.at(edgeIndex).toIndex + 1]++;
+    }
+  }
+
+  for(int i = 1; i < reverseEdgeOffsets.size(); i++)
+    reverseEdgeOffsets[i] += reverseEdgeOffsets.at(i - 1);
+
+  QList<int> fillPos(reverseEdgeOffsets);
+  for(int edgeIndex = 0; edgeIndex < edges.size(); edgeIndex++)
+    reverseEdgeIndexArr[fillPos[edges.at(edgeIndex).toIndex]++] = edgeIndex;
+}
+
+void RouteNetwork::updateLandmarks(int numLandmarks)
+{
+  landmarkIndexes.clear();
+  landmarkFromDistArr.clear();
+  landmarkToDistArr.clear();
+
+  int numNodes = static_cast<int>(nodeIndex.size());
+  if(numLandmarks <= 0 || edges.isEmpty())
+    return;
+
+  // Select landmarks by farthest point selection on all nodes connected to airways or tracks =============
+  QList<float> minDistances(numNodes, std::numeric_limits<float>::max());
+  int next = -1;
+  for(int i = 0; i < numNodes && next == -1; i++)
+  {
+    if(getNumEdges(i) > 0)
+      next = i;
+  }
+
+  while(next != -1 && landmarkIndexes.size() < numLandmarks)
+  {
+    landmarkIndexes.append(next);
+    const Point3D& landmarkPoint = nodeIndex.atPoint3D(next);
+
+    // Next landmark is the node with the largest distance to all landmarks found so far
+    next = -1;
+    float maxDistance = 0.f;
+    for(int i = 0; i < numNodes; i++)
+    {
+      if(getNumEdges(i) == 0)
+        continue;
+
+      minDistances[i] = std::min(minDistances.at(i), nodeIndex.atPoint3D(i).directDistanceMeter(landmarkPoint));
+      if(minDistances.at(i) > maxDistance)
+      {
+        maxDistance = minDistances.at(i);
+        next = i;
+      }
+    }
+  }
+
+  // Calculate distances from and to all landmarks in parallel =============
+  landmarkFromDistArr.resize(landmarkIndexes.size() * numNodes);
+  landmarkToDistArr.resize(landmarkIndexes.size() * numNodes);
+
+  // Tasks write into distinct ranges - get pointers once to avoid detaching in threads
+  float *fromDistArr = landmarkFromDistArr.data(), *toDistArr = landmarkToDistArr.data();
+
+  QThreadPool pool;
+  for(int i = 0; i < landmarkIndexes.size(); i++)
+  {
+    int landmarkIndex = landmarkIndexes.at(i);
+    float *fromDist = fromDistArr + i * numNodes, *toDist = toDistArr + i * numNodes;
+    pool.start([this, fromDist, landmarkIndex]() -> void {
+      calculateLandmarkDistances(fromDist, landmarkIndex, false /* reverse */);
+    });
+    pool.start([this, toDist, landmarkIndex]() -> void {
+      calculateLandmarkDistances(toDist, landmarkIndex, true /* reverse */);
+    });
+  }
+  pool.waitForDone();
+}
+
+void RouteNetwork::calculateLandmarkDistances(float *distances, int landmarkIndex, bool reverse) const
+{
+  int numNodes = static_cast<int>(nodeIndex.size());
+  std::fill_n(distances, numNodes, std::numeric_limits<float>::max());
+
+  atools::util::IndexedHeap<float> heap(10000);
+  heap.reset(numNodes);
+
+  distances[landmarkIndex] = 0.f;
+  heap.pushData(landmarkIndex, 0.f);
+
+  while(!heap.isEmpty())
+  {
+    int index = heap.popData();
+    float distance = distances[index];
+
+    int begin = reverse ? reverseEdgeOffsets.at(index) : edgeOffsets.at(index);
+    int end = reverse ? reverseEdgeOffsets.at(index + 1) : edgeOffsets.at(index + 1);
+    for(int i = begin; i < end; i++)
+    {
+      int edgeIndex = reverse ? reverseEdgeIndexArr.at(i) : i;
+      const Edge& edge = edges.at(edgeIndex);
+      int nextIndex = reverse ? edgeFromIndexArr.at(edgeIndex) : edge.toIndex;
+
+      // Lowest costs RouteFinder can assign to this edge - all other factors are above 1 and costs are truncated
+      float length = edge.lengthMeter;
+      if(edge.type == EDGE_TRACK)
+        length = std::floor(length * COST_FACTOR_TRACK);
+
+      float nextDistance = distance + length;
+      if(nextDistance < distances[nextIndex])
+      {
+        distances[nextIndex] = nextDistance;
+        heap.changeOrPush(nextIndex, nextDistance);
+      }
+    }
+  }
+}
+
+void RouteNetwork::getLandmarkDistances(LandmarkDistances& distances, const RouteNetworkQuery& query, int index) const
+{
+  const float UNREACHABLE = std::numeric_limits<float>::max();
+  int numLandmarks = static_cast<int>(landmarkIndexes.size()), numNodes = static_cast<int>(nodeIndex.size());
+  distances.fromLandmark.fill(UNREACHABLE, numLandmarks);
+  distances.toLandmark.fill(UNREACHABLE, numLandmarks);
+
+  if(index >= 0)
+  {
+    // Network node ===================================
+    for(int i = 0; i < numLandmarks; i++)
+    {
+      distances.fromLandmark[i] = landmarkFromDistArr.at(i * numNodes + index);
+      distances.toLandmark[i] = landmarkToDistArr.at(i * numNodes + index);
+    }
+  }
+  else if(index == Node::DEPARTURE_INDEX || index == Node::DESTINATION_INDEX)
+  {
+    // Virtual node ===================================
+    // Assume an edge between virtual node and all network nodes. Costs are at least the truncated direct distance.
+    bool departure = index == Node::DEPARTURE_INDEX;
+    const Point3D& point = departure ? query.departurePoint : query.destinationPoint;
+    QList<float> edgeCosts(numNodes);
+    for(int n = 0; n < numNodes; n++)
+      edgeCosts[n] = std::floor(nodeIndex.atPoint3D(n).directDistanceMeter(point));
+
+    // Departure has only outgoing edges and destination only incoming
+    const QList<float>& landmarkDistArr = departure ? landmarkToDistArr : landmarkFromDistArr;
+    QList<float>& result = departure ? distances.toLandmark : distances.fromLandmark;
+    for(int i = 0; i < numLandmarks; i++)
+    {
+      const float *dist = landmarkDistArr.constData() + i * numNodes;
+      float minDist = UNREACHABLE;
+      for(int n = 0; n < numNodes; n++)
+      {
+        if(dist[n] < UNREACHABLE)
+          minDist = std::min(minDist, dist[n] + edgeCosts.at(n));
+      }
+      result[i] = minDist;
+    }
+  }
+}
+
+float RouteNetwork::getLandmarkBoundMeter(int index, const LandmarkDistances& target) const
+{
+  if(landmarkIndexes.isEmpty() || index < 0 || target.fromLandmark.size() != landmarkIndexes.size())
+    return 0.f;
+
+  const float UNREACHABLE = std::numeric_limits<float>::max();
+  qsizetype numNodes = nodeIndex.size();
+  const float *fromDist = landmarkFromDistArr.constData() + index, *toDist = landmarkToDistArr.constData() + index;
+
+  float bound = 0.f;
+  for(int i = 0; i < landmarkIndexes.size(); i++, fromDist += numNodes, toDist += numNodes)
+  {
+    // dist(n, t) >= dist(L, t) - dist(L, n)
+    if(*fromDist < UNREACHABLE && target.fromLandmark.at(i) < UNREACHABLE)
+      bound = std::max(bound, target.fromLandmark.at(i) - *fromDist);
+
+    // dist(n, t) >= dist(n, L) - dist(t, L)
+    if(*toDist < UNREACHABLE && target.toLandmark.at(i) < UNREACHABLE)
+      bound = std::max(bound, *toDist - target.toLandmark.at(i));
+  }
+  return bound;
+}
+
+float RouteNetwork::getLandmarkBoundMeter(const LandmarkDistances& source, int index) const
+{
+  if(landmarkIndexes.isEmpty() || index < 0 || source.fromLandmark.size() != landmarkIndexes.size())
+    return 0.f;
+
+  const float UNREACHABLE = std::numeric_limits<float>::max();
+  qsizetype numNodes = nodeIndex.size();
+  const float *fromDist = landmarkFromDistArr.constData() + index, *toDist = landmarkToDistArr.constData() + index;
+
+  float bound = 0.f;
+  for(int i = 0; i < landmarkIndexes.size(); i++, fromDist += numNodes, toDist += numNodes)
+  {
+    // dist(s, n) >= dist(L, n) - dist(L, s)
+    if(*fromDist < UNREACHABLE && source.fromLandmark.at(i) < UNREACHABLE)
+      bound = std::max(bound, *fromDist - source.fromLandmark.at(i));
+
+    // dist(s, n) >= dist(s, L) - dist(n, L)
+    if(*toDist < UNREACHABLE && source.toLandmark.at(i) < UNREACHABLE)
+      bound = std::max(bound, source.toLandmark.at(i) - *toDist);
+  }
+  return bound;
+}
+
+qint64 RouteNetwork::getMemoryUsage() const
+{
+  qint64 numEdges = edges.capacity();
+  return nodeIndex.capacity() * static_cast<qint64>(sizeof(Node) + sizeof(Point3D)) +
+         (edgeOffsets.capacity() + reverseEdgeOffsets.capacity()) * static_cast<qint64>(sizeof(int)) +
+         numEdges * static_cast<qint64>(sizeof(Edge) + 2 * sizeof(int)) +
+         (landmarkFromDistArr.capacity() + landmarkToDistArr.capacity()) * static_cast<qint64>(sizeof(float));
+}
+
 void RouteNetwork::clear()
 {
   clearParameters();
   nodeIndex.clearIndex();
+  edgeOffsets.clear();
+  edges.clear();
+  updateReverseEdges();
   altLevelsEast.clear();
   altLevelsWest.clear();
+  updateLandmarks(0);
 }
 
 bool RouteNetwork::isLoaded() const
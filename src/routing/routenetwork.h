@@ -26,6 +26,34 @@ namespace routing {
 
 class RouteNetworkLoader;
 
+/*
+ * Departure and destination nodes, altitude and mode for one route calculation.
+ * Created by RouteNetwork::createQuery(). Passing a query to the RouteNetwork methods instead of using
+ * setParameters() allows concurrent route calculations on one loaded network.
+ */
+struct RouteNetworkQuery
+{
+  /* Used to filter airway edges by altitude restrictions. */
+  int altitude = 0;
+
+  /* Filter for getNeighbours */
+  atools::routing::Modes mode = atools::routing::MODE_ALL;
+
+  atools::routing::Node departureNode, destinationNode;
+  atools::geo::Point3D departurePoint, destinationPoint;
+  float routeDirectDistance = 0.f, routeGcDistance = 0.f;
+};
+
+/*
+ * Landmark distances of a route endpoint for the ALT heuristic. Filled by RouteNetwork::getLandmarkDistances().
+ * Values are lower bounds for the route costs from landmark i to the endpoint and from the endpoint to landmark i.
+ * Unreachable is the maximum float value.
+ */
+struct LandmarkDistances
+{
+  QList<float> fromLandmark, toLandmark;
+};
+
 /*
  * Network forming a directed graph by navaid nodes and airway edges or generated edges by neares neighbor search.
  * The class already applies various filtering mechanisms (e.g. distance to destination) when looking for nearest nodes.
@@ -38,6 +66,8 @@ class RouteNetworkLoader;
  * The class has a state (i.e. start and destination) and is not re-entrant.
  *
  * A call to setParameters with valid departure and destination is required before using any other methods.
+ * Methods having a RouteNetworkQuery parameter do not use this state and can be called concurrently
+ * once the network is loaded.
  */
 class RouteNetwork
 {
@@ -56,8 +86,30 @@ public:
    * Adjacent objects are filtered based on distance and type criteria like airway types.
    * Edges may be airways or generated edges by nearest neighbor search.
    * Nodes/edges having a longer distance to the destination than the origin are filtered out .*/
+  void getNeighbours(atools::routing::Result& result, const atools::routing::RouteNetworkQuery& query,
+                     const atools::routing::Node& origin, const Edge *prevEdge = nullptr) const;
+
+  /* As above but uses the state from setParameters() */
   void getNeighbours(atools::routing::Result& result, const atools::routing::Node& origin,
-                     const Edge *prevEdge = nullptr) const;
+                     const Edge *prevEdge = nullptr) const
+  {
+    getNeighbours(result, currentQuery, origin, prevEdge);
+  }
+
+  /* Reverse of getNeighbours() for backward search from the destination.
+   * Returns all nodes having an edge leading to target. Nodes are filtered by type, mode and altitude
+   * and only nodes leading towards the departure are returned.
+   * nextEdge is the edge leaving target in the path to the destination.
+   * Edges in result have the original direction, i.e. from the returned node to target. */
+  void getPredecessors(atools::routing::Result& result, const atools::routing::RouteNetworkQuery& query,
+                       const atools::routing::Node& target, const Edge *nextEdge = nullptr) const;
+
+  /* As above but uses the state from setParameters() */
+  void getPredecessors(atools::routing::Result& result, const atools::routing::Node& target,
+                       const Edge *nextEdge = nullptr) const
+  {
+    getPredecessors(result, currentQuery, target, nextEdge);
+  }
 
   /* Same as above but uses a the nearest node for the position. */
   void getNeighbours(atools::routing::Result& result, const atools::geo::Pos& origin,
@@ -86,23 +138,40 @@ public:
   void setParameters(const atools::geo::Pos& departurePos, const atools::geo::Pos& destinationPos,
                      int altitudeParam, atools::routing::Modes modeParam);
 
+  /* Same as setParameters() but returns the parameters instead of keeping them in the network. */
+  atools::routing::RouteNetworkQuery createQuery(const atools::geo::Pos& departurePos,
+                                                 const atools::geo::Pos& destinationPos,
+                                                 int altitudeParam, atools::routing::Modes modeParam) const;
+
+  /* Parameters as set by setParameters() */
+  const atools::routing::RouteNetworkQuery& getQuery() const
+  {
+    return currentQuery;
+  }
+
   /* Reset all parameters set by above method*/
   void clearParameters();
 
   /* Get the virtual departure node that was added using setParameters */
   const atools::routing::Node& getDepartureNode() const
   {
-    return departureNode;
+    return currentQuery.departureNode;
   }
 
   /* Get the virtual destination node that was added using setParameters */
   const atools::routing::Node& getDestinationNode() const
   {
-    return destinationNode;
+    return currentQuery.destinationNode;
   }
 
   /* Get a node by routing network node index. If index is -1 an invalid node with id -1 is returned */
-  const atools::routing::Node& getNode(int index) const;
+  const atools::routing::Node& getNode(int index) const
+  {
+    return getNode(currentQuery, index);
+  }
+
+  /* As above but returns departure and destination from the given query */
+  const atools::routing::Node& getNode(const atools::routing::RouteNetworkQuery& query, int index) const;
 
   /* Get a single nearest node to the position. */
   const atools::routing::Node& getNearestNode(const atools::geo::Pos& pos) const
@@ -180,29 +249,80 @@ public:
   /* Mode that defines which features are used for edge filtering (airways, tracks, direct connections, etc.) */
   atools::routing::Modes getMode() const
   {
-    return mode;
+    return currentQuery.mode;
+  }
+
+  /* Number of outgoing airway and track edges for node index. Edges are not filtered. */
+  int getNumEdges(int index) const
+  {
+    return index >= 0 && index < edgeOffsets.size() - 1 ? edgeOffsets.at(index + 1) - edgeOffsets.at(index) : 0;
   }
 
+  /* Total number of loaded airway and track edges */
+  int getNumEdges() const
+  {
+    return edges.size();
+  }
+
+  /* Approximate memory used by nodes, edges and spatial index in bytes */
+  qint64 getMemoryUsage() const;
+
+  /* Select numLandmarks landmark nodes spread over the airway network and calculate the shortest airway distances
+   * from and to all other nodes. Used for the ALT heuristic in getLandmarkBoundMeter().
+   * Distances use all airway and track edges with the lowest possible RouteFinder costs, i.e. the truncated length
+   * and COST_FACTOR_TRACK for tracks. This makes them a lower bound for all queries not using direct waypoint
+   * connections between network nodes (MODE_WAYPOINT).
+   * Clears landmarks if numLandmarks is 0. Called by the loader. Runs one thread per landmark and direction. */
+  void updateLandmarks(int numLandmarks);
+
+  /* true if landmark distances were calculated */
+  bool hasLandmarks() const
+  {
+    return !landmarkIndexes.isEmpty();
+  }
+
+  /* Get landmark distances for a network node or the virtual departure or destination of the query.
+   * The virtual departure has only outgoing and the destination only incoming edges. The costs of these edges are
+   * bound by the direct distance to all network nodes. Empty if no landmarks are available. */
+  void getLandmarkDistances(atools::routing::LandmarkDistances& distances, const RouteNetworkQuery& query,
+                            int index) const;
+
+  /* Lower bound for the route costs from network node index to target using the triangle inequality on
+   * directed landmark distances: dist(n, t) >= dist(L, t) - dist(L, n) and dist(n, t) >= dist(n, L) - dist(t, L).
+   * Returns 0 if no landmarks are available. */
+  float getLandmarkBoundMeter(int index, const atools::routing::LandmarkDistances& target) const;
+
+  /* As above but for the costs from source to network node index */
+  float getLandmarkBoundMeter(const atools::routing::LandmarkDistances& source, int index) const;
+
 private:
   friend class atools::routing::RouteNetworkLoader;
 
-  /* Get nearest nodes and edges */
-  int searchNearest(atools::routing::Result& result, const Node& origin, float minDistanceMeter,
-                    float maxDistanceMeter, const QSet<int> *excludeIndexes = nullptr) const;
+  /* Get nearest nodes and edges. Searches towards the departure instead of the destination if reverse is true.
+   * Edges lead to origin in this case. */
+  int searchNearest(atools::routing::Result& result, const RouteNetworkQuery& query, const Node& origin,
+                    float minDistanceMeter, float maxDistanceMeter, const QSet<int> *excludeIndexes = nullptr,
+                    bool reverse = false) const;
 
   /* Check node filter based on mode. */
-  bool matchNode(const Node& node) const;
+  bool matchNode(const RouteNetworkQuery& query, const Node& node) const;
 
   atools::geo::Point3D nodeToCartesian(const atools::routing::Node& node) const
   {
     return node.index >= 0 ? nodeIndex.atPoint3D(node.index) : node.pos.toCartesian();
   }
 
-  /* Check if altitude, RNAV constraints and more allow to use this edge */
-  bool matchEdge(const atools::routing::Edge& edge) const;
+  /* Check if altitude, RNAV constraints and more allow to use this edge. edgeIndex is the position in edges. */
+  bool matchEdge(const RouteNetworkQuery& query, int edgeIndex) const;
+
+  /* Build the incoming edge arrays for backward search after loading. Needs edges and edgeOffsets. */
+  void updateReverseEdges();
+
+  /* Dijkstra search from landmark over all airway edges or reversed edges. distances has size of nodes. */
+  void calculateLandmarkDistances(float *distances, int landmarkIndex, bool reverse) const;
 
   /* Get point in 3D space. Returns destination or departure for appropriate indexes. */
-  const atools::geo::Point3D& point3D(int index) const;
+  const atools::geo::Point3D& point3D(const RouteNetworkQuery& query, int index) const;
 
   /* All distances in meter */
   float minNearestDistanceRadioM, maxNearestDistanceRadioM,
@@ -211,19 +331,29 @@ private:
 
   float directDistanceFactorRadio, directDistanceFactorWp, directDistanceFactorAirway;
 
-  /* Used to filter airway edges by altitude restrictions. */
-  int altitude = 0;
-
-  /* Filter for getNeighbours */
-  atools::routing::Modes mode = atools::routing::MODE_ALL;
-
-  atools::routing::Node departureNode, destinationNode;
-  atools::geo::Point3D departurePoint, destinationPoint;
-  float routeDirectDistance = 0.f, routeGcDistance = 0.f;
+  /* Departure, destination and filter set by setParameters() */
+  atools::routing::RouteNetworkQuery currentQuery;
 
   /* Spatial index for nearest neighbor search using KD-tree internally */
   atools::geo::SpatialIndex<Node> nodeIndex;
 
+  /* Outgoing airway and track edges of all nodes in one contiguous array (compressed sparse row layout).
+   * Edges for node index i are in range edgeOffsets[i] to edgeOffsets[i + 1] - 1.
+   * edgeOffsets has size number of nodes plus one if loaded. Empty for radio navaid networks. */
+  QList<int> edgeOffsets;
+  QList<Edge> edges;
+
+  /* Incoming edges for backward search. Indexes into edges for node index i are in
+   * reverseEdgeIndexArr[reverseEdgeOffsets[i]] to reverseEdgeIndexArr[reverseEdgeOffsets[i + 1] - 1].
+   * edgeFromIndexArr maps edge index to the node index the edge starts at. */
+  QList<int> reverseEdgeOffsets, reverseEdgeIndexArr, edgeFromIndexArr;
+
+  /* Landmark node indexes and airway distances for the ALT heuristic. Distance from landmark i to node n is
+   * landmarkFromDistArr[i * number of nodes + n] and from node n to landmark i landmarkToDistArr[same index].
+   * Unreachable nodes have the maximum float value. Empty if not calculated. */
+  QList<int> landmarkIndexes;
+  QList<float> landmarkFromDistArr, landmarkToDistArr;
+
   /* Map database track.track_id to altitude levels if existing */
   QHash<int, QList<quint16> > altLevelsEast, altLevelsWest;
 
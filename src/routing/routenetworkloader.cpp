@@ -26,7 +26,11 @@
 #include "sql/sqlutil.h"
 #include "track/tracktypes.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
 
 using atools::sql::SqlUtil;
 using atools::sql::SqlQuery;
@@ -49,6 +53,34 @@ inline size_t trackHash(const QString& name, const QString& type)
 namespace atools {
 namespace routing {
 
+/* Number of rows read at once in batch queries */
+static const int FETCH_ROWS = 10000;
+
+/* Snapshot file header */
+static const quint32 SNAPSHOT_MAGIC_NUMBER = 0x4154524E;
+
+/* Increase when changing the snapshot format or any of the Node or Edge structures */
+static const quint32 SNAPSHOT_VERSION = 3;
+
+/* Node as stored in the snapshot file. Index is implicit and edges are stored separately. */
+struct NodeRecord
+{
+  qint32 id, range;
+  float lonX, latY;
+  quint8 type, subtype, con;
+};
+
+/* Assign minimum altitude and maximum altitude if given - otherwise max */
+static void assignAltitudes(Edge& edge, int minAlt, int maxAlt)
+{
+  edge.minAltFt = static_cast<quint16>(std::min(minAlt, static_cast<int>(Edge::MAX_ALTITUDE)));
+
+  if(maxAlt > 0)
+    edge.maxAltFt = static_cast<quint16>(std::min(maxAlt, static_cast<int>(Edge::MAX_ALTITUDE)));
+  else
+    edge.maxAltFt = Edge::MAX_ALTITUDE;
+}
+
 RouteNetworkLoader::RouteNetworkLoader(atools::sql::SqlDatabase *sqlDbNav, atools::sql::SqlDatabase *sqlDbTrack)
   : dbNav(sqlDbNav), dbTrack(sqlDbTrack)
 {
@@ -66,9 +98,25 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
   network = networkParam;
   network->clear();
 
+  QByteArray key;
+  if(!snapshotFile.isEmpty())
+  {
+    key = snapshotKey();
+    if(readSnapshot(key))
+    {
+      qDebug() << Q_FUNC_INFO << "snapshot" << snapshotFile << timer.restart() << "ms" << "nodes" << network->getNodes().size()
+               << "edges" << network->getNumEdges();
+      return;
+    }
+  }
+
   bool hasTracks = dbTrack != nullptr && SqlUtil(dbTrack).hasTableAndRows("track");
   bool hasNav = dbNav != nullptr && SqlUtil(dbNav).hasTableAndRows("waypoint");
 
+  // Measures reading from database separately
+  QElapsedTimer queryTimer;
+  queryTimer.start();
+
   if(network->source == SOURCE_RADIO && dbNav != nullptr)
   {
     // Load VOR, VORDME and VORTAC. No DME and no TACAN. ==========================================
@@ -78,6 +126,8 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
 
     // Load all NDB =================================================
     readNodesRadio("select n.ndb_id, n.lonx, n.laty, n.range, null as has_dme from ndb n", false);
+
+    qDebug() << Q_FUNC_INFO << "radio nodes read in" << queryTimer.elapsed() << "ms";
   }
   else if(network->source == SOURCE_AIRWAY)
   {
@@ -96,6 +146,8 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
     if(hasTracks)
       readEdgesAirway(nodeEdgeMap, true /* track */);
 
+    qDebug() << Q_FUNC_INFO << "edges read in" << queryTimer.restart() << "ms";
+
     // Maps the database node id to index position in list
     QHash<int, int> nodeIdIndexMap;
     nodeIdIndexMap.reserve(300000);
@@ -161,19 +213,26 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
                       "where w.type = 'N' and (w.num_jet_airway > 0 or w.num_victor_airway > 0)",
                       false, true /* NDB */, false, false);
 
-    // Insert outgoing edges to each node and copy node to the index ========================
+    qDebug() << Q_FUNC_INFO << "nodes read in" << queryTimer.restart() << "ms";
+
+    // Copy outgoing edges of each node into one contiguous array and copy node to the index ========================
     network->nodeIndex.reserve(nodeList.size());
-    for(Node& node : nodeList)
+    network->edgeOffsets.reserve(nodeList.size() + 1);
+    network->edges.reserve(nodeEdgeMap.size());
+    for(const Node& node : std::as_const(nodeList))
     {
+      network->edgeOffsets.append(network->edges.size());
       for(auto it = nodeEdgeMap.find(node.id); it != nodeEdgeMap.end() && it.key() == node.id; ++it)
-        node.edges.append(it.value());
-
-      // Replace database ids in Edge::toIndex with array indexes
-      for(Edge& edge : node.edges)
+      {
+        // Replace database ids in Edge::toIndex with array indexes
+        Edge edge = it.value();
         edge.toIndex = nodeIdIndexMap.value(edge.toIndex);
+        network->edges.append(edge);
+      }
 
       network->nodeIndex.append(node);
     }
+    network->edgeOffsets.append(network->edges.size());
   } // else if(network->source == SOURCE_AIRWAY)
 
   // Update spatial index
@@ -183,8 +242,12 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
   for(Node& node : network->nodeIndex)
   {
     atools::routing::NodeConnections connections = CONNECTION_NONE;
-    for(Edge& edge : node.edges)
+    int edgesBegin = network->edgeOffsets.isEmpty() ? 0 : network->edgeOffsets.at(node.index);
+    int edgesEnd = network->edgeOffsets.isEmpty() ? 0 : network->edgeOffsets.at(node.index + 1);
+    for(int edgeIndex = edgesBegin; edgeIndex < edgesEnd; edgeIndex++)
     {
+      Edge& edge = network->edges[edgeIndex];
+
       // Fill connection flags based on outgoing edges
       switch(edge.type)
       {
@@ -216,11 +279,254 @@ void RouteNetworkLoader::load(atools::routing::RouteNetwork *networkParam)
     node.setConnections(connections);
   }
 
+  // Build incoming edges for backward search
+  network->updateReverseEdges();
+
   // Assign CONNECTION_TRACK_START_END to all nodes which are track end or start points
   if(hasTracks)
     readTrackStartEndPoints();
 
-  qDebug() << Q_FUNC_INFO << timer.restart() << "ms" << "nodes" << network->getNodes().size();
+  if(numLandmarks > 0 && network->isAirwayRouting())
+  {
+    network->updateLandmarks(numLandmarks);
+    qDebug() << Q_FUNC_INFO << "landmarks" << network->landmarkIndexes.size() << timer.restart() << "ms";
+  }
+
+  qDebug() << Q_FUNC_INFO << timer.restart() << "ms" << "nodes" << network->getNodes().size()
+           << "edges" << network->getNumEdges() << "memory" << network->getMemoryUsage() / 1024 << "kB";
+
+  if(!snapshotFile.isEmpty())
+    writeSnapshot(key);
+}
+
+QByteArray RouteNetworkLoader::snapshotKey() const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray::number(SNAPSHOT_VERSION));
+  hash.addData(QByteArray::number(network->source));
+  hash.addData(QByteArray::number(numLandmarks));
+
+  // Add all metadata values which contain load time, cycle and version numbers
+  if(dbNav != nullptr)
+  {
+    hash.addData(dbNav->databaseName().toUtf8());
+
+    if(SqlUtil(dbNav).hasTable("metadata"))
+    {
+      SqlQuery query("select * from metadata limit 1", dbNav);
+      query.exec();
+      if(query.next())
+      {
+        for(int i = 0; i < query.record().count(); i++)
+          hash.addData(query.value(i).toString().toUtf8());
+      }
+    }
+  }
+
+  // Tracks change with every download
+  if(dbTrack != nullptr && SqlUtil(dbTrack).hasTable("trackmeta"))
+  {
+    SqlQuery query("select count(1), max(trackmeta_id), max(download_timestamp) from trackmeta", dbTrack);
+    query.exec();
+    if(query.next())
+    {
+      for(int i = 0; i < query.record().count(); i++)
+        hash.addData(query.value(i).toString().toUtf8());
+    }
+  }
+
+  return hash.result();
+}
+
+bool RouteNetworkLoader::readSnapshot(const QByteArray& key)
+{
+  QFile file(snapshotFile);
+  if(!file.exists())
+    return false;
+
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open" << snapshotFile << file.errorString();
+    return false;
+  }
+
+  uchar *mapped = file.map(0, file.size());
+  if(mapped == nullptr)
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot map" << snapshotFile << file.errorString();
+    return false;
+  }
+
+  // Read from mapped memory instead of loading the file into a buffer first.
+  // Records are still copied into the network lists below.
+  QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), file.size());
+  QDataStream in(bytes);
+  in.setVersion(QDataStream::Qt_5_5);
+
+  quint32 magicNumber, version;
+  QByteArray fileKey;
+  qint32 edgeSize, source, numNodes, numOffsets, numEdges;
+  in >> magicNumber >> version >> fileKey >> edgeSize >> source >> numNodes >> numOffsets >> numEdges;
+
+  // Check counts before allocating memory
+  qint64 remaining = bytes.size() - in.device()->pos();
+  bool countsValid = numNodes >= 0 && numEdges >= 0 && (numOffsets == static_cast<qint64>(numNodes) + 1 || (numOffsets == 0 && numEdges == 0)) &&
+                     static_cast<qint64>(numNodes) * static_cast<qint64>(sizeof(NodeRecord)) +
+                     static_cast<qint64>(numOffsets) * static_cast<qint64>(sizeof(int)) +
+                     static_cast<qint64>(numEdges) * static_cast<qint64>(sizeof(Edge)) <= remaining;
+
+  bool ok = false;
+  if(in.status() != QDataStream::Ok || magicNumber != SNAPSHOT_MAGIC_NUMBER || version != SNAPSHOT_VERSION)
+    qWarning() << Q_FUNC_INFO << "Invalid snapshot file" << snapshotFile;
+  else if(fileKey != key || edgeSize != static_cast<qint32>(sizeof(Edge)) || source != network->source)
+    qInfo() << Q_FUNC_INFO << "Outdated snapshot file" << snapshotFile;
+  else if(!countsValid)
+    qWarning() << Q_FUNC_INFO << "Invalid counts in snapshot file" << snapshotFile << "nodes" << numNodes
+               << "offsets" << numOffsets << "edges" << numEdges << "remaining bytes" << remaining;
+  else
+  {
+    ok = readSnapshotData(in, numNodes, numOffsets, numEdges);
+
+    if(ok)
+    {
+      // KD-tree is built from the node positions which is fast compared to the database queries
+      network->nodeIndex.updateIndex();
+      network->updateReverseEdges();
+    }
+    else
+    {
+      qWarning() << Q_FUNC_INFO << "Truncated or invalid snapshot file" << snapshotFile;
+      network->clear();
+    }
+  }
+
+  file.unmap(mapped);
+  file.close();
+  return ok;
+}
+
+/* Read raw array and check for truncation */
+static bool readRaw(QDataStream& in, void *data, qint64 size)
+{
+  return size == 0 || in.readRawData(reinterpret_cast<char *>(data), static_cast<int>(size)) == size;
+}
+
+bool RouteNetworkLoader::readSnapshotData(QDataStream& in, qint32 numNodes, qint32 numOffsets, qint32 numEdges)
+{
+  // Nodes ============================
+  QList<NodeRecord> nodeRecords(numNodes);
+  if(!readRaw(in, nodeRecords.data(), numNodes * static_cast<qint64>(sizeof(NodeRecord))))
+    return false;
+
+  network->nodeIndex.reserve(numNodes);
+  for(const NodeRecord& record : std::as_const(nodeRecords))
+  {
+    Node node;
+    node.index = network->nodeIndex.size();
+    node.id = record.id;
+    node.range = record.range;
+    node.pos = atools::geo::Pos(record.lonX, record.latY);
+    node.type = static_cast<NodeType>(record.type);
+    node.subtype = static_cast<NodeType>(record.subtype);
+    node.con = static_cast<NodeConnection>(record.con);
+    network->nodeIndex.append(node);
+  }
+
+  // Edges ============================
+  network->edgeOffsets.resize(numOffsets);
+  if(!readRaw(in, network->edgeOffsets.data(), numOffsets * static_cast<qint64>(sizeof(int))))
+    return false;
+
+  // Offsets have to start at 0, increase monotonically and end at number of edges
+  if(numOffsets > 0 && (network->edgeOffsets.constFirst() != 0 || network->edgeOffsets.constLast() != numEdges))
+    return false;
+
+  for(int i = 1; i < numOffsets; i++)
+  {
+    if(network->edgeOffsets.at(i) < network->edgeOffsets.at(i - 1))
+      return false;
+  }
+
+  network->edges.resize(numEdges);
+  if(!readRaw(in, network->edges.data(), numEdges * static_cast<qint64>(sizeof(Edge))))
+    return false;
+
+  for(const Edge& edge : std::as_const(network->edges))
+  {
+    if(edge.toIndex < 0 || edge.toIndex >= numNodes)
+      return false;
+  }
+
+  // Track altitude levels ============================
+  in >> network->altLevelsEast >> network->altLevelsWest;
+
+  // Landmark distances ============================
+  in >> network->landmarkIndexes;
+  if(in.status() != QDataStream::Ok)
+    return false;
+
+  for(int index : std::as_const(network->landmarkIndexes))
+  {
+    if(index < 0 || index >= numNodes)
+      return false;
+  }
+
+  qint64 numDistances = static_cast<qint64>(network->landmarkIndexes.size()) * numNodes;
+  qint64 distanceBytes = numDistances * static_cast<qint64>(sizeof(float));
+  if(distanceBytes * 2 > in.device()->size() - in.device()->pos())
+    return false;
+
+  network->landmarkFromDistArr.resize(numDistances);
+  network->landmarkToDistArr.resize(numDistances);
+  if(!readRaw(in, network->landmarkFromDistArr.data(), distanceBytes) || !readRaw(in, network->landmarkToDistArr.data(), distanceBytes))
+    return false;
+
+  return in.status() == QDataStream::Ok;
+}
+
+void RouteNetworkLoader::writeSnapshot(const QByteArray& key) const
+{
+  // Write to temporary file and rename when done
+  QSaveFile file(snapshotFile);
+  if(file.open(QIODevice::WriteOnly))
+  {
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_5);
+
+    const QList<Node>& nodes = network->getNodes();
+    out << SNAPSHOT_MAGIC_NUMBER << SNAPSHOT_VERSION << key << static_cast<qint32>(sizeof(Edge))
+        << static_cast<qint32>(network->source) << static_cast<qint32>(nodes.size())
+        << static_cast<qint32>(network->edgeOffsets.size()) << static_cast<qint32>(network->edges.size());
+
+    // Nodes ============================
+    QList<NodeRecord> nodeRecords;
+    nodeRecords.reserve(nodes.size());
+    for(const Node& node : nodes)
+      nodeRecords.append({node.id, node.range, node.pos.getLonX(), node.pos.getLatY(),
+                          static_cast<quint8>(node.type), static_cast<quint8>(node.subtype), static_cast<quint8>(node.con)});
+    out.writeRawData(reinterpret_cast<const char *>(nodeRecords.constData()), nodeRecords.size() * static_cast<int>(sizeof(NodeRecord)));
+
+    // Edges ============================
+    out.writeRawData(reinterpret_cast<const char *>(network->edgeOffsets.constData()),
+                     network->edgeOffsets.size() * static_cast<int>(sizeof(int)));
+    out.writeRawData(reinterpret_cast<const char *>(network->edges.constData()),
+                     network->edges.size() * static_cast<int>(sizeof(Edge)));
+
+    // Track altitude levels ============================
+    out << network->altLevelsEast << network->altLevelsWest;
+
+    // Landmark distances ============================
+    out << network->landmarkIndexes;
+    out.writeRawData(reinterpret_cast<const char *>(network->landmarkFromDistArr.constData()),
+                     network->landmarkFromDistArr.size() * static_cast<int>(sizeof(float)));
+    out.writeRawData(reinterpret_cast<const char *>(network->landmarkToDistArr.constData()),
+                     network->landmarkToDistArr.size() * static_cast<int>(sizeof(float)));
+
+    if(out.status() != QDataStream::Ok || !file.commit())
+      qWarning() << Q_FUNC_INFO << "Cannot write" << snapshotFile << file.errorString();
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "Cannot open" << snapshotFile << file.errorString();
 }
 
 void RouteNetworkLoader::readTrackStartEndPoints() const
@@ -287,78 +593,101 @@ void RouteNetworkLoader::readEdgesAirway(QMultiHash<int, Edge>& nodeEdgeMap, boo
   };
 
   SqlQuery query(queryTxt, track ? dbTrack : dbNav);
+  query.setForwardOnly(true);
   query.exec();
-  while(query.next())
-  {
-    Edge edge;
-    edge.id = query.valueInt(ID);
-
-    edge.minAltFt = static_cast<quint16>(std::min(query.valueInt(MIN), static_cast<int>(Edge::MAX_ALTITUDE)));
-
-    // Assign max altitude if given - otherwise max
-    if(query.valueInt(MAX) > 0)
-      edge.maxAltFt = static_cast<quint16>(std::min(query.valueInt(MAX), static_cast<int>(Edge::MAX_ALTITUDE)));
-    else
-      edge.maxAltFt = Edge::MAX_ALTITUDE;
 
-    // From and to waypoint ids
-    int fromId = query.valueInt(FROM);
-    int toId = query.valueInt(TO);
-
-    if(!track)
+  if(!track)
+  {
+    // Read navdata airways in chunks by column ======================================
+    atools::sql::SqlColumnBatch batch;
+    int idIdx = batch.addInt(ID), fromIdx = batch.addInt(FROM), toIdx = batch.addInt(TO);
+    int minIdx = batch.addInt(MIN), maxIdx = batch.addInt(MAX);
+    int nameIdx = batch.addStr(NAME), routeTypeIdx = batch.addStr(ROUTE_TYPE), airwayTypeIdx = batch.addStr(AIRWAY_TYPE),
+        directionIdx = batch.addStr(DIRECTION);
+
+    int rows;
+    while((rows = query.fetchColumns(batch, FETCH_ROWS)) > 0)
     {
-      // Assign route type ======================================
-      QString typeStr = query.valueStr(AIRWAY_TYPE);
-      edge.airwayHash = airwayHash(query.valueStr(NAME));
-      char routeType = atools::strToChar(query.valueStr(ROUTE_TYPE));
-      if(routeType == 'A')
-        edge.routeType = AIRLINE; /* A Airline Airway (Tailored Data) */
-      else if(routeType == 'C')
-        edge.routeType = CONTROL; /* C Control */
-      else if(routeType == 'D')
-        edge.routeType = DIRECT; /* D Direct Route */
-      else if(routeType == 'H')
-        edge.routeType = HELICOPTER; /* H Helicopter Airways */
-      else if(routeType == 'O')
-        edge.routeType = OFFICIAL; /* O Officially Designated Airways, except RNAV, Helicopter Airways */
-      else if(routeType == 'R')
-        edge.routeType = RNAV; /* R RNAV Airways */
-      else if(routeType == 'S')
-        edge.routeType = UNDESIGNATED; /* S Undesignated ATS Route */
-      else
-        edge.routeType = NO_ROUTE_TYPE;
-
-      // Assign airway type ======================================
-      char type = atools::strToChar(typeStr);
-      if(type == 'J')
-        edge.type = EDGE_JET;
-      else if(type == 'V')
-        edge.type = EDGE_VICTOR;
-      else if(type == 'B')
-        edge.type = EDGE_BOTH;
-
-      // Assign towards node ======================================
-      // Add one edge for each allowed direction
-      char dir = atools::strToChar(query.valueStr(DIRECTION));
-
-      if(dir == '\0' || dir == 'F' || dir == 'N')
-      {
-        // Forward or both directions allowed
-        // Use id temporarily - will be replaced with index later
-        edge.toIndex = toId;
-        nodeEdgeMap.insert(fromId, edge);
-      }
+      const QList<int>& ids = batch.ints(idIdx), & fromIds = batch.ints(fromIdx), & toIds = batch.ints(toIdx),
+      & minAlts = batch.ints(minIdx), & maxAlts = batch.ints(maxIdx);
+      const QStringList& names = batch.strs(nameIdx), & routeTypes = batch.strs(routeTypeIdx),
+      & airwayTypes = batch.strs(airwayTypeIdx), & directions = batch.strs(directionIdx);
 
-      if(dir == '\0' || dir == 'B' || dir == 'N')
+      for(int row = 0; row < rows; row++)
       {
-        // Backward or both directions allowed
-        // Use id temporarily - will be replaced with index later
-        edge.toIndex = fromId;
-        nodeEdgeMap.insert(toId, edge);
-      }
-    }
-    else
+        Edge edge;
+        edge.id = ids.at(row);
+        assignAltitudes(edge, minAlts.at(row), maxAlts.at(row));
+
+        // From and to waypoint ids
+        int fromId = fromIds.at(row);
+        int toId = toIds.at(row);
+
+        // Assign route type ======================================
+        edge.airwayHash = airwayHash(names.at(row));
+        char routeType = atools::strToChar(routeTypes.at(row));
+        if(routeType == 'A')
+          edge.routeType = AIRLINE; /* A Airline Airway (Tailored Data) */
+        else if(routeType == 'C')
+          edge.routeType = CONTROL; /* C Control */
+        else if(routeType == 'D')
+          edge.routeType = DIRECT; /* D Direct Route */
+        else if(routeType == 'H')
+          edge.routeType = HELICOPTER; /* H Helicopter Airways */
+        else if(routeType == 'O')
+          edge.routeType = OFFICIAL; /* O Officially Designated Airways, except RNAV, Helicopter Airways */
+        else if(routeType == 'R')
+          edge.routeType = RNAV; /* R RNAV Airways */
+        else if(routeType == 'S')
+          edge.routeType = UNDESIGNATED; /* S Undesignated ATS Route */
+        else
+          edge.routeType = NO_ROUTE_TYPE;
+
+        // Assign airway type ======================================
+        char type = atools::strToChar(airwayTypes.at(row));
+        if(type == 'J')
+          edge.type = EDGE_JET;
+        else if(type == 'V')
+          edge.type = EDGE_VICTOR;
+        else if(type == 'B')
+          edge.type = EDGE_BOTH;
+
+        // Assign towards node ======================================
+        // Add one edge for each allowed direction
+        char dir = atools::strToChar(directions.at(row));
+
+        if(dir == '\0' || dir == 'F' || dir == 'N')
+        {
+          // Forward or both directions allowed
+          // Use id temporarily - will be replaced with index later
+          edge.toIndex = toId;
+          nodeEdgeMap.insert(fromId, edge);
+        }
+
+        if(dir == '\0' || dir == 'B' || dir == 'N')
+        {
+          // Backward or both directions allowed
+          // Use id temporarily - will be replaced with index later
+          edge.toIndex = fromId;
+          nodeEdgeMap.insert(toId, edge);
+        }
+      } // for(int row = 0; row < rows; row++)
+      batch.clearValues();
+    } // while(fetchColumns)
+  }
+  else
+  {
+    // Read few tracks by row because of the altitude level arrays ======================================
+    while(query.next())
     {
+      Edge edge;
+      edge.id = query.valueInt(ID);
+      assignAltitudes(edge, query.valueInt(MIN), query.valueInt(MAX));
+
+      // From and to waypoint ids
+      int fromId = query.valueInt(FROM);
+      int toId = query.valueInt(TO);
+
       // Calculate hash including type to avoid jumping between tracks
       edge.airwayHash = trackHash(query.valueStr(NAME), query.valueStr(TRACK_TYPE));
 
@@ -388,8 +717,8 @@ void RouteNetworkLoader::readEdgesAirway(QMultiHash<int, Edge>& nodeEdgeMap, boo
       edge.toIndex = toId;
 
       nodeEdgeMap.insert(fromId, edge);
-    }
-  } // while(query.next())
+    } // while(query.next())
+  }
 }
 
 void RouteNetworkLoader::readNodesAirway(QList<Node>& nodes, QHash<int, int>& nodeIdIndexMap,
@@ -437,67 +766,85 @@ void RouteNetworkLoader::readNodesAirway(QList<Node>& nodes, QHash<int, int>& no
   }
 
   SqlQuery query(queryStr, track ? dbTrack : dbNav);
+  query.setForwardOnly(true);
   query.exec();
-  while(query.next())
-  {
-    int nodeId = query.valueInt(ID);
-    if(procNodeIds.contains(nodeId))
-      // Not part of an airway but part of a procedure or part of an airport (terminal waypoint) - ignore
-      continue;
 
-    atools::geo::Pos pos(query.valueFloat(LONX), query.valueFloat(LATY));
+  // Read in chunks by column - optional columns are only added if present in query
+  atools::sql::SqlColumnBatch batch;
+  int idIdx = batch.addInt(ID), identIdx = batch.addStr(IDENT), lonxIdx = batch.addFloat(LONX), latyIdx = batch.addFloat(LATY);
+  int rangeIdx = vor || ndb ? batch.addInt(RANGE) : -1;
+  int radioTypeIdx = vor ? batch.addStr(RADIO_TYPE) : -1, dmeAltNullIdx = vor ? batch.addNull(DME_ALTITUDE) : -1,
+      dmeOnlyIdx = vor ? batch.addInt(DME_ONLY) : -1;
 
-    // No name and grid filter for NDB and VOR waypoints
-    if(!ndb && !vor && filterProc)
-    {
-      // Include all one degree grid confluence points
-      // Ignore half degee points
-      bool ok = pos.nearGrid(1.f, atools::geo::Pos::POS_EPSILON_10M);
-
-      // Check for visual reporting points like "VP123" as well as other obscure numbered points and ignore these
-      // if not confluence points
-      if(!ok)
-      {
-        QString ident = query.valueStr(IDENT);
-        if(charAt(ident, 2).isDigit() && charAt(ident, 3).isDigit() && charAt(ident, 4).isDigit())
-          continue;
-      }
-    } // if(!ndb && !vor)
+  int rows;
+  while((rows = query.fetchColumns(batch, FETCH_ROWS)) > 0)
+  {
+    const QList<int>& ids = batch.ints(idIdx);
+    const QStringList& idents = batch.strs(identIdx);
+    const QList<float>& lonxs = batch.floats(lonxIdx), & latys = batch.floats(latyIdx);
 
-    Node node;
-    node.index = nodes.size();
-    node.id = nodeId;
-    node.pos = pos;
-    node.type = NODE_WAYPOINT;
+    for(int row = 0; row < rows; row++)
+    {
+      int nodeId = ids.at(row);
+      if(procNodeIds.contains(nodeId))
+        // Not part of an airway but part of a procedure or part of an airport (terminal waypoint) - ignore
+        continue;
 
-    if(vor || ndb)
-      node.range = nmToMeter(query.valueInt(RANGE));
+      atools::geo::Pos pos(lonxs.at(row), latys.at(row));
 
-    if(vor)
-    {
-      // Query uses VOR table ====================
-      QString vortype = query.valueStr(RADIO_TYPE);
-      if(vortype == "H" || vortype == "L" || vortype == "T" || vortype.startsWith("VT"))
+      // No name and grid filter for NDB and VOR waypoints
+      if(!ndb && !vor && filterProc)
       {
-        if(query.valueBool(DME_ONLY))
-          node.subtype = NODE_DME;
-        else
-          node.subtype = query.isNull(DME_ALTITUDE) ? NODE_VOR : NODE_VORDME;
+        // Include all one degree grid confluence points
+        // Ignore half degee points
+        bool ok = pos.nearGrid(1.f, atools::geo::Pos::POS_EPSILON_10M);
+
+        // Check for visual reporting points like "VP123" as well as other obscure numbered points and ignore these
+        // if not confluence points
+        if(!ok)
+        {
+          const QString& ident = idents.at(row);
+          if(charAt(ident, 2).isDigit() && charAt(ident, 3).isDigit() && charAt(ident, 4).isDigit())
+            continue;
+        }
+      } // if(!ndb && !vor)
+
+      Node node;
+      node.index = nodes.size();
+      node.id = nodeId;
+      node.pos = pos;
+      node.type = NODE_WAYPOINT;
+
+      if(vor || ndb)
+        node.range = nmToMeter(batch.ints(rangeIdx).at(row));
+
+      if(vor)
+      {
+        // Query uses VOR table ====================
+        const QString& vortype = batch.strs(radioTypeIdx).at(row);
+        if(vortype == "H" || vortype == "L" || vortype == "T" || vortype.startsWith("VT"))
+        {
+          if(batch.ints(dmeOnlyIdx).at(row) != 0)
+            node.subtype = NODE_DME;
+          else
+            node.subtype = batch.nulls(dmeAltNullIdx).at(row) ? NODE_VOR : NODE_VORDME;
+        }
       }
-    }
 
-    if(ndb)
-      // Query uses NDB table ====================
-      node.subtype = NODE_NDB;
+      if(ndb)
+        // Query uses NDB table ====================
+        node.subtype = NODE_NDB;
 
-    // Connection flags are populated later by analyzing edges
+      // Connection flags are populated later by analyzing edges
 
-    if(node.type == NODE_NONE)
-      qWarning() << Q_FUNC_INFO << "No node type" << query.record();
+      if(node.type == NODE_NONE)
+        qWarning() << Q_FUNC_INFO << "No node type" << nodeId;
 
-    nodes.append(node);
-    nodeIdIndexMap.insert(node.id, node.index);
-  } // while(query.next())
+      nodes.append(node);
+      nodeIdIndexMap.insert(node.id, node.index);
+    } // for(int row = 0; row < rows; row++)
+    batch.clearValues();
+  } // while(fetchColumns)
 }
 
 void RouteNetworkLoader::readNodesRadio(const QString& queryStr, bool vor)
@@ -514,18 +861,30 @@ void RouteNetworkLoader::readNodesRadio(const QString& queryStr, bool vor)
   };
 
   SqlQuery query(queryStr, dbNav);
+  query.setForwardOnly(true);
   query.exec();
-  while(query.next())
+
+  // Read all rows by column at once
+  atools::sql::SqlColumnBatch batch;
+  int idIdx = batch.addInt(ID), rangeIdx = batch.addInt(RANGE), hasDmeIdx = batch.addInt(HAS_DME);
+  int lonxIdx = batch.addFloat(LONX), latyIdx = batch.addFloat(LATY);
+  int rows = query.fetchColumns(batch);
+
+  const QList<int>& ids = batch.ints(idIdx), & ranges = batch.ints(rangeIdx), & hasDmes = batch.ints(hasDmeIdx);
+  const QList<float>& lonxs = batch.floats(lonxIdx), & latys = batch.floats(latyIdx);
+
+  network->nodeIndex.reserve(network->nodeIndex.size() + rows);
+  for(int row = 0; row < rows; row++)
   {
     Node node;
     node.index = network->nodeIndex.size();
-    node.id = query.valueInt(ID);
-    node.pos.setLonX(query.valueFloat(LONX));
-    node.pos.setLatY(query.valueFloat(LATY));
-    node.range = nmToMeter(query.valueInt(RANGE));
+    node.id = ids.at(row);
+    node.pos.setLonX(lonxs.at(row));
+    node.pos.setLatY(latys.at(row));
+    node.range = nmToMeter(ranges.at(row));
 
     if(vor)
-      node.type = query.valueBool(HAS_DME) ? NODE_VORDME : NODE_VOR;
+      node.type = hasDmes.at(row) != 0 ? NODE_VORDME : NODE_VOR;
     else
       node.type = NODE_NDB;
 
@@ -20,6 +20,8 @@
 
 #include "routing/routenetworktypes.h"
 
+class QDataStream;
+
 namespace atools {
 namespace sql {
 class SqlDatabase;
@@ -44,9 +46,35 @@ public:
   virtual ~RouteNetworkLoader();
 
   /* Loads network data from databases into memory in RouteNetwork.
-   * Not reentrant. */
+   * Uses the snapshot file if set and valid. Not reentrant. */
   void load(atools::routing::RouteNetwork *networkParam);
 
+  /* Binary snapshot of the loaded network. load() reads this file instead of querying the databases
+   * if the stored key matches the current navdata metadata and track data.
+   * Otherwise the file is written after loading from the databases.
+   * Empty name disables the snapshot which is the default. */
+  void setSnapshotFile(const QString& filename)
+  {
+    snapshotFile = filename;
+  }
+
+  const QString& getSnapshotFile() const
+  {
+    return snapshotFile;
+  }
+
+  /* Number of landmarks to calculate for the ALT heuristic after loading an airway network.
+   * Landmarks are stored in the snapshot file. Default is 0 which disables landmarks. */
+  void setNumLandmarks(int value)
+  {
+    numLandmarks = value;
+  }
+
+  int getNumLandmarks() const
+  {
+    return numLandmarks;
+  }
+
 private:
   /* Read VOR and NDB into index */
   void readNodesRadio(const QString& queryStr, bool vor);
@@ -62,8 +90,23 @@ private:
   /* Reads metadata and adds CONNECTION_TRACK_START_END flag to nodes if they are a start or end of a track. */
   void readTrackStartEndPoints() const;
 
+  /* Build a hash from snapshot format version, network source, navdata metadata and track metadata */
+  QByteArray snapshotKey() const;
+
+  /* Read snapshot file into network. Returns false if the file is missing, invalid or the key does not match. */
+  bool readSnapshot(const QByteArray& key);
+
+  /* Read and validate nodes, edges and landmarks after the snapshot header. Counts are checked against the file size
+   * already. Returns false if data is truncated or offsets and indexes are out of range. */
+  bool readSnapshotData(QDataStream& in, qint32 numNodes, qint32 numOffsets, qint32 numEdges);
+
+  /* Write network into snapshot file */
+  void writeSnapshot(const QByteArray& key) const;
+
   atools::routing::RouteNetwork *network = nullptr;
   atools::sql::SqlDatabase *dbNav = nullptr, *dbTrack = nullptr;
+  QString snapshotFile;
+  int numLandmarks = 0;
 };
 
 } // namespace routing
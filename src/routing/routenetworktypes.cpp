@@ -31,7 +31,6 @@ QDebug operator<<(QDebug out, const Node& obj)
                           << ", type " << nodeTypeToStr(obj.type)
                           << ", subtype " << nodeTypeToStr(obj.subtype)
                           << ", connections " << nodeConnectionsToStr(obj.con)
-                          << ", num edges " << obj.edges.size()
                           << ")";
   return out;
 
@@ -33,7 +33,7 @@ enum DataSource
 };
 
 /* Network mode. Changes which edges and nodes are returned as neighbours. */
-enum Mode : quint8
+enum Mode : quint16
 {
   MODE_NONE = 0,
   MODE_RADIONAV_VOR = 1 << 0, /* VOR/NDB to VOR/NDB */
@@ -49,6 +49,9 @@ enum Mode : quint8
                                 * instead of airport to airport.
                                 * Sets minimum distance at departure to zero. */
 
+  MODE_BIDIRECTIONAL = 1 << 8, /* Search forward from departure and backward from destination in two threads.
+                                * Not a network filter. */
+
   MODE_AIRWAY = MODE_VICTOR | MODE_JET,
   MODE_AIRWAY_WAYPOINT = MODE_VICTOR | MODE_JET | MODE_WAYPOINT,
   MODE_AIRWAY_TRACK = MODE_AIRWAY | MODE_TRACK,
@@ -62,9 +65,13 @@ enum Mode : quint8
   MODE_ALL = MODE_AIRWAY | MODE_NAVAID,
 };
 
-ATOOLS_DECLARE_FLAGS_8(Modes, Mode)
+ATOOLS_DECLARE_FLAGS_16(Modes, Mode)
 ATOOLS_DECLARE_OPERATORS_FOR_FLAGS(atools::routing::Modes)
 
+/* Cost factor to prefer tracks if enabled. This is the only factor below 1.
+ * Used by RouteFinder for edge costs and by RouteNetwork to keep landmark distances a lower bound. */
+const static float COST_FACTOR_TRACK = 0.8f;
+
 /* Type and subtype of a node */
 enum NodeType : unsigned char
 {
@@ -199,8 +206,8 @@ struct Node
                             subtype /* VOR, VORDME, NDB, ... for airway network if type is one of WAYPOINT_* */;
   atools::routing::NodeConnection con; /* Flags indicating all connected airways and tracks */
 
-  QList<Edge> edges; /* Attached outgoing edges on airway only.
-                        * Do not use this since edges are already filtered by the RouteNetwork. */
+  /* Attached outgoing edges on airway networks are stored in RouteNetwork in a compressed sparse row layout.
+   * Use RouteNetwork::getNeighbours() to get filtered edges. */
 
   /* Default unitialized */
   constexpr static int INVALID_INDEX = -1;
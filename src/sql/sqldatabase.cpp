@@ -201,6 +201,22 @@ void SqlDatabase::executePragmas(const QStringList& pragmas)
   checkError(db.transaction(), "SqlDatabase::pragma() error");
 }
 
+QStringList SqlDatabase::getPragmas(const QStringList& pragmas) const
+{
+  QStringList current;
+  for(const QString& pragmaQuery : pragmas)
+  {
+    QString pragma = pragmaQuery.section('=', 0, 0).trimmed();
+
+    QSqlQuery query(db);
+    if(query.exec(pragma) && query.next())
+      current.append(pragma + "=" + query.value(0).toString());
+    else
+      qWarning() << Q_FUNC_INFO << "Cannot read" << pragma << query.lastError().text();
+  }
+  return current;
+}
+
 void SqlDatabase::attachDatabase(const QString& file, const QString& dbName)
 {
   checkError(db.rollback(), "SqlDatabase::attachDatabase() error");
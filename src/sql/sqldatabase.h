@@ -132,6 +132,12 @@ public:
    * Rolls the current transaction back and executes the list of pragmas. Opens transaction again afterwards. */
   void executePragmas(const QStringList& pragmas);
 
+  /* Sqlite only.
+   * Reads the current values for the given pragmas which can be given with or without assignment like
+   * "PRAGMA synchronous=OFF". Returns a list of statements like "PRAGMA synchronous=2" which can be passed to
+   * executePragmas() to restore the values. */
+  QStringList getPragmas(const QStringList& pragmas) const;
+
   bool isAutocommit() const
   {
     return autocommit;
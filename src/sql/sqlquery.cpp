@@ -30,6 +30,19 @@ namespace atools {
 
 namespace sql {
 
+void SqlColumnBatch::clearValues()
+{
+  for(QList<int>& values : intValues)
+    values.clear();
+  for(QList<float>& values : floatValues)
+    values.clear();
+  for(QStringList& values : strValues)
+    values.clear();
+  for(QList<bool>& values : nullValues)
+    values.clear();
+  numRows = 0;
+}
+
 SqlQuery::SqlQuery(QSqlResult *r)
 {
   query = QSqlQuery(r);
@@ -98,10 +111,11 @@ bool SqlQuery::isNull(const QString& name) const
   checkError(isValid(), QLatin1String(Q_FUNC_INFO) % " on invalid query");
   checkError(isActive(), QLatin1String(Q_FUNC_INFO) % " on inactive query");
 
-  if(!query.record().contains(name))
+  int index = columnIndexInternal(name);
+  if(index == -1)
     throw SqlException(this, QLatin1String(Q_FUNC_INFO) % ": Value name \"" % name % "\" does not exist in query \"" % queryString % "\"");
 
-  return query.isNull(name);
+  return query.isNull(index);
 }
 
 int SqlQuery::at() const
@@ -157,6 +171,7 @@ void SqlQuery::setForwardOnly(bool forward)
 void SqlQuery::exec(const QString& queryStr)
 {
   queryString = queryStr;
+  columnIndexes.clear();
   checkError(query.exec(queryStr), QLatin1String(Q_FUNC_INFO) % ": Error executing query");
 
   if(db->isAutocommit())
@@ -178,7 +193,8 @@ QVariant SqlQuery::value(const QString& name) const
 {
   checkError(isValid(), QLatin1String(Q_FUNC_INFO) % " on invalid query");
   checkError(isActive(), QLatin1String(Q_FUNC_INFO) % " on inactive query");
-  QVariant retval = query.value(name);
+  int index = columnIndexInternal(name);
+  QVariant retval = index != -1 ? query.value(index) : QVariant();
   if(!retval.isValid())
     throw SqlException(this, QLatin1String(Q_FUNC_INFO) % ": Value name \"" % name % "\" does not exist in query \"" % queryString % "\"");
   return retval;
@@ -188,7 +204,63 @@ bool SqlQuery::hasField(const QString& name) const
 {
   checkError(isValid(), QLatin1String(Q_FUNC_INFO) % " on invalid query");
   checkError(isActive(), QLatin1String(Q_FUNC_INFO) % " on inactive query");
-  return query.record().contains(name);
+  return columnIndexInternal(name) != -1;
+}
+
+int SqlQuery::columnIndex(const QString& name) const
+{
+  checkError(isActive(), QLatin1String(Q_FUNC_INFO) % " on inactive query");
+  return columnIndexInternal(name);
+}
+
+int SqlQuery::columnIndexInternal(const QString& name) const
+{
+  auto it = columnIndexes.constFind(name);
+  if(it != columnIndexes.constEnd())
+    return it.value();
+
+  // Get record only once for each name - indexOf() is case insensitive
+  int index = static_cast<int>(query.record().indexOf(name));
+  columnIndexes.insert(name, index);
+  return index;
+}
+
+int SqlQuery::fetchColumns(SqlColumnBatch& batch, int maxRows)
+{
+  checkError(isSelect(), QLatin1String(Q_FUNC_INFO) % " on query which is not a select");
+  checkError(isActive(), QLatin1String(Q_FUNC_INFO) % " on inactive query");
+
+  // Check column indexes once
+  int numColumns = query.record().count();
+  for(const QList<int> *columns : {&batch.intColumns, &batch.floatColumns, &batch.strColumns, &batch.nullColumns})
+  {
+    for(int column : *columns)
+    {
+      if(column < 0 || column >= numColumns)
+        throw SqlException(this, QLatin1String(Q_FUNC_INFO) % ": Value index " % QString::number(column) %
+                           " does not exist in query \"" % queryString % "\"");
+    }
+  }
+
+  int rows = 0;
+  while((maxRows == -1 || rows < maxRows) && query.next())
+  {
+    for(int i = 0; i < batch.intColumns.size(); i++)
+      batch.intValues[i].append(query.value(batch.intColumns.at(i)).toInt());
+
+    for(int i = 0; i < batch.floatColumns.size(); i++)
+      batch.floatValues[i].append(query.value(batch.floatColumns.at(i)).toFloat());
+
+    for(int i = 0; i < batch.strColumns.size(); i++)
+      batch.strValues[i].append(query.value(batch.strColumns.at(i)).toString());
+
+    for(int i = 0; i < batch.nullColumns.size(); i++)
+      batch.nullValues[i].append(query.isNull(batch.nullColumns.at(i)));
+    rows++;
+  }
+
+  batch.numRows += rows;
+  return rows;
 }
 
 void SqlQuery::setNumericalPrecisionPolicy(QSql::NumericalPrecisionPolicy precisionPolicy)
@@ -238,6 +310,7 @@ bool SqlQuery::last()
 
 void SqlQuery::clear()
 {
+  columnIndexes.clear();
   query.clear();
 }
 
@@ -274,6 +347,7 @@ void SqlQuery::exec()
   qDebug() << Q_FUNC_INFO << boundValuesAsString();
 #endif
 
+  columnIndexes.clear();
   checkError(query.exec(), QLatin1String(Q_FUNC_INFO) % ": Error executing query");
   if(db->isAutocommit())
     db->commit();
@@ -290,6 +364,7 @@ void SqlQuery::execBatch(QSqlQuery::BatchExecutionMode mode)
 void SqlQuery::prepare(const QString& queryStr)
 {
   queryString = queryStr;
+  columnIndexes.clear();
   checkError(query.prepare(queryStr), QLatin1String(Q_FUNC_INFO) % ": Error executing prepare");
 
   // Extract named or positional bindings
@@ -541,6 +616,7 @@ void SqlQuery::finish()
 
 bool SqlQuery::nextResult()
 {
+  columnIndexes.clear();
   return query.nextResult();
 }
 
@@ -22,6 +22,7 @@
 #include "sql/sqltypes.h"
 
 #include <QDateTime>
+#include <QHash>
 #include <QSet>
 #include <QSqlQuery>
 #include <QVariant>
@@ -34,12 +35,96 @@ namespace sql {
 class SqlDatabase;
 class SqlRecord;
 
+/*
+ * Column buffers for SqlQuery::fetchColumns(). Add the columns to read by result index and type
+ * before fetching. Values of each column are appended to a separate list in row order.
+ *
+ * Values are still converted from the QVariant returned by the Qt driver. The batch avoids the query state checks,
+ * name lookups and record copies per value. Read large results in chunks to keep the lists small.
+ */
+class SqlColumnBatch
+{
+public:
+  /* Add column to read. Returns the index of the value list for the respective type. */
+  int addInt(int column)
+  {
+    intColumns.append(column);
+    intValues.append(QList<int>());
+    return static_cast<int>(intColumns.size() - 1);
+  }
+
+  int addFloat(int column)
+  {
+    floatColumns.append(column);
+    floatValues.append(QList<float>());
+    return static_cast<int>(floatColumns.size() - 1);
+  }
+
+  int addStr(int column)
+  {
+    strColumns.append(column);
+    strValues.append(QStringList());
+    return static_cast<int>(strColumns.size() - 1);
+  }
+
+  /* Stores true if the value is null */
+  int addNull(int column)
+  {
+    nullColumns.append(column);
+    nullValues.append(QList<bool>());
+    return static_cast<int>(nullColumns.size() - 1);
+  }
+
+  /* Values for index as returned by the add methods */
+  const QList<int>& ints(int index) const
+  {
+    return intValues.at(index);
+  }
+
+  const QList<float>& floats(int index) const
+  {
+    return floatValues.at(index);
+  }
+
+  const QStringList& strs(int index) const
+  {
+    return strValues.at(index);
+  }
+
+  const QList<bool>& nulls(int index) const
+  {
+    return nullValues.at(index);
+  }
+
+  /* Number of rows read */
+  int size() const
+  {
+    return numRows;
+  }
+
+  /* Clear values but keep columns */
+  void clearValues();
+
+private:
+  friend class SqlQuery;
+
+  QList<int> intColumns, floatColumns, strColumns, nullColumns;
+  QList<QList<int> > intValues;
+  QList<QList<float> > floatValues;
+  QList<QStringList> strValues;
+  QList<QList<bool> > nullValues;
+  int numRows = 0;
+};
+
 /*
  * Wrapper around QSqlQuery that adds exceptions to avoid plenty of
  * boilerplate coding. In case of error or invalid connections SqlException
  * is thrown.
  * Exception is also thrown if a bind() or value() receive an invalid
  * name or index.
+ *
+ * Column names are resolved to indexes once per executed query and cached. Use index based access
+ * or fetchColumns() in tight loops to avoid the name lookup completely.
  */
 class SqlQuery
 {
@@ -74,6 +159,15 @@ public:
   QVariant value(const QString& name) const;
   bool hasField(const QString& name) const;
 
+  /* Index of column name in current result. Comparison is case insensitive. -1 if not found.
+   * Resolved once and cached until the next exec(). Throws exception if query is not active. */
+  int columnIndex(const QString& name) const;
+
+  /* Read all remaining rows or at most maxRows if not -1 and append the values of the columns in batch to its lists.
+   * Query state is checked only once and values are fetched by index. Returns number of rows read which is 0 at
+   * the end of the result. Use setForwardOnly(true) before exec() to avoid caching of rows in the driver. */
+  int fetchColumns(atools::sql::SqlColumnBatch& batch, int maxRows = -1);
+
   /* Typed getters. Throw exception if value does not exist as field. */
   QString valueStr(int i) const
   {
@@ -290,12 +384,18 @@ private:
   void checkPos(const QString& funcInfo, int pos) const;
   void checkValues(const QString& funcInfo, const QVariantList& values) const;
 
+  /* Resolve name without checking query state */
+  int columnIndexInternal(const QString& name) const;
+
   QSqlQuery query;
   QString queryString;
   QStringList placeholderList;
   QSet<QString> placeholderSet;
   bool positionalPlaceholders = false;
 
+  /* Cache for column name to index. Includes names not found having index -1. Cleared on exec(). */
+  mutable QHash<QString, int> columnIndexes;
+
   atools::sql::SqlDatabase *db = nullptr;
 };
 
@@ -5,15 +5,295 @@
 
 #include "template.h"
 #include <QFileInfo>
-#include <QStringEncoder>
+#include <QStringDecoder>
+
+#include <algorithm>
 
 using namespace stefanfrings;
 
+// ===============================================================================
+// CompiledTemplate
+
+CompiledTemplate::CompiledTemplate(const QString& sourceText, const QString& sourceName)
+  : source(sourceText)
+{
+  /** Open block while parsing */
+  struct Block
+  {
+    /** Index of the block token */
+    int index;
+
+    /** Name with loop indexes replaced by '#' */
+    QString generic;
+  };
+  QList<Block> blocks;
+
+  // Get name with loop indexes of all enclosing loops replaced by '#'
+  auto genericName = [this, &blocks](const QString& name) -> QString {
+                       QString generic = name;
+                       for(const Block& block : std::as_const(blocks))
+                       {
+                         if(tokens.at(block.index).type == LOOP && generic.startsWith(block.generic) &&
+                            generic.size() > block.generic.size() && generic.at(block.generic.size()) == '.')
+                           generic = block.generic + '#' + generic.mid(block.generic.size());
+                       }
+                       return generic;
+                     };
+
+  // Turn an unterminated block back into literal text
+  auto flattenBlock = [this, &sourceName](const Block& block) -> void {
+                        Token& token = tokens[block.index];
+                        qWarning("Template: missing end tag for %s in %s", qPrintable(token.text),
+                                 qPrintable(sourceName));
+
+                        if(token.elseIndex >= 0)
+                        {
+                          Token& elseToken = tokens[token.elseIndex];
+                          QString tag;
+                          appendTag(tag, ELSE, elseToken.text);
+                          elseToken.type = TEXT;
+                          elseToken.text = tag;
+                        }
+
+                        QString tag;
+                        appendTag(tag, token.type, token.text);
+                        token.type = TEXT;
+                        token.text = tag;
+                        token.elseIndex = token.endIndex = -1;
+                      };
+
+  const qsizetype size = source.size();
+  const QChar *chars = source.constData();
+  qsizetype pos = 0, textStart = 0;
+
+  // Add literal text from textStart up to the given position
+  auto flushText = [this, &textStart](qsizetype end) -> void {
+                     if(end > textStart)
+                       tokens.append(Token{TEXT, source.mid(textStart, end - textStart), -1, -1});
+                   };
+
+  while(pos < size)
+  {
+    qsizetype open = source.indexOf('{', pos);
+    if(open < 0)
+      break;
+
+    // Find closing brace - a nested opening brace starts a new candidate
+    qsizetype close = open + 1;
+    while(close < size && chars[close] != '}' && chars[close] != '{')
+      close++;
+
+    if(close >= size)
+      break;
+
+    pos = close;
+    if(chars[close] == '{')
+      continue;
+
+    pos = close + 1;
+    QStringView content(chars + open + 1, close - open - 1);
+
+    // Classify tag ===========================================
+    TokenType type = TEXT;
+    bool end = false;
+    qsizetype nameStart = 0;
+    if(content.startsWith(u"if "))
+    {
+      type = IF;
+      nameStart = 3;
+    }
+    else if(content.startsWith(u"ifnot "))
+    {
+      type = IFNOT;
+      nameStart = 6;
+    }
+    else if(content.startsWith(u"loop "))
+    {
+      type = LOOP;
+      nameStart = 5;
+    }
+    else if(content.startsWith(u"else "))
+    {
+      type = ELSE;
+      nameStart = 5;
+    }
+    else if(content.startsWith(u"end "))
+    {
+      end = true;
+      nameStart = 4;
+    }
+    else if(std::none_of(content.begin(), content.end(), [](QChar c) -> bool {
+        return c.isSpace();
+      }))
+      type = VARIABLE;
+
+    QString name = content.mid(nameStart).toString();
+    if((type == TEXT && !end) || name.isEmpty())
+      // Not a tag - keep as text
+      continue;
+
+    if(end)
+    {
+      // Find the matching block - ignore the end tag if there is none
+      int match = static_cast<int>(blocks.size()) - 1;
+      while(match >= 0 && tokens.at(blocks.at(match).index).text != name)
+        match--;
+
+      if(match < 0)
+        continue;
+
+      flushText(open);
+      while(blocks.size() - 1 > match)
+        flattenBlock(blocks.takeLast());
+
+      Block block = blocks.takeLast();
+      Token& token = tokens[block.index];
+      token.endIndex = static_cast<int>(tokens.size());
+      if(token.type == LOOP)
+        loopCounts.add(block.generic);
+      else
+        conditionCounts.add(block.generic);
+    }
+    else if(type == ELSE)
+    {
+      // Else is only valid once directly in a block with the same name
+      if(blocks.isEmpty() || tokens.at(blocks.constLast().index).text != name ||
+         tokens.at(blocks.constLast().index).elseIndex >= 0)
+        continue;
+
+      flushText(open);
+      tokens[blocks.constLast().index].elseIndex = static_cast<int>(tokens.size());
+      tokens.append(Token{ELSE, name, -1, -1});
+    }
+    else if(type == VARIABLE)
+    {
+      flushText(open);
+      variableCounts.add(genericName(name));
+      tokens.append(Token{VARIABLE, name, -1, -1});
+    }
+    else
+    {
+      // Start of block
+      flushText(open);
+      QString generic = genericName(name);
+      blocks.append(Block{static_cast<int>(tokens.size()), generic});
+      tokens.append(Token{type, name, -1, -1});
+    }
+    textStart = pos;
+  }
+  flushText(size);
+
+  while(!blocks.isEmpty())
+    flattenBlock(blocks.takeLast());
+
+  memorySize = source.size();
+  for(const Token& token : std::as_const(tokens))
+  {
+    if(token.type == TEXT)
+      textSize += token.text.size();
+    memorySize += token.text.size();
+  }
+}
+
+int CompiledTemplate::countVariables(const QString& name) const
+{
+  return variableCounts.count(name);
+}
+
+int CompiledTemplate::countConditions(const QString& name) const
+{
+  return conditionCounts.count(name);
+}
+
+int CompiledTemplate::countLoops(const QString& name) const
+{
+  return loopCounts.count(name);
+}
+
+void CompiledTemplate::appendTag(QString& out, TokenType type, const QString& name)
+{
+  switch(type)
+  {
+    case TEXT:
+    case VARIABLE:
+      out.append(u"{");
+      break;
+    case IF:
+      out.append(u"{if ");
+      break;
+    case IFNOT:
+      out.append(u"{ifnot ");
+      break;
+    case LOOP:
+      out.append(u"{loop ");
+      break;
+    case ELSE:
+      out.append(u"{else ");
+      break;
+  }
+  out.append(name).append(u'}');
+}
+
+void CompiledTemplate::TagCounts::add(const QString& generic)
+{
+  if(generic.contains('#'))
+  {
+    for(std::pair<QString, int>& entry : numbered)
+    {
+      if(entry.first == generic)
+      {
+        entry.second++;
+        return;
+      }
+    }
+    numbered.append(std::make_pair(generic, 1));
+  }
+  else
+    plain[generic]++;
+}
+
+int CompiledTemplate::TagCounts::count(const QString& name) const
+{
+  int count = plain.value(name, 0);
+  for(const std::pair<QString, int>& entry : numbered)
+  {
+    if(matchNumbered(entry.first, name))
+      count += entry.second;
+  }
+  return count;
+}
+
+bool CompiledTemplate::matchNumbered(const QString& generic, const QString& name)
+{
+  qsizetype i = 0, j = 0;
+  while(i < generic.size())
+  {
+    if(generic.at(i) == '#')
+    {
+      // One or more digits - always followed by a dot in generic
+      qsizetype digitStart = j;
+      while(j < name.size() && name.at(j).isDigit())
+        j++;
+      if(j == digitStart)
+        return false;
+    }
+    else if(j < name.size() && generic.at(i) == name.at(j))
+      j++;
+    else
+      return false;
+    i++;
+  }
+  return j == name.size();
+}
+
+// ===============================================================================
+// Template
+
 Template::Template(const QString source, const QString sourceName)
-  : QString(source)
 {
   this->sourceName = sourceName;
   this->warnings = false;
+  compiled = QSharedPointer<const CompiledTemplate>(new CompiledTemplate(source, sourceName));
 }
 
 Template::Template(QFile& file, const QStringConverter::Encoding encoding)
@@ -26,128 +306,51 @@ Template::Template(QFile& file, const QStringConverter::Encoding encoding)
   }
   QByteArray data = file.readAll();
   file.close();
+  QString source;
   if(data.size() == 0 || file.error())
   {
     qCritical("Template: cannot read from %s, %s", qPrintable(sourceName), qPrintable(file.errorString()));
   }
   else
   {
-    append(QStringEncoder(encoding).encode(data));
+    source = QStringDecoder(encoding).decode(data);
   }
+  compiled = QSharedPointer<const CompiledTemplate>(new CompiledTemplate(source, sourceName));
+}
+
+Template::Template(QSharedPointer<const CompiledTemplate> compiled, const QString sourceName)
+{
+  this->sourceName = sourceName;
+  this->warnings = false;
+  this->compiled = compiled;
 }
 
 int Template::setVariable(const QString name, const QString value)
 {
-  int count = 0;
-  QString variable = "{" + name + "}";
-  int start = indexOf(variable);
-  while(start >= 0)
+  // First value wins like replacing the tags in the document
+  int count = variables.contains(name) ? 0 : compiled->countVariables(name);
+  if(count > 0)
   {
-    replace(start, variable.length(), value);
-    count++;
-    start = indexOf(variable, start + value.length());
+    variables.insert(name, value);
+    valueSize += value.size() * count;
   }
-  if(count == 0 && warnings)
+  else if(warnings)
   {
-    qWarning("Template: missing variable %s in %s", qPrintable(variable), qPrintable(sourceName));
+    qWarning("Template: missing variable {%s} in %s", qPrintable(name), qPrintable(sourceName));
   }
   return count;
 }
 
 int Template::setCondition(const QString name, const bool value)
 {
-  int count = 0;
-  QString startTag = QStringLiteral("{if %1}").arg(name);
-  QString elseTag = QStringLiteral("{else %1}").arg(name);
-  QString endTag = QStringLiteral("{end %1}").arg(name);
-  // search for if-else-end
-  int start = indexOf(startTag);
-  while(start >= 0)
+  int count = conditions.contains(name) ? 0 : compiled->countConditions(name);
+  if(count > 0)
   {
-    int end = indexOf(endTag, start + startTag.length());
-    if(end >= 0)
-    {
-      count++;
-      int ellse = indexOf(elseTag, start + startTag.length());
-      if(ellse > start && ellse < end)
-      {
-        // there is an else part
-        if(value == true)
-        {
-          QString truePart = mid(start + startTag.length(), ellse - start - startTag.length());
-          replace(start, end - start + endTag.length(), truePart);
-        }
-        else
-        {
-          // value==false
-          QString falsePart = mid(ellse + elseTag.length(), end - ellse - elseTag.length());
-          replace(start, end - start + endTag.length(), falsePart);
-        }
-      }
-      else if(value == true)
-      {
-        // and no else part
-        QString truePart = mid(start + startTag.length(), end - start - startTag.length());
-        replace(start, end - start + endTag.length(), truePart);
-      }
-      else
-      {
-        // value==false and no else part
-        replace(start, end - start + endTag.length(), "");
-      }
-      start = indexOf(startTag, start);
-    }
-    else
-    {
-      qWarning("Template: missing condition end %s in %s", qPrintable(endTag), qPrintable(sourceName));
-    }
+    conditions.insert(name, value);
   }
-  // search for ifnot-else-end
-  QString startTag2 = "{ifnot " + name + "}";
-  start = indexOf(startTag2);
-  while(start >= 0)
+  else if(warnings)
   {
-    int end = indexOf(endTag, start + startTag2.length());
-    if(end >= 0)
-    {
-      count++;
-      int ellse = indexOf(elseTag, start + startTag2.length());
-      if(ellse > start && ellse < end)
-      {
-        // there is an else part
-        if(value == false)
-        {
-          QString falsePart = mid(start + startTag2.length(), ellse - start - startTag2.length());
-          replace(start, end - start + endTag.length(), falsePart);
-        }
-        else
-        {
-          // value==true
-          QString truePart = mid(ellse + elseTag.length(), end - ellse - elseTag.length());
-          replace(start, end - start + endTag.length(), truePart);
-        }
-      }
-      else if(value == false)
-      {
-        // and no else part
-        QString falsePart = mid(start + startTag2.length(), end - start - startTag2.length());
-        replace(start, end - start + endTag.length(), falsePart);
-      }
-      else
-      {
-        // value==true and no else part
-        replace(start, end - start + endTag.length(), "");
-      }
-      start = indexOf(startTag2, start);
-    }
-    else
-    {
-      qWarning("Template: missing condition end %s in %s", qPrintable(endTag), qPrintable(sourceName));
-    }
-  }
-  if(count == 0 && warnings)
-  {
-    qWarning("Template: missing condition %s or %s in %s", qPrintable(startTag), qPrintable(startTag2),
+    qWarning("Template: missing condition {if %s} or {ifnot %s} in %s", qPrintable(name), qPrintable(name),
              qPrintable(sourceName));
   }
   return count;
@@ -156,88 +359,129 @@ int Template::setCondition(const QString name, const bool value)
 int Template::loop(const QString name, const int repetitions)
 {
   Q_ASSERT(repetitions >= 0);
-  int count = 0;
-  QString startTag = "{loop " + name + "}";
-  QString elseTag = "{else " + name + "}";
-  QString endTag = "{end " + name + "}";
-  // search for loop-else-end
-  int start = indexOf(startTag);
-  while(start >= 0)
-  {
-    int end = indexOf(endTag, start + startTag.length());
-    if(end >= 0)
+  int count = loops.contains(name) ? 0 : compiled->countLoops(name);
+  if(count > 0)
+  {
+    loops.insert(name, repetitions);
+  }
+  else if(warnings)
+  {
+    qWarning("Template: missing loop {loop %s} in %s", qPrintable(name), qPrintable(sourceName));
+  }
+  return count;
+}
+
+void Template::enableWarnings(const bool enable)
+{
+  warnings = enable;
+}
+
+QString Template::render() const
+{
+  QString out;
+  out.reserve(compiled->getTextSize() + valueSize);
+
+  LoopScope scope;
+  renderTokens(out, 0, static_cast<int>(compiled->getTokens().size()), scope);
+  return out;
+}
+
+void Template::renderTokens(QString& out, int begin, int end, LoopScope& scope) const
+{
+  const QList<CompiledTemplate::Token>& tokens = compiled->getTokens();
+  int i = begin;
+  while(i < end)
+  {
+    const CompiledTemplate::Token& token = tokens.at(i);
+    switch(token.type)
     {
-      count++;
-      int ellse = indexOf(elseTag, start + startTag.length());
-      if(ellse > start && ellse < end)
-      {
-        // there is an else part
-        if(repetitions > 0)
-        {
-          QString loopPart = mid(start + startTag.length(), ellse - start - startTag.length());
-          QString insertMe;
-          for(int i = 0; i < repetitions; ++i)
-          {
-            // number variables, conditions and sub-loop within the loop
-            QString nameNum = name + QString::number(i);
-            QString s = loopPart;
-            s.replace(QStringLiteral("{%1.").arg(name), QStringLiteral("{%1.").arg(nameNum));
-            s.replace(QStringLiteral("{if %1.").arg(name), QStringLiteral("{if %1.").arg(nameNum));
-            s.replace(QStringLiteral("{ifnot %1.").arg(name), QStringLiteral("{ifnot %1.").arg(nameNum));
-            s.replace(QStringLiteral("{else %1.").arg(name), QStringLiteral("{else %1.").arg(nameNum));
-            s.replace(QStringLiteral("{end %1.").arg(name), QStringLiteral("{end %1.").arg(nameNum));
-            s.replace(QStringLiteral("{loop %1.").arg(name), QStringLiteral("{loop %1.").arg(nameNum));
-            insertMe.append(s);
-          }
-          replace(start, end - start + endTag.length(), insertMe);
-        }
-        else
+      case CompiledTemplate::TEXT:
+        out.append(token.text);
+        i++;
+        break;
+
+      case CompiledTemplate::VARIABLE:
         {
-          // repetitions==0
-          QString elsePart = mid(ellse + elseTag.length(), end - ellse - elseTag.length());
-          replace(start, end - start + endTag.length(), elsePart);
+          QString name = resolveName(token.text, scope);
+          auto it = variables.constFind(name);
+          if(it != variables.constEnd())
+            out.append(it.value());
+          else
+            // Not set - keep tag
+            CompiledTemplate::appendTag(out, token.type, name);
+          i++;
+          break;
         }
-      }
-      else if(repetitions > 0)
-      {
-        // and no else part
-        QString loopPart = mid(start + startTag.length(), end - start - startTag.length());
-        QString insertMe;
-        for(int i = 0; i < repetitions; ++i)
+
+      case CompiledTemplate::IF:
+      case CompiledTemplate::IFNOT:
+      case CompiledTemplate::LOOP:
         {
-          // number variables, conditions and sub-loop within the loop
-          QString nameNum = name + QString::number(i);
-          QString s = loopPart;
-          s.replace(QStringLiteral("{%1.").arg(name), QStringLiteral("{%1.").arg(nameNum));
-          s.replace(QStringLiteral("{if %1.").arg(name), QStringLiteral("{if %1.").arg(nameNum));
-          s.replace(QStringLiteral("{ifnot %1.").arg(name), QStringLiteral("{ifnot %1.").arg(nameNum));
-          s.replace(QStringLiteral("{else %1.").arg(name), QStringLiteral("{else %1.").arg(nameNum));
-          s.replace(QStringLiteral("{end %1.").arg(name), QStringLiteral("{end %1.").arg(nameNum));
-          s.replace(QStringLiteral("{loop %1.").arg(name), QStringLiteral("{loop %1.").arg(nameNum));
-          insertMe.append(s);
+          QString name = resolveName(token.text, scope);
+          int trueEnd = token.elseIndex >= 0 ? token.elseIndex : token.endIndex;
+          bool set, first = false;
+          int repetitions = 0;
+          if(token.type == CompiledTemplate::LOOP)
+          {
+            auto it = loops.constFind(name);
+            set = it != loops.constEnd();
+            repetitions = set ? it.value() : 0;
+            first = repetitions > 0;
+          }
+          else
+          {
+            auto it = conditions.constFind(name);
+            set = it != conditions.constEnd();
+            first = set && it.value() == (token.type == CompiledTemplate::IF);
+          }
+
+          if(!set)
+          {
+            // Not set - keep tags and process both parts
+            CompiledTemplate::appendTag(out, token.type, name);
+            renderTokens(out, i + 1, trueEnd, scope);
+            if(token.elseIndex >= 0)
+            {
+              CompiledTemplate::appendTag(out, CompiledTemplate::ELSE, name);
+              renderTokens(out, token.elseIndex + 1, token.endIndex, scope);
+            }
+            out.append(u"{end ").append(name).append(u'}');
+          }
+          else if(token.type == CompiledTemplate::LOOP && repetitions > 0)
+          {
+            // Number variables, conditions and sub-loops within the loop
+            QString prefix = name + '.';
+            for(int r = 0; r < repetitions; r++)
+            {
+              scope.append(std::make_pair(prefix, name + QString::number(r) + '.'));
+              renderTokens(out, i + 1, trueEnd, scope);
+              scope.removeLast();
+            }
+          }
+          else if(first)
+            renderTokens(out, i + 1, trueEnd, scope);
+          else if(token.elseIndex >= 0)
+            renderTokens(out, token.elseIndex + 1, token.endIndex, scope);
+
+          i = token.endIndex;
+          break;
         }
-        replace(start, end - start + endTag.length(), insertMe);
-      }
-      else
-      {
-        // repetitions==0 and no else part
-        replace(start, end - start + endTag.length(), "");
-      }
-      start = indexOf(startTag, start);
-    }
-    else
-    {
-      qWarning("Template: missing loop end %s in %s", qPrintable(endTag), qPrintable(sourceName));
+
+      case CompiledTemplate::ELSE:
+        // Only reached as block separator which is skipped by the block above
+        i++;
+        break;
     }
   }
-  if(count == 0 && warnings)
-  {
-    qWarning("Template: missing loop %s in %s", qPrintable(startTag), qPrintable(sourceName));
-  }
-  return count;
 }
 
-void Template::enableWarnings(const bool enable)
+QString Template::resolveName(const QString& name, const LoopScope& scope)
 {
-  warnings = enable;
+  QString resolved = name;
+  for(const std::pair<QString, QString>& prefix : scope)
+  {
+    if(resolved.startsWith(prefix.first))
+      resolved = prefix.second + resolved.mid(prefix.first.size());
+  }
+  return resolved;
 }
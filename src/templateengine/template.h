@@ -11,14 +11,121 @@
 #include <QIODevice>
 #include <QFile>
 #include <QString>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
 #include "templateglobal.h"
 
 namespace stefanfrings {
 
 /**
- *  Enhanced version of QString for template processing. Templates
- *  are usually loaded from files, but may also be loaded from
- *  prepared Strings.
+ *  Template source parsed once into a flat list of literal text chunks and tags.
+ *  Blocks like {if name}...{else name}...{end name} are stored as a single token
+ *  which refers to the index of its else separator and to the index behind its end.
+ *  <p>
+ *  Unterminated blocks and tags which are not well-formed are kept as literal text.
+ *  <p>
+ *  Instances are immutable and can be shared between threads.
+ *  @see Template
+ *  @see TemplateCache
+ */
+class DECLSPEC CompiledTemplate
+{
+public:
+  /** Type of a token */
+  enum TokenType : quint8
+  {
+    TEXT, /**< Literal text */
+    VARIABLE, /**< {name} */
+    IF, /**< {if name} */
+    IFNOT, /**< {ifnot name} */
+    LOOP, /**< {loop name} */
+    ELSE /**< {else name} separating the two parts of a block */
+  };
+
+  /** Literal text chunk or tag */
+  struct Token
+  {
+    TokenType type;
+
+    /** Literal text or name of the tag */
+    QString text;
+
+    /** Index of the ELSE token of a block or -1 if there is no else part */
+    int elseIndex;
+
+    /** Index of the first token after a block */
+    int endIndex;
+  };
+
+  /**
+   *  Parse the given template source.
+   *  @param source The template source text
+   *  @param sourceName Name of the source file, used for logging
+   */
+  CompiledTemplate(const QString& source, const QString& sourceName);
+
+  /** Unprocessed template source */
+  const QString& getSource() const
+  {
+    return source;
+  }
+
+  const QList<Token>& getTokens() const
+  {
+    return tokens;
+  }
+
+  /** Total length of all literal text chunks */
+  qsizetype getTextSize() const
+  {
+    return textSize;
+  }
+
+  /** Approximate memory usage in characters of source and all token texts. Used as cost in TemplateCache. */
+  qsizetype getMemorySize() const
+  {
+    return memorySize;
+  }
+
+  /**
+   *  Get the number of tags matching a name as given to Template::setVariable(),
+   *  Template::setCondition() or Template::loop(). Numbered names of loop variables like
+   *  "row0.column1.value" match the tags within loops.
+   */
+  int countVariables(const QString& name) const;
+  int countConditions(const QString& name) const;
+  int countLoops(const QString& name) const;
+
+  /** Append the tag text like "{if name}" for the given token type to out */
+  static void appendTag(QString& out, TokenType type, const QString& name);
+
+private:
+  /**
+   *  Tag names mapped to their number of occurrences. Names of tags within loops
+   *  have the loop index replaced by '#', e.g. "row#.column#.value".
+   */
+  struct TagCounts
+  {
+    QHash<QString, int> plain;
+    QList<std::pair<QString, int> > numbered;
+
+    void add(const QString& generic);
+    int count(const QString& name) const;
+  };
+
+  /** true if name matches generic where '#' matches one or more digits */
+  static bool matchNumbered(const QString& generic, const QString& name);
+
+  QString source;
+  QList<Token> tokens;
+  TagCounts variableCounts, conditionCounts, loopCounts;
+  qsizetype textSize = 0, memorySize = 0;
+};
+
+/**
+ *  Template processing. Templates are usually loaded from files,
+ *  but may also be loaded from prepared Strings.
  *  Example template file:
  *  <p><code><pre>
  *  Hello {username}, how are you?
@@ -84,12 +191,23 @@ namespace stefanfrings {
  *  t.setVariable("row2.column2.value","k");
  *  t.setVariable("row2.column3.value","l");
  *  </pre></code></p>
+ *  <p>
+ *  The template source is compiled once into a CompiledTemplate. The setters only record
+ *  the values and render() produces the document in one pass.
+ *  <p>
+ *  Differences to earlier versions which were derived from QString and replaced tags in place:
+ *  <ul>
+ *  <li>This class is not a QString anymore. Use render() to get the processed document
+ *  and getSource() for the unprocessed source.</li>
+ *  <li>Values are inserted as they are. Tags contained in values of variables are not
+ *  expanded anymore, e.g. a value "{name}" is kept literally even if "name" is set.</li>
+ *  </ul>
+ *  @see CompiledTemplate
  *  @see TemplateLoader
  *  @see TemplateCache
  */
 
-class DECLSPEC Template :
-  public QString
+class DECLSPEC Template
 {
 public:
   /**
@@ -110,6 +228,13 @@ public:
    */
   Template(QFile& file, const QStringConverter::Encoding encoding);
 
+  /**
+   *  Constructor that uses an already compiled template source.
+   *  @param compiled The compiled template, usually shared with TemplateCache
+   *  @param sourceName Name of the source file, used for logging
+   */
+  Template(QSharedPointer<const CompiledTemplate> compiled, const QString sourceName);
+
   /**
    *  Replace a variable by the given value.
    *  Affects tags with the syntax
@@ -119,6 +244,7 @@ public:
    *  After settings the
    *  value of a variable, the variable does not exist anymore,
    *  it it cannot be changed multiple times.
+   *  Variables which are not set are kept as tags in the rendered document.
    *  @param name name of the variable
    *  @param value new value
    *  @return The count of variables that have been processed
@@ -158,12 +284,45 @@ public:
    */
   void enableWarnings(const bool enable = true);
 
+  /**
+   *  Produce the document by inserting all variables, conditions and loops in one pass
+   *  over the compiled template.
+   *  @return The processed document
+   */
+  QString render() const;
+
+  /** Unprocessed template source */
+  const QString& getSource() const
+  {
+    return compiled->getSource();
+  }
+
 private:
+  /** Loop names with trailing dot mapped to the numbered loop names for the current repetition */
+  typedef QList<std::pair<QString, QString> > LoopScope;
+
+  /** Render tokens from begin to end exclusive into out */
+  void renderTokens(QString& out, int begin, int end, LoopScope& scope) const;
+
+  /** Apply the loop numbering of the scope to name */
+  static QString resolveName(const QString& name, const LoopScope& scope);
+
   /** Name of the source file */
   QString sourceName;
 
   /** Enables warnings, if true */
   bool warnings;
+
+  /** Shared compiled source */
+  QSharedPointer<const CompiledTemplate> compiled;
+
+  /** Values given to setVariable(), setCondition() and loop() */
+  QHash<QString, QString> variables;
+  QHash<QString, bool> conditions;
+  QHash<QString, int> loops;
+
+  /** Sum of all variable value lengths to estimate the size of the rendered document */
+  qsizetype valueSize = 0;
 };
 
 } // end of namespace
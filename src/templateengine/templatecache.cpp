@@ -20,23 +20,27 @@ TemplateCache::~TemplateCache()
 }
 
 QString TemplateCache::tryFile(const QString localizedName)
+{
+  QSharedPointer<const CompiledTemplate> document = tryCompiled(localizedName);
+  return document.isNull() ? QString() : document->getSource();
+}
+
+QSharedPointer<const CompiledTemplate> TemplateCache::tryCompiled(const QString localizedName)
 {
   qint64 now = QDateTime::currentMSecsSinceEpoch();
-  mutex.lock();
+  QMutexLocker locker(&mutex);
   // search in cache
   qDebug("TemplateCache: trying cached %s", qPrintable(localizedName));
   CacheEntry *entry = cache.object(localizedName);
   if(entry && (cacheTimeout == 0 || entry->created > now - cacheTimeout))
   {
-    mutex.unlock();
     return entry->document;
   }
-  // search on filesystem
+  // search on filesystem and compile once
   entry = new CacheEntry();
   entry->created = now;
-  entry->document = TemplateLoader::tryFile(localizedName);
+  entry->document = TemplateLoader::tryCompiled(localizedName);
   // Store in cache even when the file did not exist, to remember that there is no such file
-  cache.insert(localizedName, entry, entry->document.size());
-  mutex.unlock();
+  cache.insert(localizedName, entry, entry->document.isNull() ? 0 : entry->document->getMemorySize());
   return entry->document;
 }
@@ -38,6 +38,10 @@ namespace stefanfrings {
  *  settings are in the registry, the path is relative to the current working directory.
  *  <p>
  *  Files are cached as long as possible, when cacheTime=0.
+ *  <p>
+ *  Templates are cached in compiled form, so the source is parsed only once
+ *  and each request only renders the shared CompiledTemplate.
+ *  The cache size is counted in characters of the source and the compiled tokens.
  *  @see TemplateLoader
  */
 
@@ -69,10 +73,18 @@ protected:
    */
   virtual QString tryFile(const QString localizedName) override;
 
+  /**
+   *  Try to get a compiled template from cache or filesystem.
+   *  @param localizedName Name of the template with locale to find
+   *  @return The compiled template, or null if not found
+   */
+  virtual QSharedPointer<const CompiledTemplate> tryCompiled(const QString localizedName) override;
+
 private:
   struct CacheEntry
   {
-    QString document;
+    /** Null if the file does not exist */
+    QSharedPointer<const CompiledTemplate> document;
     qint64 created;
   };
 
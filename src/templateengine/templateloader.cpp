@@ -56,6 +56,16 @@ QString TemplateLoader::tryFile(QString localizedName)
   return "";
 }
 
+QSharedPointer<const CompiledTemplate> TemplateLoader::tryCompiled(const QString localizedName)
+{
+  QString document = tryFile(localizedName);
+  if(document.isEmpty())
+  {
+    return QSharedPointer<const CompiledTemplate>();
+  }
+  return QSharedPointer<const CompiledTemplate>(new CompiledTemplate(document, localizedName));
+}
+
 Template TemplateLoader::getTemplate(QString templateName, QString locales)
 {
   QSet<QString> tried; // used to suppress duplicate attempts
@@ -70,8 +80,8 @@ Template TemplateLoader::getTemplate(QString templateName, QString locales)
     QString localizedName = templateName + "-" + loc.trimmed();
     if(!tried.contains(localizedName))
     {
-      QString document = tryFile(localizedName);
-      if(!document.isEmpty())
+      QSharedPointer<const CompiledTemplate> document = tryCompiled(localizedName);
+      if(!document.isNull())
       {
         return Template(document, localizedName);
       }
@@ -86,8 +96,8 @@ Template TemplateLoader::getTemplate(QString templateName, QString locales)
     QString localizedName = templateName + "-" + loc.trimmed();
     if(!tried.contains(localizedName))
     {
-      QString document = tryFile(localizedName);
-      if(!document.isEmpty())
+      QSharedPointer<const CompiledTemplate> document = tryCompiled(localizedName);
+      if(!document.isNull())
       {
         return Template(document, localizedName);
       }
@@ -96,8 +106,8 @@ Template TemplateLoader::getTemplate(QString templateName, QString locales)
   }
 
   // Search for default file
-  QString document = tryFile(templateName);
-  if(!document.isEmpty())
+  QSharedPointer<const CompiledTemplate> document = tryCompiled(templateName);
+  if(!document.isNull())
   {
     return Template(document, templateName);
   }
@@ -69,6 +69,14 @@ protected:
    */
   virtual QString tryFile(const QString localizedName);
 
+  /**
+   *  Try to get a compiled template from cache or filesystem.
+   *  The default implementation compiles the result of tryFile() on each call.
+   *  @param localizedName Name of the template with locale to find
+   *  @return The compiled template, or null if not found
+   */
+  virtual QSharedPointer<const CompiledTemplate> tryCompiled(const QString localizedName);
+
   /** Directory where the templates are searched */
   QString templatePath;
 
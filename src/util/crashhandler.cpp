@@ -43,6 +43,8 @@ extern "C"
 }
 #endif
 
+#include "logging/logginghandler.h"
+
 #include <cpptrace/cpptrace.hpp>
 #include <sstream>
 #include <string>
@@ -60,6 +62,9 @@ static void setSignalHandler();
 
 static QByteArray stacktraceFilename;
 static const int SIGNAL_STACK_SIZE = 1024 * 1024;
+
+/* Maximum wait time for writing queued log messages */
+static const int LOG_FLUSH_TIMEOUT_MS = 500;
 #endif
 
 void init()
@@ -315,6 +320,10 @@ static LONG WINAPI windowsExceptionFilter(EXCEPTION_POINTERS *ExceptionInfo)
   printSignalMessage(filehandle, "windowsExceptionFilter exit\n");
   closeSignalOutput(filehandle);
 
+  // Not safe in this context but queued messages are lost otherwise. Done after writing the stack trace
+  // since this can block until timeout or crash again if a lock is held by the crashed thread.
+  atools::logging::LoggingHandler::flush(LOG_FLUSH_TIMEOUT_MS);
+
   return EXCEPTION_EXECUTE_HANDLER;
 }
 
@@ -423,6 +432,10 @@ static void posixSignalHandler(int sig, siginfo_t *siginfo, void *context)
   printSignalMessage(filehandle, " exit\n");
   closeSignalOutput(filehandle);
 
+  // Not signal safe but queued messages are lost otherwise. Done after writing the stack trace
+  // since this can block until timeout or crash again if a lock is held by the crashed thread.
+  atools::logging::LoggingHandler::flush(LOG_FLUSH_TIMEOUT_MS);
+
   exit(EXIT_FAILURE);
 }
 
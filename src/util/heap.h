@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <functional>
 #include <queue>
+#include <vector>
 
 namespace atools {
 namespace util {
@@ -121,6 +122,160 @@ private:
   std::vector<HeapNode> heap;
 };
 
+/*
+ * Binary min heap for integer keys in a limited range like node indexes.
+ * Keeps the heap position for each key which allows contains() in O(1) and
+ * changeOrPush() in O(log n) instead of the linear search in Heap.
+ *
+ * Call reset() before use to define the key range.
+ */
+template<typename COST>
+class IndexedHeap
+{
+public:
+  IndexedHeap(int reserve)
+  {
+    heap.reserve(reserve);
+  }
+
+  /* Remove all elements and set the allowed key range from -keyOffset to numKeys - keyOffset - 1 */
+  void reset(int numKeys, int keyOffset = 0);
+
+  /* Take the key from the top of the heap. This will be the one with the lowest cost assigned */
+  int popData();
+
+  /* Add key which must not be contained already */
+  void pushData(int key, COST cost)
+  {
+    heap.push_back({key, cost});
+    position(key) = static_cast<int>(heap.size()) - 1;
+    siftUp(static_cast<int>(heap.size()) - 1);
+  }
+
+  bool contains(int key) const
+  {
+    return positions.at(static_cast<size_t>(key + keyOffset)) != -1;
+  }
+
+  /* Update the costs of a key if it exists or add it otherwise */
+  void changeOrPush(int key, COST cost);
+
+  bool isEmpty() const
+  {
+    return heap.empty();
+  }
+
+  int size() const
+  {
+    return static_cast<int>(heap.size());
+  }
+
+private:
+  struct HeapNode
+  {
+    int key;
+    COST cost;
+  };
+
+  int& position(int key)
+  {
+    return positions[static_cast<size_t>(key + keyOffset)];
+  }
+
+  /* Swap two heap entries and update the position map */
+  void swapNodes(int pos1, int pos2)
+  {
+    std::swap(heap[static_cast<size_t>(pos1)], heap[static_cast<size_t>(pos2)]);
+    position(heap[static_cast<size_t>(pos1)].key) = pos1;
+    position(heap[static_cast<size_t>(pos2)].key) = pos2;
+  }
+
+  void siftUp(int pos);
+  void siftDown(int pos);
+
+  std::vector<HeapNode> heap;
+
+  /* Maps key plus offset to heap position or -1 if not contained */
+  std::vector<int> positions;
+  int keyOffset = 0;
+};
+
+template<typename COST>
+void IndexedHeap<COST>::reset(int numKeys, int keyOffset)
+{
+  heap.clear();
+  positions.assign(static_cast<size_t>(numKeys), -1);
+  this->keyOffset = keyOffset;
+}
+
+template<typename COST>
+int IndexedHeap<COST>::popData()
+{
+  int key = heap.front().key;
+  swapNodes(0, static_cast<int>(heap.size()) - 1);
+  heap.pop_back();
+  position(key) = -1;
+
+  if(!heap.empty())
+    siftDown(0);
+  return key;
+}
+
+template<typename COST>
+void IndexedHeap<COST>::changeOrPush(int key, COST cost)
+{
+  int pos = position(key);
+  if(pos != -1)
+  {
+    COST oldCost = heap[static_cast<size_t>(pos)].cost;
+    heap[static_cast<size_t>(pos)].cost = cost;
+
+    if(cost < oldCost)
+      siftUp(pos);
+    else if(cost > oldCost)
+      siftDown(pos);
+  }
+  else
+    pushData(key, cost);
+}
+
+template<typename COST>
+void IndexedHeap<COST>::siftUp(int pos)
+{
+  while(pos > 0)
+  {
+    int parent = (pos - 1) / 2;
+    if(heap[static_cast<size_t>(pos)].cost < heap[static_cast<size_t>(parent)].cost)
+    {
+      swapNodes(pos, parent);
+      pos = parent;
+    }
+    else
+      break;
+  }
+}
+
+template<typename COST>
+void IndexedHeap<COST>::siftDown(int pos)
+{
+  int num = static_cast<int>(heap.size());
+  while(true)
+  {
+    int smallest = pos, left = 2 * pos + 1, right = left + 1;
+
+    if(left < num && heap[static_cast<size_t>(left)].cost < heap[static_cast<size_t>(smallest)].cost)
+      smallest = left;
+    if(right < num && heap[static_cast<size_t>(right)].cost < heap[static_cast<size_t>(smallest)].cost)
+      smallest = right;
+
+    if(smallest == pos)
+      break;
+
+    swapNodes(pos, smallest);
+    pos = smallest;
+  }
+}
+
 template<typename TYPE, typename COST>
 COST Heap<TYPE, COST>::pop(TYPE& data)
 {